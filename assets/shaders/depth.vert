@@ -0,0 +1,57 @@
+#version 460
+
+// position stream only, see VertexStream in vertex_format.h
+layout (location = 0) in vec3 inPosition;
+
+// camera ubo
+layout (binding = 0) uniform CameraUniforms
+{
+    mat4 view;
+    mat4 proj;
+} camera;
+
+struct InstanceData
+{
+    mat4 transform;
+    uint materialIndex;
+    uint meshIndex;
+    uint drawIndex;
+    uint padding;
+};
+
+layout (std430, binding = 2) readonly buffer Instances
+{
+    InstanceData instances[];
+};
+
+// instances that survived culling, indexed by gl_InstanceIndex (includes
+// firstInstance)
+layout (std430, binding = 4) readonly buffer VisibleInstances
+{
+    uint visibleInstances[];
+};
+
+struct DrawData
+{
+    vec4 positionScale;
+    vec4 positionOffset;
+};
+
+// per draw dequantization, indirect draws add gl_DrawID to the offset
+layout (std430, binding = 3) readonly buffer Draws
+{
+    DrawData draws[];
+};
+
+layout (push_constant) uniform DrawConstants
+{
+    uint drawOffset;
+} constants;
+
+void main ()
+{
+    DrawData draw = draws[constants.drawOffset + gl_DrawID];
+    vec3 position = inPosition * draw.positionScale.xyz + draw.positionOffset.xyz;
+    mat4 model = instances[visibleInstances[gl_InstanceIndex]].transform;
+    gl_Position = camera.proj * camera.view * model * vec4 (position, 1.0);
+}
@@ -0,0 +1,78 @@
+// Workgroup wide prefix sum shared by the parallel primitives, see
+// GpuPrimitives in gpu_primitives.h. Defining USE_SUBGROUPS before the
+// include scans within subgroups first, which needs the subgroup
+// arithmetic operations in compute shaders.
+
+#define SCAN_GROUP_SIZE 256
+
+#ifdef USE_SUBGROUPS
+
+#extension GL_KHR_shader_subgroup_arithmetic : require
+
+// one total per subgroup, sized for the smallest possible subgroups
+shared uint scanSubgroupSums[SCAN_GROUP_SIZE];
+shared uint scanTotal;
+
+// exclusive prefix sum of one value per invocation, total is the sum over
+// the workgroup. Called from uniform control flow
+uint WorkgroupExclusiveScan(uint value, out uint total)
+{
+    // an earlier call may still be reading the shared sums
+    barrier();
+
+    uint inclusive = subgroupInclusiveAdd(value);
+    if (gl_SubgroupInvocationID == gl_SubgroupSize - 1u) {
+        scanSubgroupSums[gl_SubgroupID] = inclusive;
+    }
+    barrier();
+
+    // the first subgroup scans the subgroup totals, in chunks when there
+    // are more subgroups than it has invocations
+    if (gl_SubgroupID == 0u) {
+        uint carry = 0u;
+        for (uint base = 0u; base < gl_NumSubgroups; base += gl_SubgroupSize) {
+            uint i = base + gl_SubgroupInvocationID;
+            uint sum = i < gl_NumSubgroups ? scanSubgroupSums[i] : 0u;
+            uint scanned = subgroupExclusiveAdd(sum) + carry;
+            if (i < gl_NumSubgroups) {
+                scanSubgroupSums[i] = scanned;
+            }
+            carry += subgroupAdd(sum);
+        }
+        if (gl_SubgroupInvocationID == 0u) {
+            scanTotal = carry;
+        }
+    }
+    barrier();
+
+    total = scanTotal;
+    return scanSubgroupSums[gl_SubgroupID] + inclusive - value;
+}
+
+#else
+
+shared uint scanValues[SCAN_GROUP_SIZE];
+
+// exclusive prefix sum of one value per invocation, total is the sum over
+// the workgroup. Called from uniform control flow
+uint WorkgroupExclusiveScan(uint value, out uint total)
+{
+    uint id = gl_LocalInvocationID.x;
+
+    // an earlier call may still be reading the shared values
+    barrier();
+    scanValues[id] = value;
+    barrier();
+
+    for (uint offset = 1u; offset < gl_WorkGroupSize.x; offset <<= 1) {
+        uint other = id >= offset ? scanValues[id - offset] : 0u;
+        barrier();
+        scanValues[id] += other;
+        barrier();
+    }
+
+    total = scanValues[gl_WorkGroupSize.x - 1u];
+    return scanValues[id] - value;
+}
+
+#endif
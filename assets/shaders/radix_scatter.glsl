@@ -0,0 +1,93 @@
+// One pass of the key value radix sort. Every block sorts its elements by
+// the pass digit in shared memory with one split per bit, which keeps the
+// order of equal digits, then writes them after the elements of the same
+// digit from earlier blocks.
+
+layout (local_size_x = SCAN_GROUP_SIZE) in;
+
+const uint RADIX_BITS = 4u;
+const uint RADIX_DIGITS = 16u;
+
+layout (std430, binding = 0) readonly buffer Keys
+{
+    uint keys[];
+};
+
+layout (std430, binding = 1) readonly buffer Values
+{
+    uint values[];
+};
+
+layout (std430, binding = 2) readonly buffer Offsets
+{
+    uint offsets[];
+};
+
+layout (std430, binding = 3) writeonly buffer SortedKeys
+{
+    uint sortedKeys[];
+};
+
+layout (std430, binding = 4) writeonly buffer SortedValues
+{
+    uint sortedValues[];
+};
+
+layout (push_constant) uniform RadixConstants
+{
+    uint count;
+    uint shift;
+    uint blockCount;
+    uint digitMask;  // fewer bits in a last pass past the key bits
+} params;
+
+shared uint blockKeys[SCAN_GROUP_SIZE];
+shared uint blockValues[SCAN_GROUP_SIZE];
+shared uint digitStarts[RADIX_DIGITS];
+
+void main ()
+{
+    uint id = gl_LocalInvocationID.x;
+    uint index = gl_GlobalInvocationID.x;
+    uint groupSize = gl_WorkGroupSize.x;
+    uint validCount = min(groupSize, params.count - gl_WorkGroupID.x * groupSize);
+
+    // elements past the end take the highest digit, so they sort behind
+    // every real element and are never written
+    uint key = index < params.count ? keys[index] : 0xFFFFFFFFu;
+    uint value = index < params.count ? values[index] : 0u;
+
+    for (uint bit = 0; bit < RADIX_BITS; ++bit) {
+        // the same for every invocation, so the barriers stay uniform
+        if ((params.digitMask & (1u << bit)) == 0u) {
+            continue;
+        }
+        uint bitSet = (key >> (params.shift + bit)) & 1u;
+        uint setCount;
+        uint setBefore = WorkgroupExclusiveScan(bitSet, setCount);
+        uint destination = bitSet != 0u ? groupSize - setCount + setBefore
+                                        : id - setBefore;
+
+        blockKeys[destination] = key;
+        blockValues[destination] = value;
+        barrier();
+        key = blockKeys[id];
+        value = blockValues[id];
+        barrier();
+    }
+
+    uint digit = (key >> params.shift) & params.digitMask;
+    uint previous = id > 0u ? (blockKeys[id - 1] >> params.shift) & params.digitMask
+                           : RADIX_DIGITS;
+    if (digit != previous) {
+        digitStarts[digit] = id;
+    }
+    barrier();
+
+    if (id < validCount) {
+        uint destination = offsets[digit * params.blockCount + gl_WorkGroupID.x] +
+                           id - digitStarts[digit];
+        sortedKeys[destination] = key;
+        sortedValues[destination] = value;
+    }
+}
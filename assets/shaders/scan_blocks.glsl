@@ -0,0 +1,58 @@
+// Scans one block of SCAN_BLOCK_SIZE elements per workgroup and writes the
+// block totals, which the next level scans in turn. The scanned totals are
+// added back by scan_add.comp.
+
+layout (local_size_x = SCAN_GROUP_SIZE) in;
+
+layout (constant_id = 0) const bool INCLUSIVE = false;
+
+const uint ITEMS_PER_INVOCATION = 4u;
+
+layout (std430, binding = 0) readonly buffer Input
+{
+    uint inputValues[];
+};
+
+layout (std430, binding = 1) writeonly buffer Output
+{
+    uint outputValues[];
+};
+
+layout (std430, binding = 2) writeonly buffer BlockSums
+{
+    uint blockSums[];
+};
+
+layout (push_constant) uniform ScanConstants
+{
+    uint count;
+    uint writeBlockSums; // 0 for the last level, a single block
+} params;
+
+void main ()
+{
+    uint base = gl_GlobalInvocationID.x * ITEMS_PER_INVOCATION;
+
+    uint values[ITEMS_PER_INVOCATION];
+    uint sum = 0u;
+    for (uint i = 0u; i < ITEMS_PER_INVOCATION; ++i) {
+        uint index = base + i;
+        values[i] = index < params.count ? inputValues[index] : 0u;
+        sum += values[i];
+    }
+
+    uint total;
+    uint running = WorkgroupExclusiveScan(sum, total);
+
+    for (uint i = 0u; i < ITEMS_PER_INVOCATION; ++i) {
+        uint index = base + i;
+        if (index < params.count) {
+            outputValues[index] = INCLUSIVE ? running + values[i] : running;
+        }
+        running += values[i];
+    }
+
+    if (params.writeBlockSums != 0u && gl_LocalInvocationID.x == 0u) {
+        blockSums[gl_WorkGroupID.x] = total;
+    }
+}
@@ -1,35 +1,91 @@
 #version 450
+#extension GL_EXT_nonuniform_qualifier : require
 
 layout (location = 0) in vec3 fragColor;
 layout (location = 1) in vec3 fragNormal;
 layout (location = 2) in vec3 fragPosition;
 layout (location = 3) in vec2 fragUV;
+layout (location = 4) flat in uint fragMaterialIndex;
 
 layout (location = 0) out vec4 outColor;
 
-layout (binding = 1) uniform sampler2D texSampler;
+// bindless texture table, only slots handed out by Uniforms::AddTexture
+// are written
+layout (binding = 1) uniform sampler2D textures[];
 
-// Directional light properties
-const vec3 lightDir = normalize(vec3(1.0, 3.0, -2.0)); // Direction towards the light
-const vec3 lightColor = vec3(1.0, 1.0, 1.0); // White light
-const float ambientStrength = 0.1;
+// texture index of a missing texture
+const uint NO_TEXTURE = 0xFFFFFFFFu;
+
+struct MaterialData
+{
+    vec4 baseColor;
+    vec3 emissive;
+    float roughness;
+    float metallic;
+    float normalScale;
+    float occlusionStrength;
+    uint albedoTexture;
+    uint normalTexture;
+    uint roughnessTexture;
+    uint metallicTexture;
+    uint occlusionTexture;
+};
+
+layout (std430, binding = 5) readonly buffer Materials
+{
+    MaterialData materials[];
+};
+
+// Specialized by the pipeline, see braque/specialization.h. Loops and
+// branches on them are folded away by the driver
+layout (constant_id = 0) const uint LIGHT_COUNT = 1;
+layout (constant_id = 1) const float AMBIENT_STRENGTH = 0.1;
+layout (constant_id = 2) const bool ALBEDO_TEXTURES = true;
+layout (constant_id = 3) const bool OCCLUSION_TEXTURES = true;
+
+// Directional lights, the first LIGHT_COUNT are used
+const uint MAX_LIGHTS = 4;
+const vec3 lightDirs[MAX_LIGHTS] = vec3[](
+    normalize(vec3(1.0, 3.0, -2.0)),
+    normalize(vec3(-2.0, 1.0, 1.0)),
+    normalize(vec3(0.0, -1.0, 0.0)),
+    normalize(vec3(1.0, 0.5, 3.0)));
+const vec3 lightColors[MAX_LIGHTS] = vec3[](
+    vec3(1.0, 1.0, 1.0),
+    vec3(0.3, 0.35, 0.4),
+    vec3(0.15, 0.12, 0.1),
+    vec3(0.2, 0.2, 0.2));
+const vec3 ambientColor = vec3(1.0, 1.0, 1.0);
 
 void main () {
     // Normalize the fragment normal
     vec3 norm = normalize(fragNormal);
 
     // Calculate diffuse lighting
-    float diff = max(dot(norm, -lightDir), 0.0);
-    vec3 diffuse = diff * lightColor;
+    vec3 diffuse = vec3(0.0);
+    for (uint i = 0; i < min(LIGHT_COUNT, MAX_LIGHTS); ++i) {
+        diffuse += max(dot(norm, -lightDirs[i]), 0.0) * lightColors[i];
+    }
 
     // Calculate ambient lighting
-    vec3 ambient = ambientStrength * lightColor;
+    vec3 ambient = AMBIENT_STRENGTH * ambientColor;
+
+    MaterialData material = materials[fragMaterialIndex];
+
+    // Sample the albedo texture, scaled by the base color
+    vec3 texColor = material.baseColor.rgb;
+    if (ALBEDO_TEXTURES && material.albedoTexture != NO_TEXTURE) {
+        texColor *= texture(textures[nonuniformEXT(material.albedoTexture)], fragUV).rgb;
+    }
 
-    // Sample the texture
-    vec3 texColor = texture(texSampler, fragUV).rgb;
+    // ambient occlusion only darkens the ambient term
+    if (OCCLUSION_TEXTURES && material.occlusionTexture != NO_TEXTURE) {
+        float occlusion = texture(textures[nonuniformEXT(material.occlusionTexture)], fragUV).r;
+        ambient *= mix(1.0, occlusion, material.occlusionStrength);
+    }
 
     // Combine lighting with texture and vertex color
-    vec3 result = (ambient + diffuse) * texColor;
+    vec3 result = (ambient + diffuse) * texColor + material.emissive;
 
     outColor = vec4(result, 1.0);
 }
\ No newline at end of file
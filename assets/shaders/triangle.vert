@@ -12,16 +12,44 @@ layout (binding = 0) uniform CameraUniforms
     mat4 proj;
 } camera;
 
+struct InstanceData
+{
+    mat4 transform;
+    uint materialIndex;
+    uint meshIndex;
+    uint drawIndex;
+    uint padding;
+};
+
+layout (std430, binding = 2) readonly buffer Instances
+{
+    InstanceData instances[];
+};
+
+// instances that survived culling, indexed by gl_InstanceIndex (includes
+// firstInstance)
+layout (std430, binding = 4) readonly buffer VisibleInstances
+{
+    uint visibleInstances[];
+};
+
 layout (location = 0) out vec3 fragColor;
 layout (location = 1) out vec3 fragNormal;
 layout (location = 2) out vec3 fragPosition;
 layout (location = 3) out vec2 fragUV;
+layout (location = 4) flat out uint fragMaterialIndex;
 
 void main ()
 {
-    gl_Position = camera.proj * camera.view * vec4 (inPosition, 1.0);
+    InstanceData instance = instances[visibleInstances[gl_InstanceIndex]];
+    mat4 model = instance.transform;
+    vec4 worldPosition = model * vec4 (inPosition, 1.0);
+
+    gl_Position = camera.proj * camera.view * worldPosition;
     fragColor = inColor;
-    fragNormal = inNormal;
-    fragPosition = inPosition;
+    // assumes uniform scale
+    fragNormal = mat3 (model) * inNormal;
+    fragPosition = worldPosition.xyz;
     fragUV = inUV;
+    fragMaterialIndex = instance.materialIndex;
 }
\ No newline at end of file
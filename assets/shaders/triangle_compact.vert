@@ -0,0 +1,84 @@
+#version 460
+
+// compact vertex layout, see VertexLayout in vertex_format.h
+layout (location = 0) in vec3 inPosition; // unorm16 or float16
+layout (location = 1) in vec2 inNormal;   // octahedral snorm16
+layout (location = 2) in vec4 inColor;    // rgba8 unorm
+layout (location = 3) in vec2 inUV;       // float16
+
+// camera ubo
+layout (binding = 0) uniform CameraUniforms
+{
+    mat4 view;
+    mat4 proj;
+} camera;
+
+struct InstanceData
+{
+    mat4 transform;
+    uint materialIndex;
+    uint meshIndex;
+    uint drawIndex;
+    uint padding;
+};
+
+layout (std430, binding = 2) readonly buffer Instances
+{
+    InstanceData instances[];
+};
+
+// instances that survived culling, indexed by gl_InstanceIndex (includes
+// firstInstance)
+layout (std430, binding = 4) readonly buffer VisibleInstances
+{
+    uint visibleInstances[];
+};
+
+struct DrawData
+{
+    vec4 positionScale;
+    vec4 positionOffset;
+};
+
+// per draw dequantization, indirect draws add gl_DrawID to the offset
+layout (std430, binding = 3) readonly buffer Draws
+{
+    DrawData draws[];
+};
+
+layout (push_constant) uniform DrawConstants
+{
+    uint drawOffset;
+} constants;
+
+layout (location = 0) out vec3 fragColor;
+layout (location = 1) out vec3 fragNormal;
+layout (location = 2) out vec3 fragPosition;
+layout (location = 3) out vec2 fragUV;
+layout (location = 4) flat out uint fragMaterialIndex;
+
+vec3 decodeOctahedral (vec2 e)
+{
+    vec3 n = vec3(e.xy, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.xy += mix(vec2(t), vec2(-t), greaterThanEqual(n.xy, vec2(0.0)));
+    return normalize(n);
+}
+
+void main ()
+{
+    DrawData draw = draws[constants.drawOffset + gl_DrawID];
+    vec3 position = inPosition * draw.positionScale.xyz + draw.positionOffset.xyz;
+
+    InstanceData instance = instances[visibleInstances[gl_InstanceIndex]];
+    mat4 model = instance.transform;
+    vec4 worldPosition = model * vec4 (position, 1.0);
+
+    gl_Position = camera.proj * camera.view * worldPosition;
+    fragColor = inColor.rgb;
+    // assumes uniform scale
+    fragNormal = mat3 (model) * decodeOctahedral(inNormal);
+    fragPosition = worldPosition.xyz;
+    fragUV = inUV;
+    fragMaterialIndex = instance.materialIndex;
+}
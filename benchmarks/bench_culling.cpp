@@ -0,0 +1,83 @@
+// benchmarks/bench_culling.cpp
+#include <benchmark/benchmark.h>
+
+#include "braque/job_system.h"
+#include "braque/sphere_bounds.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <random>
+#include <string>
+
+namespace {
+
+auto MakeFrustum() -> braque::Frustum {
+  const auto view = glm::lookAt(glm::vec3(0, 0, 0), glm::vec3(0, 0, -1),
+                                glm::vec3(0, 1, 0));
+  const auto proj = glm::perspective(glm::radians(60.0F), 16.0F / 9.0F,
+                                     0.1F, 500.0F);
+  return braque::ExtractFrustum(proj * view);
+}
+
+// spheres scattered around the camera so plane tests do not all agree
+auto MakeBounds(size_t count) -> braque::SphereBounds {
+  std::mt19937 rng(42);
+  std::uniform_real_distribution<float> position(-500.0F, 500.0F);
+  std::uniform_real_distribution<float> radius(0.5F, 10.0F);
+
+  braque::SphereBounds bounds;
+  bounds.Resize(count);
+  for (size_t i = 0; i < count; ++i) {
+    bounds.Set(i, glm::vec3(position(rng), position(rng), position(rng)),
+               radius(rng));
+  }
+  return bounds;
+}
+
+void BM_CullSpheresScalar(benchmark::State& state) {
+  const auto frustum = MakeFrustum();
+  const auto bounds = MakeBounds(static_cast<size_t>(state.range(0)));
+  std::vector<uint8_t> visible(bounds.Size());
+
+  for (auto _ : state) {
+    braque::CullSpheresScalar(frustum, bounds, visible);
+    benchmark::DoNotOptimize(visible.data());
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_CullSpheresSimd(benchmark::State& state) {
+  const auto frustum = MakeFrustum();
+  const auto bounds = MakeBounds(static_cast<size_t>(state.range(0)));
+  std::vector<uint8_t> visible(bounds.Size());
+
+  for (auto _ : state) {
+    braque::CullSpheres(frustum, bounds, visible);
+    benchmark::DoNotOptimize(visible.data());
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  state.SetLabel(std::to_string(braque::GetCullLaneCount()) + " lanes");
+}
+
+void BM_CullSpheresParallel(benchmark::State& state) {
+  const auto frustum = MakeFrustum();
+  const auto bounds = MakeBounds(static_cast<size_t>(state.range(0)));
+  std::vector<uint8_t> visible(bounds.Size());
+  braque::JobSystem jobs;
+
+  for (auto _ : state) {
+    braque::CullSpheres(jobs, frustum, bounds, visible);
+    benchmark::DoNotOptimize(visible.data());
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  state.SetLabel(std::to_string(jobs.GetWorkerCount() + 1) + " threads");
+}
+
+}  // namespace
+
+BENCHMARK(BM_CullSpheresScalar)->Arg(10'000)->Arg(100'000)->Arg(1'000'000);
+BENCHMARK(BM_CullSpheresSimd)->Arg(10'000)->Arg(100'000)->Arg(1'000'000);
+BENCHMARK(BM_CullSpheresParallel)->Arg(10'000)->Arg(100'000)->Arg(1'000'000);
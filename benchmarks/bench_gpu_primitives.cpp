@@ -0,0 +1,279 @@
+// benchmarks/bench_gpu_primitives.cpp
+#include <benchmark/benchmark.h>
+
+#include "braque/buffer.h"
+#include "braque/descriptor_allocator.h"
+#include "braque/engine_context.h"
+#include "braque/gpu_primitives.h"
+#include "braque/job_system.h"
+#include "braque/memory_allocator.h"
+#include "braque/renderer.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <functional>
+#include <numeric>
+#include <random>
+#include <vector>
+
+namespace {
+
+constexpr uint32_t kMaxCount = 1U << 24;
+
+// a device and the primitives, shared by every benchmark since creating
+// them takes far longer than any run
+struct GpuContext {
+  braque::Renderer renderer;
+  braque::MemoryAllocator allocator{renderer};
+  braque::JobSystem jobs{1};
+  braque::EngineContext engine{allocator, renderer, jobs};
+  braque::DescriptorSetCache descriptors{renderer.getDevice(), 1};
+  braque::GpuPrimitives primitives{engine, descriptors, kMaxCount};
+
+  vk::QueryPool timestamps;
+  vk::CommandBuffer commands = renderer.CreateCommandBuffer();
+
+  GpuContext() {
+    vk::QueryPoolCreateInfo poolInfo{};
+    poolInfo.setQueryType(vk::QueryType::eTimestamp);
+    poolInfo.setQueryCount(2);
+    timestamps = renderer.getDevice().createQueryPool(poolInfo);
+  }
+
+  ~GpuContext() { renderer.getDevice().destroyQueryPool(timestamps); }
+
+  GpuContext(const GpuContext&) = delete;
+  auto operator=(const GpuContext&) -> GpuContext& = delete;
+
+  // fills a device local buffer, for the inputs of the runs
+  void Upload(braque::Buffer& destination, const std::vector<uint32_t>& data) {
+    braque::Buffer staging(engine, braque::BufferType::staging,
+                           destination.GetSize());
+    staging.CopyData(data.data(), data.size() * sizeof(uint32_t));
+
+    commands.begin(vk::CommandBufferBeginInfo{});
+    staging.CopyToBuffer(commands, destination);
+    commands.end();
+    renderer.SubmitAndWait(commands);
+  }
+
+  // reads back the first count elements of a buffer the primitives wrote
+  auto Download(const braque::Buffer& source, uint32_t count)
+      -> std::vector<uint32_t> {
+    const auto size = count * sizeof(uint32_t);
+    braque::Buffer readback(engine, braque::BufferType::readback, size);
+
+    commands.begin(vk::CommandBufferBeginInfo{});
+    braque::InsertMemoryBarrier(commands,
+                                vk::PipelineStageFlagBits2::eComputeShader,
+                                vk::AccessFlagBits2::eShaderWrite,
+                                vk::PipelineStageFlagBits2::eCopy,
+                                vk::AccessFlagBits2::eTransferRead);
+    commands.copyBuffer(source.GetBuffer(), readback.GetBuffer(),
+                        vk::BufferCopy{0, 0, size});
+    braque::InsertMemoryBarrier(commands, vk::PipelineStageFlagBits2::eCopy,
+                                vk::AccessFlagBits2::eTransferWrite,
+                                vk::PipelineStageFlagBits2::eHost,
+                                vk::AccessFlagBits2::eHostRead);
+    commands.end();
+    renderer.SubmitAndWait(commands);
+
+    vmaInvalidateAllocation(allocator.getAllocator(), readback.GetAllocation(),
+                            0, VK_WHOLE_SIZE);
+    std::vector<uint32_t> data(count);
+    std::memcpy(data.data(), readback.GetPointer<uint32_t>(), size);
+    return data;
+  }
+
+  // seconds the GPU spent on the recorded work
+  auto Time(const std::function<void(vk::CommandBuffer)>& record) -> double {
+    descriptors.BeginFrame(0);
+
+    commands.begin(vk::CommandBufferBeginInfo{});
+    commands.resetQueryPool(timestamps, 0, 2);
+    commands.writeTimestamp2KHR(vk::PipelineStageFlagBits2::eAllCommands,
+                                timestamps, 0);
+    record(commands);
+    commands.writeTimestamp2KHR(vk::PipelineStageFlagBits2::eAllCommands,
+                                timestamps, 1);
+    commands.end();
+    renderer.SubmitAndWait(commands);
+
+    std::array<uint64_t, 2> ticks{};
+    const auto result = renderer.getDevice().getQueryPoolResults(
+        timestamps, 0, 2, sizeof(ticks), ticks.data(), sizeof(uint64_t),
+        vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWait);
+    if (result != vk::Result::eSuccess) {
+      return 0.0;
+    }
+
+    const auto period = renderer.getPhysicalDevice()
+                            .getProperties()
+                            .limits.timestampPeriod;
+    return static_cast<double>(ticks[1] - ticks[0]) * period * 1e-9;
+  }
+};
+
+auto GetContext() -> GpuContext& {
+  static GpuContext context;
+  return context;
+}
+
+auto MakeValues(uint32_t count, uint32_t range) -> std::vector<uint32_t> {
+  std::mt19937 rng(42);
+  std::vector<uint32_t> values(count);
+  for (auto& value : values) {
+    value = range == 0 ? rng() : rng() % range;
+  }
+  return values;
+}
+
+// a fast but wrong primitive is not worth timing, so the first run of
+// each benchmark is compared with the standard library once
+auto Check(benchmark::State& state, const std::vector<uint32_t>& actual,
+           const std::vector<uint32_t>& expected) -> bool {
+  if (actual != expected) {
+    state.SkipWithError("GPU output differs from the reference");
+    return false;
+  }
+  return true;
+}
+
+void BM_GpuScan(benchmark::State& state, bool inclusive) {
+  auto& context = GetContext();
+  const auto count = static_cast<uint32_t>(state.range(0));
+  const auto size = count * sizeof(uint32_t);
+
+  braque::Buffer input(context.engine, braque::BufferType::indirect, size);
+  braque::Buffer output(context.engine, braque::BufferType::indirect, size);
+  const auto source = MakeValues(count, 16);
+  context.Upload(input, source);
+
+  auto run = [&](vk::CommandBuffer cmd) {
+    if (inclusive) {
+      context.primitives.InclusiveScan(cmd, input.GetBuffer(),
+                                       output.GetBuffer(), count);
+    } else {
+      context.primitives.ExclusiveScan(cmd, input.GetBuffer(),
+                                       output.GetBuffer(), count);
+    }
+  };
+
+  std::vector<uint32_t> expected(count);
+  if (inclusive) {
+    std::inclusive_scan(source.begin(), source.end(), expected.begin());
+  } else {
+    std::exclusive_scan(source.begin(), source.end(), expected.begin(), 0U);
+  }
+  context.Time(run);
+  if (!Check(state, context.Download(output, count), expected)) {
+    return;
+  }
+
+  for (auto _ : state) {
+    state.SetIterationTime(context.Time(run));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_GpuCompact(benchmark::State& state) {
+  auto& context = GetContext();
+  const auto count = static_cast<uint32_t>(state.range(0));
+  const auto size = count * sizeof(uint32_t);
+
+  braque::Buffer values(context.engine, braque::BufferType::indirect, size);
+  braque::Buffer flags(context.engine, braque::BufferType::indirect, size);
+  braque::Buffer output(context.engine, braque::BufferType::indirect, size);
+  braque::Buffer compacted(context.engine, braque::BufferType::indirect,
+                           sizeof(uint32_t));
+  const auto source = MakeValues(count, 0);
+  // about half survive, like a culling pass
+  const auto source_flags = MakeValues(count, 2);
+  context.Upload(values, source);
+  context.Upload(flags, source_flags);
+
+  auto run = [&](vk::CommandBuffer cmd) {
+    context.primitives.Compact(cmd, values.GetBuffer(), flags.GetBuffer(),
+                               output.GetBuffer(), compacted.GetBuffer(),
+                               count);
+  };
+
+  std::vector<uint32_t> expected;
+  for (uint32_t i = 0; i < count; ++i) {
+    if (source_flags[i] != 0) {
+      expected.push_back(source[i]);
+    }
+  }
+  const auto survivors = static_cast<uint32_t>(expected.size());
+  context.Time(run);
+  if (!Check(state, context.Download(compacted, 1), {survivors}) ||
+      !Check(state, context.Download(output, survivors), expected)) {
+    return;
+  }
+
+  for (auto _ : state) {
+    state.SetIterationTime(context.Time(run));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_GpuRadixSort(benchmark::State& state, uint32_t key_bits) {
+  auto& context = GetContext();
+  const auto count = static_cast<uint32_t>(state.range(0));
+  const auto size = count * sizeof(uint32_t);
+  const auto source = MakeValues(count, 0);
+
+  braque::Buffer keys(context.engine, braque::BufferType::indirect, size);
+  braque::Buffer values(context.engine, braque::BufferType::indirect, size);
+  braque::Buffer source_keys(context.engine, braque::BufferType::indirect,
+                             size);
+  context.Upload(source_keys, source);
+  context.Upload(values, source);
+
+  // the values are the unsorted keys, so both follow the stable order
+  auto expected = source;
+  const auto mask = key_bits < 32 ? (1U << key_bits) - 1 : ~0U;
+  std::stable_sort(expected.begin(), expected.end(),
+                   [mask](uint32_t a, uint32_t b) {
+                     return (a & mask) < (b & mask);
+                   });
+  context.Time([&](vk::CommandBuffer cmd) {
+    source_keys.CopyToBuffer(cmd, keys);
+  });
+  context.Time([&](vk::CommandBuffer cmd) {
+    context.primitives.RadixSort(cmd, keys.GetBuffer(), values.GetBuffer(),
+                                 count, key_bits);
+  });
+  if (!Check(state, context.Download(keys, count), expected) ||
+      !Check(state, context.Download(values, count), expected)) {
+    return;
+  }
+
+  for (auto _ : state) {
+    // only the sort counts, not restoring the unsorted keys
+    context.Time([&](vk::CommandBuffer cmd) {
+      source_keys.CopyToBuffer(cmd, keys);
+    });
+
+    state.SetIterationTime(context.Time([&](vk::CommandBuffer cmd) {
+      context.primitives.RadixSort(cmd, keys.GetBuffer(), values.GetBuffer(),
+                                   count, key_bits);
+    }));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+}  // namespace
+
+// 1k to 16M elements, timed on the GPU
+BENCHMARK_CAPTURE(BM_GpuScan, exclusive, false)
+    ->RangeMultiplier(4)->Range(1 << 10, kMaxCount)->UseManualTime();
+BENCHMARK_CAPTURE(BM_GpuScan, inclusive, true)
+    ->RangeMultiplier(4)->Range(1 << 10, kMaxCount)->UseManualTime();
+BENCHMARK(BM_GpuCompact)
+    ->RangeMultiplier(4)->Range(1 << 10, kMaxCount)->UseManualTime();
+BENCHMARK_CAPTURE(BM_GpuRadixSort, keys_32_bits, 32)
+    ->RangeMultiplier(4)->Range(1 << 10, kMaxCount)->UseManualTime();
+BENCHMARK_CAPTURE(BM_GpuRadixSort, keys_16_bits, 16)
+    ->RangeMultiplier(4)->Range(1 << 10, kMaxCount)->UseManualTime();
@@ -0,0 +1,61 @@
+// benchmarks/bench_sort.cpp
+#include <benchmark/benchmark.h>
+
+#include "braque/draw_packet.h"
+#include "braque/job_system.h"
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+
+namespace {
+
+// keys spread like a frame of draws, few pipelines and materials and
+// many depths and meshes
+auto MakeKeys(size_t count) -> std::vector<uint64_t> {
+  std::mt19937 rng(42);
+  std::vector<uint64_t> keys(count);
+  for (auto& key : keys) {
+    key = braque::MakeDrawKey(braque::DrawPass::eOpaque, rng() % 8,
+                              rng() % 64, rng() & 0xFFFF, rng() % 4096);
+  }
+  return keys;
+}
+
+void BM_StdSort(benchmark::State& state) {
+  const auto source = MakeKeys(static_cast<size_t>(state.range(0)));
+  std::vector<uint32_t> order(source.size());
+
+  for (auto _ : state) {
+    std::iota(order.begin(), order.end(), 0U);
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+      return source[a] < source[b];
+    });
+    benchmark::DoNotOptimize(order.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_RadixSort(benchmark::State& state, uint32_t workers) {
+  braque::JobSystem jobs(workers);
+  const auto source = MakeKeys(static_cast<size_t>(state.range(0)));
+  std::vector<uint64_t> keys(source.size());
+  std::vector<uint32_t> order(source.size());
+
+  for (auto _ : state) {
+    keys = source;
+    std::iota(order.begin(), order.end(), 0U);
+    braque::RadixSort(jobs, keys, order);
+    benchmark::DoNotOptimize(order.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+}  // namespace
+
+BENCHMARK(BM_StdSort)->Arg(1'000)->Arg(10'000)->Arg(100'000)->Arg(1'000'000);
+BENCHMARK_CAPTURE(BM_RadixSort, single_thread, 0)
+    ->Arg(1'000)->Arg(10'000)->Arg(100'000)->Arg(1'000'000);
+BENCHMARK_CAPTURE(BM_RadixSort, job_system,
+                  braque::JobSystem::DefaultWorkerCount())
+    ->Arg(1'000)->Arg(10'000)->Arg(100'000)->Arg(1'000'000)->UseRealTime();
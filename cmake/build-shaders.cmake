@@ -1,27 +1,95 @@
 # Find glslc shader compiler
 find_program(GLSLC glslc HINTS Vulkan::glslc)
+find_program(SPIRV_OPT spirv-opt HINTS Vulkan::spirv-opt)
+
+# release builds ship optimized shaders inside the engine, development builds
+# keep debug info and load them from disk so they can be rebuilt on their own
+if (CMAKE_BUILD_TYPE STREQUAL "Release")
+    set(BRAQUE_EMBED_SHADERS_DEFAULT ON)
+else ()
+    set(BRAQUE_EMBED_SHADERS_DEFAULT OFF)
+endif ()
+option(BRAQUE_EMBED_SHADERS "Embed optimized SPIR-V into the engine library"
+        ${BRAQUE_EMBED_SHADERS_DEFAULT})
+
+if (BRAQUE_EMBED_SHADERS AND NOT SPIRV_OPT)
+    message(WARNING "spirv-opt not found, embedded shaders keep their debug names")
+endif ()
 
 # Function to compile shaders
 function(compile_shader TARGET SHADER)
     get_filename_component(SHADER_NAME ${SHADER} NAME)
     set(SPIRV "${CMAKE_CURRENT_BINARY_DIR}/assets/shaders/${SHADER_NAME}.spv")
-    add_custom_command(
-            OUTPUT ${SPIRV}
-            COMMAND ${GLSLC} -o ${SPIRV} -g --target-env=vulkan1.2 ${SHADER}
-            DEPENDS ${SHADER}
-            COMMENT "Compiling ${SHADER_NAME}"
-    )
+    # shaders may include shared .glsl sources, glslc lists them in a depfile
+    set(DEPFILE_ARGS -MD -MF ${SPIRV}.d)
+    if (BRAQUE_EMBED_SHADERS)
+        set(STRIP_COMMAND)
+        if (SPIRV_OPT)
+            set(STRIP_COMMAND COMMAND ${SPIRV_OPT} --strip-debug -o ${SPIRV} ${SPIRV})
+        endif ()
+        add_custom_command(
+                OUTPUT ${SPIRV}
+                COMMAND ${GLSLC} -o ${SPIRV} -O --target-env=vulkan1.2 ${DEPFILE_ARGS} ${SHADER}
+                ${STRIP_COMMAND}
+                DEPENDS ${SHADER}
+                DEPFILE ${SPIRV}.d
+                COMMENT "Compiling optimized ${SHADER_NAME}"
+        )
+    else ()
+        add_custom_command(
+                OUTPUT ${SPIRV}
+                COMMAND ${GLSLC} -o ${SPIRV} -g --target-env=vulkan1.2 ${DEPFILE_ARGS} ${SHADER}
+                DEPENDS ${SHADER}
+                DEPFILE ${SPIRV}.d
+                COMMENT "Compiling ${SHADER_NAME}"
+        )
+    endif ()
     target_sources(${TARGET} PRIVATE ${SPIRV})
 endfunction()
 
-# Function to compile all shaders in a directory
-function(compile_shaders TARGET)
+function(find_shaders OUT)
     file(GLOB_RECURSE SHADERS
             "${PROJECT_SOURCE_DIR}/assets/shaders/*.vert"
             "${PROJECT_SOURCE_DIR}/assets/shaders/*.frag"
+            "${PROJECT_SOURCE_DIR}/assets/shaders/*.comp"
     )
+    set(${OUT} ${SHADERS} PARENT_SCOPE)
+endfunction()
+
+# Function to compile all shaders in a directory
+function(compile_shaders TARGET)
+    find_shaders(SHADERS)
     foreach(SHADER ${SHADERS})
         compile_shader(${TARGET} ${SHADER})
     endforeach()
 
-endfunction()
\ No newline at end of file
+endfunction()
+
+# Function to compile all shaders into a generated source of the target,
+# looked up by file name through FindEmbeddedShader
+function(embed_shaders TARGET)
+    find_shaders(SHADERS)
+    set(SPIRV_FILES)
+    foreach(SHADER ${SHADERS})
+        get_filename_component(SHADER_NAME ${SHADER} NAME)
+        compile_shader(${TARGET} ${SHADER})
+        list(APPEND SPIRV_FILES
+                "${CMAKE_CURRENT_BINARY_DIR}/assets/shaders/${SHADER_NAME}.spv")
+    endforeach()
+
+    # lists can not be passed through a custom command as is
+    string(REPLACE ";" "|" SPIRV_ARGUMENT "${SPIRV_FILES}")
+
+    set(SOURCE "${CMAKE_CURRENT_BINARY_DIR}/embedded_shaders.cc")
+    add_custom_command(
+            OUTPUT ${SOURCE}
+            COMMAND ${CMAKE_COMMAND} "-DSHADERS=${SPIRV_ARGUMENT}"
+                    "-DOUTPUT=${SOURCE}"
+                    -P "${PROJECT_SOURCE_DIR}/cmake/embed-shaders.cmake"
+            DEPENDS ${SPIRV_FILES} "${PROJECT_SOURCE_DIR}/cmake/embed-shaders.cmake"
+            COMMENT "Embedding shaders"
+            VERBATIM
+    )
+    target_sources(${TARGET} PRIVATE ${SOURCE})
+    target_compile_definitions(${TARGET} PUBLIC BRAQUE_EMBED_SHADERS)
+endfunction()
@@ -0,0 +1,63 @@
+# Writes SPIR-V modules as constexpr word arrays with a table to look them
+# up by file name. Run as a script with SHADERS, the modules separated by |,
+# and OUTPUT, the source to generate.
+
+string(REPLACE "|" ";" SHADERS "${SHADERS}")
+
+set(ARRAYS "")
+set(ENTRIES "")
+foreach(SPIRV ${SHADERS})
+    get_filename_component(SHADER_NAME ${SPIRV} NAME)
+    string(MAKE_C_IDENTIFIER "k_${SHADER_NAME}" IDENTIFIER)
+
+    # glslc writes words in the byte order of the little endian hosts we
+    # build on, reassemble them and break lines every eight words
+    file(READ ${SPIRV} HEX HEX)
+    string(REGEX REPLACE
+            "([0-9a-f][0-9a-f])([0-9a-f][0-9a-f])([0-9a-f][0-9a-f])([0-9a-f][0-9a-f])"
+            "0x\\4\\3\\2\\1, " WORDS "${HEX}")
+    set(WORD "0x[0-9a-f]+, ")
+    string(REGEX REPLACE
+            "(${WORD}${WORD}${WORD}${WORD}${WORD}${WORD}${WORD}${WORD})"
+            "\\1\n    " WORDS "${WORDS}")
+    string(REPLACE ", \n" ",\n" WORDS "${WORDS}")
+
+    string(APPEND ARRAYS
+            "constexpr uint32_t ${IDENTIFIER}[] = {\n    ${WORDS}};\n\n")
+    string(APPEND ENTRIES
+            "    EmbeddedShader{\"${SHADER_NAME}\", ${IDENTIFIER}},\n")
+endforeach()
+
+file(WRITE ${OUTPUT}.tmp
+"// generated by cmake/embed-shaders.cmake, do not edit
+
+#include \"braque/embedded_shaders.h\"
+
+#include <algorithm>
+#include <array>
+
+namespace braque {
+
+namespace {
+
+${ARRAYS}constexpr std::array kEmbeddedShaders = {
+${ENTRIES}};
+
+}  // namespace
+
+auto FindEmbeddedShader(std::string_view name) -> std::span<const uint32_t> {
+  const auto found = std::find_if(
+      kEmbeddedShaders.begin(), kEmbeddedShaders.end(),
+      [name](const EmbeddedShader& shader) { return shader.name == name; });
+  if (found == kEmbeddedShaders.end()) {
+    return {};
+  }
+  return found->code;
+}
+
+}  // namespace braque
+")
+
+# only touch the source when a module changed
+file(COPY_FILE ${OUTPUT}.tmp ${OUTPUT} ONLY_IF_DIFFERENT)
+file(REMOVE ${OUTPUT}.tmp)
@@ -0,0 +1,109 @@
+#ifndef ASYNC_COMPUTE_H
+#define ASYNC_COMPUTE_H
+
+#include <cstdint>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "braque/compute_pipeline.h"
+
+namespace braque {
+
+class Renderer;
+
+// Submits compute work to the renderer's compute queue so it runs next to
+// the raster work of the graphics queue. Both queues count their
+// submissions on a timeline semaphore and wait for a value of the other
+// instead of a fence, so neither the CPU nor the other queue stalls longer
+// than the data dependency needs. Storage and indirect buffers are shared
+// between the queue families, images written on one queue and read on the
+// other need an ownership transfer. Without an async queue the work goes
+// to the graphics queue the same way and only stops overlapping. Used from
+// the render thread.
+class AsyncCompute {
+ public:
+  AsyncCompute(Renderer& renderer, uint32_t frame_count);
+  ~AsyncCompute();
+
+  AsyncCompute(const AsyncCompute&) = delete;
+  AsyncCompute(AsyncCompute&&) noexcept = delete;
+  auto operator=(const AsyncCompute&) -> AsyncCompute& = delete;
+  auto operator=(AsyncCompute&&) noexcept -> AsyncCompute& = delete;
+
+  // waits for the compute work the frame submitted last time around, then
+  // recycles its command buffers. Call after waiting on the frame's fence
+  void BeginFrame(uint32_t frame);
+
+  // a command buffer of the current frame, recording
+  auto Begin() -> vk::CommandBuffer;
+
+  // ends and submits the buffer once graphics reached graphics_value, 0
+  // does not wait. Returns the compute value signaled when it finished
+  auto Submit(vk::CommandBuffer buffer, uint64_t graphics_value = 0)
+      -> uint64_t;
+
+  // records the pass into the compute submission of every frame. It waits
+  // for the previous frame's graphics work and the frame's graphics work
+  // waits for it at consumer_stages, e.g. culling or particles whose
+  // results are drawn
+  void AddPass(ComputePass pass, vk::PipelineStageFlags2 consumer_stages);
+
+  // submits the passes of the current frame and returns what the frame's
+  // graphics submission waits on, nothing without passes
+  auto SubmitPasses() -> std::vector<vk::SemaphoreSubmitInfo>;
+
+  // for a graphics submission to wait until compute reached the value
+  [[nodiscard]] auto WaitForCompute(uint64_t compute_value,
+                                    vk::PipelineStageFlags2 stages) const
+      -> vk::SemaphoreSubmitInfo;
+
+  // for the next graphics submission to signal, compute waits on the
+  // returned value
+  auto SignalGraphics() -> vk::SemaphoreSubmitInfo;
+
+  // last value handed out for graphics to signal
+  [[nodiscard]] auto GetGraphicsValue() const -> uint64_t {
+    return graphics_value_;
+  }
+
+  // last value a compute submission signals
+  [[nodiscard]] auto GetComputeValue() const -> uint64_t {
+    return compute_value_;
+  }
+
+  [[nodiscard]] auto IsAsync() const -> bool { return async_; }
+
+ private:
+  struct Frame {
+    vk::CommandPool pool;
+    std::vector<vk::CommandBuffer> buffers;
+    uint32_t used = 0;
+    uint64_t compute_value = 0;  // signaled by its last submission
+  };
+
+  struct Pass {
+    ComputePass record;
+    vk::PipelineStageFlags2 consumer_stages;
+  };
+
+  vk::Device device_;
+  vk::Queue queue_;
+  bool async_;
+
+  vk::Semaphore graphics_timeline_;
+  vk::Semaphore compute_timeline_;
+  uint64_t graphics_value_ = 0;
+  uint64_t compute_value_ = 0;
+
+  std::vector<Frame> frames_;
+  uint32_t current_ = 0;
+
+  std::vector<Pass> passes_;
+
+  auto CreateTimeline() const -> vk::Semaphore;
+};
+
+}  // namespace braque
+
+#endif  // ASYNC_COMPUTE_H
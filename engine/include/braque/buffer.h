@@ -14,7 +14,10 @@ enum class BufferType: uint8_t {
     vertex,
     index,
     uniform,
-    staging
+    staging,
+    storage,
+    indirect,  // gpu written storage consumed by indirect draws and copies
+    readback   // gpu results copied back for the host to read
   };
 
 class Buffer {
@@ -30,8 +33,9 @@ public:
   Buffer(Buffer&& other) noexcept;
   // Buffer& operator=(Buffer&&) noexcept;
 
-  void Bind(vk::CommandBuffer buffer, vk::DeviceSize offset = 0);
-  void CopyData(const void* data, size_t size);
+  void Bind(vk::CommandBuffer buffer, vk::DeviceSize offset = 0,
+            vk::IndexType index_type = vk::IndexType::eUint32);
+  void CopyData(const void* data, size_t size, vk::DeviceSize offset = 0);
   void CopyData(vk::CommandBuffer buffer, const void* data, size_t size);
   void CopyToBuffer(vk::CommandBuffer, Buffer& destination);
 
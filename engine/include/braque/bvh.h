@@ -0,0 +1,105 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "frustum.h"
+
+namespace braque {
+
+class JobSystem;
+
+constexpr uint32_t kInvalidObject = std::numeric_limits<uint32_t>::max();
+
+// leaves hold at most this many objects
+constexpr uint32_t kBvhMaxLeafSize = 4;
+
+// candidate split planes per axis for the surface area heuristic
+constexpr uint32_t kBvhBinCount = 16;
+
+// Interior nodes keep their children next to each other, the right child
+// directly follows the left one. Leaves point into the object order.
+struct BvhNode {
+  Aabb bounds;
+  uint32_t first;  // left child, or first object of a leaf
+  uint32_t count;  // objects in a leaf, 0 for interior nodes
+
+  [[nodiscard]] auto IsLeaf() const -> bool { return count > 0; }
+};
+
+static_assert(sizeof(BvhNode) == 32, "two nodes per cache line");
+
+struct Ray {
+  glm::vec3 origin;
+  glm::vec3 direction;
+  float max_distance = std::numeric_limits<float>::max();
+};
+
+// nearest object box along a ray, object is kInvalidObject on a miss
+struct RayHit {
+  uint32_t object = kInvalidObject;
+  float distance = std::numeric_limits<float>::max();
+};
+
+// Bounding volume hierarchy over object boxes, built top down with binned
+// SAH splits into a flat node array. Object ids are indices into the
+// boxes passed to Build. Moving objects are handled by Update and Refit,
+// which keep the tree correct but let its quality drift, GetCost grows as
+// it does and tells when a rebuild pays off.
+class Bvh {
+ public:
+  void Build(std::span<const Aabb> boxes);
+
+  // replaces the box of one object, call Refit once the batch is done
+  void Update(uint32_t object, const Aabb& box);
+  // recomputes every node bound bottom up
+  void Refit();
+
+  // SAH cost of the tree relative to its root, a few times the leaf count
+  // for a good tree
+  [[nodiscard]] auto GetCost() const -> float;
+
+  // appends every object whose box touches the volume
+  void QueryFrustum(const Frustum& frustum,
+                    std::vector<uint32_t>& objects) const;
+  void QueryAabb(const Aabb& box, std::vector<uint32_t>& objects) const;
+
+  // nearest object box the ray enters, objects containing the origin hit
+  // at distance 0
+  [[nodiscard]] auto Raycast(const Ray& ray) const -> RayHit;
+
+  // batched versions, the queries are spread across the job system and
+  // results[i] answers queries[i]
+  void QueryFrustums(JobSystem& jobs, std::span<const Frustum> frustums,
+                     std::span<std::vector<uint32_t>> results) const;
+  void QueryAabbs(JobSystem& jobs, std::span<const Aabb> boxes,
+                  std::span<std::vector<uint32_t>> results) const;
+  void Raycast(JobSystem& jobs, std::span<const Ray> rays,
+               std::span<RayHit> hits) const;
+
+  [[nodiscard]] auto GetNodes() const -> std::span<const BvhNode> {
+    return nodes_;
+  }
+  [[nodiscard]] auto GetObjectCount() const -> uint32_t {
+    return static_cast<uint32_t>(boxes_.size());
+  }
+
+ private:
+  std::vector<BvhNode> nodes_;
+  std::vector<uint32_t> objects_;  // object ids in leaf order
+  std::vector<Aabb> boxes_;        // indexed by object id
+
+  void Split(uint32_t node_index, std::vector<glm::vec3>& centers);
+
+  template <typename Predicate>
+  void Query(const Predicate& overlaps, std::vector<uint32_t>& objects) const;
+};
+
+}  // namespace braque
+
+#endif  // BVH_H
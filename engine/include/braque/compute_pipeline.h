@@ -0,0 +1,122 @@
+#ifndef COMPUTE_PIPELINE_H
+#define COMPUTE_PIPELINE_H
+
+#include <array>
+#include <functional>
+#include <memory>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "braque/descriptor_allocator.h"
+#include "braque/shader_reflection.h"
+#include "braque/specialization.h"
+
+namespace braque {
+
+class LayoutCache;
+
+// records compute work of a frame in flight into a command buffer
+using ComputePass =
+    std::function<void(vk::CommandBuffer buffer, uint32_t frame)>;
+
+// one execution and memory dependency between passes, e.g. from a compute
+// write to the reads of the next dispatch or of the draws
+void InsertMemoryBarrier(vk::CommandBuffer buffer,
+                         vk::PipelineStageFlags2 src_stage,
+                         vk::AccessFlags2 src_access,
+                         vk::PipelineStageFlags2 dst_stage,
+                         vk::AccessFlags2 dst_access);
+
+// Compute pipeline with its layout built from the reflected shader: a set
+// layout from the layout cache for every set the shader uses and its push
+// constant block. Pipelines with the same interface share layouts, so a
+// set bound for one stays bound for the next. Everything it records uses
+// the compute bind point and leaves graphics state alone, so dispatches
+// can go anywhere in a frame outside of a rendering pass.
+class ComputePipeline {
+ public:
+  // bindings, when given, replace the reflected bindings of the sets they
+  // name, so shaders using parts of one set share its layout. The shader
+  // may only use bindings they cover
+  ComputePipeline(vk::Device device, vk::PipelineCache cache,
+                  LayoutCache& layouts, const std::string& shader_filename,
+                  std::span<const ShaderBinding> bindings = {},
+                  const SpecializationConstants& constants = {});
+  ~ComputePipeline();
+
+  ComputePipeline(const ComputePipeline&) = delete;
+  ComputePipeline(ComputePipeline&&) noexcept = delete;
+  auto operator=(const ComputePipeline&) -> ComputePipeline& = delete;
+  auto operator=(ComputePipeline&&) noexcept -> ComputePipeline& = delete;
+
+  void Bind(vk::CommandBuffer buffer) const;
+
+  void BindSet(vk::CommandBuffer buffer, vk::DescriptorSet set,
+               uint32_t index = 0) const;
+
+  // the size must match the shader's push constant block
+  void PushConstants(vk::CommandBuffer buffer, const void* data,
+                     uint32_t size) const;
+
+  template <typename T>
+  void PushConstants(vk::CommandBuffer buffer, const T& constants) const {
+    static_assert(std::is_trivially_copyable_v<T>);
+    PushConstants(buffer, &constants, sizeof(T));
+  }
+
+  // enough workgroups to cover count invocations along x
+  void Dispatch(vk::CommandBuffer buffer, uint32_t count) const;
+  // enough workgroups to cover a grid of invocations, e.g. one per texel
+  void Dispatch(vk::CommandBuffer buffer, uint32_t width, uint32_t height,
+                uint32_t depth = 1) const;
+  // workgroup counts from a VkDispatchIndirectCommand an earlier pass
+  // wrote, the buffer needs indirect usage
+  static void DispatchIndirect(vk::CommandBuffer buffer,
+                               vk::Buffer commands,
+                               vk::DeviceSize offset = 0);
+
+  // empty storage buffers and images of a set to fill in
+  [[nodiscard]] auto MakeData(uint32_t index = 0) const -> DescriptorData;
+  // a set written once that lives as long as the allocator
+  auto AllocateSet(DescriptorAllocator& allocator, const DescriptorData& data,
+                   uint32_t index = 0) const -> vk::DescriptorSet;
+  // a transient set for the current frame, shared by identical data
+  auto GetSet(DescriptorSetCache& cache, const DescriptorData& data,
+              uint32_t index = 0) const -> vk::DescriptorSet;
+
+  [[nodiscard]] auto GetSetLayout(uint32_t index = 0) const
+      -> vk::DescriptorSetLayout;
+
+  [[nodiscard]] auto GetLocalSize() const -> const std::array<uint32_t, 3>& {
+    return reflection_.local_size;
+  }
+
+  [[nodiscard]] auto GetReflection() const -> const ShaderReflection& {
+    return reflection_;
+  }
+
+  [[nodiscard]] auto VulkanLayout() const -> vk::PipelineLayout {
+    return layout_;
+  }
+
+ private:
+  vk::Device device_;
+  std::string name_;
+  ShaderReflection reflection_;
+
+  // layouts belong to the layout cache
+  vk::PipelineLayout layout_;
+  std::vector<vk::DescriptorSetLayout> set_layouts_;
+  std::vector<std::unique_ptr<DescriptorTemplate>> templates_;
+  vk::Pipeline pipeline_;
+
+  auto GetTemplate(uint32_t index) const -> const DescriptorTemplate&;
+};
+
+}  // namespace braque
+
+#endif  //COMPUTE_PIPELINE_H
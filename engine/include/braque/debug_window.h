@@ -12,6 +12,7 @@ namespace braque
   class Engine;
   class FrameStats;
   class Image;
+  class OcclusionRasterizer;
 
   class DebugWindow
   {
@@ -33,6 +34,7 @@ namespace braque
     Engine & engine;
 
     static void initAssets();
+    static void drawOcclusionBuffer( const OcclusionRasterizer & rasterizer );
   };
 
 }  // namespace braque
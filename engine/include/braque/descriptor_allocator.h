@@ -0,0 +1,175 @@
+#ifndef DESCRIPTOR_ALLOCATOR_H
+#define DESCRIPTOR_ALLOCATOR_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "braque/shader_reflection.h"
+
+namespace braque {
+
+// descriptors of a type a pool holds for every set it can allocate
+struct DescriptorPoolRatio {
+  vk::DescriptorType type;
+  float per_set;
+};
+
+// what the engine's compute passes and draws bind, mostly buffers
+constexpr std::array kDefaultPoolRatios = {
+    DescriptorPoolRatio{vk::DescriptorType::eStorageBuffer, 4.0F},
+    DescriptorPoolRatio{vk::DescriptorType::eUniformBuffer, 1.0F},
+    DescriptorPoolRatio{vk::DescriptorType::eCombinedImageSampler, 2.0F},
+    DescriptorPoolRatio{vk::DescriptorType::eStorageImage, 1.0F}};
+
+constexpr uint32_t kInitialSetsPerPool = 64;
+constexpr uint32_t kMaxSetsPerPool = 4096;
+
+// at least one descriptor of every type, rounded up
+[[nodiscard]] auto GetPoolSizes(std::span<const DescriptorPoolRatio> ratios,
+                                uint32_t set_count)
+    -> std::vector<vk::DescriptorPoolSize>;
+
+// every new pool doubles the sets of the last one, up to kMaxSetsPerPool
+[[nodiscard]] auto GetNextPoolSetCount(uint32_t set_count) -> uint32_t;
+
+// Chain of descriptor pools that grows a new pool when the current one
+// runs out instead of failing. Reset frees every set at once by resetting
+// the pools, which is far cheaper than freeing sets one by one. Used from
+// one thread.
+class DescriptorAllocator {
+ public:
+  DescriptorAllocator(vk::Device device,
+                      std::span<const DescriptorPoolRatio> ratios,
+                      uint32_t sets_per_pool = kInitialSetsPerPool,
+                      vk::DescriptorPoolCreateFlags flags = {});
+  ~DescriptorAllocator();
+
+  DescriptorAllocator(const DescriptorAllocator&) = delete;
+  DescriptorAllocator(DescriptorAllocator&&) noexcept = delete;
+  auto operator=(const DescriptorAllocator&) -> DescriptorAllocator& = delete;
+  auto operator=(DescriptorAllocator&&) noexcept
+      -> DescriptorAllocator& = delete;
+
+  auto Allocate(vk::DescriptorSetLayout layout) -> vk::DescriptorSet;
+
+  // the sets must no longer be in use by the GPU
+  void Reset();
+
+  [[nodiscard]] auto GetPoolCount() const -> size_t {
+    return ready_.size() + full_.size();
+  }
+
+ private:
+  vk::Device device_;
+  std::vector<DescriptorPoolRatio> ratios_;
+  vk::DescriptorPoolCreateFlags flags_;
+  uint32_t sets_per_pool_;
+
+  std::vector<vk::DescriptorPool> ready_;  // the last one allocates
+  std::vector<vk::DescriptorPool> full_;
+
+  auto CreatePool() -> vk::DescriptorPool;
+};
+
+// Descriptor contents of one set, laid out for a descriptor update
+// template built from the same bindings. Each descriptor takes one slot of
+// the largest descriptor info, runtime arrays are left out and written
+// slot by slot. Two data with the same contents compare and hash equal.
+class DescriptorData {
+ public:
+  explicit DescriptorData(std::span<const ShaderBinding> bindings);
+
+  void SetBuffer(uint32_t binding, vk::Buffer buffer,
+                 vk::DeviceSize offset = 0,
+                 vk::DeviceSize range = VK_WHOLE_SIZE, uint32_t element = 0);
+  void SetImage(uint32_t binding, vk::ImageView view, vk::ImageLayout layout,
+                vk::Sampler sampler = {}, uint32_t element = 0);
+
+  [[nodiscard]] auto Hash() const -> uint64_t;
+  [[nodiscard]] auto GetData() const -> const void* { return bytes_.data(); }
+
+  auto operator==(const DescriptorData&) const -> bool = default;
+
+ private:
+  std::vector<uint32_t> first_;  // first slot of each binding number
+  std::vector<uint32_t> counts_;
+  std::vector<std::byte> bytes_;
+
+  auto Slot(uint32_t binding, uint32_t element) -> std::byte*;
+};
+
+// Writes a whole set in one vkUpdateDescriptorSetWithTemplate call from a
+// DescriptorData of the same bindings.
+class DescriptorTemplate {
+ public:
+  DescriptorTemplate(vk::Device device, vk::DescriptorSetLayout layout,
+                     std::span<const ShaderBinding> bindings);
+  ~DescriptorTemplate();
+
+  DescriptorTemplate(const DescriptorTemplate&) = delete;
+  DescriptorTemplate(DescriptorTemplate&&) noexcept = delete;
+  auto operator=(const DescriptorTemplate&) -> DescriptorTemplate& = delete;
+  auto operator=(DescriptorTemplate&&) noexcept
+      -> DescriptorTemplate& = delete;
+
+  void Update(vk::DescriptorSet set, const DescriptorData& data) const;
+
+  // empty data to fill in for this template
+  [[nodiscard]] auto MakeData() const -> DescriptorData {
+    return DescriptorData(bindings_);
+  }
+
+  [[nodiscard]] auto GetLayout() const -> vk::DescriptorSetLayout {
+    return layout_;
+  }
+
+ private:
+  vk::Device device_;
+  vk::DescriptorSetLayout layout_;
+  std::vector<ShaderBinding> bindings_;
+  vk::DescriptorUpdateTemplate template_;
+};
+
+// Transient sets for one frame in flight at a time, from pools that are
+// reset when the frame comes around again. Identical contents requested
+// twice in a frame share one set, so per draw sets cost a hash lookup once
+// the first draw wrote them.
+class DescriptorSetCache {
+ public:
+  DescriptorSetCache(vk::Device device, uint32_t frame_count,
+                     std::span<const DescriptorPoolRatio> ratios =
+                         kDefaultPoolRatios);
+
+  // forgets the sets of the frame, call after waiting on its fence
+  void BeginFrame(uint32_t frame);
+
+  auto Get(const DescriptorTemplate& descriptor_template,
+           const DescriptorData& data) -> vk::DescriptorSet;
+
+ private:
+  struct CachedSet {
+    vk::DescriptorSetLayout layout;
+    DescriptorData data;
+    vk::DescriptorSet set;
+  };
+
+  struct Frame {
+    std::unique_ptr<DescriptorAllocator> allocator;
+    // sets by the hash of their layout and contents
+    std::unordered_map<uint64_t, std::vector<CachedSet>> sets;
+  };
+
+  std::vector<Frame> frames_;
+  uint32_t current_ = 0;
+};
+
+}  // namespace braque
+
+#endif  // DESCRIPTOR_ALLOCATOR_H
@@ -0,0 +1,144 @@
+#ifndef DRAW_PACKET_H
+#define DRAW_PACKET_H
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "vertex_format.h"
+
+namespace braque {
+
+class JobSystem;
+
+// Sort key fields from the most significant bits down. Draws sort by pass,
+// then pipeline, then material so state changes are grouped, then front to
+// back inside a material, and the mesh keeps ties deterministic.
+constexpr uint32_t kDrawKeyPassBits = 4;
+constexpr uint32_t kDrawKeyPipelineBits = 12;
+constexpr uint32_t kDrawKeyMaterialBits = 16;
+constexpr uint32_t kDrawKeyDepthBits = 16;
+constexpr uint32_t kDrawKeyMeshBits = 16;
+
+static_assert(kDrawKeyPassBits + kDrawKeyPipelineBits + kDrawKeyMaterialBits +
+                      kDrawKeyDepthBits + kDrawKeyMeshBits ==
+                  64,
+              "draw key fields must fill 64 bits");
+
+enum class DrawPass : uint8_t {
+  eOpaque,
+  eTransparent
+};
+
+// fields wider than their bits are truncated
+[[nodiscard]] auto MakeDrawKey(DrawPass pass, uint32_t pipeline,
+                               uint32_t material, uint32_t depth,
+                               uint32_t mesh) -> uint64_t;
+
+// logarithmic depth bucket, nearer is smaller. Back to front passes use
+// the complement of the bucket
+[[nodiscard]] auto QuantizeDepth(float depth, float near_plane,
+                                 float far_plane) -> uint32_t;
+
+// stable LSD radix sort of the keys, the values are moved along with them.
+// Digits every key shares are skipped, large inputs split every pass
+// across the job system
+void RadixSort(JobSystem& jobs, std::span<uint64_t> keys,
+               std::span<uint32_t> values);
+
+// everything needed to record one indexed draw
+struct DrawPacket {
+  vk::Pipeline pipeline;             // null keeps the bound pipeline
+  vk::DescriptorSet descriptor_set;  // set 0, null keeps the bound set
+  vk::Buffer vertex_buffer;          // every vertex stream lives in it
+  vk::Buffer index_buffer;
+  vk::DeviceSize index_buffer_offset;
+  vk::IndexType index_type;
+  uint32_t draw_offset;  // DrawConstants of the draw
+  uint32_t index_count;
+  uint32_t first_index;
+  int32_t vertex_offset;
+  uint32_t instance_count;
+  uint32_t first_instance;
+};
+
+// Packets collected for a frame, submitted in key order instead of the
+// order they were added in.
+class DrawPacketList {
+ public:
+  void Clear();
+  void Add(uint64_t key, const DrawPacket& packet);
+  void Sort(JobSystem& jobs);
+
+  [[nodiscard]] auto Size() const -> size_t { return packets_.size(); }
+  [[nodiscard]] auto Empty() const -> bool { return packets_.empty(); }
+
+  // the i-th packet in key order once sorted
+  [[nodiscard]] auto Get(size_t i) const -> const DrawPacket& {
+    return packets_[order_[i]];
+  }
+  [[nodiscard]] auto GetKey(size_t i) const -> uint64_t { return keys_[i]; }
+
+ private:
+  std::vector<DrawPacket> packets_;
+  std::vector<uint64_t> keys_;
+  std::vector<uint32_t> order_;  // packet of each key
+};
+
+// state changes the translator issued and skipped while recording
+struct DrawSubmitStats {
+  uint32_t draws = 0;
+  uint32_t state_binds = 0;
+  uint32_t redundant_binds = 0;
+};
+
+// Records packets into a command buffer, binding a pipeline, descriptor
+// set, vertex buffer or index buffer only when it differs from what the
+// previous packet left bound. Only the requested vertex streams are bound.
+class DrawTranslator {
+ public:
+  DrawTranslator(vk::CommandBuffer buffer, vk::PipelineLayout layout,
+                 std::span<const vk::DeviceSize> stream_offsets,
+                 VertexStreams streams);
+
+  void Submit(const DrawPacketList& packets);
+  void Submit(const DrawPacket& packet);
+
+  [[nodiscard]] auto GetStats() const -> const DrawSubmitStats& {
+    return stats_;
+  }
+
+ private:
+  vk::CommandBuffer buffer_;
+  vk::PipelineLayout layout_;
+  std::span<const vk::DeviceSize> stream_offsets_;
+  VertexStreams streams_;
+
+  // the index buffer is bound together with its offset and type
+  struct IndexBinding {
+    vk::Buffer buffer;
+    vk::DeviceSize offset = 0;
+    vk::IndexType type = vk::IndexType::eUint32;
+
+    auto operator==(const IndexBinding&) const -> bool = default;
+  };
+
+  vk::Pipeline pipeline_;
+  vk::DescriptorSet descriptor_set_;
+  vk::Buffer vertex_buffer_;
+  IndexBinding index_binding_;
+  uint32_t draw_offset_ = 0;
+  bool has_draw_offset_ = false;
+
+  DrawSubmitStats stats_;
+
+  // true when the state changed and has to be bound
+  template <typename T>
+  auto Update(T& bound, const T& wanted) -> bool;
+};
+
+}  // namespace braque
+
+#endif  // DRAW_PACKET_H
@@ -0,0 +1,23 @@
+#ifndef EMBEDDED_SHADERS_H
+#define EMBEDDED_SHADERS_H
+
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+namespace braque {
+
+// optimized SPIR-V compiled into the engine by embed_shaders in
+// cmake/build-shaders.cmake, only defined when BRAQUE_EMBED_SHADERS is
+struct EmbeddedShader {
+  std::string_view name;  // file name of the module, e.g. triangle.vert.spv
+  std::span<const uint32_t> code;
+};
+
+// empty when no module of that name was embedded
+[[nodiscard]] auto FindEmbeddedShader(std::string_view name)
+    -> std::span<const uint32_t>;
+
+}  // namespace braque
+
+#endif  // EMBEDDED_SHADERS_H
@@ -5,16 +5,19 @@
 #ifndef ENGINE_HPP
 #define ENGINE_HPP
 
+#include "async_compute.h"
 #include "camera.h"
 #include "debug_window.h"
 #include "engine_context.h"
 #include "input/app_controller.h"
 #include "input/fps_controller.h"
 #include "input/input_controller.h"
+#include "job_system.h"
 #include "memory_allocator.h"
 #include "renderer.h"
 #include "rendering_stage.h"
 #include "scene.h"
+#include "shader_watcher.h"
 #include "swapchain.h"
 #include "uniforms.h"
 #include "window.h"
@@ -38,6 +41,9 @@ class Engine {
 
   auto getSwapchain() -> Swapchain& { return swapchain; }
 
+  // compute work that overlaps the frame's raster work
+  auto getAsyncCompute() -> AsyncCompute& { return async_compute_; }
+
   //auto getRenderingStage() -> RenderingStage& { return renderingStage; }
   auto getRenderingStage() -> RenderingStage& { return renderingStage; }
 
@@ -45,6 +51,8 @@ class Engine {
 
   auto getUniforms() -> Uniforms& { return uniforms_; }
 
+  auto getScene() -> Scene& { return scene_; }
+
   void Quit() { running = false; }
 
   void run();
@@ -53,8 +61,10 @@ class Engine {
   Window window;
   Renderer renderer;
   MemoryAllocator memoryAllocator;
+  JobSystem jobSystem_;
   EngineContext context_;
   Swapchain swapchain;
+  AsyncCompute async_compute_;
   Uniforms uniforms_;
   Camera camera_;
   RenderingStage renderingStage;
@@ -64,6 +74,9 @@ class Engine {
   AppController app_controller_;
   Scene scene_;
 
+  // development builds only, see BRAQUE_SHADER_HOT_RELOAD
+  std::unique_ptr<ShaderWatcher> shader_watcher_;
+
   bool running = true;
 
 
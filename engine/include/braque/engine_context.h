@@ -8,21 +8,25 @@
 
 namespace braque {
 
+class JobSystem;
 class MemoryAllocator;
 class Renderer;
 class Swapchain;
 
 class EngineContext {
  public:
-  EngineContext(MemoryAllocator& allocator, Renderer& renderer)
-      : allocator_(allocator), renderer_(renderer) {}
+  EngineContext(MemoryAllocator& allocator, Renderer& renderer,
+                JobSystem& jobs)
+      : allocator_(allocator), renderer_(renderer), jobs_(jobs) {}
   auto getMemoryAllocator() const -> MemoryAllocator& { return allocator_; }
   auto getRenderer() const -> Renderer& { return renderer_; }
+  auto getJobSystem() const -> JobSystem& { return jobs_; }
   // auto getSwapchain() const -> Swapchain& { return swapchain_; }
 
  private:
   MemoryAllocator& allocator_;
   Renderer& renderer_;
+  JobSystem& jobs_;
   // Swapchain& swapchain_;
 };
 
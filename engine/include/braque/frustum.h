@@ -0,0 +1,36 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <array>
+
+#include <glm/glm.hpp>
+
+namespace braque {
+
+// Six normalized planes (xyz normal pointing inwards, w distance), in the
+// order left, right, bottom, top, near, far. Laid out to match the planes
+// array pushed to the culling shader.
+struct Frustum {
+  std::array<glm::vec4, 6> planes;
+};
+
+// axis aligned box, min and max corners inclusive
+struct Aabb {
+  glm::vec3 min;
+  glm::vec3 max;
+};
+
+// extracts the planes of a projection * view matrix with zero to one depth
+[[nodiscard]] auto ExtractFrustum(const glm::mat4& view_projection) -> Frustum;
+
+// conservative test, spheres crossing a plane count as visible
+[[nodiscard]] auto IsSphereVisible(const Frustum& frustum, glm::vec3 center,
+                                   float radius) -> bool;
+
+// conservative test, boxes crossing a plane count as visible
+[[nodiscard]] auto IsBoxVisible(const Frustum& frustum, const Aabb& box)
+    -> bool;
+
+}  // namespace braque
+
+#endif  //FRUSTUM_H
@@ -0,0 +1,122 @@
+#ifndef GPU_PRIMITIVES_H
+#define GPU_PRIMITIVES_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "braque/buffer.h"
+#include "braque/compute_pipeline.h"
+
+namespace braque {
+
+class DescriptorSetCache;
+class EngineContext;
+
+// elements one workgroup of the scan shaders covers, 256 invocations of 4
+constexpr uint32_t kScanBlockSize = 1024;
+// elements one workgroup of the radix sort shaders covers
+constexpr uint32_t kRadixBlockSize = 256;
+// key bits sorted per pass, 16 digits
+constexpr uint32_t kRadixBits = 4;
+constexpr uint32_t kRadixDigits = 1U << kRadixBits;
+
+// elements scanned at each level of a scan over count elements: the input,
+// then the block totals of the level before, down to a single block
+[[nodiscard]] auto GetScanLevels(uint32_t count) -> std::vector<uint32_t>;
+
+// passes sorting the low key_bits bits of the keys, 1 to 32 bits
+[[nodiscard]] auto GetRadixPassCount(uint32_t key_bits) -> uint32_t;
+
+// digit bits a pass sorts, all of them except in a last pass that only
+// has the rest of key_bits left
+[[nodiscard]] auto GetRadixDigitMask(uint32_t key_bits, uint32_t pass)
+    -> uint32_t;
+
+// Scan, compaction and sort of 32 bit values in storage buffers, recorded
+// into a compute command buffer like any other pass. Scans go block by
+// block through a hierarchy of block totals, the sort is a least
+// significant digit radix sort with a histogram, a scan and a stable
+// scatter per pass. With subgroup arithmetic the workgroup scans run
+// within subgroups first, which needs far fewer barriers. Every operation
+// waits for earlier compute writes and the caller inserts a barrier before
+// reading its results. Operations share scratch memory, so only one may be
+// in flight at a time, and take transient sets from the cache of the
+// current frame. Buffers need storage usage and may not alias.
+class GpuPrimitives {
+ public:
+  // max_count is the largest count any operation is recorded with. Without
+  // allow_subgroups the portable shaders run even where subgroup
+  // arithmetic is supported, e.g. to compare both
+  GpuPrimitives(EngineContext& engine, DescriptorSetCache& descriptors,
+                uint32_t max_count, bool allow_subgroups = true);
+  ~GpuPrimitives();
+
+  GpuPrimitives(const GpuPrimitives&) = delete;
+  GpuPrimitives(GpuPrimitives&&) noexcept = delete;
+  auto operator=(const GpuPrimitives&) -> GpuPrimitives& = delete;
+  auto operator=(GpuPrimitives&&) noexcept -> GpuPrimitives& = delete;
+
+  // output[i] is the sum of input[0] to input[i - 1]
+  void ExclusiveScan(vk::CommandBuffer buffer, vk::Buffer input,
+                     vk::Buffer output, uint32_t count);
+  // output[i] is the sum of input[0] to input[i]
+  void InclusiveScan(vk::CommandBuffer buffer, vk::Buffer input,
+                     vk::Buffer output, uint32_t count);
+
+  // writes the values whose flag is 1 to output in their order and their
+  // number to the first uint of count_output, e.g. for an indirect
+  // dispatch over the survivors. Flags are 0 or 1, their scan is the
+  // position of each value
+  void Compact(vk::CommandBuffer buffer, vk::Buffer values, vk::Buffer flags,
+               vk::Buffer output, vk::Buffer count_output, uint32_t count);
+
+  // sorts the keys in place by their low key_bits bits and moves the
+  // values with them, equal keys keep their order. With an odd number of
+  // passes the result is copied back, so both need transfer dst usage
+  void RadixSort(vk::CommandBuffer buffer, vk::Buffer keys, vk::Buffer values,
+                 uint32_t count, uint32_t key_bits = 32);
+
+  [[nodiscard]] auto UsesSubgroups() const -> bool { return subgroups_; }
+
+ private:
+  // part of the scratch buffer, one per scan level
+  struct ScanLevel {
+    vk::DeviceSize sums_offset;     // block totals of the level before
+    vk::DeviceSize scanned_offset;  // their scan
+    vk::DeviceSize size;
+  };
+
+  DescriptorSetCache& descriptors_;
+  uint32_t max_count_;
+  bool subgroups_;
+
+  std::unique_ptr<ComputePipeline> scan_exclusive_pipeline_;
+  std::unique_ptr<ComputePipeline> scan_inclusive_pipeline_;
+  std::unique_ptr<ComputePipeline> scan_add_pipeline_;
+  std::unique_ptr<ComputePipeline> compact_pipeline_;
+  std::unique_ptr<ComputePipeline> histogram_pipeline_;
+  std::unique_ptr<ComputePipeline> scatter_pipeline_;
+
+  // levels after the first, sized for max_count, in scan_scratch_
+  std::vector<ScanLevel> scan_levels_;
+  Buffer scan_scratch_;
+  Buffer flag_offsets_;
+  Buffer histogram_;
+  Buffer digit_offsets_;
+  Buffer sorted_keys_;
+  Buffer sorted_values_;
+
+  void Scan(vk::CommandBuffer buffer, vk::Buffer input, vk::Buffer output,
+            uint32_t count, bool inclusive);
+  void CheckCount(uint32_t count) const;
+
+  static auto LayoutScanLevels(const EngineContext& engine,
+                               uint32_t max_count) -> std::vector<ScanLevel>;
+};
+
+}  // namespace braque
+
+#endif  // GPU_PRIMITIVES_H
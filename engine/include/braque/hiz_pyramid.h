@@ -0,0 +1,76 @@
+#ifndef HIZ_PYRAMID_H
+#define HIZ_PYRAMID_H
+
+#include <memory>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "buffer.h"
+#include "compute_pipeline.h"
+#include "descriptor_allocator.h"
+#include "image.h"
+
+namespace braque {
+
+class EngineContext;
+
+constexpr uint32_t kMaxHiZLevels = 13;
+
+// Hierarchical depth pyramid, every texel holds the farthest depth of the
+// region it covers. Level 0 is the largest power of two that fits the
+// depth buffer so each level halves cleanly. The whole chain is built by a
+// single compute dispatch: every workgroup reduces a 32x32 tile down to
+// one texel and the last workgroup to finish reduces the rest.
+class HiZPyramid {
+ public:
+  // one source per frame in flight, multisampled depth is resolved to the
+  // farthest sample while building level 0
+  HiZPyramid(EngineContext& engine, std::vector<Image>& depth_images);
+  ~HiZPyramid();
+
+  HiZPyramid(const HiZPyramid&) = delete;
+  HiZPyramid(HiZPyramid&&) noexcept = delete;
+  auto operator=(const HiZPyramid&) -> HiZPyramid& = delete;
+  auto operator=(HiZPyramid&&) noexcept -> HiZPyramid& = delete;
+
+  // must be recorded outside rendering, the depth image is handed back in
+  // depth attachment layout
+  void Build(vk::CommandBuffer buffer, uint32_t frame);
+
+  // whole mip chain in general layout, sample with GetSampler
+  [[nodiscard]] auto GetImageView() const -> vk::ImageView {
+    return pyramid_.GetImageView();
+  }
+  [[nodiscard]] auto GetSampler() const -> vk::Sampler { return sampler_; }
+  [[nodiscard]] auto GetExtent() const -> vk::Extent2D { return extent_; }
+  [[nodiscard]] auto GetLevelCount() const -> uint32_t { return level_count_; }
+
+ private:
+  EngineContext& engine_;
+  std::vector<Image>& depth_images_;
+
+  vk::Extent2D extent_;
+  uint32_t level_count_;
+  Image pyramid_;
+  std::vector<vk::ImageView> level_views_;
+  vk::Sampler sampler_;
+
+  // number of finished workgroups, reset every build
+  Buffer counter_;
+
+  std::unique_ptr<ComputePipeline> pipeline_;
+  std::vector<vk::DescriptorSet> descriptor_sets_;  // per frame in flight
+
+  [[nodiscard]] static auto GetPyramidExtent(vk::Extent3D depth_extent)
+      -> vk::Extent2D;
+  [[nodiscard]] static auto GetLevelCount(vk::Extent2D extent) -> uint32_t;
+
+  void CreateLevelViews();
+  void CreateSampler();
+  void CreateDescriptorSets();
+};
+
+}  // namespace braque
+
+#endif  //HIZ_PYRAMID_H
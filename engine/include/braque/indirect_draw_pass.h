@@ -0,0 +1,182 @@
+#ifndef INDIRECT_DRAW_PASS_H
+#define INDIRECT_DRAW_PASS_H
+
+#include <memory>
+#include <span>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <vulkan/vulkan.hpp>
+
+#include "buffer.h"
+#include "compute_pipeline.h"
+#include "descriptor_allocator.h"
+#include "mesh_lod.h"
+
+namespace braque {
+
+class EngineContext;
+class HiZPyramid;
+
+// A bucket holds draws that share pipeline state and index buffer binding,
+// each bucket is submitted with a single multi draw indirect call.
+constexpr uint32_t kMaxDrawBuckets = 2;
+constexpr uint32_t kMaxDrawsPerBucket = 4096;
+constexpr uint32_t kMaxIndirectDraws = kMaxDrawBuckets * kMaxDrawsPerBucket;
+
+// Two phase occlusion culling. The first phase draws what was visible last
+// frame, a Hi-Z pyramid is built from that depth and the second phase draws
+// whatever the pyramid shows has become visible.
+enum class CullPhase : uint8_t {
+  eVisibleLastFrame,
+  eDisoccluded
+};
+
+constexpr uint32_t kCullPhaseCount = 2;
+
+// each phase owns its commands and draw data
+constexpr uint32_t kIndirectDrawDataCount = kCullPhaseCount * kMaxIndirectDraws;
+
+// what the culling pass tests against this frame
+struct CullView {
+  glm::mat4 view_projection{1.0F};
+  bool frustum = false;
+  bool occlusion = false;
+
+  // level of detail selection, see SelectLod in mesh_lod.h. A threshold
+  // of 0 draws every instance with its first record
+  glm::vec3 eye{0.0F};
+  float lod_scale = 0.0F;
+  float lod_threshold = 0.0F;
+};
+
+// per draw data fetched by the vertex shader with draw_offset + gl_DrawID
+struct DrawData {
+  glm::vec4 position_scale;
+  glm::vec4 position_offset;
+};
+
+// push constants of the scene pipelines
+struct DrawConstants {
+  uint32_t draw_offset;
+};
+
+// one detail level of a batch of instances as seen by the command
+// generation shader, laid out to match the std430 DrawRecord block in
+// draw_commands.comp. The levels of a batch are consecutive records and
+// instances point at the first one
+struct DrawRecord {
+  uint32_t index_count;
+  uint32_t first_index;
+  int32_t vertex_offset;
+  uint32_t first_instance;
+  uint32_t instance_count;
+  uint32_t bucket;
+  uint32_t slot;  // fixed position inside the bucket for the fallback path
+  uint32_t lod_count;  // levels of the batch, repeated on every level
+  glm::vec4 bounding_sphere;  // object space center and radius
+  DrawData draw_data;
+  float lod_error;  // object space error of this level
+  uint32_t padding[3];
+};
+
+static_assert(sizeof(DrawRecord) == 96, "DrawRecord must match std430");
+
+// instance totals of the last completed frame
+struct CullingStats {
+  uint32_t visible = 0;
+  uint32_t culled = 0;
+};
+
+// GPU driven submission: draw records live in a storage buffer. A culling
+// pass tests every instance against the camera frustum and the Hi-Z pyramid
+// and compacts the survivors of each record, then a second pass turns the
+// records into VkDrawIndexedIndirectCommands and the CPU issues one
+// indirect draw per bucket regardless of how many records there are.
+class IndirectDrawPass {
+ public:
+  IndirectDrawPass(EngineContext& engine,
+                   const std::vector<Buffer>& instance_buffers,
+                   const std::vector<Buffer>& draw_data_buffers,
+                   const HiZPyramid& hiz_pyramid);
+  ~IndirectDrawPass();
+
+  IndirectDrawPass(const IndirectDrawPass&) = delete;
+  IndirectDrawPass(IndirectDrawPass&&) noexcept = delete;
+  auto operator=(const IndirectDrawPass&) -> IndirectDrawPass& = delete;
+  auto operator=(IndirectDrawPass&&) noexcept -> IndirectDrawPass& = delete;
+
+  // replaces the draw records of one frame in flight, instance_count is
+  // the number of sorted instances the records cover
+  void SetRecords(uint32_t frame, std::span<const DrawRecord> records,
+                  uint32_t instance_count);
+
+  // culls and generates the indirect commands of one phase, must be
+  // recorded outside rendering. The second phase is only recorded when
+  // view.occlusion is set and expects the pyramid to be built.
+  void Dispatch(vk::CommandBuffer buffer, uint32_t frame, const CullView& view,
+                CullPhase phase);
+
+  // picks up the counters of the last submission of this frame, call once
+  // its fence has been waited on
+  void ReadStats(uint32_t frame);
+
+  [[nodiscard]] auto GetStats() const -> const CullingStats& {
+    return stats_;
+  }
+
+  // sorted instance ids that survived culling, indexed by gl_InstanceIndex.
+  // Every detail level owns a full copy of the sorted range
+  [[nodiscard]] auto GetVisibleInstances(uint32_t frame) const
+      -> const Buffer& {
+    return frames_[frame].visible_instances;
+  }
+
+  // issues the draws of one bucket, the matching index buffer is bound
+  void Draw(vk::CommandBuffer buffer, uint32_t frame, uint32_t bucket,
+            vk::PipelineLayout layout, CullPhase phase) const;
+
+ private:
+  EngineContext& engine_;
+
+  bool use_draw_count_;
+  bool use_multi_draw_;
+
+  struct FrameResources {
+    Buffer records;
+    Buffer commands;        // per phase
+    Buffer counts;          // per phase and bucket
+    Buffer visible_instances;
+    Buffer visible_counts;  // first phase, then both phases, per record
+    Buffer stats;
+    Buffer stats_readback;
+    Buffer cull_uniforms;
+    vk::DescriptorSet descriptor_set;
+    uint32_t record_count = 0;
+    uint32_t instance_count = 0;
+    std::array<uint32_t, kMaxDrawBuckets> bucket_sizes{};
+    bool stats_pending = false;
+  };
+  std::vector<FrameResources> frames_;
+  CullingStats stats_;
+
+  // one flag per sorted instance, whether it passed the last occlusion
+  // test. Frames run in submission order so a single copy is shared.
+  Buffer visibility_;
+
+  glm::vec2 pyramid_size_{0.0F};
+  uint32_t pyramid_levels_ = 0;
+
+  std::unique_ptr<ComputePipeline> cull_pipeline_;
+  std::unique_ptr<ComputePipeline> command_pipeline_;
+
+  void CreateDescriptorSets(const std::vector<Buffer>& instance_buffers,
+                            const std::vector<Buffer>& draw_data_buffers,
+                            const HiZPyramid& hiz_pyramid);
+  void RecordCull(vk::CommandBuffer buffer, const FrameResources& resources,
+                  const CullView& view, CullPhase phase) const;
+};
+
+}  // namespace braque
+
+#endif  //INDIRECT_DRAW_PASS_H
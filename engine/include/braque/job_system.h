@@ -0,0 +1,57 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace braque {
+
+// Fixed pool of worker threads for data parallel CPU work. The calling
+// thread takes part in the work, so a pool with no workers runs
+// everything inline.
+class JobSystem {
+ public:
+  // defaults to one worker per hardware thread besides the caller
+  explicit JobSystem(uint32_t worker_count = DefaultWorkerCount());
+  ~JobSystem();
+
+  JobSystem(const JobSystem&) = delete;
+  JobSystem(JobSystem&&) noexcept = delete;
+  auto operator=(const JobSystem&) -> JobSystem& = delete;
+  auto operator=(JobSystem&&) noexcept -> JobSystem& = delete;
+
+  // splits [0, count) into ranges of at most grain items and returns once
+  // every range has run
+  void ParallelFor(size_t count, size_t grain,
+                   const std::function<void(size_t begin, size_t end)>& job);
+
+  // runs a long task on a worker, or inline when there are none
+  auto Async(std::function<void()> task) -> std::future<void>;
+
+  [[nodiscard]] auto GetWorkerCount() const -> uint32_t {
+    return static_cast<uint32_t>(workers_.size());
+  }
+
+  [[nodiscard]] static auto DefaultWorkerCount() -> uint32_t;
+
+ private:
+  std::vector<std::thread> workers_;
+
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::deque<std::function<void()>> queue_;
+  bool stopping_ = false;
+
+  void WorkerLoop();
+};
+
+}  // namespace braque
+
+#endif  // JOB_SYSTEM_H
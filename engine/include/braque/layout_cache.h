@@ -0,0 +1,67 @@
+#ifndef LAYOUT_CACHE_H
+#define LAYOUT_CACHE_H
+
+#include <cstdint>
+#include <mutex>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "braque/shader_reflection.h"
+
+namespace braque {
+
+// Creates every distinct descriptor set layout and pipeline layout once,
+// so shaders with the same interface share layouts and the handles can be
+// compared for compatibility. Layouts live as long as the cache. Safe to
+// use from several workers at once.
+class LayoutCache {
+ public:
+  explicit LayoutCache(vk::Device device);
+  ~LayoutCache();
+
+  LayoutCache(const LayoutCache&) = delete;
+  LayoutCache(LayoutCache&&) noexcept = delete;
+  auto operator=(const LayoutCache&) -> LayoutCache& = delete;
+  auto operator=(LayoutCache&&) noexcept -> LayoutCache& = delete;
+
+  // bindings of one set. Runtime arrays get runtime_array_size partially
+  // bound descriptors that can be written after binding, and the layout
+  // then needs an update after bind pool
+  auto GetSetLayout(std::span<const ShaderBinding> bindings,
+                    uint32_t runtime_array_size = 0)
+      -> vk::DescriptorSetLayout;
+
+  auto GetPipelineLayout(
+      std::span<const vk::DescriptorSetLayout> set_layouts,
+      std::span<const vk::PushConstantRange> push_constants)
+      -> vk::PipelineLayout;
+
+ private:
+  struct SetLayoutEntry {
+    std::vector<vk::DescriptorSetLayoutBinding> bindings;
+    std::vector<vk::DescriptorBindingFlags> flags;
+    vk::DescriptorSetLayout layout;
+  };
+
+  struct PipelineLayoutEntry {
+    std::vector<vk::DescriptorSetLayout> set_layouts;
+    std::vector<vk::PushConstantRange> push_constants;
+    vk::PipelineLayout layout;
+  };
+
+  vk::Device device_;
+
+  // layouts by the hash of their description, equal hashes are compared in
+  // full so a collision never returns a layout of other bindings
+  std::mutex mutex_;
+  std::unordered_map<uint64_t, std::vector<SetLayoutEntry>> set_layouts_;
+  std::unordered_map<uint64_t, std::vector<PipelineLayoutEntry>>
+      pipeline_layouts_;
+};
+
+}  // namespace braque
+
+#endif  // LAYOUT_CACHE_H
@@ -0,0 +1,90 @@
+#ifndef MATERIAL_H
+#define MATERIAL_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace braque {
+
+constexpr uint32_t kMaxMaterials = 4096;
+
+// texture index of a material without that texture
+constexpr uint32_t kNoTexture = 0xFFFFFFFF;
+
+// Parameters and bindless texture indices of a material, laid out to match
+// the std430 MaterialData block in triangle.frag. Factors multiply the
+// matching texture when it is present.
+struct MaterialData {
+  glm::vec4 base_color{1.0F};
+  glm::vec3 emissive{0.0F};
+  float roughness = 1.0F;
+  float metallic = 0.0F;
+  float normal_scale = 1.0F;
+  float occlusion_strength = 1.0F;
+  uint32_t albedo_texture = kNoTexture;
+  uint32_t normal_texture = kNoTexture;
+  uint32_t roughness_texture = kNoTexture;
+  uint32_t metallic_texture = kNoTexture;
+  uint32_t occlusion_texture = kNoTexture;
+};
+
+static_assert(sizeof(MaterialData) == 64, "MaterialData must match std430");
+
+// hash of the bytes of the material, there is no padding to skip
+[[nodiscard]] auto HashMaterial(const MaterialData& material) -> uint64_t;
+
+// contiguous entries to copy into the GPU table
+struct MaterialRange {
+  uint32_t first;
+  uint32_t count;
+};
+
+// CPU copy of the material table. Materials with the same content share an
+// index, and each frame in flight tracks which entries its copy of the
+// table is missing.
+class MaterialTable {
+ public:
+  explicit MaterialTable(uint32_t frame_count);
+
+  // index of an identical material if there is one, throws when full
+  auto Add(const MaterialData& material) -> uint32_t;
+
+  // changes the material of every instance that uses the index, throws
+  // std::out_of_range for an index Add did not return
+  void Set(uint32_t index, const MaterialData& material);
+
+  [[nodiscard]] auto Get(uint32_t index) const -> const MaterialData& {
+    return materials_[index];
+  }
+  [[nodiscard]] auto GetData() const -> const MaterialData* {
+    return materials_.data();
+  }
+  [[nodiscard]] auto Size() const -> uint32_t {
+    return static_cast<uint32_t>(materials_.size());
+  }
+
+  // runs of entries changed since the frame's copy was last written,
+  // clears them for that frame
+  auto TakeDirtyRanges(uint32_t frame) -> std::vector<MaterialRange>;
+
+ private:
+  std::vector<MaterialData> materials_;
+  std::unordered_map<uint64_t, std::vector<uint32_t>> lookup_;
+
+  struct DirtySet {
+    std::vector<uint8_t> flags;
+    std::vector<uint32_t> indices;
+  };
+  std::vector<DirtySet> dirty_;
+
+  [[nodiscard]] auto Find(const MaterialData& material, uint64_t hash) const
+      -> int64_t;
+  void MarkDirty(uint32_t index);
+};
+
+}  // namespace braque
+
+#endif  // MATERIAL_H
@@ -0,0 +1,59 @@
+#ifndef MESH_LOD_H
+#define MESH_LOD_H
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace braque {
+
+// detail levels per mesh, level 0 is the imported mesh
+constexpr uint32_t kMaxMeshLods = 4;
+
+// each level aims for this fraction of the indices of the previous one
+constexpr float kLodReduction = 0.5F;
+
+// levels are not generated past this error relative to the mesh radius
+constexpr float kLodMaxRelativeError = 0.25F;
+
+// projected error in pixels a level may show before a finer one is used
+constexpr float kDefaultLodThreshold = 1.0F;
+
+// geometric error is the object space distance the surface moved
+struct LodLevel {
+  std::vector<uint32_t> indices;
+  float error = 0.0F;
+};
+
+// Quadric error edge collapse simplification of a triangle list. Vertices
+// collapse onto neighbouring vertices and are never moved or added, so the
+// result indexes the same vertex buffer. Vertices on open borders and on
+// attribute seams, where several vertices share a position, are kept.
+// Stops at target_index_count or before a collapse would exceed max_error.
+[[nodiscard]] auto SimplifyMesh(std::span<const glm::vec3> positions,
+                                std::span<const uint32_t> indices,
+                                size_t target_index_count, float max_error)
+    -> LodLevel;
+
+// level 0 followed by progressively coarser levels, generation stops when
+// a level no longer reduces the mesh enough to be worth a draw
+[[nodiscard]] auto BuildLodChain(std::span<const glm::vec3> positions,
+                                 std::span<const uint32_t> indices,
+                                 float max_error) -> std::vector<LodLevel>;
+
+// pixels covered by one object space unit at distance one, for a vertical
+// field of view in degrees
+[[nodiscard]] auto ComputeLodScale(float fov_degrees, float viewport_height)
+    -> float;
+
+// coarsest level whose error, scaled by lod_scale / distance, stays within
+// threshold pixels. Errors must not decrease from one level to the next.
+// Mirrors selectLod in cull_instances.comp
+[[nodiscard]] auto SelectLod(std::span<const float> errors, float distance,
+                             float lod_scale, float threshold) -> uint32_t;
+
+}  // namespace braque
+
+#endif  // MESH_LOD_H
@@ -0,0 +1,94 @@
+#ifndef OCCLUSION_RASTERIZER_H
+#define OCCLUSION_RASTERIZER_H
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "frustum.h"
+
+namespace braque {
+
+class JobSystem;
+
+constexpr uint32_t kOcclusionBufferWidth = 256;
+constexpr uint32_t kOcclusionBufferHeight = 128;
+
+// rows rasterized by one job, every band owns its rows of the buffer
+constexpr uint32_t kOcclusionBandHeight = 8;
+
+// object space triangles of an occluder, usually a simplified hull of the
+// mesh it stands in for
+struct OccluderMesh {
+  std::vector<glm::vec3> positions;
+  std::vector<uint32_t> indices;
+};
+
+struct Occluder {
+  const OccluderMesh* mesh;
+  glm::mat4 transform;
+};
+
+// Low resolution CPU depth buffer for occlusion culling without the GPU.
+// Occluders are rasterized into it with a 4 wide SIMD kernel, split into
+// horizontal bands across the job system, and occludee boxes are then
+// tested against it before their draws are recorded. Depth is zero to one
+// with nearer values smaller, each texel keeps the nearest occluder.
+class OcclusionRasterizer {
+ public:
+  // width must be a multiple of 4
+  explicit OcclusionRasterizer(uint32_t width = kOcclusionBufferWidth,
+                               uint32_t height = kOcclusionBufferHeight);
+
+  // clears the buffer and draws every occluder, triangles crossing the
+  // camera plane are skipped since leaving them out is conservative
+  void Rasterize(JobSystem& jobs, const glm::mat4& view_projection,
+                 std::span<const Occluder> occluders);
+
+  // true unless every texel under the projected box is covered by an
+  // occluder nearer than the box
+  [[nodiscard]] auto IsVisible(const Aabb& box) const -> bool;
+
+  // clears visible[i] for the boxes that are occluded, entries that are
+  // already 0 are left alone
+  void TestBoxes(JobSystem& jobs, std::span<const Aabb> boxes,
+                 std::span<uint8_t> visible) const;
+
+  [[nodiscard]] auto GetWidth() const -> uint32_t { return width_; }
+  [[nodiscard]] auto GetHeight() const -> uint32_t { return height_; }
+
+  // row major, row 0 is the top of the screen
+  [[nodiscard]] auto GetDepth() const -> std::span<const float> {
+    return depth_;
+  }
+
+  [[nodiscard]] auto GetTriangleCount() const -> uint32_t {
+    return static_cast<uint32_t>(triangles_.size());
+  }
+
+ private:
+  // screen space triangle as edge and depth planes over pixel positions
+  struct ScreenTriangle {
+    glm::vec3 edges[3];     // a * x + b * y + c >= 0 inside every edge
+    glm::vec3 depth_plane;  // z = a * x + b * y + c
+    uint32_t min_x, max_x, min_y, max_y;  // pixel bounds, max exclusive
+    bool valid;
+  };
+
+  uint32_t width_;
+  uint32_t height_;
+  glm::mat4 view_projection_{1.0F};
+  std::vector<float> depth_;
+  std::vector<ScreenTriangle> triangles_;
+
+  void SetupTriangles(JobSystem& jobs, std::span<const Occluder> occluders);
+  void RasterizeBand(uint32_t row_begin, uint32_t row_end);
+  void RasterizeTriangle(const ScreenTriangle& triangle, uint32_t row_begin,
+                         uint32_t row_end);
+};
+
+}  // namespace braque
+
+#endif  // OCCLUSION_RASTERIZER_H
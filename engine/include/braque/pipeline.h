@@ -5,15 +5,81 @@
 #ifndef PIPELINE_HPP
 #define PIPELINE_HPP
 
+#include <array>
+#include <atomic>
+#include <string>
+#include <vector>
+
 #include <vulkan/vulkan.hpp>
 
+#include "braque/specialization.h"
+#include "braque/vertex_format.h"
+
 namespace braque {
 
+class PipelineLibrary;
 class Shader;
 
+// every piece of fixed function state that differs between pipelines
+struct PipelineConfig {
+  VertexLayout vertex_layout = VertexLayout::eFull;
+  VertexStreams vertex_streams = kAllVertexStreams;
+  bool depth_only = false;  // no color attachment, e.g. prepass or shadows
+  vk::SampleCountFlagBits samples = vk::SampleCountFlagBits::e4;
+  vk::CullModeFlags cull_mode = vk::CullModeFlagBits::eBack;
+  bool depth_write = true;
+  vk::CompareOp depth_compare = vk::CompareOp::eLess;
+
+  auto operator==(const PipelineConfig&) const -> bool = default;
+};
+
+inline void HashCombine(uint64_t& seed, uint64_t value) {
+  seed ^= value + 0x9E3779B97F4A7C15ULL + (seed << 6) + (seed >> 2);
+}
+
+// Fixed function state of a config as create infos. With extended dynamic
+// state the cull mode, depth write, depth compare and topology are left to
+// Pipeline::Bind. The create infos point into the members, so it is never
+// copied or moved.
+struct PipelineState {
+  PipelineState(const PipelineConfig& config, bool extended_dynamic_state);
+
+  PipelineState(const PipelineState&) = delete;
+  PipelineState(PipelineState&&) = delete;
+  auto operator=(const PipelineState&) -> PipelineState& = delete;
+  auto operator=(PipelineState&&) -> PipelineState& = delete;
+
+  VertexInputDescription vertex_input;
+  vk::PipelineVertexInputStateCreateInfo vertex_input_state;
+  vk::PipelineInputAssemblyStateCreateInfo input_assembly;
+  vk::Viewport viewport;
+  vk::Rect2D scissor;
+  vk::PipelineViewportStateCreateInfo viewport_state;
+  vk::PipelineRasterizationStateCreateInfo rasterization;
+  vk::PipelineMultisampleStateCreateInfo multisample;
+  vk::PipelineColorBlendAttachmentState blend_attachment;
+  vk::PipelineColorBlendStateCreateInfo color_blend;
+  vk::PipelineDepthStencilStateCreateInfo depth_stencil;
+  std::vector<vk::DynamicState> dynamic_states;
+  vk::PipelineDynamicStateCreateInfo dynamic_state;
+  vk::Format color_format;
+  vk::PipelineRenderingCreateInfo rendering;
+
+  // points every state of the create info at the members
+  void Apply(vk::GraphicsPipelineCreateInfo& info) const;
+};
+
 class Pipeline {
 public:
-  explicit Pipeline(vk::Device device, Shader& shader, vk::DescriptorSetLayout descriptor_set_layout);
+  // compiled as one monolithic pipeline. The layout comes from the layout
+  // cache and outlives the pipeline
+  explicit Pipeline(vk::Device device, vk::PipelineCache cache, Shader& shader, vk::PipelineLayout layout, const PipelineConfig& config = {}, bool extended_dynamic_state = false);
+  // linked from library parts without optimization, which is fast. The
+  // library compiles the parts it does not have yet
+  Pipeline(vk::Device device, PipelineLibrary& library,
+           const std::string& vertex_shader, const std::string& fragment_shader,
+           vk::PipelineLayout layout, const PipelineConfig& config,
+           const SpecializationConstants& constants = {});
   ~Pipeline();
 
   Pipeline(const Pipeline& other) = delete;
@@ -21,6 +87,12 @@ public:
   Pipeline& operator=(const Pipeline& other) = delete;
   Pipeline& operator=(Pipeline&& other) noexcept = delete;
 
+  // links the parts again with link time optimization, Bind switches to
+  // the result once it exists. Meant for a worker while the pipeline is
+  // already in use, does nothing for monolithic pipelines
+  void Optimize();
+
+  // also sets the state that is dynamic with extended dynamic state
   void Bind(vk::CommandBuffer buffer);
   static void SetScissor(vk::CommandBuffer buffer, vk::Rect2D);
   static void SetViewport(vk::CommandBuffer buffer, const vk::Viewport & viewport );
@@ -28,10 +100,21 @@ public:
 
   [[nodiscard]] vk::PipelineLayout VulkanLayout() const;
 
+  [[nodiscard]] auto IsOptimized() const -> bool {
+    return optimized_.load(std::memory_order_acquire) != VK_NULL_HANDLE;
+  }
+
 private:
   vk::Device device;
   vk::PipelineLayout layout_;
   vk::Pipeline pipeline;
+  PipelineConfig config_;
+  bool extended_dynamic_state_ = false;
+
+  // linked pipelines and their parts belong to the library
+  PipelineLibrary* library_ = nullptr;
+  std::array<vk::Pipeline, 4> parts_;
+  std::atomic<VkPipeline> optimized_{VK_NULL_HANDLE};
 };
 
 } // namespace braque
@@ -0,0 +1,50 @@
+#ifndef PIPELINE_CACHE_H
+#define PIPELINE_CACHE_H
+
+#include <cstdint>
+#include <filesystem>
+#include <span>
+
+#include <vulkan/vulkan.hpp>
+
+namespace braque {
+
+// relative to the working directory, like the asset paths
+constexpr auto kPipelineCachePath = "pipeline_cache.bin";
+
+// true when the blob starts with a cache header written by the same driver
+// for the same device, anything else is dropped instead of handed to it
+[[nodiscard]] auto IsPipelineCacheCompatible(
+    std::span<const uint8_t> data,
+    const vk::PhysicalDeviceProperties& properties) -> bool;
+
+// Driver pipeline cache shared by every graphics and compute pipeline.
+// It starts from the file at path when that was written for this device,
+// and the cache is saved back to it when destroyed.
+class PipelineCache {
+ public:
+  PipelineCache(vk::Device device,
+                const vk::PhysicalDeviceProperties& properties,
+                std::filesystem::path path);
+  ~PipelineCache();
+
+  PipelineCache(const PipelineCache&) = delete;
+  PipelineCache(PipelineCache&&) noexcept = delete;
+  auto operator=(const PipelineCache&) -> PipelineCache& = delete;
+  auto operator=(PipelineCache&&) noexcept -> PipelineCache& = delete;
+
+  // writes a temporary file and renames it over the old cache, so a crash
+  // never leaves a truncated cache behind
+  void Save() const;
+
+  [[nodiscard]] auto Get() const -> vk::PipelineCache { return cache_; }
+
+ private:
+  vk::Device device_;
+  std::filesystem::path path_;
+  vk::PipelineCache cache_;
+};
+
+}  // namespace braque
+
+#endif  // PIPELINE_CACHE_H
@@ -0,0 +1,122 @@
+#ifndef PIPELINE_LIBRARY_H
+#define PIPELINE_LIBRARY_H
+
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "braque/pipeline.h"
+#include "braque/specialization.h"
+
+namespace braque {
+
+// the four VK_EXT_graphics_pipeline_library parts of a pipeline
+enum class PipelinePart : uint8_t {
+  eVertexInput,
+  ePreRasterization,
+  eFragmentShader,
+  eFragmentOutput
+};
+
+using PipelineParts = std::array<vk::Pipeline, 4>;
+
+// Compiles each part of a graphics pipeline once for the state it depends
+// on, so a new permutation only compiles the parts no earlier pipeline
+// shared and then links. With extended dynamic state the cull and depth
+// state are not part of any key. Parts and linked pipelines are owned by
+// the library, layouts by the layout cache. Safe to use from several
+// workers at once.
+class PipelineLibrary {
+ public:
+  PipelineLibrary(vk::Device device, vk::PipelineCache cache,
+                  bool extended_dynamic_state);
+  ~PipelineLibrary();
+
+  PipelineLibrary(const PipelineLibrary&) = delete;
+  PipelineLibrary(PipelineLibrary&&) noexcept = delete;
+  auto operator=(const PipelineLibrary&) -> PipelineLibrary& = delete;
+  auto operator=(PipelineLibrary&&) noexcept -> PipelineLibrary& = delete;
+
+  // an empty fragment shader builds a fragment part without a shader, for
+  // depth only pipelines. The constants specialize both shader parts
+  auto GetParts(const std::string& vertex_shader,
+                const std::string& fragment_shader,
+                const PipelineConfig& config, vk::PipelineLayout layout,
+                const SpecializationConstants& constants = {})
+      -> PipelineParts;
+
+  // optimized links take longer but run as fast as monolithic pipelines
+  auto Link(const PipelineParts& parts, vk::PipelineLayout layout,
+            bool optimize) -> vk::Pipeline;
+
+  // forgets the parts compiled from a SPIR-V module that changed, matched
+  // by file name, so later pipelines compile it again. Pipelines linked
+  // from the old parts keep working
+  void Evict(const std::string& shader);
+
+  [[nodiscard]] auto HasExtendedDynamicState() const -> bool {
+    return extended_dynamic_state_;
+  }
+
+ private:
+  vk::Device device_;
+  vk::PipelineCache cache_;
+  bool extended_dynamic_state_;
+
+  // everything a part is built from, the config holds only the state of
+  // the part and defaults elsewhere. Hashes only pick the bucket, keys are
+  // compared in full so a collision never returns another pipeline
+  struct PartKey {
+    PipelinePart part;
+    std::string shader;
+    vk::PipelineLayout layout;
+    SpecializationConstants constants;
+    PipelineConfig config;
+
+    auto operator==(const PartKey&) const -> bool = default;
+  };
+
+  struct PartKeyHash {
+    auto operator()(const PartKey& key) const -> size_t;
+  };
+
+  struct LinkKey {
+    PipelineParts parts;
+    vk::PipelineLayout layout;
+    bool optimize;
+
+    auto operator==(const LinkKey&) const -> bool = default;
+  };
+
+  struct LinkKeyHash {
+    auto operator()(const LinkKey& key) const -> size_t;
+  };
+
+  std::mutex mutex_;
+  std::unordered_map<PartKey, vk::Pipeline, PartKeyHash> parts_;
+  std::unordered_map<LinkKey, vk::Pipeline, LinkKeyHash> linked_;
+  // evicted parts, linked pipelines may still need them
+  std::vector<vk::Pipeline> evicted_;
+
+  // compiles with the full config, the driver ignores the rest
+  auto GetPart(const PartKey& key, const PipelineConfig& config,
+               vk::PipelineLayout layout,
+               const SpecializationConstants& constants) -> vk::Pipeline;
+  auto CompilePart(PipelinePart part, const std::string& shader,
+                   const PipelineConfig& config, vk::PipelineLayout layout,
+                   const SpecializationConstants& constants) -> vk::Pipeline;
+  // keeps the first pipeline stored under the key, a racing duplicate is
+  // destroyed
+  template <typename Pipelines>
+  auto Store(Pipelines& pipelines, const typename Pipelines::key_type& key,
+             vk::Pipeline pipeline) -> vk::Pipeline;
+};
+
+}  // namespace braque
+
+#endif  // PIPELINE_LIBRARY_H
@@ -0,0 +1,143 @@
+#ifndef PIPELINE_MANAGER_H
+#define PIPELINE_MANAGER_H
+
+#include <atomic>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "braque/pipeline.h"
+
+namespace braque {
+
+class EngineContext;
+class PipelineLibrary;
+class Uniforms;
+
+// shaders and state of one graphics pipeline permutation
+struct PipelineDesc {
+  std::string vertex_shader;
+  std::string fragment_shader;  // empty for depth only pipelines
+  PipelineConfig config;
+  SpecializationConstants constants;  // permutations the driver folds in
+
+  auto operator==(const PipelineDesc&) const -> bool = default;
+};
+
+[[nodiscard]] auto HashPipelineDesc(const PipelineDesc& desc) -> uint64_t;
+
+struct PipelineDescHash {
+  auto operator()(const PipelineDesc& desc) const -> size_t {
+    return static_cast<size_t>(HashPipelineDesc(desc));
+  }
+};
+
+struct PipelineHandle {
+  uint32_t index = UINT32_MAX;
+
+  [[nodiscard]] auto IsValid() const -> bool { return index != UINT32_MAX; }
+};
+
+// Compiles graphics pipelines on the job system. Identical requests share
+// one pipeline, and a handle has no pipeline until its compile finished,
+// so callers skip the draw or use a fallback instead of stalling. With
+// graphics pipeline libraries a pipeline is ready after a fast link of
+// shared parts and is relinked with optimization afterwards on the same
+// worker. Layouts are built from the reflected shaders, with the frame set
+// of Uniforms as set 0 and its push constants, so draws keep their bound
+// set across pipelines. Requests and lookups come from the render thread.
+class PipelineManager {
+ public:
+  PipelineManager(EngineContext& engine, const Uniforms& uniforms);
+  ~PipelineManager();
+
+  PipelineManager(const PipelineManager&) = delete;
+  PipelineManager(PipelineManager&&) noexcept = delete;
+  auto operator=(const PipelineManager&) -> PipelineManager& = delete;
+  auto operator=(PipelineManager&&) noexcept -> PipelineManager& = delete;
+
+  // starts compiling unless the permutation was requested before
+  auto Request(const PipelineDesc& desc) -> PipelineHandle;
+
+  // requests every permutation and waits for them, for loading screens
+  void WarmUp(std::span<const PipelineDesc> descs);
+
+  void Wait(PipelineHandle handle) const;
+
+  // null while compiling and after a failed compile
+  [[nodiscard]] auto Get(PipelineHandle handle) const -> Pipeline*;
+  [[nodiscard]] auto IsReady(PipelineHandle handle) const -> bool {
+    return Get(handle) != nullptr;
+  }
+
+  [[nodiscard]] auto GetPendingCount() const -> uint32_t;
+
+  // recompiles the pipelines that use the SPIR-V module, e.g. after the
+  // ShaderWatcher rebuilt it, including those whose compile failed. They
+  // keep drawing with the old pipeline until ApplyReloads, and keep it if
+  // the new one fails. Waits for their first compile to finish optimizing,
+  // pipelines still in their first compile may have read the old module
+  // and reload from ApplyReloads once it finished
+  void Reload(const std::string& shader);
+
+  // swaps in the reloaded pipelines and starts the reloads that waited for
+  // a first compile, call at the start of a frame after waiting on its
+  // fence. Replaced pipelines are destroyed once no frame in flight can use
+  // them
+  void ApplyReloads();
+
+ private:
+  enum class Status : uint8_t { ePending, eReady, eFailed };
+
+  struct Entry {
+    PipelineDesc desc;
+    std::unique_ptr<Pipeline> pipeline;
+    std::atomic<Status> status{Status::ePending};
+    std::future<void> job;
+
+    // replacement compiled by Reload, taken once reload_ready is set
+    std::unique_ptr<Pipeline> reloaded;
+    std::atomic<bool> reload_ready{false};
+    std::future<void> reload_job;
+    // the module changed during the first compile
+    bool reload_wanted = false;
+  };
+
+  struct RetiredPipeline {
+    std::unique_ptr<Pipeline> pipeline;
+    uint32_t frames_left;
+  };
+
+  EngineContext& engine_;
+  const Uniforms& uniforms_;
+  bool extended_dynamic_state_;
+
+  // outlives the entries, their linked pipelines belong to it
+  std::unique_ptr<PipelineLibrary> library_;
+
+  // entries never move, workers write into theirs while more are added
+  std::vector<std::unique_ptr<Entry>> entries_;
+  std::unordered_map<PipelineDesc, uint32_t, PipelineDescHash> lookup_;
+
+  std::vector<RetiredPipeline> retired_;
+
+  void Compile(Entry& entry) const;
+  void StartReload(Entry& entry);
+  // monolithic, so the pipeline owns everything it replaces
+  void Recompile(Entry& entry) const;
+
+  // throws when the shaders need inputs or frame set bindings nobody
+  // provides
+  [[nodiscard]] auto GetLayout(const PipelineDesc& desc) const
+      -> vk::PipelineLayout;
+};
+
+}  // namespace braque
+
+#endif  // PIPELINE_MANAGER_H
@@ -5,12 +5,47 @@
 #ifndef RENDERER_HPP
 #define RENDERER_HPP
 
+#include <memory>
+#include <span>
+#include <vector>
+
 #include "vulkan/vulkan.hpp"
 
 namespace braque {
 
+class DescriptorAllocator;
+class LayoutCache;
+class PipelineCache;
+
 using VulkanString = const char*;
 
+// optional device capabilities detected at startup
+struct DeviceFeatures {
+  bool multi_draw_indirect = false;
+  bool draw_indirect_count = false;
+  // VK_EXT_graphics_pipeline_library, pipelines are linked from parts
+  bool graphics_pipeline_library = false;
+  // VK_EXT_extended_dynamic_state, cull, depth and topology set at bind
+  bool extended_dynamic_state = false;
+  // subgroup arithmetic in compute shaders, scans within a subgroup
+  bool subgroup_arithmetic = false;
+};
+
+// Queues the renderer submits to. Async compute is a second queue next to
+// graphics, preferably from a family without graphics whose work fills the
+// compute units raster passes leave idle, otherwise a second queue of the
+// graphics family. Without either, compute shares the graphics queue.
+struct QueueSelection {
+  uint32_t graphics_family = 0;
+  uint32_t compute_family = 0;
+  uint32_t compute_index = 0;  // of the queue inside compute_family
+  bool async_compute = false;
+};
+
+// throws when no family supports graphics
+[[nodiscard]] auto SelectQueues(
+    std::span<const vk::QueueFamilyProperties> families) -> QueueSelection;
+
 class Renderer {
  public:
   Renderer();
@@ -32,6 +67,23 @@ class Renderer {
     return m_physicalDevice;
   }
 
+  [[nodiscard]] auto GetFeatures() const -> const DeviceFeatures& {
+    return features_;
+  }
+
+  // pass to every pipeline creation, persisted across runs
+  [[nodiscard]] auto GetPipelineCache() const -> vk::PipelineCache;
+
+  // descriptor set and pipeline layouts shared by every pipeline
+  [[nodiscard]] auto GetLayoutCache() const -> LayoutCache& {
+    return *layout_cache_;
+  }
+
+  // sets that live as long as the renderer, e.g. those of compute passes
+  [[nodiscard]] auto GetDescriptorAllocator() const -> DescriptorAllocator& {
+    return *descriptor_allocator_;
+  }
+
   [[nodiscard]] auto getGraphicsQueue() const -> vk::Queue {
     return m_graphicsQueue;
   }
@@ -40,6 +92,23 @@ class Renderer {
     return graphicsQueueFamilyIndex;
   }
 
+  // the graphics queue when there is no async compute queue
+  [[nodiscard]] auto GetComputeQueue() const -> vk::Queue {
+    return compute_queue_;
+  }
+
+  [[nodiscard]] auto GetComputeQueueFamilyIndex() const -> uint32_t {
+    return queues_.compute_family;
+  }
+
+  [[nodiscard]] auto HasAsyncCompute() const -> bool {
+    return queues_.async_compute;
+  }
+
+  // every family a resource used by both queues is shared with, resources
+  // exchanged between two families are created concurrent
+  [[nodiscard]] auto GetQueueFamilyIndices() const -> std::vector<uint32_t>;
+
   [[nodiscard]] auto CreateCommandBuffer() const -> vk::CommandBuffer;
 
   void SubmitAndWait(vk::CommandBuffer cmd) const;
@@ -47,22 +116,33 @@ class Renderer {
  private:
   vk::Instance instance_;
   vk::PhysicalDevice m_physicalDevice;
+  DeviceFeatures features_;
+  QueueSelection queues_;
   vk::Device m_device;
   vk::Queue m_graphicsQueue;
+  vk::Queue compute_queue_;
 
   // used for creating command buffers
   vk::CommandPool command_pool_;
 
+  std::unique_ptr<PipelineCache> pipeline_cache_;
+  std::unique_ptr<LayoutCache> layout_cache_;
+  std::unique_ptr<DescriptorAllocator> descriptor_allocator_;
+
   uint32_t graphicsQueueFamilyIndex;
 
   static vk::Instance createInstance();
   static vk::PhysicalDevice createPhysicalDevice(vk::Instance instance);
-  static vk::Device createLogicalDevice(vk::PhysicalDevice physicalDevice);
+  static DeviceFeatures QueryFeatures(vk::PhysicalDevice physicalDevice);
+  static vk::Device createLogicalDevice(vk::PhysicalDevice physicalDevice,
+                                        const DeviceFeatures& features,
+                                        const QueueSelection& queues);
   static vk::Queue createGraphicsQueue(vk::Device device, uint32_t graphicsQueueFamilyIndex);
   static vk::CommandPool CreateCommandPool(vk::Device device, uint32_t graphicsQueueFamilyIndex);
 
   static auto getInstanceExtensions() -> std::vector<VulkanString>;
-  static auto getDeviceExtensions() -> std::vector<VulkanString>;
+  static auto getDeviceExtensions(const DeviceFeatures& features)
+      -> std::vector<VulkanString>;
   static auto getInstanceFlags() -> vk::InstanceCreateFlags;
 };
 
@@ -5,22 +5,37 @@
 #ifndef RENDERING_STAGE_HPP
 #define RENDERING_STAGE_HPP
 
+#include <array>
 #include <memory>
+#include <vector>
 #include <vulkan/vulkan.hpp>
 
+#include "braque/compute_pipeline.h"
+#include "braque/descriptor_allocator.h"
+#include "braque/hiz_pyramid.h"
 #include "braque/pipeline.h"
+#include "braque/pipeline_manager.h"
+#include "braque/vertex_format.h"
 
 namespace braque {
 // Forward declarations
 class EngineContext;
 class Image;
-class Shader;
 class Uniforms;
 class Swapchain;
 
+// places in the frame outside of rendering passes where compute work runs
+enum class FramePoint : uint8_t {
+  eBeforeDraws,    // after culling, before the first phase draws
+  eBetweenPhases,  // after the first phase drew its depth
+  eAfterDraws,     // after the last phase, before the resolve
+};
+
+constexpr uint32_t kFramePointCount = 3;
+
 class RenderingStage {
  public:
-  explicit RenderingStage(EngineContext& engine, Swapchain& swapchain, Uniforms& uniforms);
+  explicit RenderingStage(EngineContext& engine, Swapchain& swapchain, Uniforms& uniforms, VertexLayout vertex_layout = kDefaultVertexLayout);
   ~RenderingStage();
 
   // make sure copy and move are deleted
@@ -34,10 +49,37 @@ class RenderingStage {
   }
 
   // get PipelineLayout
-  [[nodiscard]] auto GetPipeline() const -> Pipeline& { return *pipeline; }
+  [[nodiscard]] auto GetPipeline() const -> Pipeline& {
+    return *pipelines_->Get(pipelineHandle);
+  }
+
+  // compiles further permutations without stalling the frame
+  [[nodiscard]] auto GetPipelineManager() const -> PipelineManager& {
+    return *pipelines_;
+  }
+
+  // depth pyramid of the current frame, built between the culling phases
+  [[nodiscard]] auto GetHiZPyramid() const -> HiZPyramid& {
+    return *hizPyramid;
+  }
+
+  // transient descriptor sets of the current frame, e.g. per draw sets
+  [[nodiscard]] auto GetFrameDescriptors() const -> DescriptorSetCache& {
+    return *frameDescriptors;
+  }
+
+  // recycles the current frame's transient sets, call after waiting on
+  // its fence
+  void BeginFrame();
+
+  // records the pass at the point of every frame, after the passes added
+  // before. Passes insert their own barriers, see InsertMemoryBarrier
+  void AddComputePass(FramePoint point, ComputePass pass);
+  void RecordComputePasses(vk::CommandBuffer buffer, FramePoint point) const;
 
   static void begin(vk::CommandBuffer buffer);
-  void beginRenderingPass(vk::CommandBuffer buffer) const;
+  // clear is false for passes that continue drawing into the frame
+  void beginRenderingPass(vk::CommandBuffer buffer, bool clear = true) const;
   void prepareImageForColorAttachment(vk::CommandBuffer buffer) const;
   void prepareImageForDisplay(vk::CommandBuffer buffer) const;
   static void endRenderingPass(vk::CommandBuffer buffer);
@@ -61,8 +103,13 @@ class RenderingStage {
 
   std::vector<Image> postprocessingImages;
 
-  std::unique_ptr<Shader> shader;
-  std::unique_ptr<Pipeline> pipeline;
+  std::unique_ptr<HiZPyramid> hizPyramid;
+  std::unique_ptr<DescriptorSetCache> frameDescriptors;
+
+  std::array<std::vector<ComputePass>, kFramePointCount> computePasses;
+
+  std::unique_ptr<PipelineManager> pipelines_;
+  PipelineHandle pipelineHandle;
 
   void createDescriptorPool();
 };
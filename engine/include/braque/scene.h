@@ -7,45 +7,221 @@
 
 #include <vulkan/vulkan.hpp>
 #include <glm/glm.hpp>
+#include <array>
+#include <future>
+#include <memory>
+#include <span>
+#include <string>
 #include <vector>
 
 #include "buffer.h"
+#include "bvh.h"
+#include "draw_packet.h"
+#include "indirect_draw_pass.h"
+#include "material.h"
+#include "mesh_lod.h"
+#include "occlusion_rasterizer.h"
+#include "sphere_bounds.h"
+#include "vertex_format.h"
 
 namespace braque {
 
 // forward declarations
+class Camera;
 class EngineContext;
+class HiZPyramid;
 class Texture;
 class Uniforms;
 
-constexpr vk::DeviceSize kVertexBufferSize = 32000;
+// packed vertex streams of every mesh, about 760k vertices with every
+// attribute present
+constexpr vk::DeviceSize kVertexBufferSize = 32 * 1024 * 1024;
+// indices of every mesh and its detail levels, 4M 32-bit indices
+constexpr vk::DeviceSize kIndexBufferSize = 16 * 1024 * 1024;
 
+// meshes below this vertex count are imported with 16-bit indices
+constexpr size_t kMaxUint16Vertices = 65536;
+
+constexpr uint32_t kMaxMeshes = 4096;
+
+// index range of one detail level, every level shares the mesh vertices
+struct MeshLod {
+  uint32_t index_offset;  // first index inside the region of index_type
+  uint32_t index_count;
+  float error;  // object space distance the surface moved, 0 for level 0
+};
+
+// names live in Scene::mesh_names_, off the draw path
 struct Mesh {
-  std::string name;
   int32_t vertex_offset;
-  uint32_t index_offset;
-  uint32_t index_count;
+  vk::IndexType index_type = vk::IndexType::eUint32;
+
+  // level 0 is the imported mesh, then progressively coarser levels
+  std::array<MeshLod, kMaxMeshLods> lods{};
+  uint32_t lod_count = 1;
+
+  // dequantization for compact vertex layouts
+  glm::vec3 position_scale{1.0F};
+  glm::vec3 position_offset{0.0F};
+
+  // object space center and radius used for culling
+  glm::vec4 bounding_sphere{0.0F};
 };
 
-struct Vertex {
-  glm::vec3 position;
-  glm::vec3 normal;
-  glm::vec3 color;
-  glm::vec2 uv;
+constexpr uint32_t kMaxInstances = 131072;
+
+// the instance BVH is rebuilt in the background once refits have made it
+// this much more expensive than a fresh build
+constexpr float kBvhRebuildCostRatio = 1.5F;
+
+// per instance data read by the vertex shader through the visible instance
+// list, laid out to match the std430 InstanceData block in the shaders
+struct InstanceData {
+  glm::mat4 transform;
+  uint32_t material_index;  // entry in the material table
+  uint32_t mesh_index;
+  uint32_t draw_index;  // draw record of the batch, set when sorting
+  uint32_t padding;
+};
+
+static_assert(sizeof(InstanceData) == 80, "InstanceData must match std430");
+
+// all instances of one mesh, drawn with a single instanced draw
+struct DrawBatch {
+  uint32_t mesh;
+  uint32_t first_instance;
+  uint32_t instance_count;
 };
 
 class Scene {
 public:
-  explicit Scene(EngineContext& engine, Uniforms& uniforms);
+  explicit Scene(EngineContext& engine, Uniforms& uniforms,
+                 const HiZPyramid& pyramid,
+                 VertexLayout vertex_layout = kDefaultVertexLayout);
   ~Scene();
 
   void UploadSceneData();
-  void Draw(vk::CommandBuffer buffer);
+  // only the requested vertex streams are bound, depth passes use
+  // kPositionStreamOnly. Direct draws have nothing to add in the second
+  // culling phase
+  void Draw(vk::CommandBuffer buffer, vk::PipelineLayout layout,
+            VertexStreams streams = kAllVertexStreams,
+            CullPhase phase = CullPhase::eVisibleLastFrame);
   void AddCube();
 
+  // imports a mesh, picking the smallest index type that fits and
+  // generating its detail levels
+  auto AddMesh(const std::string& name, std::span<const Vertex> vertices,
+               std::span<const uint32_t> indices) -> uint32_t;
+
+  // places a copy of a mesh in the world, instances of the same mesh are
+  // batched into one instanced draw. Throws std::out_of_range for an
+  // unknown mesh or material
+  auto AddInstance(uint32_t mesh, const glm::mat4& transform,
+                   uint32_t material_index = 0) -> uint32_t;
+  // throw std::out_of_range for an instance AddInstance did not return
+  // or a material AddMaterial did not
+  void SetTransform(uint32_t instance, const glm::mat4& transform);
+  void SetInstanceMaterial(uint32_t instance, uint32_t material_index);
+
+  // materials with the same content share an index, the default material
+  // at index 0 uses the scene texture
+  auto AddMaterial(const MaterialData& material) -> uint32_t;
+  // every instance using the material sees the change
+  void SetMaterial(uint32_t material_index, const MaterialData& material);
+  [[nodiscard]] auto GetMaterials() const -> const MaterialTable& {
+    return materials_;
+  }
+
+  // instances of the mesh hide what is behind them from the software
+  // occlusion rasterizer, the triangles can be a simplified hull
+  void SetOccluder(uint32_t mesh, std::span<const glm::vec3> positions,
+                   std::span<const uint32_t> indices);
+
+  // writes changed instance data for the frame about to be recorded
+  void Update(uint32_t frame_index);
+
+  // GPU driven submission, draw commands are generated by a compute pass
+  void SetGpuDriven(bool enabled) { gpu_driven_ = enabled; }
+  [[nodiscard]] auto IsGpuDriven() const -> bool { return gpu_driven_; }
+
+  // frustum culling of instances, on the GPU for GPU driven draws and with
+  // the SIMD kernel in sphere_bounds.h for direct draws. Disabled draws
+  // every instance
+  void SetFrustumCulling(bool enabled) { frustum_culling_ = enabled; }
+  [[nodiscard]] auto IsFrustumCulling() const -> bool {
+    return frustum_culling_;
+  }
+
+  // CPU occlusion culling of direct draws against the occluder meshes,
+  // runs after CPU frustum culling
+  void SetSoftwareOcclusion(bool enabled) { software_occlusion_ = enabled; }
+  [[nodiscard]] auto IsSoftwareOcclusion() const -> bool {
+    return software_occlusion_;
+  }
+
+  // coverage of the last CPU culled frame, for the debug window
+  [[nodiscard]] auto GetOcclusionRasterizer() const
+      -> const OcclusionRasterizer& {
+    return occlusion_rasterizer_;
+  }
+
+  // two phase occlusion culling against the Hi-Z pyramid, see CullPhase
+  void SetOcclusionCulling(bool enabled) { occlusion_culling_ = enabled; }
+  [[nodiscard]] auto IsOcclusionCulling() const -> bool {
+    return occlusion_culling_;
+  }
+
+  // true when the frame needs the pyramid and the second rendering pass
+  [[nodiscard]] auto IsOcclusionActive() const -> bool {
+    return gpu_driven_ && occlusion_culling_;
+  }
+
+  // state changes of the last direct draw submission
+  [[nodiscard]] auto GetSubmitStats() const -> const DrawSubmitStats& {
+    return submit_stats_;
+  }
+
+  // culling results, GPU results lag a few frames behind
+  [[nodiscard]] auto GetCullingStats() const -> const CullingStats& {
+    return IsCpuCulling() ? cpu_stats_ : indirect_pass_->GetStats();
+  }
+
+  // projected error in pixels an instance may show before a finer level
+  // is drawn, 0 always draws the full meshes
+  void SetLodThreshold(float pixels) { lod_threshold_ = pixels; }
+  [[nodiscard]] auto GetLodThreshold() const -> float {
+    return lod_threshold_;
+  }
+
+  // records the compute work that has to run before the rendering pass,
+  // the viewport height scales the error used to select detail levels
+  void PrepareDraws(vk::CommandBuffer buffer, const Camera& camera,
+                    uint32_t viewport_height);
+
+  // records the second culling phase, after the pyramid was built from the
+  // depth of the first
+  void PrepareOcclusionDraws(vk::CommandBuffer buffer);
+
+  [[nodiscard]] auto GetVertexLayout() const -> VertexLayout {
+    return vertex_layout_;
+  }
+
+  // spatial queries over the world bounds of the instances as of the last
+  // Update, results are instance ids
+  void QueryInstances(const Frustum& frustum,
+                      std::vector<uint32_t>& instances) const;
+  void QueryInstances(const Aabb& box, std::vector<uint32_t>& instances) const;
+  // nearest instance whose bounding box the ray enters
+  [[nodiscard]] auto PickInstance(const Ray& ray) const -> RayHit;
+
+  [[nodiscard]] auto GetBvh() const -> const Bvh& { return bvh_; }
+
 private:
 
   EngineContext& engine_;
+  Uniforms& uniforms_;
+  VertexLayout vertex_layout_;
 
   Buffer vertex_buffer_;
   Buffer index_buffer_;
@@ -54,11 +230,116 @@ private:
   Buffer index_staging_buffer_;
 
   std::vector<Mesh> meshes_;
+  std::vector<std::string> mesh_names_;
+
+  // meshes grouped by index type so each group binds the index buffer once
+  struct IndexGroup {
+    vk::IndexType index_type;
+    vk::DeviceSize byte_offset = 0;
+    std::vector<uint32_t> meshes;
+  };
+  std::array<IndexGroup, 2> index_groups_{
+      IndexGroup{vk::IndexType::eUint32}, IndexGroup{vk::IndexType::eUint16}};
+
+  // geometry waiting for UploadSceneData, one array per vertex stream
+  std::array<std::vector<std::byte>, kVertexStreamCount> vertex_streams_;
+  std::array<vk::DeviceSize, kVertexStreamCount> stream_offsets_{};
+  uint32_t vertex_count_ = 0;
+  std::vector<uint32_t> indices32_;
+  std::vector<uint16_t> indices16_;
+
+  // instances in creation order, sorted into batches on upload
+  std::vector<InstanceData> instances_;
+  std::vector<uint32_t> instance_slots_;  // instance id -> sorted position
+  std::vector<DrawBatch> batches_;        // one per mesh
+  std::vector<InstanceData> sorted_instances_;
+  std::vector<DrawRecord> draw_records_;
+  // world space bounds of sorted_instances_ for CPU culling
+  SphereBounds instance_bounds_;
+  bool batches_dirty_ = false;
+  uint32_t instance_frames_dirty_ = 0;
+  uint32_t draw_frames_dirty_ = 0;
+  uint32_t current_frame_ = 0;
+
+  MaterialTable materials_;
+
+  // per frame in flight
+  std::vector<Buffer> instance_buffers_;
+  std::vector<Buffer> material_buffers_;
+  // indirect draws use the first kIndirectDrawDataCount entries, direct
+  // draws use one entry per mesh after them
+  std::vector<Buffer> draw_data_buffers_;
+
+  bool gpu_driven_ = true;
+  bool frustum_culling_ = true;
+  float lod_threshold_ = kDefaultLodThreshold;
+  bool occlusion_culling_ = true;
+  CullView cull_view_;
+  std::unique_ptr<IndirectDrawPass> indirect_pass_;
+
+  // CPU culling results, the visible list is written straight into a host
+  // visible buffer per frame in flight
+  std::vector<uint8_t> instance_visible_;
+  std::vector<uint8_t> instance_lods_;
+  // kMaxMeshLods per mesh, the survivors of each level follow the previous
+  std::vector<uint32_t> batch_visible_counts_;
+  std::vector<Buffer> cpu_visible_buffers_;
+  std::vector<float> batch_depths_;  // nearest survivor per mesh
+  CullingStats cpu_stats_;
+
+  // direct draws of the frame in sort key order
+  DrawPacketList draw_packets_;
+  DrawSubmitStats submit_stats_;
+
+  bool software_occlusion_ = true;
+  std::vector<OccluderMesh> occluder_meshes_;  // one per mesh, empty if none
+  OcclusionRasterizer occlusion_rasterizer_;
+  std::vector<Occluder> occluders_;
+  std::vector<Aabb> occludee_boxes_;
+
+  // instance BVH indexed by instance id, refit as instances move and
+  // rebuilt on a worker into pending_bvh_ when its quality drops
+  Bvh bvh_;
+  float bvh_build_cost_ = 0.0F;
+  std::vector<uint32_t> bvh_moved_;
+  Bvh pending_bvh_;
+  std::vector<Aabb> pending_bvh_boxes_;
+  std::future<void> bvh_rebuild_;
+
   Texture* texture_;
+  uint32_t texture_index_ = 0;  // slot in the bindless texture array
 
   vk::Sampler texture_sampler_;
 
   void CreateTextureSampler();
+  void CreateInstanceBuffers();
+  void CreateDrawDataBuffers();
+  void CreateMaterialBuffers();
+  void UpdateMaterials(uint32_t frame_index);
+  void RebuildBatches();
+  [[nodiscard]] static auto ComputeBoundingSphere(
+      std::span<const Vertex> vertices) -> glm::vec4;
+  void UpdateBounds(uint32_t slot);
+  void CheckInstance(uint32_t instance) const;
+  void CheckMaterial(uint32_t material_index) const;
+  [[nodiscard]] auto IsCpuCulling() const -> bool {
+    return !gpu_driven_ && frustum_culling_;
+  }
+  void CullOnCpu(const Camera& camera, uint32_t viewport_height);
+  void OccludeOnCpu(const glm::mat4& view_projection);
+  [[nodiscard]] auto GetInstanceBox(uint32_t instance) const -> Aabb;
+  void UpdateSpatialIndex();
+  void BuildDrawPackets(const Camera& camera);
+  void UpdateDrawData(uint32_t frame_index);
+  void DrawDirect(vk::CommandBuffer buffer, vk::PipelineLayout layout,
+                  VertexStreams streams);
+  void DrawIndirect(vk::CommandBuffer buffer, vk::PipelineLayout layout,
+                    CullPhase phase);
+
+  [[nodiscard]] static auto GetIndexGroup(const Mesh& mesh) -> uint32_t {
+    return mesh.index_type == vk::IndexType::eUint32 ? 0 : 1;
+  }
+  void BindVertexStreams(vk::CommandBuffer buffer, VertexStreams streams) const;
 
 };
 
@@ -7,11 +7,58 @@
 
 #include <vulkan/vulkan.hpp>
 
+#include "braque/shader_reflection.h"
+#include "braque/specialization.h"
+
 namespace braque {
 
+// scene shaders, relative to the working directory like the other assets
+constexpr auto kSceneVertexShader = "../assets/shaders/triangle.vert.spv";
+constexpr auto kSceneCompactVertexShader =
+    "../assets/shaders/triangle_compact.vert.spv";
+constexpr auto kSceneFragmentShader = "../assets/shaders/triangle.frag.spv";
+constexpr auto kDepthVertexShader = "../assets/shaders/depth.vert.spv";
+
+// compute shaders
+constexpr auto kHiZDownsampleShader =
+    "../assets/shaders/hiz_downsample.comp.spv";
+constexpr auto kCullInstancesShader =
+    "../assets/shaders/cull_instances.comp.spv";
+constexpr auto kDrawCommandsShader = "../assets/shaders/draw_commands.comp.spv";
+
+// parallel primitives, the _subgroup variants need subgroup arithmetic
+constexpr auto kScanBlocksShader = "../assets/shaders/scan_blocks.comp.spv";
+constexpr auto kScanBlocksSubgroupShader =
+    "../assets/shaders/scan_blocks_subgroup.comp.spv";
+constexpr auto kScanAddShader = "../assets/shaders/scan_add.comp.spv";
+constexpr auto kCompactScatterShader =
+    "../assets/shaders/compact_scatter.comp.spv";
+constexpr auto kRadixHistogramShader =
+    "../assets/shaders/radix_histogram.comp.spv";
+constexpr auto kRadixScatterShader =
+    "../assets/shaders/radix_scatter.comp.spv";
+constexpr auto kRadixScatterSubgroupShader =
+    "../assets/shaders/radix_scatter_subgroup.comp.spv";
+
+// reads a whole binary file, e.g. a SPIR-V module
+auto ReadFile(const std::string& filename) -> std::vector<char>;
+
+// SPIR-V of one of the shader paths above. Builds with BRAQUE_EMBED_SHADERS
+// find it among the embedded modules by file name and only read the file
+// when it was not embedded
+auto LoadShaderCode(const std::string& filename) -> std::vector<char>;
+
+auto ReflectShader(const std::vector<char>& code) -> ShaderReflection;
+
+// reads and reflects a SPIR-V module without creating a shader module
+auto ReflectShaderFile(const std::string& filename) -> ShaderReflection;
+
 class Shader {
 public:
-    Shader(vk::Device device, const std::string &vertShaderFilename, const std::string &fragShaderFilename);
+    // the constants specialize both stages
+    Shader(vk::Device device, const std::string &vertShaderFilename, const std::string &fragShaderFilename, const SpecializationConstants &constants = {});
+    // vertex only, for depth and shadow passes
+    Shader(vk::Device device, const std::string &vertShaderFilename, const SpecializationConstants &constants = {});
     ~Shader();
 
     // remove copy and move
@@ -22,14 +69,45 @@ public:
 
     [[nodiscard]] auto getPipelineShaderStageCreateInfos() const -> std::vector<vk::PipelineShaderStageCreateInfo>;
 
+    // bindings, push constants and vertex inputs of all stages
+    [[nodiscard]] auto GetReflection() const -> const ShaderReflection & { return reflection; }
+
 private:
     vk::Device device;
     vk::ShaderModule vertexModule;
     vk::ShaderModule fragmentModule;
+    ShaderReflection reflection;
+    SpecializationConstants constants;
+    vk::SpecializationInfo specializationInfo;
 
     auto createShaderModule(const std::vector<char> &code) const -> vk::ShaderModule;
 };
 
+// the single stage of a compute pipeline, kept only until the pipeline is
+// created
+class ComputeShader {
+public:
+    ComputeShader(vk::Device device, const std::string &filename, const SpecializationConstants &constants = {});
+    ~ComputeShader();
+
+    ComputeShader(const ComputeShader &) = delete;
+    auto operator=(const ComputeShader &) -> ComputeShader & = delete;
+    ComputeShader(ComputeShader &&) = delete;
+    auto operator=(ComputeShader &&) -> ComputeShader & = delete;
+
+    [[nodiscard]] auto GetStageCreateInfo() const -> vk::PipelineShaderStageCreateInfo;
+
+    // bindings, push constants and workgroup size
+    [[nodiscard]] auto GetReflection() const -> const ShaderReflection & { return reflection; }
+
+private:
+    vk::Device device;
+    vk::ShaderModule module;
+    ShaderReflection reflection;
+    SpecializationConstants constants;
+    vk::SpecializationInfo specializationInfo;
+};
+
 } // namespace braque
 
 #endif //SHADER_HPP
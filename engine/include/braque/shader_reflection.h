@@ -0,0 +1,71 @@
+#ifndef SHADER_REFLECTION_H
+#define SHADER_REFLECTION_H
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+namespace braque {
+
+// one descriptor binding used by a shader
+struct ShaderBinding {
+  uint32_t set = 0;
+  uint32_t binding = 0;
+  vk::DescriptorType type = vk::DescriptorType::eUniformBuffer;
+  uint32_t count = 1;  // 0 for runtime arrays, e.g. the bindless textures
+  vk::ShaderStageFlags stages;
+
+  auto operator==(const ShaderBinding&) const -> bool = default;
+};
+
+// a vertex attribute as the vertex shader declares it, compact vertex
+// layouts feed it from a narrower format
+struct ShaderVertexInput {
+  uint32_t location = 0;
+  vk::Format format = vk::Format::eUndefined;
+
+  auto operator==(const ShaderVertexInput&) const -> bool = default;
+};
+
+// interface of one shader stage, or of several after merging
+struct ShaderReflection {
+  vk::ShaderStageFlags stages;
+  std::vector<ShaderBinding> bindings;  // sorted by set, then binding
+  std::vector<vk::PushConstantRange> push_constants;
+  std::vector<ShaderVertexInput> vertex_inputs;  // sorted by location
+  std::array<uint32_t, 3> local_size{};  // workgroup size of compute shaders
+};
+
+// Reads the descriptor bindings, push constant block, vertex inputs and
+// workgroup size of a SPIR-V module's first entry point. Builtins are not
+// vertex inputs. Throws on a malformed module.
+[[nodiscard]] auto ReflectShader(std::span<const uint32_t> code)
+    -> ShaderReflection;
+
+// interface of the stages of one pipeline. Bindings used by several stages
+// are visible to all of them, a binding declared with different types
+// throws
+[[nodiscard]] auto MergeReflections(const ShaderReflection& a,
+                                    const ShaderReflection& b)
+    -> ShaderReflection;
+
+// ranges of the same stages grow to cover each other, since a stage may
+// only appear in one range of a pipeline layout
+[[nodiscard]] auto MergePushConstantRanges(
+    std::span<const vk::PushConstantRange> a,
+    std::span<const vk::PushConstantRange> b)
+    -> std::vector<vk::PushConstantRange>;
+
+// one past the highest set any binding uses
+[[nodiscard]] auto GetSetCount(const ShaderReflection& reflection)
+    -> uint32_t;
+
+[[nodiscard]] auto GetSetBindings(const ShaderReflection& reflection,
+                                  uint32_t set) -> std::vector<ShaderBinding>;
+
+}  // namespace braque
+
+#endif  // SHADER_REFLECTION_H
@@ -0,0 +1,81 @@
+#ifndef SHADER_WATCHER_H
+#define SHADER_WATCHER_H
+
+#include <filesystem>
+#include <future>
+#include <memory>
+#include <set>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace braque {
+
+class JobSystem;
+
+// file names a GLSL source includes with #include "name"
+[[nodiscard]] auto ParseShaderIncludes(std::string_view source)
+    -> std::vector<std::string>;
+
+// Watches the GLSL sources of a directory and recompiles the ones that
+// change to SPIR-V on the job system, for iterating on shaders without
+// restarting. A changed .glsl include recompiles every source including
+// it, directly or through other includes. Changes come from inotify on Linux and from polling write
+// times elsewhere. Each module is written next to the others under its
+// usual name, replacing the old one at once, so loads never see half a
+// file. Used from the render thread.
+class ShaderWatcher {
+ public:
+  // compiler is a glslc compatible executable
+  ShaderWatcher(JobSystem& jobs, std::filesystem::path source_dir,
+                std::filesystem::path output_dir, std::string compiler);
+  ~ShaderWatcher();
+
+  ShaderWatcher(const ShaderWatcher&) = delete;
+  ShaderWatcher(ShaderWatcher&&) noexcept = delete;
+  auto operator=(const ShaderWatcher&) -> ShaderWatcher& = delete;
+  auto operator=(ShaderWatcher&&) noexcept -> ShaderWatcher& = delete;
+
+  // starts compiling sources changed since the last poll and returns the
+  // SPIR-V paths of the compiles that succeeded since then. Call once a
+  // frame, it does not block
+  auto Poll() -> std::vector<std::string>;
+
+ private:
+  struct Compile {
+    std::filesystem::path source;
+    std::string spirv;
+    std::future<void> job;
+    bool succeeded = false;
+  };
+
+  JobSystem& jobs_;
+  std::filesystem::path source_dir_;
+  std::filesystem::path output_dir_;
+  std::string compiler_;
+
+  int inotify_fd_ = -1;
+  std::unordered_map<std::string, std::filesystem::file_time_type>
+      write_times_;
+
+  std::vector<std::unique_ptr<Compile>> compiles_;
+  // changed again while compiling, compiled once more afterwards
+  std::set<std::filesystem::path> stale_;
+
+  [[nodiscard]] static auto IsShaderSource(const std::filesystem::path& path)
+      -> bool;
+  [[nodiscard]] static auto IsShaderInclude(const std::filesystem::path& path)
+      -> bool;
+
+  auto FindChanged() -> std::set<std::filesystem::path>;
+  // replaces changed includes with the sources that use them
+  [[nodiscard]] auto ExpandIncludes(
+      const std::set<std::filesystem::path>& changed) const
+      -> std::set<std::filesystem::path>;
+  void StartCompile(const std::filesystem::path& source);
+};
+
+}  // namespace braque
+
+#endif  // SHADER_WATCHER_H
@@ -0,0 +1,45 @@
+#ifndef SLOT_ALLOCATOR_H
+#define SLOT_ALLOCATOR_H
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace braque {
+
+// Hands out indices into a fixed size table such as a descriptor array.
+// Released slots may still be read by frames in flight, so they only
+// become free again after retire_frames calls to NextFrame.
+class SlotAllocator {
+ public:
+  SlotAllocator(uint32_t capacity, uint32_t retire_frames);
+
+  // empty once every slot is in use or waiting to retire
+  [[nodiscard]] auto Allocate() -> std::optional<uint32_t>;
+  void Release(uint32_t slot);
+
+  // call once per frame after waiting on the frame's fence
+  void NextFrame();
+
+  [[nodiscard]] auto GetCapacity() const -> uint32_t { return capacity_; }
+  [[nodiscard]] auto GetUsedCount() const -> uint32_t { return used_; }
+
+ private:
+  struct RetiredSlot {
+    uint32_t slot;
+    uint64_t free_frame;
+  };
+
+  uint32_t capacity_;
+  uint32_t retire_frames_;
+  uint32_t next_ = 0;  // slots from here on were never handed out
+  uint32_t used_ = 0;
+  uint64_t frame_ = 0;
+
+  std::vector<uint32_t> free_slots_;
+  std::vector<RetiredSlot> retired_slots_;
+};
+
+}  // namespace braque
+
+#endif  // SLOT_ALLOCATOR_H
@@ -0,0 +1,49 @@
+#ifndef SPECIALIZATION_H
+#define SPECIALIZATION_H
+
+#include <cstdint>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+namespace braque {
+
+// constant_id values of the scene fragment shader, triangle.frag
+constexpr uint32_t kLightCountConstant = 0;
+constexpr uint32_t kAmbientStrengthConstant = 1;
+constexpr uint32_t kAlbedoTexturesConstant = 2;
+constexpr uint32_t kOcclusionTexturesConstant = 3;
+
+// lights triangle.frag has directions for
+constexpr uint32_t kMaxSceneLights = 4;
+
+// Values of specialization constants by constant_id, 32 bits each as bool,
+// int, uint and float constants are. The same constants are given to every
+// stage of a pipeline, a stage ignores ids it does not declare. The driver
+// folds them into the code, so branches on them cost nothing at runtime.
+class SpecializationConstants {
+ public:
+  void SetUint(uint32_t id, uint32_t value);
+  void SetInt(uint32_t id, int32_t value);
+  void SetFloat(uint32_t id, float value);
+  void SetBool(uint32_t id, bool value);
+
+  [[nodiscard]] auto IsEmpty() const -> bool { return entries_.empty(); }
+
+  // points into the constants, which must outlive it
+  [[nodiscard]] auto GetInfo() const -> vk::SpecializationInfo;
+
+  [[nodiscard]] auto Hash() const -> uint64_t;
+
+  auto operator==(const SpecializationConstants&) const -> bool = default;
+
+ private:
+  std::vector<vk::SpecializationMapEntry> entries_;  // sorted by id
+  std::vector<uint32_t> data_;
+
+  void Set(uint32_t id, uint32_t bits);
+};
+
+}  // namespace braque
+
+#endif  // SPECIALIZATION_H
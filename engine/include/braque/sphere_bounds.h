@@ -0,0 +1,75 @@
+#ifndef SPHERE_BOUNDS_H
+#define SPHERE_BOUNDS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "frustum.h"
+
+namespace braque {
+
+class JobSystem;
+
+// objects tested per instruction by CullSpheres, 8 with AVX2 and 4 with
+// SSE or NEON
+[[nodiscard]] auto GetCullLaneCount() -> uint32_t;
+
+// counts below this are culled on the calling thread
+constexpr size_t kParallelCullThreshold = 16384;
+
+// objects per job when culling in parallel, a multiple of every lane count
+constexpr size_t kCullGrainSize = 4096;
+
+// World space bounding spheres stored as a structure of arrays so the
+// culling kernel loads whole vectors of centers and radii at once. Kept
+// parallel to a draw list, index i bounds draw i.
+class SphereBounds {
+ public:
+  void Resize(size_t count);
+  void Set(size_t index, glm::vec3 center, float radius);
+
+  [[nodiscard]] auto Get(size_t index) const -> glm::vec4 {
+    return {center_x_[index], center_y_[index], center_z_[index],
+            radius_[index]};
+  }
+
+  [[nodiscard]] auto Size() const -> size_t { return radius_.size(); }
+
+  [[nodiscard]] auto CenterX() const -> const float* {
+    return center_x_.data();
+  }
+  [[nodiscard]] auto CenterY() const -> const float* {
+    return center_y_.data();
+  }
+  [[nodiscard]] auto CenterZ() const -> const float* {
+    return center_z_.data();
+  }
+  [[nodiscard]] auto Radius() const -> const float* { return radius_.data(); }
+
+ private:
+  std::vector<float> center_x_;
+  std::vector<float> center_y_;
+  std::vector<float> center_z_;
+  std::vector<float> radius_;
+};
+
+// writes 1 to visible[i] when sphere i is at least partly inside the
+// frustum and 0 otherwise, visible must hold bounds.Size() entries
+void CullSpheres(const Frustum& frustum, const SphereBounds& bounds,
+                 std::span<uint8_t> visible);
+
+// same as above, large counts are split across the job system
+void CullSpheres(JobSystem& jobs, const Frustum& frustum,
+                 const SphereBounds& bounds, std::span<uint8_t> visible);
+
+// one sphere at a time, the reference for the vector kernels
+void CullSpheresScalar(const Frustum& frustum, const SphereBounds& bounds,
+                       std::span<uint8_t> visible);
+
+}  // namespace braque
+
+#endif  // SPHERE_BOUNDS_H
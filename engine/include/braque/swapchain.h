@@ -5,6 +5,8 @@
 #ifndef SWAPCHAIN_HPP
 #define SWAPCHAIN_HPP
 
+#include <span>
+
 #include "frame_stats.h"
 #include "renderer.h"
 #include "braque/engine_context.h"
@@ -67,7 +69,10 @@ class Swapchain {
   void waitForFrame() const;
   void acquireNextImage();
   void waitForImageInFlight();
-  void submitCommandBuffer();
+  // waits and signals are added to the swapchain semaphores, e.g. the
+  // timelines of async compute
+  void submitCommandBuffer(std::span<const vk::SemaphoreSubmitInfo> waits = {},
+                           std::span<const vk::SemaphoreSubmitInfo> signals = {});
   void presentImage();
 
  private:
@@ -7,9 +7,15 @@
 #include "braque/camera.h"
 #include "braque/texture.h"
 #include "braque/buffer.h"
+#include "braque/descriptor_allocator.h"
+#include "braque/slot_allocator.h"
+#include "braque/shader_reflection.h"
 
 namespace braque {
 
+// size of the bindless texture array, slots are filled as textures are added
+constexpr uint32_t kMaxBindlessTextures = 4096;
+
 class Uniforms {
  public:
   Uniforms(EngineContext& engine, Swapchain& swapchain);
@@ -20,13 +26,41 @@ class Uniforms {
 
   void SetCameraData(vk::CommandBuffer buffer, const Camera& camera);
 
-  void SetTextureData(const Texture& texture, vk::Sampler sampler);
+  // writes the texture into a free slot of the bindless texture array and
+  // returns the index shaders sample it with
+  auto AddTexture(const Texture& texture, vk::Sampler sampler) -> uint32_t;
+
+  // the slot is reused once the frames in flight no longer read it
+  void RemoveTexture(uint32_t index);
+
+  // recycles texture slots, call after waiting on the frame's fence
+  void BeginFrame();
+
+  // storage buffer holding the InstanceData array of one frame in flight
+  void SetInstanceBuffer(uint32_t frame, const Buffer& buffer);
+
+  // storage buffer holding the DrawData array of one frame in flight
+  void SetDrawDataBuffer(uint32_t frame, const Buffer& buffer);
+
+  // storage buffer holding the culled, sorted instance ids of one frame
+  void SetVisibleInstanceBuffer(uint32_t frame, const Buffer& buffer);
 
- // bind descriptor sets
-  void Bind(vk::CommandBuffer buffer, vk::PipelineLayout layout) const;
+  // storage buffer holding the MaterialData table of one frame in flight
+  void SetMaterialBuffer(uint32_t frame, const Buffer& buffer);
+
+ // bind descriptor sets, writes the buffers set since the last bind
+  void Bind(vk::CommandBuffer buffer, vk::PipelineLayout layout);
 
   auto GetDescriptorSetLayout() const -> vk::DescriptorSetLayout { return descriptor_set_layout_; }
 
+  // merged interface of the scene shaders, set 0 is this set
+  [[nodiscard]] auto GetReflection() const -> const ShaderReflection& {
+    return reflection_;
+  }
+  [[nodiscard]] auto GetBindings() const -> const std::vector<ShaderBinding>& {
+    return bindings_;
+  }
+
  private:
   EngineContext& engine_;
   Swapchain& swapchain_;
@@ -34,13 +68,28 @@ class Uniforms {
   std::vector<Buffer> camera_buffers_;
   std::vector<vk::DescriptorSet> descriptor_sets_;
 
+  // reflected from the scene shaders
+  ShaderReflection reflection_;
+  std::vector<ShaderBinding> bindings_;
+
   vk::DescriptorSetLayout descriptor_set_layout_;
-  vk::DescriptorPool descriptor_pool_;
+  std::unique_ptr<DescriptorAllocator> descriptor_allocator_;
+  std::unique_ptr<DescriptorTemplate> descriptor_template_;
+
+  // what each frame's set should hold and what it was last written with,
+  // buffers that did not change cost no descriptor update
+  std::vector<DescriptorData> frame_data_;
+  std::vector<DescriptorData> written_data_;
+
+  SlotAllocator texture_slots_;
 
   void CreateUniformBuffers();
   void createDescriptorSetLayout();
   void createDescriptorPool();
   void createDescriptorSets();
+  void WriteStorageBuffer(uint32_t frame, uint32_t binding,
+                          const Buffer& buffer);
+  void FlushDescriptors(uint32_t frame);
 };
 
 }  // namespace braque
\ No newline at end of file
@@ -0,0 +1,111 @@
+#ifndef VERTEX_FORMAT_H
+#define VERTEX_FORMAT_H
+
+#include <array>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <vulkan/vulkan.hpp>
+
+namespace braque {
+
+// Uncompressed vertex as produced by importers and procedural geometry.
+struct Vertex {
+  glm::vec3 position;
+  glm::vec3 normal;
+  glm::vec3 color;
+  glm::vec2 uv;
+};
+
+// How vertices are laid out in the vertex buffer.
+//  eFull      - 44 bytes of float32, matches Vertex
+//  eQuantized - 20 bytes, positions as unorm16 inside the mesh bounds
+//  eHalf      - 20 bytes, positions as float16
+// The compact layouts share the remaining attributes: octahedral snorm16
+// normals, rgba8 colors and float16 uvs.
+enum class VertexLayout : uint8_t {
+  eFull,
+  eQuantized,
+  eHalf
+};
+
+constexpr VertexLayout kDefaultVertexLayout = VertexLayout::eQuantized;
+
+// Vertices are stored as separate streams so passes that only need
+// positions (depth prepass, shadows, picking) fetch a fraction of the data.
+// The stream index doubles as the vertex input binding.
+enum class VertexStream : uint8_t {
+  ePosition,
+  eNormal,
+  eAttributes  // color and uv
+};
+
+constexpr size_t kVertexStreamCount = 3;
+
+// bit mask of VertexStream values
+using VertexStreams = uint8_t;
+
+constexpr auto StreamBit(VertexStream stream) -> VertexStreams {
+  return static_cast<VertexStreams>(1U << static_cast<uint32_t>(stream));
+}
+
+constexpr VertexStreams kPositionStreamOnly = StreamBit(VertexStream::ePosition);
+constexpr VertexStreams kAllVertexStreams = StreamBit(VertexStream::ePosition) |
+                                            StreamBit(VertexStream::eNormal) |
+                                            StreamBit(VertexStream::eAttributes);
+
+struct FullAttributes {
+  glm::vec3 color;
+  glm::vec2 uv;
+};
+
+struct CompactAttributes {
+  std::array<uint8_t, 4> color;  // rgba8 unorm
+  std::array<uint16_t, 2> uv;    // float16
+};
+
+using CompactPosition = std::array<uint16_t, 4>;  // xyz + padding
+using CompactNormal = std::array<int16_t, 2>;     // octahedral encoded
+
+static_assert(sizeof(CompactPosition) + sizeof(CompactNormal) +
+                      sizeof(CompactAttributes) ==
+                  20,
+              "Compact vertices must be 20 bytes");
+
+// Vertex data ready for upload together with the per-mesh transform that
+// the vertex shader uses to turn stored positions back into object space.
+struct PackedVertices {
+  std::array<std::vector<std::byte>, kVertexStreamCount> streams;
+  glm::vec3 position_scale{1.0F};
+  glm::vec3 position_offset{0.0F};
+};
+
+struct VertexInputDescription {
+  std::vector<vk::VertexInputBindingDescription> bindings;
+  std::vector<vk::VertexInputAttributeDescription> attributes;
+};
+
+[[nodiscard]] auto GetVertexStride(VertexLayout layout, VertexStream stream)
+    -> uint32_t;
+
+// total bytes per vertex across the selected streams
+[[nodiscard]] auto GetVertexStride(VertexLayout layout,
+                                   VertexStreams streams = kAllVertexStreams)
+    -> uint32_t;
+
+[[nodiscard]] auto GetVertexInputDescription(
+    VertexLayout layout, VertexStreams streams = kAllVertexStreams)
+    -> VertexInputDescription;
+
+[[nodiscard]] auto PackVertices(std::span<const Vertex> vertices,
+                                VertexLayout layout) -> PackedVertices;
+
+// octahedral normal encoding, exposed for tests and tools
+[[nodiscard]] auto EncodeOctahedral(glm::vec3 normal) -> glm::vec2;
+[[nodiscard]] auto DecodeOctahedral(glm::vec2 encoded) -> glm::vec3;
+
+}  // namespace braque
+
+#endif  //VERTEX_FORMAT_H
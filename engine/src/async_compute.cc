@@ -0,0 +1,158 @@
+#include "braque/async_compute.h"
+
+#include "braque/renderer.h"
+
+#include <spdlog/spdlog.h>
+
+namespace braque {
+
+AsyncCompute::AsyncCompute(Renderer& renderer, uint32_t frame_count)
+    : device_(renderer.getDevice()),
+      queue_(renderer.GetComputeQueue()),
+      async_(renderer.HasAsyncCompute()),
+      graphics_timeline_(CreateTimeline()),
+      compute_timeline_(CreateTimeline()) {
+  vk::CommandPoolCreateInfo poolInfo{};
+  poolInfo.setQueueFamilyIndex(renderer.GetComputeQueueFamilyIndex());
+  poolInfo.setFlags(vk::CommandPoolCreateFlagBits::eTransient);
+
+  frames_.resize(frame_count);
+  for (auto& frame : frames_) {
+    frame.pool = device_.createCommandPool(poolInfo);
+  }
+
+  spdlog::info("Created {} compute queue",
+               async_ ? "async" : "graphics shared");
+}
+
+AsyncCompute::~AsyncCompute() {
+  // the pools free their buffers
+  for (const auto& frame : frames_) {
+    device_.destroyCommandPool(frame.pool);
+  }
+  device_.destroySemaphore(compute_timeline_);
+  device_.destroySemaphore(graphics_timeline_);
+}
+
+auto AsyncCompute::CreateTimeline() const -> vk::Semaphore {
+  vk::SemaphoreTypeCreateInfo typeInfo{};
+  typeInfo.setSemaphoreType(vk::SemaphoreType::eTimeline);
+  typeInfo.setInitialValue(0);
+
+  vk::SemaphoreCreateInfo createInfo{};
+  createInfo.setPNext(&typeInfo);
+
+  return device_.createSemaphore(createInfo);
+}
+
+void AsyncCompute::BeginFrame(uint32_t frame) {
+  current_ = frame;
+  auto& resources = frames_[frame];
+
+  if (resources.compute_value > 0) {
+    vk::SemaphoreWaitInfo waitInfo{};
+    waitInfo.setSemaphores(compute_timeline_);
+    waitInfo.setValues(resources.compute_value);
+
+    if (device_.waitSemaphores(waitInfo, UINT64_MAX) !=
+        vk::Result::eSuccess) {
+      spdlog::error("Failed to wait for async compute");
+      throw std::runtime_error("Failed to wait for async compute");
+    }
+  }
+
+  device_.resetCommandPool(resources.pool);
+  resources.used = 0;
+}
+
+auto AsyncCompute::Begin() -> vk::CommandBuffer {
+  auto& frame = frames_[current_];
+
+  // buffers are kept across frames, reset with their pool
+  if (frame.used == frame.buffers.size()) {
+    vk::CommandBufferAllocateInfo allocateInfo{};
+    allocateInfo.setCommandPool(frame.pool);
+    allocateInfo.setLevel(vk::CommandBufferLevel::ePrimary);
+    allocateInfo.setCommandBufferCount(1);
+    frame.buffers.push_back(device_.allocateCommandBuffers(allocateInfo)[0]);
+  }
+
+  const auto buffer = frame.buffers[frame.used++];
+
+  vk::CommandBufferBeginInfo beginInfo{};
+  beginInfo.setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
+  buffer.begin(beginInfo);
+  return buffer;
+}
+
+auto AsyncCompute::Submit(vk::CommandBuffer buffer, uint64_t graphics_value)
+    -> uint64_t {
+  buffer.end();
+
+  vk::SemaphoreSubmitInfo waitInfo{};
+  waitInfo.setSemaphore(graphics_timeline_);
+  waitInfo.setValue(graphics_value);
+  waitInfo.setStageMask(vk::PipelineStageFlagBits2::eAllCommands);
+
+  vk::SemaphoreSubmitInfo signalInfo{};
+  signalInfo.setSemaphore(compute_timeline_);
+  signalInfo.setValue(++compute_value_);
+  signalInfo.setStageMask(vk::PipelineStageFlagBits2::eAllCommands);
+
+  vk::CommandBufferSubmitInfo bufferInfo{};
+  bufferInfo.setCommandBuffer(buffer);
+
+  vk::SubmitInfo2 submitInfo{};
+  if (graphics_value > 0) {
+    submitInfo.setWaitSemaphoreInfos(waitInfo);
+  }
+  submitInfo.setCommandBufferInfos(bufferInfo);
+  submitInfo.setSignalSemaphoreInfos(signalInfo);
+
+  queue_.submit2KHR(submitInfo);
+
+  frames_[current_].compute_value = compute_value_;
+  return compute_value_;
+}
+
+void AsyncCompute::AddPass(ComputePass pass,
+                           vk::PipelineStageFlags2 consumer_stages) {
+  passes_.push_back({std::move(pass), consumer_stages});
+}
+
+auto AsyncCompute::SubmitPasses() -> std::vector<vk::SemaphoreSubmitInfo> {
+  if (passes_.empty()) {
+    return {};
+  }
+
+  vk::PipelineStageFlags2 consumers;
+  const auto buffer = Begin();
+  for (const auto& pass : passes_) {
+    pass.record(buffer, current_);
+    consumers |= pass.consumer_stages;
+  }
+
+  // the previous frame's graphics work is the last the passes may read
+  const auto value = Submit(buffer, graphics_value_);
+  return {WaitForCompute(value, consumers)};
+}
+
+auto AsyncCompute::WaitForCompute(uint64_t compute_value,
+                                  vk::PipelineStageFlags2 stages) const
+    -> vk::SemaphoreSubmitInfo {
+  vk::SemaphoreSubmitInfo waitInfo{};
+  waitInfo.setSemaphore(compute_timeline_);
+  waitInfo.setValue(compute_value);
+  waitInfo.setStageMask(stages);
+  return waitInfo;
+}
+
+auto AsyncCompute::SignalGraphics() -> vk::SemaphoreSubmitInfo {
+  vk::SemaphoreSubmitInfo signalInfo{};
+  signalInfo.setSemaphore(graphics_timeline_);
+  signalInfo.setValue(++graphics_value_);
+  signalInfo.setStageMask(vk::PipelineStageFlagBits2::eAllCommands);
+  return signalInfo;
+}
+
+}  // namespace braque
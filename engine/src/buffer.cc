@@ -6,6 +6,7 @@
 
 #include "braque/engine_context.h"
 #include "braque/memory_allocator.h"
+#include "braque/renderer.h"
 #include <spdlog/spdlog.h>
 
 namespace braque {
@@ -50,11 +51,43 @@ Buffer::Buffer(EngineContext& engine, BufferType buffer_type, vk::DeviceSize siz
       VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT |
       VMA_ALLOCATION_CREATE_MAPPED_BIT;
       break;
+    case BufferType::storage:
+      buffer_create_info.setUsage(vk::BufferUsageFlagBits::eStorageBuffer |
+                                  vk::BufferUsageFlagBits::eTransferDst);
+      allocation_create_info.usage = VMA_MEMORY_USAGE_AUTO;
+      allocation_create_info.flags =
+          VMA_ALLOCATION_CREATE_MAPPED_BIT |
+          VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
+      break;
+    case BufferType::indirect:
+      buffer_create_info.setUsage(vk::BufferUsageFlagBits::eStorageBuffer |
+                                  vk::BufferUsageFlagBits::eIndirectBuffer |
+                                  vk::BufferUsageFlagBits::eTransferSrc |
+                                  vk::BufferUsageFlagBits::eTransferDst);
+      allocation_create_info.usage = VMA_MEMORY_USAGE_AUTO;
+      break;
+    case BufferType::readback:
+      buffer_create_info.setUsage(vk::BufferUsageFlagBits::eTransferDst);
+      allocation_create_info.usage = VMA_MEMORY_USAGE_AUTO;
+      allocation_create_info.flags =
+          VMA_ALLOCATION_CREATE_MAPPED_BIT |
+          VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT;
+      break;
     default:
       spdlog::warn("Buffer type not recognized");
   }
 
-  buffer_create_info.setSharingMode(vk::SharingMode::eExclusive);
+  // gpu written buffers may be handed between graphics and an async compute
+  // queue of another family, shared instead of transferring ownership
+  const auto families = engine.getRenderer().GetQueueFamilyIndices();
+  const bool shared = buffer_type == BufferType::storage ||
+                      buffer_type == BufferType::indirect;
+  if (shared && families.size() > 1) {
+    buffer_create_info.setSharingMode(vk::SharingMode::eConcurrent);
+    buffer_create_info.setQueueFamilyIndices(families);
+  } else {
+    buffer_create_info.setSharingMode(vk::SharingMode::eExclusive);
+  }
 
   VkBufferCreateInfo vk_create_info = buffer_create_info;
   VkBuffer buffer = nullptr;
@@ -122,14 +155,15 @@ auto Buffer::GetType() const -> BufferType {
   return type_;
 }
 
-void Buffer::Bind(vk::CommandBuffer buffer, vk::DeviceSize offset) {
+void Buffer::Bind(vk::CommandBuffer buffer, vk::DeviceSize offset,
+                  vk::IndexType index_type) {
   // do nothing
   switch (type_) {
     case BufferType::vertex:
       buffer.bindVertexBuffers(0, buffer_, {offset});
       break;
     case BufferType::index:
-      buffer.bindIndexBuffer(buffer_, offset, vk::IndexType::eUint32);
+      buffer.bindIndexBuffer(buffer_, offset, index_type);
       break;
     default:
       spdlog::warn("binding unknown type");
@@ -137,12 +171,15 @@ void Buffer::Bind(vk::CommandBuffer buffer, vk::DeviceSize offset) {
 
 }
 
-void Buffer::CopyData(const void* data, size_t size) {
+void Buffer::CopyData(const void* data, size_t size, vk::DeviceSize offset) {
   auto const allocator = engine_.getMemoryAllocator().getAllocator();
 
   vmaMapMemory(allocator, allocation_, &mapped_data_);
-  std::memcpy(mapped_data_, data, size);
+  std::memcpy(static_cast<std::byte*>(mapped_data_) + offset, data, size);
   vmaUnmapMemory(allocator, allocation_);
+
+  // no-op on host coherent memory
+  vmaFlushAllocation(allocator, allocation_, offset, size);
 }
 
 void Buffer::CopyData(vk::CommandBuffer buffer, const void* data, size_t size) {
@@ -0,0 +1,357 @@
+#include "braque/bvh.h"
+
+#include "braque/job_system.h"
+
+#include <algorithm>
+#include <array>
+#include <numeric>
+
+namespace braque {
+
+namespace {
+
+constexpr size_t kShapeQueryGrainSize = 16;
+constexpr size_t kRayQueryGrainSize = 64;
+
+auto EmptyBox() -> Aabb {
+  return {glm::vec3(std::numeric_limits<float>::max()),
+          glm::vec3(std::numeric_limits<float>::lowest())};
+}
+
+auto Union(const Aabb& a, const Aabb& b) -> Aabb {
+  return {glm::min(a.min, b.min), glm::max(a.max, b.max)};
+}
+
+auto Grow(const Aabb& box, glm::vec3 point) -> Aabb {
+  return {glm::min(box.min, point), glm::max(box.max, point)};
+}
+
+auto SurfaceArea(const Aabb& box) -> float {
+  const auto extent = glm::max(box.max - box.min, glm::vec3(0.0F));
+  return 2.0F * (extent.x * extent.y + extent.y * extent.z +
+                 extent.z * extent.x);
+}
+
+auto BoxesOverlap(const Aabb& a, const Aabb& b) -> bool {
+  return a.min.x <= b.max.x && a.max.x >= b.min.x && a.min.y <= b.max.y &&
+         a.max.y >= b.min.y && a.min.z <= b.max.z && a.max.z >= b.min.z;
+}
+
+// distance where the ray enters the box, or max float when it misses
+auto IntersectRay(const Aabb& box, glm::vec3 origin, glm::vec3 inverse,
+                  float max_distance) -> float {
+  const auto t1 = (box.min - origin) * inverse;
+  const auto t2 = (box.max - origin) * inverse;
+  const auto lower = glm::min(t1, t2);
+  const auto upper = glm::max(t1, t2);
+
+  const float enter = std::max({lower.x, lower.y, lower.z, 0.0F});
+  const float exit = std::min({upper.x, upper.y, upper.z, max_distance});
+
+  return enter <= exit ? enter : std::numeric_limits<float>::max();
+}
+
+struct Bin {
+  Aabb bounds = EmptyBox();
+  uint32_t count = 0;
+};
+
+}  // namespace
+
+void Bvh::Build(std::span<const Aabb> boxes) {
+  boxes_.assign(boxes.begin(), boxes.end());
+  objects_.resize(boxes_.size());
+  std::iota(objects_.begin(), objects_.end(), 0U);
+  nodes_.clear();
+
+  if (boxes_.empty()) {
+    return;
+  }
+
+  // a binary tree with one object per leaf has 2n - 1 nodes
+  nodes_.reserve(2 * boxes_.size());
+
+  std::vector<glm::vec3> centers(boxes_.size());
+  for (size_t i = 0; i < boxes_.size(); ++i) {
+    centers[i] = (boxes_[i].min + boxes_[i].max) * 0.5F;
+  }
+
+  nodes_.push_back({EmptyBox(), 0, static_cast<uint32_t>(boxes_.size())});
+
+  // nodes are split in creation order, children always follow parents
+  for (uint32_t node = 0; node < nodes_.size(); ++node) {
+    Split(node, centers);
+  }
+}
+
+void Bvh::Split(uint32_t node_index, std::vector<glm::vec3>& centers) {
+  const auto first = nodes_[node_index].first;
+  const auto count = nodes_[node_index].count;
+
+  auto bounds = EmptyBox();
+  auto center_bounds = EmptyBox();
+  for (uint32_t i = first; i < first + count; ++i) {
+    bounds = Union(bounds, boxes_[objects_[i]]);
+    center_bounds = Grow(center_bounds, centers[objects_[i]]);
+  }
+  nodes_[node_index].bounds = bounds;
+
+  if (count <= 1) {
+    return;
+  }
+
+  // binned SAH over every axis with some spread
+  const auto extent = center_bounds.max - center_bounds.min;
+  float best_cost = std::numeric_limits<float>::max();
+  int best_axis = -1;
+  uint32_t best_split = 0;
+
+  for (int axis = 0; axis < 3; ++axis) {
+    if (extent[axis] <= 0.0F) {
+      continue;
+    }
+
+    const float scale = kBvhBinCount / extent[axis];
+    std::array<Bin, kBvhBinCount> bins{};
+    for (uint32_t i = first; i < first + count; ++i) {
+      const auto object = objects_[i];
+      const auto bin = std::min(
+          kBvhBinCount - 1,
+          static_cast<uint32_t>((centers[object][axis] -
+                                 center_bounds.min[axis]) *
+                                scale));
+      bins[bin].bounds = Union(bins[bin].bounds, boxes_[object]);
+      bins[bin].count++;
+    }
+
+    // areas and counts left of each split plane, then sweep from the right
+    std::array<float, kBvhBinCount - 1> left_cost{};
+    auto left_bounds = EmptyBox();
+    uint32_t left_count = 0;
+    for (uint32_t i = 0; i < kBvhBinCount - 1; ++i) {
+      left_bounds = Union(left_bounds, bins[i].bounds);
+      left_count += bins[i].count;
+      left_cost[i] = left_count > 0 ? SurfaceArea(left_bounds) * left_count
+                                    : 0.0F;
+    }
+
+    auto right_bounds = EmptyBox();
+    uint32_t right_count = 0;
+    for (uint32_t i = kBvhBinCount - 1; i > 0; --i) {
+      right_bounds = Union(right_bounds, bins[i].bounds);
+      right_count += bins[i].count;
+      if (right_count == 0 || right_count == count) {
+        continue;
+      }
+
+      const float cost = left_cost[i - 1] + SurfaceArea(right_bounds) * right_count;
+      if (cost < best_cost) {
+        best_cost = cost;
+        best_axis = axis;
+        best_split = i;
+      }
+    }
+  }
+
+  // splitting costs one traversal step, keep small nodes as leaves when
+  // that is cheaper
+  const float leaf_cost = SurfaceArea(bounds) * count;
+  if (count <= kBvhMaxLeafSize &&
+      (best_axis < 0 || best_cost + SurfaceArea(bounds) >= leaf_cost)) {
+    return;
+  }
+
+  auto* begin = objects_.data() + first;
+  auto* end = begin + count;
+  auto* middle = begin + count / 2;
+
+  if (best_axis >= 0) {
+    const float scale = kBvhBinCount / extent[best_axis];
+    middle = std::partition(begin, end, [&](uint32_t object) {
+      const auto bin = std::min(
+          kBvhBinCount - 1,
+          static_cast<uint32_t>((centers[object][best_axis] -
+                                 center_bounds.min[best_axis]) *
+                                scale));
+      return bin < best_split;
+    });
+  } else {
+    // every center coincides, any halving is as good as another
+    middle = begin + count / 2;
+  }
+
+  const auto left_count = static_cast<uint32_t>(middle - begin);
+
+  const auto left = static_cast<uint32_t>(nodes_.size());
+  nodes_.push_back({EmptyBox(), first, left_count});
+  nodes_.push_back({EmptyBox(), first + left_count, count - left_count});
+
+  nodes_[node_index].first = left;
+  nodes_[node_index].count = 0;
+}
+
+void Bvh::Update(uint32_t object, const Aabb& box) {
+  boxes_[object] = box;
+}
+
+void Bvh::Refit() {
+  // children follow their parents, so a reverse sweep is bottom up
+  for (auto node = nodes_.rbegin(); node != nodes_.rend(); ++node) {
+    if (node->IsLeaf()) {
+      auto bounds = EmptyBox();
+      for (uint32_t i = node->first; i < node->first + node->count; ++i) {
+        bounds = Union(bounds, boxes_[objects_[i]]);
+      }
+      node->bounds = bounds;
+    } else {
+      node->bounds =
+          Union(nodes_[node->first].bounds, nodes_[node->first + 1].bounds);
+    }
+  }
+}
+
+auto Bvh::GetCost() const -> float {
+  if (nodes_.empty()) {
+    return 0.0F;
+  }
+
+  const float root_area = std::max(SurfaceArea(nodes_.front().bounds),
+                                   std::numeric_limits<float>::min());
+  float cost = 0.0F;
+  for (const auto& node : nodes_) {
+    const float weight = node.IsLeaf() ? static_cast<float>(node.count) : 1.0F;
+    cost += SurfaceArea(node.bounds) / root_area * weight;
+  }
+  return cost;
+}
+
+template <typename Predicate>
+void Bvh::Query(const Predicate& overlaps,
+                std::vector<uint32_t>& objects) const {
+  if (nodes_.empty()) {
+    return;
+  }
+
+  std::vector<uint32_t> stack;
+  stack.reserve(64);
+  stack.push_back(0);
+
+  while (!stack.empty()) {
+    const auto& node = nodes_[stack.back()];
+    stack.pop_back();
+
+    if (!overlaps(node.bounds)) {
+      continue;
+    }
+
+    if (node.IsLeaf()) {
+      for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+        if (overlaps(boxes_[objects_[i]])) {
+          objects.push_back(objects_[i]);
+        }
+      }
+    } else {
+      stack.push_back(node.first + 1);
+      stack.push_back(node.first);
+    }
+  }
+}
+
+void Bvh::QueryFrustum(const Frustum& frustum,
+                       std::vector<uint32_t>& objects) const {
+  Query([&](const Aabb& box) { return IsBoxVisible(frustum, box); }, objects);
+}
+
+void Bvh::QueryAabb(const Aabb& box, std::vector<uint32_t>& objects) const {
+  Query([&](const Aabb& other) { return BoxesOverlap(box, other); }, objects);
+}
+
+auto Bvh::Raycast(const Ray& ray) const -> RayHit {
+  RayHit hit;
+  if (nodes_.empty()) {
+    return hit;
+  }
+
+  // divisions by zero give infinities, which the slab test handles
+  const auto inverse = 1.0F / ray.direction;
+  const auto miss = std::numeric_limits<float>::max();
+
+  std::vector<uint32_t> stack;
+  stack.reserve(64);
+  if (IntersectRay(nodes_.front().bounds, ray.origin, inverse,
+                   ray.max_distance) < miss) {
+    stack.push_back(0);
+  }
+
+  while (!stack.empty()) {
+    const auto& node = nodes_[stack.back()];
+    stack.pop_back();
+
+    // a closer hit may have been found since the node was pushed
+    if (IntersectRay(node.bounds, ray.origin, inverse, ray.max_distance) >=
+        hit.distance) {
+      continue;
+    }
+
+    if (node.IsLeaf()) {
+      for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+        const float distance = IntersectRay(boxes_[objects_[i]], ray.origin,
+                                            inverse, ray.max_distance);
+        if (distance < hit.distance) {
+          hit = {objects_[i], distance};
+        }
+      }
+      continue;
+    }
+
+    // push the farther child first so the nearer one is visited first
+    const float left = IntersectRay(nodes_[node.first].bounds, ray.origin,
+                                    inverse, ray.max_distance);
+    const float right = IntersectRay(nodes_[node.first + 1].bounds,
+                                     ray.origin, inverse, ray.max_distance);
+    const bool left_nearer = left <= right;
+    const float near_distance = left_nearer ? left : right;
+    const float far_distance = left_nearer ? right : left;
+
+    if (far_distance < hit.distance) {
+      stack.push_back(left_nearer ? node.first + 1 : node.first);
+    }
+    if (near_distance < hit.distance) {
+      stack.push_back(left_nearer ? node.first : node.first + 1);
+    }
+  }
+
+  return hit;
+}
+
+void Bvh::QueryFrustums(JobSystem& jobs, std::span<const Frustum> frustums,
+                        std::span<std::vector<uint32_t>> results) const {
+  jobs.ParallelFor(frustums.size(), kShapeQueryGrainSize,
+                   [&](size_t begin, size_t end) {
+                     for (size_t i = begin; i < end; ++i) {
+                       QueryFrustum(frustums[i], results[i]);
+                     }
+                   });
+}
+
+void Bvh::QueryAabbs(JobSystem& jobs, std::span<const Aabb> boxes,
+                     std::span<std::vector<uint32_t>> results) const {
+  jobs.ParallelFor(boxes.size(), kShapeQueryGrainSize,
+                   [&](size_t begin, size_t end) {
+                     for (size_t i = begin; i < end; ++i) {
+                       QueryAabb(boxes[i], results[i]);
+                     }
+                   });
+}
+
+void Bvh::Raycast(JobSystem& jobs, std::span<const Ray> rays,
+                  std::span<RayHit> hits) const {
+  jobs.ParallelFor(rays.size(), kRayQueryGrainSize,
+                   [&](size_t begin, size_t end) {
+                     for (size_t i = begin; i < end; ++i) {
+                       hits[i] = Raycast(rays[i]);
+                     }
+                   });
+}
+
+}  // namespace braque
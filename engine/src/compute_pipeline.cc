@@ -0,0 +1,181 @@
+#include "braque/compute_pipeline.h"
+
+#include "braque/layout_cache.h"
+#include "braque/shader.h"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <iterator>
+
+namespace braque {
+
+void InsertMemoryBarrier(vk::CommandBuffer buffer,
+                         vk::PipelineStageFlags2 src_stage,
+                         vk::AccessFlags2 src_access,
+                         vk::PipelineStageFlags2 dst_stage,
+                         vk::AccessFlags2 dst_access) {
+  vk::MemoryBarrier2 barrier{};
+  barrier.srcStageMask = src_stage;
+  barrier.srcAccessMask = src_access;
+  barrier.dstStageMask = dst_stage;
+  barrier.dstAccessMask = dst_access;
+
+  vk::DependencyInfo dependency{};
+  dependency.setMemoryBarriers(barrier);
+  buffer.pipelineBarrier2KHR(dependency);
+}
+
+ComputePipeline::ComputePipeline(vk::Device device, vk::PipelineCache cache,
+                                 LayoutCache& layouts,
+                                 const std::string& shader_filename,
+                                 std::span<const ShaderBinding> bindings,
+                                 const SpecializationConstants& constants)
+    : device_(device), name_(shader_filename) {
+  const ComputeShader shader(device, shader_filename, constants);
+  reflection_ = shader.GetReflection();
+
+  uint32_t set_count = GetSetCount(reflection_);
+  for (const auto& binding : bindings) {
+    set_count = std::max(set_count, binding.set + 1);
+  }
+
+  for (uint32_t set = 0; set < set_count; ++set) {
+    auto set_bindings = GetSetBindings(reflection_, set);
+
+    std::vector<ShaderBinding> shared;
+    std::copy_if(bindings.begin(), bindings.end(), std::back_inserter(shared),
+                 [set](const ShaderBinding& binding) {
+                   return binding.set == set;
+                 });
+
+    if (!shared.empty()) {
+      for (const auto& used : set_bindings) {
+        const auto found = std::find_if(
+            shared.begin(), shared.end(), [&used](const ShaderBinding& given) {
+              return given.binding == used.binding;
+            });
+        if (found == shared.end() || found->type != used.type ||
+            !(found->stages & vk::ShaderStageFlagBits::eCompute)) {
+          spdlog::error("{} uses set {} binding {} unlike the shared layout",
+                        shader_filename, set, used.binding);
+          throw std::runtime_error("Shader does not match the shared layout");
+        }
+      }
+      set_bindings = std::move(shared);
+    }
+
+    set_layouts_.push_back(layouts.GetSetLayout(set_bindings));
+    templates_.push_back(
+        set_bindings.empty()
+            ? nullptr
+            : std::make_unique<DescriptorTemplate>(device, set_layouts_.back(),
+                                                   set_bindings));
+  }
+
+  layout_ = layouts.GetPipelineLayout(set_layouts_, reflection_.push_constants);
+
+  vk::ComputePipelineCreateInfo pipelineInfo{};
+  pipelineInfo.setStage(shader.GetStageCreateInfo());
+  pipelineInfo.setLayout(layout_);
+
+  // the shader module is destroyed with the shader once the pipeline exists
+  auto result = device.createComputePipeline(cache, pipelineInfo);
+  if (result.result != vk::Result::eSuccess) {
+    spdlog::error("Failed to create compute pipeline {}", shader_filename);
+    throw std::runtime_error("Failed to create compute pipeline");
+  }
+
+  pipeline_ = result.value;
+
+  spdlog::info("Created compute pipeline {}", shader_filename);
+}
+
+ComputePipeline::~ComputePipeline() {
+  // the templates go with their members, the layouts stay with the cache
+  device_.destroyPipeline(pipeline_);
+}
+
+void ComputePipeline::Bind(vk::CommandBuffer buffer) const {
+  buffer.bindPipeline(vk::PipelineBindPoint::eCompute, pipeline_);
+}
+
+void ComputePipeline::BindSet(vk::CommandBuffer buffer, vk::DescriptorSet set,
+                              uint32_t index) const {
+  buffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, layout_, index,
+                            set, nullptr);
+}
+
+void ComputePipeline::PushConstants(vk::CommandBuffer buffer,
+                                    const void* data, uint32_t size) const {
+  if (reflection_.push_constants.empty() ||
+      reflection_.push_constants.front().size != size) {
+    spdlog::error("{} takes no {} bytes of push constants", name_, size);
+    throw std::runtime_error("Push constants do not match the shader");
+  }
+  buffer.pushConstants(layout_, vk::ShaderStageFlagBits::eCompute, 0, size,
+                       data);
+}
+
+void ComputePipeline::Dispatch(vk::CommandBuffer buffer,
+                               uint32_t count) const {
+  Dispatch(buffer, count, 1, 1);
+}
+
+void ComputePipeline::Dispatch(vk::CommandBuffer buffer, uint32_t width,
+                               uint32_t height, uint32_t depth) const {
+  if (width == 0 || height == 0 || depth == 0) {
+    return;
+  }
+
+  const auto& local_size = reflection_.local_size;
+  if (local_size[0] == 0) {
+    spdlog::error("{} sets its workgroup size by specialization", name_);
+    throw std::runtime_error("Workgroup size is not known");
+  }
+
+  buffer.dispatch((width + local_size[0] - 1) / local_size[0],
+                  (height + local_size[1] - 1) / local_size[1],
+                  (depth + local_size[2] - 1) / local_size[2]);
+}
+
+void ComputePipeline::DispatchIndirect(vk::CommandBuffer buffer,
+                                       vk::Buffer commands,
+                                       vk::DeviceSize offset) {
+  buffer.dispatchIndirect(commands, offset);
+}
+
+auto ComputePipeline::MakeData(uint32_t index) const -> DescriptorData {
+  return GetTemplate(index).MakeData();
+}
+
+auto ComputePipeline::AllocateSet(DescriptorAllocator& allocator,
+                                  const DescriptorData& data,
+                                  uint32_t index) const -> vk::DescriptorSet {
+  const auto& descriptor_template = GetTemplate(index);
+  const auto set = allocator.Allocate(descriptor_template.GetLayout());
+  descriptor_template.Update(set, data);
+  return set;
+}
+
+auto ComputePipeline::GetSet(DescriptorSetCache& cache,
+                             const DescriptorData& data, uint32_t index) const
+    -> vk::DescriptorSet {
+  return cache.Get(GetTemplate(index), data);
+}
+
+auto ComputePipeline::GetSetLayout(uint32_t index) const
+    -> vk::DescriptorSetLayout {
+  return set_layouts_.at(index);
+}
+
+auto ComputePipeline::GetTemplate(uint32_t index) const
+    -> const DescriptorTemplate& {
+  if (index >= templates_.size() || !templates_[index]) {
+    spdlog::error("{} has no bindings in set {}", name_, index);
+    throw std::runtime_error("Set has no bindings");
+  }
+  return *templates_[index];
+}
+
+}  // namespace braque
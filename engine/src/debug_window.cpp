@@ -14,6 +14,8 @@
 #include "imgui_impl_vulkan.h"
 #include "spdlog/spdlog.h"
 
+#include <algorithm>
+
 namespace braque
 {
 
@@ -86,9 +88,92 @@ namespace braque
     ImGui::Text( "Total memory: %llu", report.totalMemory );
     ImGui::Text( "Used memory: %llu", report.usedMemory );
     ImGui::Separator();
+
+    // culling counters are read back from an earlier frame
+    auto & scene = engine.getScene();
+    bool frustumCulling = scene.IsFrustumCulling();
+    if ( ImGui::Checkbox( "Frustum culling", &frustumCulling ) )
+    {
+      scene.SetFrustumCulling( frustumCulling );
+    }
+
+    bool occlusionCulling = scene.IsOcclusionCulling();
+    if ( ImGui::Checkbox( "Occlusion culling", &occlusionCulling ) )
+    {
+      scene.SetOcclusionCulling( occlusionCulling );
+    }
+
+    bool softwareOcclusion = scene.IsSoftwareOcclusion();
+    if ( ImGui::Checkbox( "Software occlusion", &softwareOcclusion ) )
+    {
+      scene.SetSoftwareOcclusion( softwareOcclusion );
+    }
+
+    // 0 pixels disables level of detail selection
+    float lodThreshold = scene.GetLodThreshold();
+    if ( ImGui::SliderFloat( "LOD error (px)", &lodThreshold, 0.0F, 8.0F ) )
+    {
+      scene.SetLodThreshold( lodThreshold );
+    }
+
+    const auto & culling = scene.GetCullingStats();
+    ImGui::Text( "Visible instances: %u", culling.visible );
+    ImGui::Text( "Culled instances: %u", culling.culled );
+
+    // direct draws only, indirect draws bind once per bucket
+    if ( !scene.IsGpuDriven() )
+    {
+      const auto & submit = scene.GetSubmitStats();
+      ImGui::Text( "Draws: %u, state binds: %u, skipped: %u", submit.draws,
+                   submit.state_binds, submit.redundant_binds );
+    }
+
+    if ( ImGui::CollapsingHeader( "Occlusion buffer" ) )
+    {
+      drawOcclusionBuffer( scene.GetOcclusionRasterizer() );
+    }
     ImGui::End();
   }
 
+  void DebugWindow::drawOcclusionBuffer( const OcclusionRasterizer & rasterizer )
+  {
+    // one rectangle per block of texels keeps the draw list small
+    constexpr uint32_t blockSize  = 4;
+    constexpr float    cellPixels = 8.0F;
+
+    const auto width  = rasterizer.GetWidth();
+    const auto height = rasterizer.GetHeight();
+    const auto depth  = rasterizer.GetDepth();
+
+    ImGui::Text( "Occluder triangles: %u", rasterizer.GetTriangleCount() );
+
+    const auto origin   = ImGui::GetCursorScreenPos();
+    auto *     drawList = ImGui::GetWindowDrawList();
+
+    for ( uint32_t by = 0; by < height / blockSize; ++by )
+    {
+      for ( uint32_t bx = 0; bx < width / blockSize; ++bx )
+      {
+        // nearest depth in the block, nearer occluders are brighter
+        float nearest = 1.0F;
+        for ( uint32_t y = 0; y < blockSize; ++y )
+        {
+          for ( uint32_t x = 0; x < blockSize; ++x )
+          {
+            nearest = std::min( nearest, depth[( by * blockSize + y ) * width + bx * blockSize + x] );
+          }
+        }
+
+        const auto shade = nearest < 1.0F ? static_cast<int>( 64.0F + 191.0F * ( 1.0F - nearest ) ) : 0;
+        const auto min   = ImVec2( origin.x + bx * cellPixels, origin.y + by * cellPixels );
+        const auto max   = ImVec2( min.x + cellPixels, min.y + cellPixels );
+        drawList->AddRectFilled( min, max, IM_COL32( shade, shade, shade, 255 ) );
+      }
+    }
+
+    ImGui::Dummy( ImVec2( width / blockSize * cellPixels, height / blockSize * cellPixels ) );
+  }
+
   void DebugWindow::renderFrame( const vk::CommandBuffer & commandBuffer )
   {
     ImGui::Render();
@@ -0,0 +1,256 @@
+#include "braque/descriptor_allocator.h"
+
+#include "braque/pipeline.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+
+#include <spdlog/spdlog.h>
+
+namespace braque {
+
+namespace {
+
+// every descriptor info a template reads fits one slot
+constexpr size_t kSlotSize = std::max({sizeof(VkDescriptorImageInfo),
+                                       sizeof(VkDescriptorBufferInfo),
+                                       sizeof(VkBufferView)});
+
+constexpr uint32_t kNoSlot = UINT32_MAX;
+
+template <typename T>
+void Write(std::byte* slot, size_t offset, const T& value) {
+  std::memcpy(slot + offset, &value, sizeof(T));
+}
+
+}  // namespace
+
+auto GetPoolSizes(std::span<const DescriptorPoolRatio> ratios,
+                  uint32_t set_count) -> std::vector<vk::DescriptorPoolSize> {
+  std::vector<vk::DescriptorPoolSize> sizes;
+  sizes.reserve(ratios.size());
+  for (const auto& ratio : ratios) {
+    const auto count = static_cast<uint32_t>(
+        std::ceil(ratio.per_set * static_cast<float>(set_count)));
+    sizes.emplace_back(ratio.type, std::max(count, 1U));
+  }
+  return sizes;
+}
+
+auto GetNextPoolSetCount(uint32_t set_count) -> uint32_t {
+  return std::min(set_count * 2, kMaxSetsPerPool);
+}
+
+DescriptorAllocator::DescriptorAllocator(
+    vk::Device device, std::span<const DescriptorPoolRatio> ratios,
+    uint32_t sets_per_pool, vk::DescriptorPoolCreateFlags flags)
+    : device_(device),
+      ratios_(ratios.begin(), ratios.end()),
+      flags_(flags),
+      sets_per_pool_(sets_per_pool) {
+  ready_.push_back(CreatePool());
+}
+
+DescriptorAllocator::~DescriptorAllocator() {
+  for (const auto pool : ready_) {
+    device_.destroyDescriptorPool(pool);
+  }
+  for (const auto pool : full_) {
+    device_.destroyDescriptorPool(pool);
+  }
+}
+
+auto DescriptorAllocator::Allocate(vk::DescriptorSetLayout layout)
+    -> vk::DescriptorSet {
+  vk::DescriptorSetAllocateInfo allocInfo;
+  allocInfo.setSetLayouts(layout);
+
+  // a fresh pool only fails when the layout needs types it has no room for
+  for (int attempt = 0; attempt < 2; ++attempt) {
+    allocInfo.setDescriptorPool(ready_.back());
+
+    vk::DescriptorSet set;
+    const auto result = device_.allocateDescriptorSets(&allocInfo, &set);
+    if (result == vk::Result::eSuccess) {
+      return set;
+    }
+    if (result != vk::Result::eErrorOutOfPoolMemory &&
+        result != vk::Result::eErrorFragmentedPool) {
+      break;
+    }
+
+    full_.push_back(ready_.back());
+    ready_.pop_back();
+    if (ready_.empty()) {
+      sets_per_pool_ = GetNextPoolSetCount(sets_per_pool_);
+      ready_.push_back(CreatePool());
+    }
+  }
+
+  spdlog::error("Failed to allocate a descriptor set");
+  throw std::runtime_error("Failed to allocate a descriptor set");
+}
+
+void DescriptorAllocator::Reset() {
+  for (const auto pool : ready_) {
+    device_.resetDescriptorPool(pool);
+  }
+  for (const auto pool : full_) {
+    device_.resetDescriptorPool(pool);
+    ready_.push_back(pool);
+  }
+  full_.clear();
+}
+
+auto DescriptorAllocator::CreatePool() -> vk::DescriptorPool {
+  const auto poolSizes = GetPoolSizes(ratios_, sets_per_pool_);
+
+  vk::DescriptorPoolCreateInfo poolInfo;
+  poolInfo.setPoolSizes(poolSizes);
+  poolInfo.setMaxSets(sets_per_pool_);
+  poolInfo.setFlags(flags_);
+
+  return device_.createDescriptorPool(poolInfo);
+}
+
+DescriptorData::DescriptorData(std::span<const ShaderBinding> bindings) {
+  uint32_t slots = 0;
+  for (const auto& binding : bindings) {
+    if (binding.binding >= first_.size()) {
+      first_.resize(binding.binding + 1, kNoSlot);
+      counts_.resize(binding.binding + 1, 0);
+    }
+    first_[binding.binding] = slots;
+    counts_[binding.binding] = binding.count;
+    slots += binding.count;
+  }
+  bytes_.resize(slots * kSlotSize);
+}
+
+void DescriptorData::SetBuffer(uint32_t binding, vk::Buffer buffer,
+                               vk::DeviceSize offset, vk::DeviceSize range,
+                               uint32_t element) {
+  auto* slot = Slot(binding, element);
+  Write(slot, offsetof(VkDescriptorBufferInfo, buffer),
+        static_cast<VkBuffer>(buffer));
+  Write(slot, offsetof(VkDescriptorBufferInfo, offset), offset);
+  Write(slot, offsetof(VkDescriptorBufferInfo, range), range);
+}
+
+void DescriptorData::SetImage(uint32_t binding, vk::ImageView view,
+                              vk::ImageLayout layout, vk::Sampler sampler,
+                              uint32_t element) {
+  auto* slot = Slot(binding, element);
+  Write(slot, offsetof(VkDescriptorImageInfo, sampler),
+        static_cast<VkSampler>(sampler));
+  Write(slot, offsetof(VkDescriptorImageInfo, imageView),
+        static_cast<VkImageView>(view));
+  Write(slot, offsetof(VkDescriptorImageInfo, imageLayout),
+        static_cast<VkImageLayout>(layout));
+}
+
+auto DescriptorData::Hash() const -> uint64_t {
+  // FNV-1a, the slots are zeroed so padding hashes the same every time
+  constexpr uint64_t kOffsetBasis = 14695981039346656037ULL;
+  constexpr uint64_t kPrime = 1099511628211ULL;
+
+  uint64_t hash = kOffsetBasis;
+  for (const auto byte : bytes_) {
+    hash = (hash ^ static_cast<uint8_t>(byte)) * kPrime;
+  }
+  return hash;
+}
+
+auto DescriptorData::Slot(uint32_t binding, uint32_t element) -> std::byte* {
+  if (binding >= first_.size() || first_[binding] == kNoSlot ||
+      element >= counts_[binding]) {
+    spdlog::error("Binding {} element {} is not in the set", binding,
+                  element);
+    throw std::runtime_error("Descriptor is not in the set");
+  }
+  return bytes_.data() + (first_[binding] + element) * kSlotSize;
+}
+
+DescriptorTemplate::DescriptorTemplate(vk::Device device,
+                                       vk::DescriptorSetLayout layout,
+                                       std::span<const ShaderBinding> bindings)
+    : device_(device), layout_(layout) {
+  // runtime arrays have no slots in the data
+  std::copy_if(bindings.begin(), bindings.end(),
+               std::back_inserter(bindings_),
+               [](const ShaderBinding& binding) { return binding.count > 0; });
+
+  std::vector<vk::DescriptorUpdateTemplateEntry> entries;
+  size_t slot = 0;
+  for (const auto& binding : bindings_) {
+    vk::DescriptorUpdateTemplateEntry entry{};
+    entry.setDstBinding(binding.binding);
+    entry.setDstArrayElement(0);
+    entry.setDescriptorCount(binding.count);
+    entry.setDescriptorType(binding.type);
+    entry.setOffset(slot * kSlotSize);
+    entry.setStride(kSlotSize);
+    entries.push_back(entry);
+    slot += binding.count;
+  }
+
+  vk::DescriptorUpdateTemplateCreateInfo templateInfo{};
+  templateInfo.setDescriptorUpdateEntries(entries);
+  templateInfo.setTemplateType(vk::DescriptorUpdateTemplateType::eDescriptorSet);
+  templateInfo.setDescriptorSetLayout(layout);
+
+  template_ = device.createDescriptorUpdateTemplate(templateInfo);
+}
+
+DescriptorTemplate::~DescriptorTemplate() {
+  device_.destroyDescriptorUpdateTemplate(template_);
+}
+
+void DescriptorTemplate::Update(vk::DescriptorSet set,
+                                const DescriptorData& data) const {
+  device_.updateDescriptorSetWithTemplate(set, template_, data.GetData());
+}
+
+DescriptorSetCache::DescriptorSetCache(
+    vk::Device device, uint32_t frame_count,
+    std::span<const DescriptorPoolRatio> ratios) {
+  frames_.resize(frame_count);
+  for (auto& frame : frames_) {
+    frame.allocator = std::make_unique<DescriptorAllocator>(device, ratios);
+  }
+}
+
+void DescriptorSetCache::BeginFrame(uint32_t frame) {
+  current_ = frame;
+  frames_[frame].allocator->Reset();
+  frames_[frame].sets.clear();
+}
+
+auto DescriptorSetCache::Get(const DescriptorTemplate& descriptor_template,
+                             const DescriptorData& data)
+    -> vk::DescriptorSet {
+  auto& frame = frames_[current_];
+
+  uint64_t key = data.Hash();
+  HashCombine(key, reinterpret_cast<uint64_t>(static_cast<VkDescriptorSetLayout>(
+                       descriptor_template.GetLayout())));
+
+  // equal hashes are compared in full, a collision must not bind the
+  // resources of another set
+  auto& bucket = frame.sets[key];
+  for (const auto& cached : bucket) {
+    if (cached.layout == descriptor_template.GetLayout() &&
+        cached.data == data) {
+      return cached.set;
+    }
+  }
+
+  const auto set = frame.allocator->Allocate(descriptor_template.GetLayout());
+  descriptor_template.Update(set, data);
+  bucket.push_back({descriptor_template.GetLayout(), data, set});
+  return set;
+}
+
+}  // namespace braque
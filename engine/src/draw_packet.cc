@@ -0,0 +1,219 @@
+#include "braque/draw_packet.h"
+
+#include "braque/indirect_draw_pass.h"
+#include "braque/job_system.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+namespace braque {
+
+namespace {
+
+constexpr uint32_t kRadixBits = 8;
+constexpr uint32_t kRadixSize = 1U << kRadixBits;
+constexpr uint32_t kRadixPasses = 64 / kRadixBits;
+
+// below this many keys a single thread sorts faster than a split pass
+constexpr size_t kParallelSortThreshold = 16384;
+constexpr size_t kSortChunkSize = 8192;
+
+using Histogram = std::array<uint32_t, kRadixSize>;
+
+auto Digit(uint64_t key, uint32_t pass) -> uint32_t {
+  return static_cast<uint32_t>(key >> (pass * kRadixBits)) & (kRadixSize - 1);
+}
+
+auto Field(uint32_t value, uint32_t bits) -> uint64_t {
+  return value & ((1ULL << bits) - 1);
+}
+
+}  // namespace
+
+auto MakeDrawKey(DrawPass pass, uint32_t pipeline, uint32_t material,
+                 uint32_t depth, uint32_t mesh) -> uint64_t {
+  uint64_t key = Field(static_cast<uint32_t>(pass), kDrawKeyPassBits);
+  key = (key << kDrawKeyPipelineBits) | Field(pipeline, kDrawKeyPipelineBits);
+  key = (key << kDrawKeyMaterialBits) | Field(material, kDrawKeyMaterialBits);
+  key = (key << kDrawKeyDepthBits) | Field(depth, kDrawKeyDepthBits);
+  key = (key << kDrawKeyMeshBits) | Field(mesh, kDrawKeyMeshBits);
+  return key;
+}
+
+auto QuantizeDepth(float depth, float near_plane, float far_plane)
+    -> uint32_t {
+  constexpr auto kMaxBucket =
+      static_cast<float>((1U << kDrawKeyDepthBits) - 1);
+
+  // logarithmic so nearby draws, where overdraw matters, get more buckets
+  const float clamped = std::clamp(depth, near_plane, far_plane);
+  const float t =
+      std::log(clamped / near_plane) / std::log(far_plane / near_plane);
+  return static_cast<uint32_t>(t * kMaxBucket + 0.5F);
+}
+
+void RadixSort(JobSystem& jobs, std::span<uint64_t> keys,
+               std::span<uint32_t> values) {
+  const size_t count = keys.size();
+  if (count < 2) {
+    return;
+  }
+
+  const size_t chunk_size =
+      count < kParallelSortThreshold ? count : kSortChunkSize;
+  const size_t chunk_count = (count + chunk_size - 1) / chunk_size;
+
+  // digits shared by every key do not reorder anything, find them once
+  std::array<Histogram, kRadixPasses> totals{};
+  for (const auto key : keys) {
+    for (uint32_t pass = 0; pass < kRadixPasses; ++pass) {
+      totals[pass][Digit(key, pass)]++;
+    }
+  }
+
+  std::vector<uint64_t> key_scratch(count);
+  std::vector<uint32_t> value_scratch(count);
+  std::span<uint64_t> source_keys = keys;
+  std::span<uint32_t> source_values = values;
+  std::span<uint64_t> target_keys = key_scratch;
+  std::span<uint32_t> target_values = value_scratch;
+
+  std::vector<Histogram> offsets(chunk_count);
+
+  for (uint32_t pass = 0; pass < kRadixPasses; ++pass) {
+    if (std::any_of(totals[pass].begin(), totals[pass].end(),
+                    [count](uint32_t total) { return total == count; })) {
+      continue;
+    }
+
+    // digit counts of every chunk in the current order
+    jobs.ParallelFor(chunk_count, 1, [&](size_t begin, size_t end) {
+      for (size_t chunk = begin; chunk < end; ++chunk) {
+        auto& histogram = offsets[chunk];
+        histogram.fill(0);
+        const auto last = std::min(count, (chunk + 1) * chunk_size);
+        for (size_t i = chunk * chunk_size; i < last; ++i) {
+          histogram[Digit(source_keys[i], pass)]++;
+        }
+      }
+    });
+
+    // each chunk writes after the earlier chunks with the same digit,
+    // which keeps the sort stable
+    uint32_t running = 0;
+    for (uint32_t digit = 0; digit < kRadixSize; ++digit) {
+      for (auto& histogram : offsets) {
+        const auto digit_count = histogram[digit];
+        histogram[digit] = running;
+        running += digit_count;
+      }
+    }
+
+    jobs.ParallelFor(chunk_count, 1, [&](size_t begin, size_t end) {
+      for (size_t chunk = begin; chunk < end; ++chunk) {
+        auto& histogram = offsets[chunk];
+        const auto last = std::min(count, (chunk + 1) * chunk_size);
+        for (size_t i = chunk * chunk_size; i < last; ++i) {
+          const auto slot = histogram[Digit(source_keys[i], pass)]++;
+          target_keys[slot] = source_keys[i];
+          target_values[slot] = source_values[i];
+        }
+      }
+    });
+
+    std::swap(source_keys, target_keys);
+    std::swap(source_values, target_values);
+  }
+
+  // an odd number of passes leaves the result in the scratch arrays
+  if (source_keys.data() != keys.data()) {
+    std::copy(source_keys.begin(), source_keys.end(), keys.begin());
+    std::copy(source_values.begin(), source_values.end(), values.begin());
+  }
+}
+
+void DrawPacketList::Clear() {
+  packets_.clear();
+  keys_.clear();
+  order_.clear();
+}
+
+void DrawPacketList::Add(uint64_t key, const DrawPacket& packet) {
+  order_.push_back(static_cast<uint32_t>(packets_.size()));
+  keys_.push_back(key);
+  packets_.push_back(packet);
+}
+
+void DrawPacketList::Sort(JobSystem& jobs) {
+  RadixSort(jobs, keys_, order_);
+}
+
+DrawTranslator::DrawTranslator(vk::CommandBuffer buffer,
+                               vk::PipelineLayout layout,
+                               std::span<const vk::DeviceSize> stream_offsets,
+                               VertexStreams streams)
+    : buffer_(buffer),
+      layout_(layout),
+      stream_offsets_(stream_offsets),
+      streams_(streams) {}
+
+template <typename T>
+auto DrawTranslator::Update(T& bound, const T& wanted) -> bool {
+  if (bound == wanted) {
+    stats_.redundant_binds++;
+    return false;
+  }
+  bound = wanted;
+  stats_.state_binds++;
+  return true;
+}
+
+void DrawTranslator::Submit(const DrawPacketList& packets) {
+  for (size_t i = 0; i < packets.Size(); ++i) {
+    Submit(packets.Get(i));
+  }
+}
+
+void DrawTranslator::Submit(const DrawPacket& packet) {
+  if (packet.pipeline && Update(pipeline_, packet.pipeline)) {
+    buffer_.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline_);
+  }
+
+  if (packet.descriptor_set &&
+      Update(descriptor_set_, packet.descriptor_set)) {
+    buffer_.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, layout_, 0,
+                               descriptor_set_, nullptr);
+  }
+
+  if (Update(vertex_buffer_, packet.vertex_buffer)) {
+    for (uint32_t i = 0; i < stream_offsets_.size(); ++i) {
+      if ((streams_ & StreamBit(static_cast<VertexStream>(i))) != 0) {
+        buffer_.bindVertexBuffers(i, vertex_buffer_, stream_offsets_[i]);
+      }
+    }
+  }
+
+  const IndexBinding index_binding{packet.index_buffer,
+                                   packet.index_buffer_offset,
+                                   packet.index_type};
+  if (Update(index_binding_, index_binding)) {
+    buffer_.bindIndexBuffer(index_binding.buffer, index_binding.offset,
+                            index_binding.type);
+  }
+
+  if (!has_draw_offset_ || packet.draw_offset != draw_offset_) {
+    has_draw_offset_ = true;
+    draw_offset_ = packet.draw_offset;
+    const DrawConstants constants{draw_offset_};
+    buffer_.pushConstants(layout_, vk::ShaderStageFlagBits::eVertex, 0,
+                          sizeof(DrawConstants), &constants);
+  }
+
+  buffer_.drawIndexed(packet.index_count, packet.instance_count,
+                      packet.first_index, packet.vertex_offset,
+                      packet.first_instance);
+  stats_.draws++;
+}
+
+}  // namespace braque
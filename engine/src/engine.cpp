@@ -19,12 +19,14 @@ namespace braque {
 Engine::Engine()
     :
       memoryAllocator(renderer),
-context_(memoryAllocator, renderer),
+      context_(memoryAllocator, renderer, jobSystem_),
       swapchain(window, context_),
+      async_compute_(renderer, Swapchain::getFramesInFlightCount()),
       uniforms_(context_, swapchain),
-      renderingStage(context_, swapchain,uniforms_),
+      renderingStage(context_, swapchain, uniforms_, kDefaultVertexLayout),
       debugWindow(*this),
-      scene_(context_, uniforms_) {
+      scene_(context_, uniforms_, renderingStage.GetHiZPyramid(),
+             kDefaultVertexLayout) {
   // Any other initialization after all members are constructed
   spdlog::info("Engine created");
   input_controller_.RegisterWindow(&window);
@@ -35,10 +37,20 @@ context_(memoryAllocator, renderer),
 
   camera_.SetAspectRatio(swapchain.getExtent().width /
                          static_cast<float>(swapchain.getExtent().height));
+
+#ifdef BRAQUE_SHADER_HOT_RELOAD
+  // compiled where the shaders are loaded from, relative to the working
+  // directory like them
+  shader_watcher_ = std::make_unique<ShaderWatcher>(
+      jobSystem_, BRAQUE_SHADER_SOURCE_DIR, "../assets/shaders", BRAQUE_GLSLC);
+#endif
 }
 
 Engine::~Engine() {
   renderer.waitIdle();
+
+  // compiles in flight run on the job system
+  shader_watcher_.reset();
 }
 
 void Engine::run() {
@@ -77,11 +89,29 @@ void Engine::run() {
     auto extent = swapchain.getExtent();
     auto& swapchainImage = swapchain.GetSwapchainImage();
     auto& currentColorImage = renderingStage.GetColorImages()[swapchain.CurrentFrameIndex()];
+    auto& currentDepthImage = renderingStage.GetDepthImages()[swapchain.CurrentFrameIndex()];
     auto& currentPostprocessImage = renderingStage.GetPostprocessingImages()[swapchain.CurrentFrameIndex()];
 
     auto commandBuffer = swapchain.getCommandBuffer();
     RenderingStage::begin(commandBuffer);
+    uniforms_.BeginFrame();
+    renderingStage.BeginFrame();
+    async_compute_.BeginFrame(swapchain.CurrentFrameIndex());
+
+    // submitted first so it runs while the frame is recorded and drawn
+    const auto computeWaits = async_compute_.SubmitPasses();
+
+    // pipelines of edited shaders take over from this frame on
+    auto& pipelines = renderingStage.GetPipelineManager();
+    if (shader_watcher_) {
+      for (const auto& shader : shader_watcher_->Poll()) {
+        pipelines.Reload(shader);
+      }
+    }
+    pipelines.ApplyReloads();
     uniforms_.SetCameraData(commandBuffer, camera_);
+    scene_.Update(swapchain.CurrentFrameIndex());
+    scene_.PrepareDraws(commandBuffer, camera_, extent.height);
 
     // prepare color image for rendering to
 
@@ -92,6 +122,19 @@ void Engine::run() {
 
     currentColorImage.TransitionLayout(vk::ImageLayout::eColorAttachmentOptimal, commandBuffer, barriers);
 
+    // prepare depth image, it is cleared by the first pass
+    barriers.srcStage = vk::PipelineStageFlagBits2::eEarlyFragmentTests |
+                        vk::PipelineStageFlagBits2::eLateFragmentTests;
+    barriers.srcAccess = {};
+    barriers.dstStage = vk::PipelineStageFlagBits2::eEarlyFragmentTests |
+                        vk::PipelineStageFlagBits2::eLateFragmentTests;
+    barriers.dstAccess = vk::AccessFlagBits2::eDepthStencilAttachmentRead |
+                         vk::AccessFlagBits2::eDepthStencilAttachmentWrite;
+    currentDepthImage.TransitionLayout(vk::ImageLayout::eDepthAttachmentOptimal, commandBuffer, barriers);
+
+    renderingStage.RecordComputePasses(commandBuffer, FramePoint::eBeforeDraws);
+
+    // first phase, instances that were visible last frame
     renderingStage.beginRenderingPass(commandBuffer);
     uniforms_.Bind(commandBuffer, renderingStage.GetPipeline().VulkanLayout());
     renderingStage.GetPipeline().Bind(commandBuffer);
@@ -100,12 +143,36 @@ void Engine::run() {
     Pipeline::SetViewport(commandBuffer,
                           {0, 0, static_cast<float>(extent.width),
                            static_cast<float>(extent.height), 0, 1});
-    scene_.Draw(commandBuffer);
+    scene_.Draw(commandBuffer, renderingStage.GetPipeline().VulkanLayout());
 
     //DebugWindow::renderFrame(commandBuffer);
 
     RenderingStage::endRenderingPass(commandBuffer);
 
+    renderingStage.RecordComputePasses(commandBuffer, FramePoint::eBetweenPhases);
+
+    // second phase, test everything against the depth drawn so far and
+    // draw what became visible
+    if (scene_.IsOcclusionActive()) {
+      renderingStage.GetHiZPyramid().Build(commandBuffer,
+                                           swapchain.CurrentFrameIndex());
+      scene_.PrepareOcclusionDraws(commandBuffer);
+
+      renderingStage.beginRenderingPass(commandBuffer, false);
+      uniforms_.Bind(commandBuffer, renderingStage.GetPipeline().VulkanLayout());
+      renderingStage.GetPipeline().Bind(commandBuffer);
+      Pipeline::SetScissor(commandBuffer,
+                           vk::Rect2D{{0, 0}, {extent.width, extent.height}});
+      Pipeline::SetViewport(commandBuffer,
+                            {0, 0, static_cast<float>(extent.width),
+                             static_cast<float>(extent.height), 0, 1});
+      scene_.Draw(commandBuffer, renderingStage.GetPipeline().VulkanLayout(),
+                  kAllVertexStreams, CullPhase::eDisoccluded);
+      RenderingStage::endRenderingPass(commandBuffer);
+    }
+
+    renderingStage.RecordComputePasses(commandBuffer, FramePoint::eAfterDraws);
+
     // transition color image to transfer src
     barriers.srcStage = vk::PipelineStageFlagBits2::eColorAttachmentOutput;
     barriers.srcAccess = vk::AccessFlagBits2::eColorAttachmentWrite;
@@ -159,7 +226,8 @@ void Engine::run() {
 
     RenderingStage::end(commandBuffer);
 
-    swapchain.submitCommandBuffer();
+    const auto graphicsSignal = async_compute_.SignalGraphics();
+    swapchain.submitCommandBuffer(computeWaits, {&graphicsSignal, 1});
 
 
 
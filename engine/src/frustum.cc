@@ -0,0 +1,51 @@
+#include "braque/frustum.h"
+
+namespace braque {
+
+auto ExtractFrustum(const glm::mat4& view_projection) -> Frustum {
+  // rows of the matrix, glm stores columns
+  std::array<glm::vec4, 4> rows{};
+  for (int i = 0; i < 4; ++i) {
+    rows[i] = glm::vec4(view_projection[0][i], view_projection[1][i],
+                        view_projection[2][i], view_projection[3][i]);
+  }
+
+  Frustum frustum{};
+  frustum.planes[0] = rows[3] + rows[0];  // left
+  frustum.planes[1] = rows[3] - rows[0];  // right
+  frustum.planes[2] = rows[3] + rows[1];  // bottom
+  frustum.planes[3] = rows[3] - rows[1];  // top
+  frustum.planes[4] = rows[2];            // near, depth is zero to one
+  frustum.planes[5] = rows[3] - rows[2];  // far
+
+  for (auto& plane : frustum.planes) {
+    plane /= glm::length(glm::vec3(plane));
+  }
+
+  return frustum;
+}
+
+auto IsSphereVisible(const Frustum& frustum, glm::vec3 center, float radius)
+    -> bool {
+  for (const auto& plane : frustum.planes) {
+    if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) {
+      return false;
+    }
+  }
+  return true;
+}
+
+auto IsBoxVisible(const Frustum& frustum, const Aabb& box) -> bool {
+  for (const auto& plane : frustum.planes) {
+    // the corner furthest along the plane normal
+    const glm::vec3 corner(plane.x >= 0.0F ? box.max.x : box.min.x,
+                           plane.y >= 0.0F ? box.max.y : box.min.y,
+                           plane.z >= 0.0F ? box.max.z : box.min.z);
+    if (glm::dot(glm::vec3(plane), corner) + plane.w < 0.0F) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace braque
@@ -0,0 +1,355 @@
+#include "braque/gpu_primitives.h"
+
+#include "braque/engine_context.h"
+#include "braque/renderer.h"
+#include "braque/shader.h"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <utility>
+
+namespace braque {
+
+namespace {
+
+// invocations of the scan shaders each cover this many elements
+constexpr uint32_t kScanItemsPerInvocation = 4;
+
+// scan_blocks.comp and scan_add.comp
+struct ScanConstants {
+  uint32_t count;
+  uint32_t write_block_sums;
+};
+
+struct AddConstants {
+  uint32_t count;
+};
+
+struct CompactConstants {
+  uint32_t count;
+};
+
+// radix_histogram.comp and radix_scatter.comp
+struct RadixConstants {
+  uint32_t count;
+  uint32_t shift;
+  uint32_t block_count;
+  uint32_t digit_mask;
+};
+
+auto DivideRoundingUp(uint32_t value, uint32_t divisor) -> uint32_t {
+  return (value + divisor - 1) / divisor;
+}
+
+auto AlignUp(vk::DeviceSize value, vk::DeviceSize alignment)
+    -> vk::DeviceSize {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+// digits of every radix block, scanned into the scatter offsets
+auto GetDigitCount(uint32_t count) -> uint32_t {
+  return kRadixDigits * DivideRoundingUp(count, kRadixBlockSize);
+}
+
+// the later passes of a dispatch read what the earlier ones wrote
+void ComputeBarrier(vk::CommandBuffer buffer) {
+  InsertMemoryBarrier(
+      buffer, vk::PipelineStageFlagBits2::eComputeShader,
+      vk::AccessFlagBits2::eShaderWrite,
+      vk::PipelineStageFlagBits2::eComputeShader,
+      vk::AccessFlagBits2::eShaderRead | vk::AccessFlagBits2::eShaderWrite);
+}
+
+}  // namespace
+
+auto GetScanLevels(uint32_t count) -> std::vector<uint32_t> {
+  std::vector<uint32_t> levels = {count};
+  while (levels.back() > kScanBlockSize) {
+    levels.push_back(DivideRoundingUp(levels.back(), kScanBlockSize));
+  }
+  return levels;
+}
+
+auto GetRadixPassCount(uint32_t key_bits) -> uint32_t {
+  if (key_bits == 0 || key_bits > 32) {
+    spdlog::error("Can not sort keys of {} bits", key_bits);
+    throw std::runtime_error("Radix sort key bits out of range");
+  }
+  return DivideRoundingUp(key_bits, kRadixBits);
+}
+
+auto GetRadixDigitMask(uint32_t key_bits, uint32_t pass) -> uint32_t {
+  const auto bits = std::min(key_bits - pass * kRadixBits, kRadixBits);
+  return (1U << bits) - 1;
+}
+
+GpuPrimitives::GpuPrimitives(EngineContext& engine,
+                             DescriptorSetCache& descriptors,
+                             uint32_t max_count, bool allow_subgroups)
+    : descriptors_(descriptors),
+      max_count_(std::max(max_count, 1U)),
+      subgroups_(allow_subgroups &&
+                 engine.getRenderer().GetFeatures().subgroup_arithmetic),
+      scan_levels_(LayoutScanLevels(engine, max_count_)),
+      scan_scratch_(engine, BufferType::indirect,
+                    scan_levels_.empty() ? sizeof(uint32_t)
+                                         : scan_levels_.back().scanned_offset +
+                                               scan_levels_.back().size),
+      flag_offsets_(engine, BufferType::indirect,
+                    max_count_ * sizeof(uint32_t)),
+      histogram_(engine, BufferType::indirect,
+                 GetDigitCount(max_count_) * sizeof(uint32_t)),
+      digit_offsets_(engine, BufferType::indirect,
+                     GetDigitCount(max_count_) * sizeof(uint32_t)),
+      sorted_keys_(engine, BufferType::indirect,
+                   max_count_ * sizeof(uint32_t)),
+      sorted_values_(engine, BufferType::indirect,
+                     max_count_ * sizeof(uint32_t)) {
+  auto& renderer = engine.getRenderer();
+  const auto device = renderer.getDevice();
+  const auto cache = renderer.GetPipelineCache();
+  auto& layouts = renderer.GetLayoutCache();
+
+  const auto* scan_shader =
+      subgroups_ ? kScanBlocksSubgroupShader : kScanBlocksShader;
+  const auto* scatter_shader =
+      subgroups_ ? kRadixScatterSubgroupShader : kRadixScatterShader;
+
+  SpecializationConstants inclusive;
+  inclusive.SetBool(0, true);
+
+  scan_exclusive_pipeline_ = std::make_unique<ComputePipeline>(
+      device, cache, layouts, scan_shader);
+  scan_inclusive_pipeline_ = std::make_unique<ComputePipeline>(
+      device, cache, layouts, scan_shader, std::span<const ShaderBinding>{},
+      inclusive);
+  scan_add_pipeline_ = std::make_unique<ComputePipeline>(
+      device, cache, layouts, kScanAddShader);
+  compact_pipeline_ = std::make_unique<ComputePipeline>(
+      device, cache, layouts, kCompactScatterShader);
+  histogram_pipeline_ = std::make_unique<ComputePipeline>(
+      device, cache, layouts, kRadixHistogramShader);
+  scatter_pipeline_ = std::make_unique<ComputePipeline>(
+      device, cache, layouts, scatter_shader);
+
+  spdlog::info("Created GPU primitives for {} elements{}", max_count_,
+               subgroups_ ? " with subgroup scans" : "");
+}
+
+// the sets belong to the frame's descriptor cache
+GpuPrimitives::~GpuPrimitives() = default;
+
+void GpuPrimitives::ExclusiveScan(vk::CommandBuffer buffer, vk::Buffer input,
+                                  vk::Buffer output, uint32_t count) {
+  CheckCount(count);
+  Scan(buffer, input, output, count, false);
+}
+
+void GpuPrimitives::InclusiveScan(vk::CommandBuffer buffer, vk::Buffer input,
+                                  vk::Buffer output, uint32_t count) {
+  CheckCount(count);
+  Scan(buffer, input, output, count, true);
+}
+
+void GpuPrimitives::Scan(vk::CommandBuffer buffer, vk::Buffer input,
+                         vk::Buffer output, uint32_t count, bool inclusive) {
+  if (count == 0) {
+    return;
+  }
+
+  const auto levels = GetScanLevels(count);
+  const auto last = static_cast<uint32_t>(levels.size() - 1);
+  const auto scratch = scan_scratch_.GetBuffer();
+
+  // scan every level's blocks and write their totals for the next level,
+  // the first level is the only one that may be inclusive
+  for (uint32_t i = 0; i <= last; ++i) {
+    const auto& pipeline = i == 0 && inclusive ? *scan_inclusive_pipeline_
+                                               : *scan_exclusive_pipeline_;
+
+    auto data = pipeline.MakeData();
+    if (i == 0) {
+      data.SetBuffer(0, input);
+      data.SetBuffer(1, output);
+    } else {
+      const auto& level = scan_levels_[i - 1];
+      data.SetBuffer(0, scratch, level.sums_offset, level.size);
+      data.SetBuffer(1, scratch, level.scanned_offset, level.size);
+    }
+    // the last level is a single block without totals to write
+    if (i < last) {
+      const auto& next = scan_levels_[i];
+      data.SetBuffer(2, scratch, next.sums_offset, next.size);
+    } else {
+      data.SetBuffer(2, scratch);
+    }
+
+    ComputeBarrier(buffer);
+    pipeline.Bind(buffer);
+    pipeline.BindSet(buffer, pipeline.GetSet(descriptors_, data));
+    pipeline.PushConstants(
+        buffer, ScanConstants{levels[i], i < last ? 1U : 0U});
+    pipeline.Dispatch(buffer,
+                      DivideRoundingUp(levels[i], kScanItemsPerInvocation));
+  }
+
+  // then add the scanned totals back from the top, every level is complete
+  // before the one below it adds its values
+  for (uint32_t i = last; i-- > 0;) {
+    const auto& offsets = scan_levels_[i];
+
+    auto data = scan_add_pipeline_->MakeData();
+    if (i == 0) {
+      data.SetBuffer(0, output);
+    } else {
+      const auto& level = scan_levels_[i - 1];
+      data.SetBuffer(0, scratch, level.scanned_offset, level.size);
+    }
+    data.SetBuffer(1, scratch, offsets.scanned_offset, offsets.size);
+
+    ComputeBarrier(buffer);
+    scan_add_pipeline_->Bind(buffer);
+    scan_add_pipeline_->BindSet(buffer,
+                                scan_add_pipeline_->GetSet(descriptors_, data));
+    scan_add_pipeline_->PushConstants(buffer, AddConstants{levels[i]});
+    scan_add_pipeline_->Dispatch(
+        buffer, DivideRoundingUp(levels[i], kScanItemsPerInvocation));
+  }
+}
+
+void GpuPrimitives::Compact(vk::CommandBuffer buffer, vk::Buffer values,
+                            vk::Buffer flags, vk::Buffer output,
+                            vk::Buffer count_output, uint32_t count) {
+  CheckCount(count);
+  Scan(buffer, flags, flag_offsets_.GetBuffer(), count, false);
+
+  auto data = compact_pipeline_->MakeData();
+  data.SetBuffer(0, values);
+  data.SetBuffer(1, flags);
+  data.SetBuffer(2, flag_offsets_.GetBuffer());
+  data.SetBuffer(3, output);
+  data.SetBuffer(4, count_output);
+
+  ComputeBarrier(buffer);
+  compact_pipeline_->Bind(buffer);
+  compact_pipeline_->BindSet(buffer,
+                             compact_pipeline_->GetSet(descriptors_, data));
+  compact_pipeline_->PushConstants(buffer, CompactConstants{count});
+  // an empty input still writes its count
+  compact_pipeline_->Dispatch(buffer, std::max(count, 1U));
+}
+
+void GpuPrimitives::RadixSort(vk::CommandBuffer buffer, vk::Buffer keys,
+                              vk::Buffer values, uint32_t count,
+                              uint32_t key_bits) {
+  CheckCount(count);
+  const auto passes = GetRadixPassCount(key_bits);
+  if (count <= 1) {
+    return;
+  }
+
+  const auto block_count = DivideRoundingUp(count, kRadixBlockSize);
+  const auto digit_count = GetDigitCount(count);
+
+  // every pass sorts from one pair of buffers into the other
+  vk::Buffer source_keys = keys;
+  vk::Buffer source_values = values;
+  vk::Buffer sorted_keys = sorted_keys_.GetBuffer();
+  vk::Buffer sorted_values = sorted_values_.GetBuffer();
+
+  for (uint32_t pass = 0; pass < passes; ++pass) {
+    const RadixConstants constants{count, pass * kRadixBits, block_count,
+                                   GetRadixDigitMask(key_bits, pass)};
+
+    auto histogram = histogram_pipeline_->MakeData();
+    histogram.SetBuffer(0, source_keys);
+    histogram.SetBuffer(1, histogram_.GetBuffer());
+
+    ComputeBarrier(buffer);
+    histogram_pipeline_->Bind(buffer);
+    histogram_pipeline_->BindSet(
+        buffer, histogram_pipeline_->GetSet(descriptors_, histogram));
+    histogram_pipeline_->PushConstants(buffer, constants);
+    histogram_pipeline_->Dispatch(buffer, count);
+
+    // digit major counts, scanned they are where each block writes a digit
+    Scan(buffer, histogram_.GetBuffer(), digit_offsets_.GetBuffer(),
+         digit_count, false);
+
+    auto scatter = scatter_pipeline_->MakeData();
+    scatter.SetBuffer(0, source_keys);
+    scatter.SetBuffer(1, source_values);
+    scatter.SetBuffer(2, digit_offsets_.GetBuffer());
+    scatter.SetBuffer(3, sorted_keys);
+    scatter.SetBuffer(4, sorted_values);
+
+    ComputeBarrier(buffer);
+    scatter_pipeline_->Bind(buffer);
+    scatter_pipeline_->BindSet(
+        buffer, scatter_pipeline_->GetSet(descriptors_, scatter));
+    scatter_pipeline_->PushConstants(buffer, constants);
+    scatter_pipeline_->Dispatch(buffer, count);
+
+    std::swap(source_keys, sorted_keys);
+    std::swap(source_values, sorted_values);
+  }
+
+  if (passes % 2 == 0) {
+    return;
+  }
+
+  // the last pass wrote the scratch buffers
+  InsertMemoryBarrier(buffer, vk::PipelineStageFlagBits2::eComputeShader,
+                      vk::AccessFlagBits2::eShaderWrite,
+                      vk::PipelineStageFlagBits2::eCopy,
+                      vk::AccessFlagBits2::eTransferRead);
+
+  const vk::BufferCopy region{0, 0, count * sizeof(uint32_t)};
+  buffer.copyBuffer(source_keys, keys, region);
+  buffer.copyBuffer(source_values, values, region);
+
+  // chains the copies into the compute stage, so the caller's barrier
+  // after compute writes covers them too
+  InsertMemoryBarrier(
+      buffer, vk::PipelineStageFlagBits2::eCopy,
+      vk::AccessFlagBits2::eTransferWrite,
+      vk::PipelineStageFlagBits2::eComputeShader,
+      vk::AccessFlagBits2::eShaderRead | vk::AccessFlagBits2::eShaderWrite);
+}
+
+auto GpuPrimitives::LayoutScanLevels(const EngineContext& engine,
+                                     uint32_t max_count)
+    -> std::vector<ScanLevel> {
+  // the digit offsets of a sort are scanned as well
+  const auto levels =
+      GetScanLevels(std::max(max_count, GetDigitCount(max_count)));
+
+  // at offsets a storage buffer descriptor may start at
+  const auto alignment = engine.getRenderer()
+                             .getPhysicalDevice()
+                             .getProperties()
+                             .limits.minStorageBufferOffsetAlignment;
+
+  std::vector<ScanLevel> scan_levels;
+  vk::DeviceSize offset = 0;
+  for (size_t i = 1; i < levels.size(); ++i) {
+    ScanLevel level{};
+    level.size = levels[i] * sizeof(uint32_t);
+    level.sums_offset = offset;
+    level.scanned_offset = AlignUp(level.sums_offset + level.size, alignment);
+    offset = AlignUp(level.scanned_offset + level.size, alignment);
+    scan_levels.push_back(level);
+  }
+  return scan_levels;
+}
+
+void GpuPrimitives::CheckCount(uint32_t count) const {
+  if (count > max_count_) {
+    spdlog::error("{} elements exceed the {} GPU primitives were created for",
+                  count, max_count_);
+    throw std::runtime_error("Too many elements for the GPU primitives");
+  }
+}
+
+}  // namespace braque
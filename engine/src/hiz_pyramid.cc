@@ -0,0 +1,216 @@
+#include "braque/hiz_pyramid.h"
+
+#include "braque/engine_context.h"
+#include "braque/layout_cache.h"
+#include "braque/renderer.h"
+#include "braque/shader.h"
+#include "braque/swapchain.h"
+
+#include <glm/glm.hpp>
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <bit>
+
+namespace braque {
+
+namespace {
+
+constexpr auto kPyramidFormat = vk::Format::eR32Sfloat;
+
+// level 0 texels covered by one workgroup along each axis
+constexpr uint32_t kTileSize = 32;
+
+constexpr uint32_t kDepthBinding = 0;
+constexpr uint32_t kLevelsBinding = 1;
+constexpr uint32_t kCounterBinding = 2;
+
+struct DownsampleConstants {
+  glm::ivec2 depth_size;
+  glm::ivec2 pyramid_size;
+  uint32_t level_count;
+  uint32_t group_count;
+};
+
+auto MakePyramidConfig(vk::Extent2D extent, uint32_t level_count)
+    -> ImageConfig {
+  ImageConfig config{};
+  config.extent = vk::Extent3D{extent, 1};
+  config.format = kPyramidFormat;
+  config.usage =
+      vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eSampled;
+  config.mipLevels = level_count;
+  return config;
+}
+
+}  // namespace
+
+HiZPyramid::HiZPyramid(EngineContext& engine, std::vector<Image>& depth_images)
+    : engine_(engine),
+      depth_images_(depth_images),
+      extent_(GetPyramidExtent(depth_images.front().GetExtent())),
+      level_count_(GetLevelCount(extent_)),
+      pyramid_(engine, MakePyramidConfig(extent_, level_count_)),
+      counter_(engine, BufferType::indirect, sizeof(uint32_t)) {
+
+  pipeline_ = std::make_unique<ComputePipeline>(
+      engine.getRenderer().getDevice(),
+      engine.getRenderer().GetPipelineCache(),
+      engine.getRenderer().GetLayoutCache(), kHiZDownsampleShader);
+
+  CreateLevelViews();
+  CreateSampler();
+  CreateDescriptorSets();
+
+  // the culling pass binds the pyramid before the first build
+  SyncBarriers barriers;
+  barriers.srcStage = vk::PipelineStageFlagBits2::eNone;
+  barriers.srcAccess = {};
+  barriers.dstStage = vk::PipelineStageFlagBits2::eComputeShader;
+  barriers.dstAccess = vk::AccessFlagBits2::eShaderSampledRead;
+
+  auto cmd = engine.getRenderer().CreateCommandBuffer();
+  cmd.begin(vk::CommandBufferBeginInfo{});
+  pyramid_.TransitionLayout(vk::ImageLayout::eGeneral, cmd, barriers,
+                            level_count_);
+  cmd.end();
+  engine.getRenderer().SubmitAndWait(cmd);
+
+  spdlog::info("Created {}x{} Hi-Z pyramid with {} levels", extent_.width,
+               extent_.height, level_count_);
+}
+
+HiZPyramid::~HiZPyramid() {
+  const auto device = engine_.getRenderer().getDevice();
+
+  // the sets stay with the renderer's allocator
+  device.destroySampler(sampler_);
+
+  for (const auto view : level_views_) {
+    device.destroyImageView(view);
+  }
+}
+
+auto HiZPyramid::GetPyramidExtent(vk::Extent3D depth_extent) -> vk::Extent2D {
+  return {std::bit_floor(depth_extent.width),
+          std::bit_floor(depth_extent.height)};
+}
+
+auto HiZPyramid::GetLevelCount(vk::Extent2D extent) -> uint32_t {
+  const auto levels = static_cast<uint32_t>(
+      std::bit_width(std::max(extent.width, extent.height)));
+  return std::min(levels, kMaxHiZLevels);
+}
+
+void HiZPyramid::CreateLevelViews() {
+  for (uint32_t level = 0; level < level_count_; ++level) {
+    vk::ImageViewCreateInfo createInfo{};
+    createInfo.setImage(pyramid_.GetImage());
+    createInfo.setViewType(vk::ImageViewType::e2D);
+    createInfo.setFormat(kPyramidFormat);
+    createInfo.setSubresourceRange(
+        {vk::ImageAspectFlagBits::eColor, level, 1, 0, 1});
+
+    level_views_.push_back(
+        engine_.getRenderer().getDevice().createImageView(createInfo));
+  }
+}
+
+void HiZPyramid::CreateSampler() {
+  // texels are fetched exactly, filtering would mix in nearer depths
+  vk::SamplerCreateInfo samplerInfo{};
+  samplerInfo.setMagFilter(vk::Filter::eNearest);
+  samplerInfo.setMinFilter(vk::Filter::eNearest);
+  samplerInfo.setMipmapMode(vk::SamplerMipmapMode::eNearest);
+  samplerInfo.setAddressModeU(vk::SamplerAddressMode::eClampToEdge);
+  samplerInfo.setAddressModeV(vk::SamplerAddressMode::eClampToEdge);
+  samplerInfo.setAddressModeW(vk::SamplerAddressMode::eClampToEdge);
+  samplerInfo.setMinLod(0.0F);
+  samplerInfo.setMaxLod(static_cast<float>(level_count_));
+
+  sampler_ = engine_.getRenderer().getDevice().createSampler(samplerInfo);
+}
+
+void HiZPyramid::CreateDescriptorSets() {
+  auto& allocator = engine_.getRenderer().GetDescriptorAllocator();
+
+  auto data = pipeline_->MakeData();
+
+  // unused array slots repeat the smallest level so every slot is valid
+  for (uint32_t i = 0; i < kMaxHiZLevels; ++i) {
+    data.SetImage(kLevelsBinding, level_views_[std::min(i, level_count_ - 1)],
+                  vk::ImageLayout::eGeneral, {}, i);
+  }
+  data.SetBuffer(kCounterBinding, counter_.GetBuffer());
+
+  for (const auto& depth : depth_images_) {
+    data.SetImage(kDepthBinding, depth.GetImageView(),
+                  vk::ImageLayout::eDepthReadOnlyOptimal, sampler_);
+
+    descriptor_sets_.push_back(pipeline_->AllocateSet(allocator, data));
+  }
+}
+
+void HiZPyramid::Build(vk::CommandBuffer buffer, uint32_t frame) {
+  auto& depth = depth_images_[frame];
+
+  // depth writes of the first phase must land before they are read
+  SyncBarriers barriers;
+  barriers.srcStage = vk::PipelineStageFlagBits2::eEarlyFragmentTests |
+                      vk::PipelineStageFlagBits2::eLateFragmentTests;
+  barriers.srcAccess = vk::AccessFlagBits2::eDepthStencilAttachmentWrite;
+  barriers.dstStage = vk::PipelineStageFlagBits2::eComputeShader;
+  barriers.dstAccess = vk::AccessFlagBits2::eShaderSampledRead;
+  depth.TransitionLayout(vk::ImageLayout::eDepthReadOnlyOptimal, buffer,
+                         barriers);
+
+  // the previous build may still be sampled by the culling pass
+  barriers.srcStage = vk::PipelineStageFlagBits2::eComputeShader;
+  barriers.srcAccess = vk::AccessFlagBits2::eShaderSampledRead;
+  barriers.dstStage = vk::PipelineStageFlagBits2::eComputeShader;
+  barriers.dstAccess = vk::AccessFlagBits2::eShaderStorageRead |
+                       vk::AccessFlagBits2::eShaderStorageWrite;
+  pyramid_.TransitionLayout(vk::ImageLayout::eGeneral, buffer, barriers,
+                            level_count_);
+
+  buffer.fillBuffer(counter_.GetBuffer(), 0, VK_WHOLE_SIZE, 0);
+
+  InsertMemoryBarrier(buffer, vk::PipelineStageFlagBits2::eTransfer,
+                      vk::AccessFlagBits2::eTransferWrite,
+                      vk::PipelineStageFlagBits2::eComputeShader,
+                      vk::AccessFlagBits2::eShaderStorageRead |
+                          vk::AccessFlagBits2::eShaderStorageWrite);
+
+  const auto groups_x = (extent_.width + kTileSize - 1) / kTileSize;
+  const auto groups_y = (extent_.height + kTileSize - 1) / kTileSize;
+
+  DownsampleConstants constants{};
+  constants.depth_size = glm::ivec2(depth.GetExtent().width,
+                                    depth.GetExtent().height);
+  constants.pyramid_size = glm::ivec2(extent_.width, extent_.height);
+  constants.level_count = level_count_;
+  constants.group_count = groups_x * groups_y;
+
+  pipeline_->Bind(buffer);
+  pipeline_->BindSet(buffer, descriptor_sets_[frame]);
+  pipeline_->PushConstants(buffer, constants);
+  buffer.dispatch(groups_x, groups_y, 1);
+
+  // hand the pyramid to the culling pass
+  InsertMemoryBarrier(buffer, vk::PipelineStageFlagBits2::eComputeShader,
+                      vk::AccessFlagBits2::eShaderStorageWrite,
+                      vk::PipelineStageFlagBits2::eComputeShader,
+                      vk::AccessFlagBits2::eShaderSampledRead);
+
+  // the second phase keeps testing and writing depth
+  barriers.srcStage = vk::PipelineStageFlagBits2::eComputeShader;
+  barriers.srcAccess = vk::AccessFlagBits2::eShaderSampledRead;
+  barriers.dstStage = vk::PipelineStageFlagBits2::eEarlyFragmentTests |
+                      vk::PipelineStageFlagBits2::eLateFragmentTests;
+  barriers.dstAccess = vk::AccessFlagBits2::eDepthStencilAttachmentRead |
+                       vk::AccessFlagBits2::eDepthStencilAttachmentWrite;
+  depth.TransitionLayout(vk::ImageLayout::eDepthAttachmentOptimal, buffer,
+                         barriers);
+}
+
+}  // namespace braque
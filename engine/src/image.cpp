@@ -132,7 +132,8 @@ Image::Image(Image&& other) noexcept
       image_view_(other.GetImageView()),
       extent_(other.extent_),
       format(other.format),
-      layout_(other.layout_) {
+      layout_(other.layout_),
+      mip_levels_(other.mip_levels_) {
   other.image_ = nullptr;
   other.image_view_ = nullptr;
   other.allocation_ = nullptr;
@@ -224,7 +225,9 @@ void Image::TransitionLayout(const vk::ImageLayout newLayout,
   barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
   barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
   barrier.image = image_;
-  barrier.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eColor;
+  barrier.subresourceRange.aspectMask = format == vk::Format::eD32Sfloat
+                                            ? vk::ImageAspectFlagBits::eDepth
+                                            : vk::ImageAspectFlagBits::eColor;
   barrier.subresourceRange.baseMipLevel = 0;
   barrier.subresourceRange.levelCount = mipLevels;  // use all mip levels
   barrier.subresourceRange.baseArrayLayer = 0;
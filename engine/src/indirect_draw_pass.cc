@@ -0,0 +1,354 @@
+#include "braque/indirect_draw_pass.h"
+
+#include "braque/engine_context.h"
+#include "braque/frustum.h"
+#include "braque/hiz_pyramid.h"
+#include "braque/layout_cache.h"
+#include "braque/memory_allocator.h"
+#include "braque/renderer.h"
+#include "braque/scene.h"
+#include "braque/shader.h"
+#include "braque/swapchain.h"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace braque {
+
+namespace {
+
+constexpr uint32_t kCommandStride = sizeof(vk::DrawIndexedIndirectCommand);
+
+// records, commands, counts, draw data, instances, visible instances,
+// visible counts, stats and visibility flags
+constexpr uint32_t kStorageBindingCount = 9;
+constexpr uint32_t kCullUniformsBinding = 9;
+constexpr uint32_t kHiZBinding = 10;
+
+auto GetPassBindings() -> std::array<ShaderBinding, kStorageBindingCount + 2> {
+  std::array<ShaderBinding, kStorageBindingCount + 2> bindings{};
+  for (uint32_t i = 0; i < kStorageBindingCount; ++i) {
+    bindings[i] = {0, i, vk::DescriptorType::eStorageBuffer, 1,
+                   vk::ShaderStageFlagBits::eCompute};
+  }
+  bindings[kCullUniformsBinding] = {0, kCullUniformsBinding,
+                                    vk::DescriptorType::eUniformBuffer, 1,
+                                    vk::ShaderStageFlagBits::eCompute};
+  bindings[kHiZBinding] = {0, kHiZBinding,
+                           vk::DescriptorType::eCombinedImageSampler, 1,
+                           vk::ShaderStageFlagBits::eCompute};
+  return bindings;
+}
+
+// shared by cull_instances.comp and draw_commands.comp
+struct PassConstants {
+  uint32_t instance_count;
+  uint32_t record_count;
+  uint32_t compact;
+  uint32_t frustum;
+  uint32_t occlusion;
+  uint32_t phase;
+};
+
+// laid out to match the std140 CullUniforms block in cull_instances.comp
+struct CullUniforms {
+  glm::mat4 view_projection;
+  std::array<glm::vec4, 6> planes;
+  glm::vec2 pyramid_size;
+  float pyramid_levels;
+  float lod_threshold;
+  glm::vec4 eye;  // camera position and lod scale
+};
+
+}  // namespace
+
+IndirectDrawPass::IndirectDrawPass(EngineContext& engine,
+                                   const std::vector<Buffer>& instance_buffers,
+                                   const std::vector<Buffer>& draw_data_buffers,
+                                   const HiZPyramid& hiz_pyramid)
+    : engine_(engine),
+      visibility_(engine, BufferType::indirect,
+                  kMaxInstances * sizeof(uint32_t)) {
+  const auto& features = engine.getRenderer().GetFeatures();
+
+  // without multi draw the count variant is limited to a single draw
+  use_draw_count_ =
+      features.draw_indirect_count && features.multi_draw_indirect;
+  use_multi_draw_ = features.multi_draw_indirect;
+
+  if (!use_draw_count_) {
+    spdlog::warn("drawIndexedIndirectCount unavailable, using max count draws");
+  }
+
+  frames_.reserve(Swapchain::getFramesInFlightCount());
+  for (uint32_t i = 0; i < Swapchain::getFramesInFlightCount(); ++i) {
+    frames_.push_back(FrameResources{
+        Buffer(engine, BufferType::storage,
+               kMaxIndirectDraws * sizeof(DrawRecord)),
+        Buffer(engine, BufferType::indirect,
+               kIndirectDrawDataCount * sizeof(vk::DrawIndexedIndirectCommand)),
+        Buffer(engine, BufferType::indirect,
+               kCullPhaseCount * kMaxDrawBuckets * sizeof(uint32_t)),
+        Buffer(engine, BufferType::indirect,
+               kMaxMeshLods * kMaxInstances * sizeof(uint32_t)),
+        Buffer(engine, BufferType::indirect,
+               kCullPhaseCount * kMaxIndirectDraws * sizeof(uint32_t)),
+        Buffer(engine, BufferType::indirect, sizeof(CullingStats)),
+        Buffer(engine, BufferType::readback, sizeof(CullingStats)),
+        Buffer(engine, BufferType::uniform, sizeof(CullUniforms))});
+  }
+
+  auto& renderer = engine.getRenderer();
+
+  // both shaders use parts of one set, which is bound once for both
+  const auto bindings = GetPassBindings();
+  cull_pipeline_ = std::make_unique<ComputePipeline>(
+      renderer.getDevice(), renderer.GetPipelineCache(),
+      renderer.GetLayoutCache(), kCullInstancesShader, bindings);
+  command_pipeline_ = std::make_unique<ComputePipeline>(
+      renderer.getDevice(), renderer.GetPipelineCache(),
+      renderer.GetLayoutCache(), kDrawCommandsShader, bindings);
+
+  CreateDescriptorSets(instance_buffers, draw_data_buffers, hiz_pyramid);
+
+  // nothing has been tested yet, start with everything visible
+  auto cmd = engine.getRenderer().CreateCommandBuffer();
+  cmd.begin(vk::CommandBufferBeginInfo{});
+  cmd.fillBuffer(visibility_.GetBuffer(), 0, VK_WHOLE_SIZE, 1);
+  cmd.end();
+  engine.getRenderer().SubmitAndWait(cmd);
+}
+
+// the sets stay with the renderer's allocator
+IndirectDrawPass::~IndirectDrawPass() = default;
+
+void IndirectDrawPass::CreateDescriptorSets(
+    const std::vector<Buffer>& instance_buffers,
+    const std::vector<Buffer>& draw_data_buffers,
+    const HiZPyramid& hiz_pyramid) {
+  auto& allocator = engine_.getRenderer().GetDescriptorAllocator();
+
+  auto data = cull_pipeline_->MakeData();
+  data.SetImage(kHiZBinding, hiz_pyramid.GetImageView(),
+                vk::ImageLayout::eGeneral, hiz_pyramid.GetSampler());
+
+  for (size_t i = 0; i < frames_.size(); ++i) {
+    auto& frame = frames_[i];
+
+    const std::array buffers = {
+        frame.records.GetBuffer(),           frame.commands.GetBuffer(),
+        frame.counts.GetBuffer(),            draw_data_buffers[i].GetBuffer(),
+        instance_buffers[i].GetBuffer(),     frame.visible_instances.GetBuffer(),
+        frame.visible_counts.GetBuffer(),    frame.stats.GetBuffer(),
+        visibility_.GetBuffer()};
+
+    for (uint32_t binding = 0; binding < kStorageBindingCount; ++binding) {
+      data.SetBuffer(binding, buffers[binding]);
+    }
+    data.SetBuffer(kCullUniformsBinding, frame.cull_uniforms.GetBuffer(), 0,
+                   sizeof(CullUniforms));
+
+    frame.descriptor_set = cull_pipeline_->AllocateSet(allocator, data);
+  }
+
+  pyramid_size_ = glm::vec2(hiz_pyramid.GetExtent().width,
+                            hiz_pyramid.GetExtent().height);
+  pyramid_levels_ = hiz_pyramid.GetLevelCount();
+}
+
+void IndirectDrawPass::SetRecords(uint32_t frame,
+                                  std::span<const DrawRecord> records,
+                                  uint32_t instance_count) {
+  if (records.size() > kMaxIndirectDraws) {
+    spdlog::error("Too many draw records: {}", records.size());
+    throw std::runtime_error("Too many draw records");
+  }
+
+  auto& resources = frames_[frame];
+  resources.record_count = static_cast<uint32_t>(records.size());
+  resources.instance_count = instance_count;
+  resources.bucket_sizes.fill(0);
+
+  for (const auto& record : records) {
+    resources.bucket_sizes[record.bucket] =
+        std::max(resources.bucket_sizes[record.bucket], record.slot + 1);
+  }
+
+  if (!records.empty()) {
+    resources.records.CopyData(records.data(), records.size_bytes());
+  }
+}
+
+void IndirectDrawPass::Dispatch(vk::CommandBuffer buffer, uint32_t frame,
+                                const CullView& view, CullPhase phase) {
+  auto& resources = frames_[frame];
+  const auto visible_counts_size =
+      static_cast<vk::DeviceSize>(kMaxIndirectDraws) * sizeof(uint32_t);
+
+  if (phase == CullPhase::eVisibleLastFrame) {
+    CullUniforms uniforms{};
+    uniforms.view_projection = view.view_projection;
+    uniforms.planes = ExtractFrustum(view.view_projection).planes;
+    uniforms.pyramid_size = pyramid_size_;
+    uniforms.pyramid_levels = static_cast<float>(pyramid_levels_);
+    uniforms.lod_threshold = view.lod_threshold;
+    uniforms.eye = glm::vec4(view.eye, view.lod_scale);
+    resources.cull_uniforms.CopyData(&uniforms, sizeof(CullUniforms));
+
+    // counters are accumulated with atomics and start from zero every
+    // frame, the previous frame may still be writing the visibility flags
+    buffer.fillBuffer(resources.counts.GetBuffer(), 0, VK_WHOLE_SIZE, 0);
+    buffer.fillBuffer(resources.visible_counts.GetBuffer(), 0,
+                      visible_counts_size, 0);
+    buffer.fillBuffer(resources.stats.GetBuffer(), 0, VK_WHOLE_SIZE, 0);
+
+    InsertMemoryBarrier(buffer,
+                        vk::PipelineStageFlagBits2::eTransfer |
+                            vk::PipelineStageFlagBits2::eComputeShader,
+                        vk::AccessFlagBits2::eTransferWrite |
+                            vk::AccessFlagBits2::eShaderStorageWrite,
+                        vk::PipelineStageFlagBits2::eComputeShader,
+                        vk::AccessFlagBits2::eShaderStorageRead |
+                            vk::AccessFlagBits2::eShaderStorageWrite);
+  } else {
+    // the second phase appends after the instances of the first
+    vk::BufferCopy countsCopy{};
+    countsCopy.setSrcOffset(0);
+    countsCopy.setDstOffset(visible_counts_size);
+    countsCopy.setSize(visible_counts_size);
+    buffer.copyBuffer(resources.visible_counts.GetBuffer(),
+                      resources.visible_counts.GetBuffer(), countsCopy);
+
+    InsertMemoryBarrier(buffer,
+                        vk::PipelineStageFlagBits2::eTransfer |
+                            vk::PipelineStageFlagBits2::eComputeShader,
+                        vk::AccessFlagBits2::eTransferWrite |
+                            vk::AccessFlagBits2::eShaderStorageWrite,
+                        vk::PipelineStageFlagBits2::eComputeShader,
+                        vk::AccessFlagBits2::eShaderStorageRead |
+                            vk::AccessFlagBits2::eShaderStorageWrite |
+                            vk::AccessFlagBits2::eShaderSampledRead);
+  }
+
+  RecordCull(buffer, resources, view, phase);
+
+  // visible counts are read back by the command generation and the copy
+  InsertMemoryBarrier(buffer, vk::PipelineStageFlagBits2::eComputeShader,
+                      vk::AccessFlagBits2::eShaderStorageWrite,
+                      vk::PipelineStageFlagBits2::eComputeShader |
+                          vk::PipelineStageFlagBits2::eTransfer,
+                      vk::AccessFlagBits2::eShaderStorageRead |
+                          vk::AccessFlagBits2::eTransferRead);
+
+  command_pipeline_->Bind(buffer);
+  command_pipeline_->Dispatch(buffer, resources.record_count);
+
+  // the last phase of the frame has the final totals, copy them to host
+  // memory and read them once this frame's fence signals
+  const bool last_phase =
+      phase == CullPhase::eDisoccluded || !view.occlusion;
+  if (last_phase) {
+    vk::BufferCopy statsCopy{};
+    statsCopy.setSize(sizeof(CullingStats));
+    buffer.copyBuffer(resources.stats.GetBuffer(),
+                      resources.stats_readback.GetBuffer(), statsCopy);
+    resources.stats_pending = true;
+  }
+
+  // commands, draw data and visible instances are consumed by the draws
+  InsertMemoryBarrier(buffer, vk::PipelineStageFlagBits2::eComputeShader |
+                                  vk::PipelineStageFlagBits2::eTransfer,
+                      vk::AccessFlagBits2::eShaderStorageWrite |
+                          vk::AccessFlagBits2::eTransferWrite,
+                      vk::PipelineStageFlagBits2::eDrawIndirect |
+                          vk::PipelineStageFlagBits2::eVertexShader |
+                          vk::PipelineStageFlagBits2::eHost,
+                      vk::AccessFlagBits2::eIndirectCommandRead |
+                          vk::AccessFlagBits2::eShaderStorageRead |
+                          vk::AccessFlagBits2::eHostRead);
+}
+
+void IndirectDrawPass::RecordCull(vk::CommandBuffer buffer,
+                                  const FrameResources& resources,
+                                  const CullView& view, CullPhase phase) const {
+  PassConstants constants{};
+  constants.instance_count = resources.instance_count;
+  constants.record_count = resources.record_count;
+  constants.compact = use_draw_count_ ? 1 : 0;
+  constants.frustum = view.frustum ? 1 : 0;
+  constants.occlusion = view.occlusion ? 1 : 0;
+  constants.phase = static_cast<uint32_t>(phase);
+
+  // both pipelines share the set layout and push constant range
+  cull_pipeline_->Bind(buffer);
+  cull_pipeline_->BindSet(buffer, resources.descriptor_set);
+  cull_pipeline_->PushConstants(buffer, constants);
+
+  cull_pipeline_->Dispatch(buffer, resources.instance_count);
+}
+
+void IndirectDrawPass::ReadStats(uint32_t frame) {
+  auto& resources = frames_[frame];
+  if (!resources.stats_pending) {
+    return;
+  }
+
+  const auto allocator = engine_.getMemoryAllocator().getAllocator();
+  vmaInvalidateAllocation(allocator, resources.stats_readback.GetAllocation(),
+                          0, VK_WHOLE_SIZE);
+
+  std::memcpy(&stats_, resources.stats_readback.GetPointer<CullingStats>(),
+              sizeof(CullingStats));
+  resources.stats_pending = false;
+}
+
+void IndirectDrawPass::Draw(vk::CommandBuffer buffer, uint32_t frame,
+                            uint32_t bucket, vk::PipelineLayout layout,
+                            CullPhase phase) const {
+  const auto& resources = frames_[frame];
+  const auto max_draws = resources.bucket_sizes[bucket];
+
+  if (max_draws == 0) {
+    return;
+  }
+
+  const auto phase_index = static_cast<uint32_t>(phase);
+  const auto draw_offset =
+      phase_index * kMaxIndirectDraws + bucket * kMaxDrawsPerBucket;
+  const vk::DeviceSize command_offset =
+      static_cast<vk::DeviceSize>(draw_offset) * kCommandStride;
+  const vk::DeviceSize count_offset =
+      static_cast<vk::DeviceSize>(phase_index * kMaxDrawBuckets + bucket) *
+      sizeof(uint32_t);
+
+  if (!use_multi_draw_) {
+    // one indirect draw per slot, gl_DrawID is always zero
+    for (uint32_t i = 0; i < max_draws; ++i) {
+      const DrawConstants constants{draw_offset + i};
+      buffer.pushConstants(layout, vk::ShaderStageFlagBits::eVertex, 0,
+                           sizeof(DrawConstants), &constants);
+      buffer.drawIndexedIndirect(resources.commands.GetBuffer(),
+                                 command_offset + i * kCommandStride, 1,
+                                 kCommandStride);
+    }
+    return;
+  }
+
+  const DrawConstants constants{draw_offset};
+  buffer.pushConstants(layout, vk::ShaderStageFlagBits::eVertex, 0,
+                       sizeof(DrawConstants), &constants);
+
+  if (use_draw_count_) {
+    buffer.drawIndexedIndirectCount(
+        resources.commands.GetBuffer(), command_offset,
+        resources.counts.GetBuffer(), count_offset, max_draws,
+        kCommandStride);
+  } else {
+    buffer.drawIndexedIndirect(resources.commands.GetBuffer(), command_offset,
+                               max_draws, kCommandStride);
+  }
+}
+
+}  // namespace braque
@@ -0,0 +1,124 @@
+#include "braque/job_system.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+namespace braque {
+
+JobSystem::JobSystem(uint32_t worker_count) {
+  workers_.reserve(worker_count);
+  for (uint32_t i = 0; i < worker_count; ++i) {
+    workers_.emplace_back([this] { WorkerLoop(); });
+  }
+}
+
+JobSystem::~JobSystem() {
+  {
+    std::lock_guard lock(mutex_);
+    stopping_ = true;
+  }
+  wake_.notify_all();
+
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+}
+
+auto JobSystem::DefaultWorkerCount() -> uint32_t {
+  const auto threads = std::thread::hardware_concurrency();
+  return threads > 1 ? threads - 1 : 0;
+}
+
+void JobSystem::ParallelFor(
+    size_t count, size_t grain,
+    const std::function<void(size_t begin, size_t end)>& job) {
+  if (count == 0) {
+    return;
+  }
+
+  grain = std::max<size_t>(grain, 1);
+
+  // Ranges are claimed from a shared counter so faster threads take more.
+  // Helpers may start after the caller has returned, for example behind an
+  // Async task, so they share this state and never touch the job once
+  // every range has been claimed.
+  struct State {
+    std::atomic<size_t> next_range{0};
+    std::atomic<size_t> finished_ranges{0};
+    size_t range_count;
+  };
+  auto state = std::make_shared<State>();
+  state->range_count = (count + grain - 1) / grain;
+
+  const auto run_ranges = [state, grain, count, &job] {
+    for (size_t range = state->next_range.fetch_add(1);
+         range < state->range_count; range = state->next_range.fetch_add(1)) {
+      const size_t begin = range * grain;
+      job(begin, std::min(begin + grain, count));
+
+      if (state->finished_ranges.fetch_add(1) + 1 == state->range_count) {
+        state->finished_ranges.notify_all();
+      }
+    }
+  };
+
+  const auto helper_count =
+      std::min<size_t>(workers_.size(), state->range_count - 1);
+
+  if (helper_count > 0) {
+    {
+      std::lock_guard lock(mutex_);
+      for (size_t i = 0; i < helper_count; ++i) {
+        queue_.emplace_back(run_ranges);
+      }
+    }
+    wake_.notify_all();
+  }
+
+  run_ranges();
+
+  // wait for the ranges still running on helpers
+  for (auto finished = state->finished_ranges.load();
+       finished < state->range_count;
+       finished = state->finished_ranges.load()) {
+    state->finished_ranges.wait(finished);
+  }
+}
+
+auto JobSystem::Async(std::function<void()> task) -> std::future<void> {
+  // the queue holds copyable functions, share the move only task
+  auto packaged = std::make_shared<std::packaged_task<void()>>(std::move(task));
+  auto future = packaged->get_future();
+
+  if (workers_.empty()) {
+    (*packaged)();
+    return future;
+  }
+
+  {
+    std::lock_guard lock(mutex_);
+    queue_.emplace_back([packaged] { (*packaged)(); });
+  }
+  wake_.notify_one();
+
+  return future;
+}
+
+void JobSystem::WorkerLoop() {
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock lock(mutex_);
+      wake_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+      if (stopping_ && queue_.empty()) {
+        return;
+      }
+      task = std::move(queue_.front());
+      queue_.pop_front();
+    }
+    task();
+  }
+}
+
+}  // namespace braque
@@ -0,0 +1,130 @@
+#include "braque/layout_cache.h"
+
+#include "braque/pipeline.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+namespace braque {
+
+LayoutCache::LayoutCache(vk::Device device) : device_(device) {}
+
+LayoutCache::~LayoutCache() {
+  for (const auto& [key, bucket] : pipeline_layouts_) {
+    for (const auto& entry : bucket) {
+      device_.destroyPipelineLayout(entry.layout);
+    }
+  }
+  for (const auto& [key, bucket] : set_layouts_) {
+    for (const auto& entry : bucket) {
+      device_.destroyDescriptorSetLayout(entry.layout);
+    }
+  }
+}
+
+auto LayoutCache::GetSetLayout(std::span<const ShaderBinding> bindings,
+                               uint32_t runtime_array_size)
+    -> vk::DescriptorSetLayout {
+  std::vector<vk::DescriptorSetLayoutBinding> layoutBindings;
+  std::vector<vk::DescriptorBindingFlags> bindingFlags;
+  bool updateAfterBind = false;
+
+  for (const auto& binding : bindings) {
+    const bool runtimeArray = binding.count == 0;
+    if (runtimeArray && runtime_array_size == 0) {
+      spdlog::error("Binding {} is a runtime array without a size",
+                    binding.binding);
+      throw std::runtime_error("Runtime array without a size");
+    }
+
+    vk::DescriptorSetLayoutBinding layoutBinding{};
+    layoutBinding.setBinding(binding.binding);
+    layoutBinding.setDescriptorType(binding.type);
+    layoutBinding.setDescriptorCount(runtimeArray ? runtime_array_size
+                                                  : binding.count);
+    layoutBinding.setStageFlags(binding.stages);
+    layoutBindings.push_back(layoutBinding);
+
+    // unused slots stay unwritten and new slots are written while earlier
+    // frames using the set are still executing
+    bindingFlags.push_back(
+        runtimeArray ? vk::DescriptorBindingFlagBits::ePartiallyBound |
+                           vk::DescriptorBindingFlagBits::eUpdateAfterBind
+                     : vk::DescriptorBindingFlags{});
+    updateAfterBind = updateAfterBind || runtimeArray;
+  }
+
+  uint64_t key = bindings.size();
+  for (const auto& binding : bindings) {
+    HashCombine(key, binding.binding);
+    HashCombine(key, static_cast<uint64_t>(binding.type));
+    HashCombine(key, binding.count == 0 ? runtime_array_size : binding.count);
+    HashCombine(key, binding.count == 0 ? 1 : 0);
+    HashCombine(key, static_cast<VkShaderStageFlags>(binding.stages));
+  }
+
+  std::lock_guard lock(mutex_);
+  auto& bucket = set_layouts_[key];
+  for (const auto& entry : bucket) {
+    if (entry.bindings == layoutBindings && entry.flags == bindingFlags) {
+      return entry.layout;
+    }
+  }
+
+  vk::DescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo;
+  bindingFlagsInfo.setBindingFlags(bindingFlags);
+
+  vk::DescriptorSetLayoutCreateInfo layoutInfo;
+  layoutInfo.setBindings(layoutBindings);
+  if (updateAfterBind) {
+    layoutInfo.setFlags(
+        vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPool);
+  }
+  layoutInfo.setPNext(&bindingFlagsInfo);
+
+  const auto layout = device_.createDescriptorSetLayout(layoutInfo);
+  bucket.push_back(
+      {std::move(layoutBindings), std::move(bindingFlags), layout});
+  return layout;
+}
+
+auto LayoutCache::GetPipelineLayout(
+    std::span<const vk::DescriptorSetLayout> set_layouts,
+    std::span<const vk::PushConstantRange> push_constants)
+    -> vk::PipelineLayout {
+  // set layouts come from this cache, so equal handles mean equal layouts
+  uint64_t key = set_layouts.size();
+  for (const auto setLayout : set_layouts) {
+    HashCombine(key, reinterpret_cast<uint64_t>(
+                         static_cast<VkDescriptorSetLayout>(setLayout)));
+  }
+  for (const auto& range : push_constants) {
+    HashCombine(key, static_cast<VkShaderStageFlags>(range.stageFlags));
+    HashCombine(key, range.offset);
+    HashCombine(key, range.size);
+  }
+
+  std::lock_guard lock(mutex_);
+  auto& bucket = pipeline_layouts_[key];
+  for (const auto& entry : bucket) {
+    if (std::ranges::equal(entry.set_layouts, set_layouts) &&
+        std::ranges::equal(entry.push_constants, push_constants)) {
+      return entry.layout;
+    }
+  }
+
+  vk::PipelineLayoutCreateInfo pipelineLayoutInfo{};
+  pipelineLayoutInfo.setSetLayouts(set_layouts);
+  pipelineLayoutInfo.setPushConstantRanges(push_constants);
+
+  const auto layout = device_.createPipelineLayout(pipelineLayoutInfo);
+  bucket.push_back({{set_layouts.begin(), set_layouts.end()},
+                    {push_constants.begin(), push_constants.end()},
+                    layout});
+  return layout;
+}
+
+}  // namespace braque
@@ -0,0 +1,117 @@
+#include "braque/material.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include <spdlog/spdlog.h>
+
+namespace braque {
+
+namespace {
+
+auto SameContent(const MaterialData& a, const MaterialData& b) -> bool {
+  return std::memcmp(&a, &b, sizeof(MaterialData)) == 0;
+}
+
+}  // namespace
+
+auto HashMaterial(const MaterialData& material) -> uint64_t {
+  // FNV-1a
+  constexpr uint64_t kOffsetBasis = 14695981039346656037ULL;
+  constexpr uint64_t kPrime = 1099511628211ULL;
+
+  const auto* bytes = reinterpret_cast<const uint8_t*>(&material);
+  uint64_t hash = kOffsetBasis;
+  for (size_t i = 0; i < sizeof(MaterialData); ++i) {
+    hash = (hash ^ bytes[i]) * kPrime;
+  }
+  return hash;
+}
+
+MaterialTable::MaterialTable(uint32_t frame_count) : dirty_(frame_count) {}
+
+auto MaterialTable::Add(const MaterialData& material) -> uint32_t {
+  const auto hash = HashMaterial(material);
+  if (const auto existing = Find(material, hash); existing >= 0) {
+    return static_cast<uint32_t>(existing);
+  }
+
+  if (materials_.size() >= kMaxMaterials) {
+    spdlog::error("Too many materials, limit is {}", kMaxMaterials);
+    throw std::runtime_error("Too many materials");
+  }
+
+  const auto index = static_cast<uint32_t>(materials_.size());
+  materials_.push_back(material);
+  lookup_[hash].push_back(index);
+  MarkDirty(index);
+  return index;
+}
+
+void MaterialTable::Set(uint32_t index, const MaterialData& material) {
+  if (index >= materials_.size()) {
+    spdlog::error("Unknown material {}, the table has {}", index,
+                  materials_.size());
+    throw std::out_of_range("Unknown material");
+  }
+
+  if (SameContent(materials_[index], material)) {
+    return;
+  }
+
+  auto& bucket = lookup_[HashMaterial(materials_[index])];
+  bucket.erase(std::find(bucket.begin(), bucket.end(), index));
+
+  materials_[index] = material;
+  lookup_[HashMaterial(material)].push_back(index);
+  MarkDirty(index);
+}
+
+auto MaterialTable::TakeDirtyRanges(uint32_t frame)
+    -> std::vector<MaterialRange> {
+  auto& dirty = dirty_[frame];
+  std::sort(dirty.indices.begin(), dirty.indices.end());
+
+  std::vector<MaterialRange> ranges;
+  for (const auto index : dirty.indices) {
+    dirty.flags[index] = 0;
+    if (!ranges.empty() &&
+        ranges.back().first + ranges.back().count == index) {
+      ranges.back().count++;
+    } else {
+      ranges.push_back({index, 1});
+    }
+  }
+  dirty.indices.clear();
+  return ranges;
+}
+
+auto MaterialTable::Find(const MaterialData& material, uint64_t hash) const
+    -> int64_t {
+  const auto bucket = lookup_.find(hash);
+  if (bucket == lookup_.end()) {
+    return -1;
+  }
+  // equal hashes are compared in full, a collision must not merge materials
+  for (const auto index : bucket->second) {
+    if (SameContent(materials_[index], material)) {
+      return index;
+    }
+  }
+  return -1;
+}
+
+void MaterialTable::MarkDirty(uint32_t index) {
+  for (auto& dirty : dirty_) {
+    if (dirty.flags.size() <= index) {
+      dirty.flags.resize(index + 1, 0);
+    }
+    if (dirty.flags[index] == 0) {
+      dirty.flags[index] = 1;
+      dirty.indices.push_back(index);
+    }
+  }
+}
+
+}  // namespace braque
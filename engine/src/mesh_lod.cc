@@ -0,0 +1,326 @@
+#include "braque/mesh_lod.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <unordered_map>
+
+namespace braque {
+
+namespace {
+
+// a level has to drop at least this share of the previous indices
+constexpr float kLodMinReduction = 0.15F;
+
+// symmetric 4x4 matrix summing squared distances to a set of planes
+struct Quadric {
+  std::array<double, 10> m{};
+
+  static auto FromPlane(glm::dvec4 plane) -> Quadric {
+    const auto [a, b, c, d] = std::array{plane.x, plane.y, plane.z, plane.w};
+    return {{a * a, a * b, a * c, a * d, b * b, b * c, b * d, c * c, c * d,
+             d * d}};
+  }
+
+  auto operator+=(const Quadric& other) -> Quadric& {
+    for (size_t i = 0; i < m.size(); ++i) {
+      m[i] += other.m[i];
+    }
+    return *this;
+  }
+
+  [[nodiscard]] auto Evaluate(glm::dvec3 p) const -> double {
+    const double x = p.x;
+    const double y = p.y;
+    const double z = p.z;
+    return m[0] * x * x + 2 * m[1] * x * y + 2 * m[2] * x * z +
+           2 * m[3] * x + m[4] * y * y + 2 * m[5] * y * z + 2 * m[6] * y +
+           m[7] * z * z + 2 * m[8] * z + m[9];
+  }
+};
+
+struct Collapse {
+  uint32_t from;
+  uint32_t to;
+  double cost;
+};
+
+auto EdgeKey(uint32_t a, uint32_t b) -> uint64_t {
+  return (static_cast<uint64_t>(std::min(a, b)) << 32) | std::max(a, b);
+}
+
+// vertices sharing a position belong to one class
+auto WeldPositions(std::span<const glm::vec3> positions,
+                   std::vector<uint32_t>& classes) -> uint32_t {
+  struct PositionHash {
+    auto operator()(const std::array<uint32_t, 3>& key) const -> size_t {
+      return (key[0] * 73856093U) ^ (key[1] * 19349663U) ^
+             (key[2] * 83492791U);
+    }
+  };
+  std::unordered_map<std::array<uint32_t, 3>, uint32_t, PositionHash> lookup;
+  lookup.reserve(positions.size());
+
+  classes.resize(positions.size());
+  for (size_t i = 0; i < positions.size(); ++i) {
+    std::array<uint32_t, 3> key{};
+    std::memcpy(key.data(), &positions[i], sizeof(key));
+    const auto [entry, inserted] =
+        lookup.try_emplace(key, static_cast<uint32_t>(lookup.size()));
+    classes[i] = entry->second;
+  }
+  return static_cast<uint32_t>(lookup.size());
+}
+
+auto TriangleNormal(glm::vec3 a, glm::vec3 b, glm::vec3 c) -> glm::vec3 {
+  return glm::cross(b - a, c - a);
+}
+
+}  // namespace
+
+auto SimplifyMesh(std::span<const glm::vec3> positions,
+                  std::span<const uint32_t> indices, size_t target_index_count,
+                  float max_error) -> LodLevel {
+  LodLevel result;
+  result.indices.assign(indices.begin(), indices.end());
+
+  std::vector<uint32_t> classes;
+  const auto class_count = WeldPositions(positions, classes);
+
+  // seams and open borders stay where they are, collapsing them would tear
+  // the surface or smear attributes
+  std::vector<uint32_t> class_sizes(class_count, 0);
+  for (const auto position_class : classes) {
+    class_sizes[position_class]++;
+  }
+
+  std::unordered_map<uint64_t, uint32_t> edge_uses;
+  std::vector<Quadric> quadrics(class_count);
+  for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+    std::array<uint32_t, 3> corners{classes[indices[t]],
+                                    classes[indices[t + 1]],
+                                    classes[indices[t + 2]]};
+    for (int e = 0; e < 3; ++e) {
+      edge_uses[EdgeKey(corners[e], corners[(e + 1) % 3])]++;
+    }
+
+    const auto normal = TriangleNormal(positions[indices[t]],
+                                       positions[indices[t + 1]],
+                                       positions[indices[t + 2]]);
+    const float length = glm::length(normal);
+    if (length <= 0.0F) {
+      continue;
+    }
+    const auto n = glm::dvec3(normal / length);
+    const auto plane =
+        glm::dvec4(n, -glm::dot(n, glm::dvec3(positions[indices[t]])));
+    const auto quadric = Quadric::FromPlane(plane);
+    for (const auto corner : corners) {
+      quadrics[corner] += quadric;
+    }
+  }
+
+  std::vector<uint8_t> locked(positions.size(), 0);
+  for (size_t i = 0; i < positions.size(); ++i) {
+    locked[i] = class_sizes[classes[i]] > 1 ? 1 : 0;
+  }
+  for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+    for (int e = 0; e < 3; ++e) {
+      const auto a = indices[t + e];
+      const auto b = indices[t + (e + 1) % 3];
+      if (edge_uses[EdgeKey(classes[a], classes[b])] == 1) {
+        locked[a] = 1;
+        locked[b] = 1;
+      }
+    }
+  }
+
+  const double max_cost = static_cast<double>(max_error) * max_error;
+  double worst_cost = 0.0;
+
+  std::vector<uint32_t> remap(positions.size());
+  std::vector<uint8_t> touched(positions.size());
+  std::vector<uint32_t> triangle_offsets(positions.size() + 1);
+  std::vector<uint32_t> vertex_triangles;
+  std::vector<Collapse> collapses;
+
+  auto& current = result.indices;
+  while (current.size() > target_index_count) {
+    // triangles around every vertex of the current mesh
+    std::fill(triangle_offsets.begin(), triangle_offsets.end(), 0);
+    for (const auto index : current) {
+      triangle_offsets[index + 1]++;
+    }
+    for (size_t i = 1; i < triangle_offsets.size(); ++i) {
+      triangle_offsets[i] += triangle_offsets[i - 1];
+    }
+    vertex_triangles.resize(current.size());
+    {
+      auto cursor = triangle_offsets;
+      for (uint32_t i = 0; i < current.size(); ++i) {
+        vertex_triangles[cursor[current[i]]++] = i / 3;
+      }
+    }
+
+    // every edge in both directions, priced by the error of the merged
+    // quadric at the vertex that remains
+    collapses.clear();
+    for (size_t t = 0; t < current.size(); t += 3) {
+      for (int e = 0; e < 3; ++e) {
+        const auto a = current[t + e];
+        const auto b = current[t + (e + 1) % 3];
+        for (const auto& [from, to] : {std::pair{a, b}, std::pair{b, a}}) {
+          if (locked[from] != 0) {
+            continue;
+          }
+          auto merged = quadrics[classes[from]];
+          merged += quadrics[classes[to]];
+          const double cost =
+              std::max(merged.Evaluate(glm::dvec3(positions[to])), 0.0);
+          if (cost <= max_cost) {
+            collapses.push_back({from, to, cost});
+          }
+        }
+      }
+    }
+    std::sort(collapses.begin(), collapses.end(),
+              [](const Collapse& a, const Collapse& b) {
+                return a.cost < b.cost;
+              });
+
+    // a collapse removes about two triangles, leave slack so the cheapest
+    // collapses of the next pass see the updated quadrics
+    const size_t budget =
+        std::max<size_t>(1, (current.size() - target_index_count) / 6);
+    size_t collapsed = 0;
+
+    std::iota(remap.begin(), remap.end(), 0U);
+    std::fill(touched.begin(), touched.end(), 0);
+
+    for (const auto& collapse : collapses) {
+      if (collapsed >= budget) {
+        break;
+      }
+      if (touched[collapse.from] != 0 || touched[collapse.to] != 0) {
+        continue;
+      }
+
+      // reject collapses that fold a surviving triangle over
+      bool flips = false;
+      for (auto i = triangle_offsets[collapse.from];
+           i < triangle_offsets[collapse.from + 1] && !flips; ++i) {
+        const auto* triangle = &current[vertex_triangles[i] * 3];
+        if (triangle[0] == collapse.to || triangle[1] == collapse.to ||
+            triangle[2] == collapse.to) {
+          continue;
+        }
+
+        std::array<glm::vec3, 3> corners{};
+        for (int c = 0; c < 3; ++c) {
+          corners[c] = positions[triangle[c]];
+        }
+        const auto before = TriangleNormal(corners[0], corners[1], corners[2]);
+        for (int c = 0; c < 3; ++c) {
+          if (triangle[c] == collapse.from) {
+            corners[c] = positions[collapse.to];
+          }
+        }
+        const auto after = TriangleNormal(corners[0], corners[1], corners[2]);
+        flips = glm::dot(before, after) <= 0.0F;
+      }
+      if (flips) {
+        continue;
+      }
+
+      // the neighbourhood is frozen for the rest of the pass so the flip
+      // tests above stay valid
+      for (auto i = triangle_offsets[collapse.from];
+           i < triangle_offsets[collapse.from + 1]; ++i) {
+        const auto* triangle = &current[vertex_triangles[i] * 3];
+        for (int c = 0; c < 3; ++c) {
+          touched[triangle[c]] = 1;
+        }
+      }
+      touched[collapse.to] = 1;
+
+      remap[collapse.from] = collapse.to;
+      quadrics[classes[collapse.to]] += quadrics[classes[collapse.from]];
+      worst_cost = std::max(worst_cost, collapse.cost);
+      collapsed++;
+    }
+
+    if (collapsed == 0) {
+      break;
+    }
+
+    // apply the collapses and drop the triangles that became degenerate
+    size_t write = 0;
+    for (size_t t = 0; t < current.size(); t += 3) {
+      const auto a = remap[current[t]];
+      const auto b = remap[current[t + 1]];
+      const auto c = remap[current[t + 2]];
+      if (a != b && b != c && c != a) {
+        current[write++] = a;
+        current[write++] = b;
+        current[write++] = c;
+      }
+    }
+    current.resize(write);
+  }
+
+  result.error = static_cast<float>(std::sqrt(worst_cost));
+  return result;
+}
+
+auto BuildLodChain(std::span<const glm::vec3> positions,
+                   std::span<const uint32_t> indices, float max_error)
+    -> std::vector<LodLevel> {
+  std::vector<LodLevel> levels;
+  levels.push_back({{indices.begin(), indices.end()}, 0.0F});
+
+  while (levels.size() < kMaxMeshLods) {
+    const auto previous_count = levels.back().indices.size();
+    const auto target =
+        static_cast<size_t>(static_cast<float>(previous_count / 3) *
+                            kLodReduction) *
+        3;
+
+    // every level starts from the full mesh so errors do not compound
+    auto level = SimplifyMesh(positions, indices, target, max_error);
+    if (static_cast<float>(level.indices.size()) >
+        static_cast<float>(previous_count) * (1.0F - kLodMinReduction)) {
+      break;
+    }
+
+    level.error = std::max(level.error, levels.back().error);
+    levels.push_back(std::move(level));
+  }
+
+  return levels;
+}
+
+auto ComputeLodScale(float fov_degrees, float viewport_height) -> float {
+  return viewport_height / (2.0F * std::tan(glm::radians(fov_degrees) * 0.5F));
+}
+
+auto SelectLod(std::span<const float> errors, float distance, float lod_scale,
+               float threshold) -> uint32_t {
+  // inside the bounds or with selection disabled the full mesh is drawn
+  if (distance <= 0.0F || threshold <= 0.0F) {
+    return 0;
+  }
+
+  const float pixels_per_unit = lod_scale / distance;
+  uint32_t lod = 0;
+  for (uint32_t i = 1; i < errors.size(); ++i) {
+    if (errors[i] * pixels_per_unit > threshold) {
+      break;
+    }
+    lod = i;
+  }
+  return lod;
+}
+
+}  // namespace braque
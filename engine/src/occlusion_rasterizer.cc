@@ -0,0 +1,328 @@
+#include "braque/occlusion_rasterizer.h"
+
+#include "braque/job_system.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace braque {
+
+namespace {
+
+// vertices closer to the camera plane than this are not projected
+constexpr float kMinClipW = 1e-5F;
+
+constexpr float kClearDepth = 1.0F;
+
+constexpr size_t kOccluderGrainSize = 16;
+constexpr size_t kBoxGrainSize = 256;
+
+struct EdgeRow {
+  float a[3];
+  float row[3];  // b * y + c of the current row
+};
+
+// nearest depth of the covered pixels in [x_begin, x_end) of one row,
+// x_begin is a multiple of 4 and x_end is at most the buffer width
+#if defined(__SSE2__) || defined(_M_X64)
+
+void RasterizeSpan(float* row, uint32_t x_begin, uint32_t x_end,
+                   const EdgeRow& edges, float depth_a, float depth_row) {
+  const auto lane_offset = _mm_setr_ps(0.5F, 1.5F, 2.5F, 3.5F);
+  const auto zero = _mm_setzero_ps();
+
+  for (uint32_t x = x_begin; x < x_end; x += 4) {
+    const auto px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), lane_offset);
+
+    auto inside = _mm_cmpge_ps(
+        _mm_add_ps(_mm_mul_ps(_mm_set1_ps(edges.a[0]), px),
+                   _mm_set1_ps(edges.row[0])),
+        zero);
+    for (int i = 1; i < 3; ++i) {
+      const auto edge = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(edges.a[i]), px),
+                                   _mm_set1_ps(edges.row[i]));
+      inside = _mm_and_ps(inside, _mm_cmpge_ps(edge, zero));
+    }
+
+    const auto depth = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(depth_a), px),
+                                  _mm_set1_ps(depth_row));
+    const auto old_depth = _mm_loadu_ps(row + x);
+    const auto nearer = _mm_min_ps(old_depth, depth);
+
+    _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearer),
+                                     _mm_andnot_ps(inside, old_depth)));
+  }
+}
+
+#elif defined(__ARM_NEON)
+
+void RasterizeSpan(float* row, uint32_t x_begin, uint32_t x_end,
+                   const EdgeRow& edges, float depth_a, float depth_row) {
+  const float offsets[4] = {0.5F, 1.5F, 2.5F, 3.5F};
+  const auto lane_offset = vld1q_f32(offsets);
+  const auto zero = vdupq_n_f32(0.0F);
+
+  for (uint32_t x = x_begin; x < x_end; x += 4) {
+    const auto px = vaddq_f32(vdupq_n_f32(static_cast<float>(x)), lane_offset);
+
+    auto inside = vcgeq_f32(
+        vaddq_f32(vmulq_f32(vdupq_n_f32(edges.a[0]), px),
+                  vdupq_n_f32(edges.row[0])),
+        zero);
+    for (int i = 1; i < 3; ++i) {
+      const auto edge = vaddq_f32(vmulq_f32(vdupq_n_f32(edges.a[i]), px),
+                                  vdupq_n_f32(edges.row[i]));
+      inside = vandq_u32(inside, vcgeq_f32(edge, zero));
+    }
+
+    const auto depth =
+        vaddq_f32(vmulq_f32(vdupq_n_f32(depth_a), px), vdupq_n_f32(depth_row));
+    const auto old_depth = vld1q_f32(row + x);
+
+    vst1q_f32(row + x,
+              vbslq_f32(inside, vminq_f32(old_depth, depth), old_depth));
+  }
+}
+
+#else
+
+void RasterizeSpan(float* row, uint32_t x_begin, uint32_t x_end,
+                   const EdgeRow& edges, float depth_a, float depth_row) {
+  for (uint32_t x = x_begin; x < x_end; ++x) {
+    const float px = static_cast<float>(x) + 0.5F;
+
+    bool inside = true;
+    for (int i = 0; i < 3; ++i) {
+      inside = inside && edges.a[i] * px + edges.row[i] >= 0.0F;
+    }
+
+    if (inside) {
+      row[x] = std::min(row[x], depth_a * px + depth_row);
+    }
+  }
+}
+
+#endif
+
+}  // namespace
+
+OcclusionRasterizer::OcclusionRasterizer(uint32_t width, uint32_t height)
+    : width_(width), height_(height), depth_(width * height, kClearDepth) {
+  if (width % 4 != 0) {
+    throw std::invalid_argument("Occlusion buffer width must be a multiple of 4");
+  }
+}
+
+void OcclusionRasterizer::Rasterize(JobSystem& jobs,
+                                    const glm::mat4& view_projection,
+                                    std::span<const Occluder> occluders) {
+  view_projection_ = view_projection;
+  std::fill(depth_.begin(), depth_.end(), kClearDepth);
+
+  SetupTriangles(jobs, occluders);
+
+  jobs.ParallelFor(height_, kOcclusionBandHeight,
+                   [this](size_t begin, size_t end) {
+                     RasterizeBand(static_cast<uint32_t>(begin),
+                                   static_cast<uint32_t>(end));
+                   });
+}
+
+void OcclusionRasterizer::SetupTriangles(JobSystem& jobs,
+                                         std::span<const Occluder> occluders) {
+  // every occluder writes its own range of the triangle list
+  std::vector<size_t> first_triangle(occluders.size() + 1, 0);
+  for (size_t i = 0; i < occluders.size(); ++i) {
+    first_triangle[i + 1] =
+        first_triangle[i] + occluders[i].mesh->indices.size() / 3;
+  }
+  triangles_.resize(first_triangle.back());
+
+  const auto width = static_cast<float>(width_);
+  const auto height = static_cast<float>(height_);
+
+  jobs.ParallelFor(occluders.size(), kOccluderGrainSize, [&](size_t begin,
+                                                             size_t end) {
+    for (size_t o = begin; o < end; ++o) {
+      const auto& mesh = *occluders[o].mesh;
+      const auto transform = view_projection_ * occluders[o].transform;
+
+      for (size_t t = 0; t < mesh.indices.size() / 3; ++t) {
+        auto& triangle = triangles_[first_triangle[o] + t];
+        triangle.valid = false;
+
+        glm::vec3 screen[3];
+        bool projected = true;
+        for (int v = 0; v < 3; ++v) {
+          const auto clip = transform *
+                            glm::vec4(mesh.positions[mesh.indices[t * 3 + v]],
+                                      1.0F);
+          // in front of the near plane the depth turns negative and would
+          // hide everything behind the part the GPU clips away, so the
+          // triangle is left out rather than clipped
+          if (clip.w < kMinClipW || clip.z < 0.0F) {
+            projected = false;
+            break;
+          }
+          const auto ndc = glm::vec3(clip) / clip.w;
+          screen[v] = {(ndc.x * 0.5F + 0.5F) * width,
+                       (ndc.y * 0.5F + 0.5F) * height, ndc.z};
+        }
+        if (!projected) {
+          continue;
+        }
+
+        // both windings are drawn, flip clockwise ones
+        float area = (screen[1].x - screen[0].x) * (screen[2].y - screen[0].y) -
+                     (screen[1].y - screen[0].y) * (screen[2].x - screen[0].x);
+        if (area < 0.0F) {
+          std::swap(screen[1], screen[2]);
+          area = -area;
+        }
+        if (area < 1e-8F) {
+          continue;
+        }
+
+        const float min_x = std::min({screen[0].x, screen[1].x, screen[2].x});
+        const float max_x = std::max({screen[0].x, screen[1].x, screen[2].x});
+        const float min_y = std::min({screen[0].y, screen[1].y, screen[2].y});
+        const float max_y = std::max({screen[0].y, screen[1].y, screen[2].y});
+
+        triangle.min_x =
+            static_cast<uint32_t>(std::clamp(std::floor(min_x), 0.0F, width));
+        triangle.max_x =
+            static_cast<uint32_t>(std::clamp(std::ceil(max_x), 0.0F, width));
+        triangle.min_y =
+            static_cast<uint32_t>(std::clamp(std::floor(min_y), 0.0F, height));
+        triangle.max_y =
+            static_cast<uint32_t>(std::clamp(std::ceil(max_y), 0.0F, height));
+        if (triangle.min_x >= triangle.max_x ||
+            triangle.min_y >= triangle.max_y) {
+          continue;
+        }
+
+        for (int e = 0; e < 3; ++e) {
+          const auto& a = screen[e];
+          const auto& b = screen[(e + 1) % 3];
+          triangle.edges[e] = {a.y - b.y, b.x - a.x,
+                               (b.y - a.y) * a.x - (b.x - a.x) * a.y};
+        }
+
+        const auto d1 = screen[1] - screen[0];
+        const auto d2 = screen[2] - screen[0];
+        const float depth_a = (d1.z * d2.y - d2.z * d1.y) / area;
+        const float depth_b = (d2.z * d1.x - d1.z * d2.x) / area;
+        triangle.depth_plane = {depth_a, depth_b,
+                                screen[0].z - depth_a * screen[0].x -
+                                    depth_b * screen[0].y};
+        triangle.valid = true;
+      }
+    }
+  });
+}
+
+void OcclusionRasterizer::RasterizeBand(uint32_t row_begin, uint32_t row_end) {
+  for (const auto& triangle : triangles_) {
+    if (triangle.valid && triangle.min_y < row_end &&
+        triangle.max_y > row_begin) {
+      RasterizeTriangle(triangle, row_begin, row_end);
+    }
+  }
+}
+
+void OcclusionRasterizer::RasterizeTriangle(const ScreenTriangle& triangle,
+                                            uint32_t row_begin,
+                                            uint32_t row_end) {
+  const auto y_begin = std::max(row_begin, triangle.min_y);
+  const auto y_end = std::min(row_end, triangle.max_y);
+
+  // spans start on a vector boundary, the edge tests mask the extra pixels
+  const auto x_begin = triangle.min_x & ~3U;
+  const auto x_end = std::min(width_, (triangle.max_x + 3U) & ~3U);
+
+  EdgeRow edges{};
+  for (int e = 0; e < 3; ++e) {
+    edges.a[e] = triangle.edges[e].x;
+  }
+
+  for (auto y = y_begin; y < y_end; ++y) {
+    const float py = static_cast<float>(y) + 0.5F;
+    for (int e = 0; e < 3; ++e) {
+      edges.row[e] = triangle.edges[e].y * py + triangle.edges[e].z;
+    }
+    const float depth_row =
+        triangle.depth_plane.y * py + triangle.depth_plane.z;
+
+    RasterizeSpan(depth_.data() + static_cast<size_t>(y) * width_, x_begin,
+                  x_end, edges, triangle.depth_plane.x, depth_row);
+  }
+}
+
+auto OcclusionRasterizer::IsVisible(const Aabb& box) const -> bool {
+  glm::vec3 min_screen(std::numeric_limits<float>::max());
+  glm::vec3 max_screen(std::numeric_limits<float>::lowest());
+
+  for (int i = 0; i < 8; ++i) {
+    const glm::vec3 corner((i & 1) != 0 ? box.max.x : box.min.x,
+                           (i & 2) != 0 ? box.max.y : box.min.y,
+                           (i & 4) != 0 ? box.max.z : box.min.z);
+    const auto clip = view_projection_ * glm::vec4(corner, 1.0F);
+
+    // crosses the camera plane, too close to say
+    if (clip.w < kMinClipW) {
+      return true;
+    }
+
+    const auto ndc = glm::vec3(clip) / clip.w;
+    min_screen = glm::min(min_screen, ndc);
+    max_screen = glm::max(max_screen, ndc);
+  }
+
+  const auto width = static_cast<float>(width_);
+  const auto height = static_cast<float>(height_);
+
+  // every texel the box touches, rounded outwards
+  const auto x_begin = static_cast<uint32_t>(
+      std::clamp(std::floor((min_screen.x * 0.5F + 0.5F) * width), 0.0F, width));
+  const auto x_end = static_cast<uint32_t>(
+      std::clamp(std::ceil((max_screen.x * 0.5F + 0.5F) * width), 0.0F, width));
+  const auto y_begin = static_cast<uint32_t>(std::clamp(
+      std::floor((min_screen.y * 0.5F + 0.5F) * height), 0.0F, height));
+  const auto y_end = static_cast<uint32_t>(std::clamp(
+      std::ceil((max_screen.y * 0.5F + 0.5F) * height), 0.0F, height));
+
+  if (x_begin >= x_end || y_begin >= y_end) {
+    return true;
+  }
+
+  for (auto y = y_begin; y < y_end; ++y) {
+    const auto* row = depth_.data() + static_cast<size_t>(y) * width_;
+    for (auto x = x_begin; x < x_end; ++x) {
+      if (row[x] >= min_screen.z) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+void OcclusionRasterizer::TestBoxes(JobSystem& jobs, std::span<const Aabb> boxes,
+                                    std::span<uint8_t> visible) const {
+  jobs.ParallelFor(boxes.size(), kBoxGrainSize, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      if (visible[i] != 0 && !IsVisible(boxes[i])) {
+        visible[i] = 0;
+      }
+    }
+  });
+}
+
+}  // namespace braque
@@ -3,130 +3,109 @@
 //
 
 #include "braque/pipeline.h"
-#include "braque/scene.h"
+#include "braque/pipeline_library.h"
 #include "braque/shader.h"
 
 #include <spdlog/spdlog.h>
 
 namespace braque {
 
-Pipeline::Pipeline(vk::Device device, Shader& shader,
-                   vk::DescriptorSetLayout descriptor_set_layout)
-    : device(device) {
-
-  constexpr uint32_t width = 800;
-  constexpr uint32_t height = 600;
-
-  vk::PipelineLayoutCreateInfo pipelineLayoutInfo{};
-  pipelineLayoutInfo.setSetLayouts(descriptor_set_layout);
-
-  layout_ = device.createPipelineLayout(pipelineLayoutInfo);
-
-  auto shaderStages = shader.getPipelineShaderStageCreateInfos();
-
-  vk::VertexInputBindingDescription bindingDescription{};
-  bindingDescription.setBinding(0);
-  bindingDescription.setStride(sizeof(Vertex));
-  bindingDescription.setInputRate(vk::VertexInputRate::eVertex);
-
-  std::array<vk::VertexInputAttributeDescription, 4> attributeDescription{};
-  attributeDescription[0].setBinding(0);
-  attributeDescription[0].setLocation(0);
-  attributeDescription[0].setFormat(vk::Format::eR32G32B32Sfloat);
-  attributeDescription[0].setOffset(0);
-
-  attributeDescription[1].setBinding(0);
-  attributeDescription[1].setLocation(1);
-  attributeDescription[1].setFormat(vk::Format::eR32G32B32Sfloat);
-  attributeDescription[1].setOffset(sizeof(float) * 3);
-
-  attributeDescription[2].setBinding(0);
-  attributeDescription[2].setLocation(2);
-  attributeDescription[2].setFormat(vk::Format::eR32G32B32Sfloat);
-  attributeDescription[2].setOffset(sizeof(float) * 6);
-
-  attributeDescription[3].setBinding(0);
-  attributeDescription[3].setLocation(3);
-  attributeDescription[3].setFormat(vk::Format::eR32G32Sfloat);
-  attributeDescription[3].setOffset(sizeof(float) * 9);
-
-  vk::PipelineVertexInputStateCreateInfo vertexInputInfo{};
-  vertexInputInfo.setVertexBindingDescriptions(bindingDescription);
-  vertexInputInfo.setVertexAttributeDescriptions(attributeDescription);
-
-  vk::PipelineInputAssemblyStateCreateInfo inputAssembly{};
-  inputAssembly.setTopology(vk::PrimitiveTopology::eTriangleList);
-  inputAssembly.setPrimitiveRestartEnable(vk::False);
-
-  vk::Viewport viewport{0, 0, width, height, 0, 1};
-  vk::Rect2D scissor{{0, 0}, {width, height}};
-
-  vk::PipelineViewportStateCreateInfo viewportState{};
-  viewportState.setViewports(viewport);
-  viewportState.setScissors(scissor);
-
-  vk::PipelineRasterizationStateCreateInfo rasterizer{};
-  rasterizer.setDepthClampEnable(vk::False);
-  rasterizer.setRasterizerDiscardEnable(vk::False);
-  rasterizer.setPolygonMode(vk::PolygonMode::eFill);
-  rasterizer.setLineWidth(1.0F);
-  rasterizer.setCullMode(vk::CullModeFlagBits::eBack);
-  rasterizer.setFrontFace(vk::FrontFace::eCounterClockwise);
-  rasterizer.setDepthBiasEnable(vk::False);
-
-  vk::PipelineMultisampleStateCreateInfo multisampling{};
-  multisampling.setSampleShadingEnable(vk::False);
-  multisampling.setRasterizationSamples(vk::SampleCountFlagBits::e4);
-
-  vk::PipelineColorBlendAttachmentState colorBlendAttachment{};
-  colorBlendAttachment.setColorWriteMask(
+PipelineState::PipelineState(const PipelineConfig& config,
+                             bool extended_dynamic_state)
+    : vertex_input(GetVertexInputDescription(config.vertex_layout,
+                                             config.vertex_streams)),
+      // the viewport and scissor are dynamic, these only fill the counts
+      viewport(0, 0, 800, 600, 0, 1),
+      scissor({0, 0}, {800, 600}),
+      color_format(vk::Format::eR16G16B16A16Sfloat) {
+
+  // vertex input is generated from the chosen vertex layout
+  vertex_input_state.setVertexBindingDescriptions(vertex_input.bindings);
+  vertex_input_state.setVertexAttributeDescriptions(vertex_input.attributes);
+
+  input_assembly.setTopology(vk::PrimitiveTopology::eTriangleList);
+  input_assembly.setPrimitiveRestartEnable(vk::False);
+
+  viewport_state.setViewports(viewport);
+  viewport_state.setScissors(scissor);
+
+  rasterization.setDepthClampEnable(vk::False);
+  rasterization.setRasterizerDiscardEnable(vk::False);
+  rasterization.setPolygonMode(vk::PolygonMode::eFill);
+  rasterization.setLineWidth(1.0F);
+  rasterization.setCullMode(config.cull_mode);
+  rasterization.setFrontFace(vk::FrontFace::eCounterClockwise);
+  rasterization.setDepthBiasEnable(vk::False);
+
+  multisample.setSampleShadingEnable(vk::False);
+  multisample.setRasterizationSamples(config.samples);
+
+  blend_attachment.setColorWriteMask(
       vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG |
       vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA);
-  colorBlendAttachment.setBlendEnable(vk::False);
+  blend_attachment.setBlendEnable(vk::False);
 
-  vk::PipelineColorBlendStateCreateInfo colorBlending{};
-  colorBlending.setLogicOpEnable(vk::False);
-  colorBlending.setLogicOp(vk::LogicOp::eCopy);
-  colorBlending.setAttachments(colorBlendAttachment);
-  colorBlending.setBlendConstants({0, 0, 0, 0});
+  color_blend.setLogicOpEnable(vk::False);
+  color_blend.setLogicOp(vk::LogicOp::eCopy);
+  if (!config.depth_only) {
+    color_blend.setAttachments(blend_attachment);
+  }
+  color_blend.setBlendConstants({0, 0, 0, 0});
+
+  depth_stencil.setDepthTestEnable(vk::True);
+  depth_stencil.setDepthWriteEnable(config.depth_write ? vk::True : vk::False);
+  depth_stencil.setDepthCompareOp(config.depth_compare);
+  depth_stencil.setDepthBoundsTestEnable(vk::False);
+  depth_stencil.setStencilTestEnable(vk::False);
+
+  dynamic_states = {vk::DynamicState::eViewport, vk::DynamicState::eScissor};
+  if (extended_dynamic_state) {
+    dynamic_states.insert(dynamic_states.end(),
+                          {vk::DynamicState::eCullModeEXT,
+                           vk::DynamicState::eDepthWriteEnableEXT,
+                           vk::DynamicState::eDepthCompareOpEXT,
+                           vk::DynamicState::ePrimitiveTopologyEXT});
+  }
+  dynamic_state.setDynamicStates(dynamic_states);
 
-  auto dynamicStates =
-      std::array{vk::DynamicState::eViewport, vk::DynamicState::eScissor};
+  if (!config.depth_only) {
+    rendering.setColorAttachmentFormats(color_format);
+  }
+  rendering.setDepthAttachmentFormat(vk::Format::eD32Sfloat);
+}
 
-  vk::PipelineDynamicStateCreateInfo dynamicState{};
-  dynamicState.setDynamicStates(dynamicStates);
+void PipelineState::Apply(vk::GraphicsPipelineCreateInfo& info) const {
+  info.setPVertexInputState(&vertex_input_state);
+  info.setPInputAssemblyState(&input_assembly);
+  info.setPViewportState(&viewport_state);
+  info.setPRasterizationState(&rasterization);
+  info.setPMultisampleState(&multisample);
+  info.setPColorBlendState(&color_blend);
+  info.setPDepthStencilState(&depth_stencil);
+  info.setPDynamicState(&dynamic_state);
+  info.setRenderPass(nullptr);
+  info.setSubpass(0);
+}
 
-  vk::PipelineDepthStencilStateCreateInfo depthStencil{};
-  depthStencil.setDepthTestEnable(vk::True);
-  depthStencil.setDepthWriteEnable(vk::True);
-  depthStencil.setDepthCompareOp(vk::CompareOp::eLess);
-  depthStencil.setDepthBoundsTestEnable(vk::False);
-  depthStencil.setStencilTestEnable(vk::False);
+Pipeline::Pipeline(vk::Device device, vk::PipelineCache cache, Shader& shader,
+                   vk::PipelineLayout layout, const PipelineConfig& config,
+                   bool extended_dynamic_state)
+    : device(device),
+      layout_(layout),
+      config_(config),
+      extended_dynamic_state_(extended_dynamic_state) {
 
-  auto colorFormat = {vk::Format::eR16G16B16A16Sfloat};
-  constexpr auto depthFormat = vk::Format::eD32Sfloat;
+  auto shaderStages = shader.getPipelineShaderStageCreateInfos();
 
-  vk::PipelineRenderingCreateInfo pipelineRenderingCreateInfo {};
-  pipelineRenderingCreateInfo.setColorAttachmentFormats(colorFormat);
-  pipelineRenderingCreateInfo.setDepthAttachmentFormat(depthFormat);
+  const PipelineState state(config, extended_dynamic_state);
 
   vk::GraphicsPipelineCreateInfo pipelineInfo{};
-
+  state.Apply(pipelineInfo);
   pipelineInfo.setStages(shaderStages);
-  pipelineInfo.setPVertexInputState(&vertexInputInfo);
-  pipelineInfo.setPInputAssemblyState(&inputAssembly);
-  pipelineInfo.setPViewportState(&viewportState);
-  pipelineInfo.setPRasterizationState(&rasterizer);
-  pipelineInfo.setPMultisampleState(&multisampling);
-  pipelineInfo.setPColorBlendState(&colorBlending);
-  pipelineInfo.setPDynamicState(&dynamicState);
   pipelineInfo.setLayout(layout_);
-  pipelineInfo.setRenderPass(nullptr);
-  pipelineInfo.setSubpass(0);
-  pipelineInfo.setPNext(&pipelineRenderingCreateInfo);
-  pipelineInfo.setPDepthStencilState(&depthStencil);
+  pipelineInfo.setPNext(&state.rendering);
 
-  auto result = device.createGraphicsPipeline(nullptr, pipelineInfo);
+  auto result = device.createGraphicsPipeline(cache, pipelineInfo);
 
   if (result.result != vk::Result::eSuccess) {
     throw std::runtime_error("Failed to create graphics pipeline");
@@ -137,13 +116,51 @@ Pipeline::Pipeline(vk::Device device, Shader& shader,
   spdlog::info("Successfully created pipeline");
 }
 
+Pipeline::Pipeline(vk::Device device, PipelineLibrary& library,
+                   const std::string& vertex_shader,
+                   const std::string& fragment_shader,
+                   vk::PipelineLayout layout, const PipelineConfig& config,
+                   const SpecializationConstants& constants)
+    : device(device),
+      layout_(layout),
+      config_(config),
+      extended_dynamic_state_(library.HasExtendedDynamicState()),
+      library_(&library) {
+
+  parts_ = library.GetParts(vertex_shader, fragment_shader, config, layout,
+                            constants);
+  pipeline = library.Link(parts_, layout, false);
+
+  spdlog::info("Linked pipeline {} {}", vertex_shader, fragment_shader);
+}
+
 Pipeline::~Pipeline() {
-  device.destroyPipeline(pipeline);
-  device.destroyPipelineLayout(layout_);
+  if (library_ == nullptr) {
+    device.destroyPipeline(pipeline);
+  }
+}
+
+void Pipeline::Optimize() {
+  if (library_ == nullptr || IsOptimized()) {
+    return;
+  }
+
+  const auto optimized = library_->Link(parts_, layout_, true);
+  optimized_.store(optimized, std::memory_order_release);
 }
 
 void Pipeline::Bind(vk::CommandBuffer buffer) {
-  buffer.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline);
+  const auto optimized = optimized_.load(std::memory_order_acquire);
+  buffer.bindPipeline(vk::PipelineBindPoint::eGraphics,
+                      optimized != VK_NULL_HANDLE ? vk::Pipeline(optimized)
+                                                  : pipeline);
+
+  if (extended_dynamic_state_) {
+    buffer.setCullModeEXT(config_.cull_mode);
+    buffer.setDepthWriteEnableEXT(config_.depth_write ? vk::True : vk::False);
+    buffer.setDepthCompareOpEXT(config_.depth_compare);
+    buffer.setPrimitiveTopologyEXT(vk::PrimitiveTopology::eTriangleList);
+  }
 }
 
 void Pipeline::SetViewport(const vk::CommandBuffer buffer,
@@ -164,4 +181,4 @@ vk::PipelineLayout Pipeline::VulkanLayout() const {
   return layout_;
 }
 
-}  // namespace braque
\ No newline at end of file
+}  // namespace braque
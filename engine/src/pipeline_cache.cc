@@ -0,0 +1,115 @@
+#include "braque/pipeline_cache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+namespace braque {
+
+namespace {
+
+// size of VkPipelineCacheHeaderVersionOne: size, version, vendor and device
+// followed by the cache UUID
+constexpr size_t kCacheHeaderSize = 16 + VK_UUID_SIZE;
+
+// the blob has no alignment guarantees
+auto ReadUint32(std::span<const uint8_t> data, size_t offset) -> uint32_t {
+  uint32_t value = 0;
+  std::memcpy(&value, data.data() + offset, sizeof(value));
+  return value;
+}
+
+auto ReadCacheFile(const std::filesystem::path& path) -> std::vector<uint8_t> {
+  std::ifstream file(path, std::ios::ate | std::ios::binary);
+  if (!file.is_open()) {
+    return {};
+  }
+
+  std::vector<uint8_t> data(static_cast<size_t>(file.tellg()));
+  file.seekg(0);
+  file.read(reinterpret_cast<char*>(data.data()),
+            static_cast<std::streamsize>(data.size()));
+  if (!file) {
+    return {};
+  }
+  return data;
+}
+
+}  // namespace
+
+auto IsPipelineCacheCompatible(std::span<const uint8_t> data,
+                               const vk::PhysicalDeviceProperties& properties)
+    -> bool {
+  if (data.size() < kCacheHeaderSize) {
+    return false;
+  }
+
+  const auto header_size = ReadUint32(data, 0);
+  const auto uuid = data.subspan(16, VK_UUID_SIZE);
+
+  return header_size >= kCacheHeaderSize && header_size <= data.size() &&
+         ReadUint32(data, 4) == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+         ReadUint32(data, 8) == properties.vendorID &&
+         ReadUint32(data, 12) == properties.deviceID &&
+         std::equal(uuid.begin(), uuid.end(),
+                    properties.pipelineCacheUUID.begin());
+}
+
+PipelineCache::PipelineCache(vk::Device device,
+                             const vk::PhysicalDeviceProperties& properties,
+                             std::filesystem::path path)
+    : device_(device), path_(std::move(path)) {
+  auto data = ReadCacheFile(path_);
+
+  // a cache from another driver version or GPU would only be rejected or
+  // worse, start empty instead
+  if (!data.empty() && !IsPipelineCacheCompatible(data, properties)) {
+    spdlog::warn("Ignoring pipeline cache {} written for another device",
+                 path_.string());
+    data.clear();
+  }
+
+  vk::PipelineCacheCreateInfo cacheInfo{};
+  cacheInfo.setInitialDataSize(data.size());
+  cacheInfo.setPInitialData(data.data());
+
+  cache_ = device_.createPipelineCache(cacheInfo);
+
+  spdlog::info("Created pipeline cache, {} bytes loaded", data.size());
+}
+
+PipelineCache::~PipelineCache() {
+  try {
+    Save();
+  } catch (const std::exception& e) {
+    spdlog::error("Failed to save pipeline cache: {}", e.what());
+  }
+  device_.destroyPipelineCache(cache_);
+}
+
+void PipelineCache::Save() const {
+  const auto data = device_.getPipelineCacheData(cache_);
+
+  auto temporary = path_;
+  temporary += ".tmp";
+
+  {
+    std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(data.data()),
+               static_cast<std::streamsize>(data.size()));
+    file.close();
+    if (!file) {
+      spdlog::error("Failed to write pipeline cache {}", temporary.string());
+      throw std::runtime_error("Failed to write pipeline cache");
+    }
+  }
+
+  std::filesystem::rename(temporary, path_);
+
+  spdlog::info("Saved pipeline cache, {} bytes", data.size());
+}
+
+}  // namespace braque
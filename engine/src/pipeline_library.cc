@@ -0,0 +1,256 @@
+#include "braque/pipeline_library.h"
+
+#include "braque/shader.h"
+
+#include <spdlog/spdlog.h>
+
+#include <filesystem>
+
+namespace braque {
+
+namespace {
+
+auto PartFlags(PipelinePart part) -> vk::GraphicsPipelineLibraryFlagsEXT {
+  switch (part) {
+    case PipelinePart::eVertexInput:
+      return vk::GraphicsPipelineLibraryFlagBitsEXT::eVertexInputInterface;
+    case PipelinePart::ePreRasterization:
+      return vk::GraphicsPipelineLibraryFlagBitsEXT::ePreRasterizationShaders;
+    case PipelinePart::eFragmentShader:
+      return vk::GraphicsPipelineLibraryFlagBitsEXT::eFragmentShader;
+    case PipelinePart::eFragmentOutput:
+      return vk::GraphicsPipelineLibraryFlagBitsEXT::eFragmentOutputInterface;
+  }
+  return {};
+}
+
+}  // namespace
+
+PipelineLibrary::PipelineLibrary(vk::Device device, vk::PipelineCache cache,
+                                 bool extended_dynamic_state)
+    : device_(device),
+      cache_(cache),
+      extended_dynamic_state_(extended_dynamic_state) {}
+
+PipelineLibrary::~PipelineLibrary() {
+  for (const auto& [key, pipeline] : linked_) {
+    device_.destroyPipeline(pipeline);
+  }
+  for (const auto& [key, part] : parts_) {
+    device_.destroyPipeline(part);
+  }
+  for (const auto part : evicted_) {
+    device_.destroyPipeline(part);
+  }
+}
+
+auto PipelineLibrary::GetParts(const std::string& vertex_shader,
+                               const std::string& fragment_shader,
+                               const PipelineConfig& config,
+                               vk::PipelineLayout layout,
+                               const SpecializationConstants& constants)
+    -> PipelineParts {
+  // each key holds only the state its part is built from, dynamic state
+  // is left out
+  PartKey vertexInput{PipelinePart::eVertexInput, {}, {}, {}, {}};
+  vertexInput.config.vertex_layout = config.vertex_layout;
+  vertexInput.config.vertex_streams = config.vertex_streams;
+
+  PartKey preRasterization{PipelinePart::ePreRasterization, vertex_shader,
+                           layout, constants, {}};
+  if (!extended_dynamic_state_) {
+    preRasterization.config.cull_mode = config.cull_mode;
+  }
+
+  PartKey fragmentShader{PipelinePart::eFragmentShader, fragment_shader,
+                         layout, constants, {}};
+  fragmentShader.config.samples = config.samples;
+  if (!extended_dynamic_state_) {
+    fragmentShader.config.depth_write = config.depth_write;
+    fragmentShader.config.depth_compare = config.depth_compare;
+  }
+
+  PartKey fragmentOutput{PipelinePart::eFragmentOutput, {}, {}, {}, {}};
+  fragmentOutput.config.samples = config.samples;
+  fragmentOutput.config.depth_only = config.depth_only;
+
+  return {
+      GetPart(vertexInput, config, layout, constants),
+      GetPart(preRasterization, config, layout, constants),
+      GetPart(fragmentShader, config, layout, constants),
+      GetPart(fragmentOutput, config, layout, constants),
+  };
+}
+
+auto PipelineLibrary::Link(const PipelineParts& parts,
+                           vk::PipelineLayout layout, bool optimize)
+    -> vk::Pipeline {
+  const LinkKey key{parts, layout, optimize};
+
+  {
+    std::lock_guard lock(mutex_);
+    if (const auto found = linked_.find(key); found != linked_.end()) {
+      return found->second;
+    }
+  }
+
+  vk::PipelineLibraryCreateInfoKHR libraryInfo{};
+  libraryInfo.setLibraries(parts);
+
+  vk::GraphicsPipelineCreateInfo pipelineInfo{};
+  pipelineInfo.setLayout(layout);
+  pipelineInfo.setPNext(&libraryInfo);
+  if (optimize) {
+    pipelineInfo.setFlags(vk::PipelineCreateFlagBits::eLinkTimeOptimizationEXT);
+  }
+
+  const auto result = device_.createGraphicsPipeline(cache_, pipelineInfo);
+  if (result.result != vk::Result::eSuccess) {
+    spdlog::error("Failed to link graphics pipeline");
+    throw std::runtime_error("Failed to link graphics pipeline");
+  }
+
+  std::lock_guard lock(mutex_);
+  return Store(linked_, key, result.value);
+}
+
+auto PipelineLibrary::GetPart(const PartKey& key, const PipelineConfig& config,
+                              vk::PipelineLayout layout,
+                              const SpecializationConstants& constants)
+    -> vk::Pipeline {
+  {
+    std::lock_guard lock(mutex_);
+    if (const auto found = parts_.find(key); found != parts_.end()) {
+      return found->second;
+    }
+  }
+
+  // compiled outside the lock so workers build different parts at once
+  const auto compiled =
+      CompilePart(key.part, key.shader, config, layout, constants);
+
+  std::lock_guard lock(mutex_);
+  return Store(parts_, key, compiled);
+}
+
+void PipelineLibrary::Evict(const std::string& shader) {
+  // the watcher and the pipelines may spell the directory differently
+  const auto name = std::filesystem::path(shader).filename();
+
+  std::lock_guard lock(mutex_);
+  for (auto it = parts_.begin(); it != parts_.end();) {
+    const auto& shader_path = it->first.shader;
+    if (shader_path.empty() ||
+        std::filesystem::path(shader_path).filename() != name) {
+      ++it;
+      continue;
+    }
+
+    evicted_.push_back(it->second);
+    it = parts_.erase(it);
+  }
+}
+
+auto PipelineLibrary::CompilePart(PipelinePart part, const std::string& shader,
+                                  const PipelineConfig& config,
+                                  vk::PipelineLayout layout,
+                                  const SpecializationConstants& constants)
+    -> vk::Pipeline {
+  const PipelineState state(config, extended_dynamic_state_);
+  const auto specializationInfo = constants.GetInfo();
+
+  vk::ShaderModule module;
+  vk::PipelineShaderStageCreateInfo stage{};
+  if (!shader.empty()) {
+    const auto code = LoadShaderCode(shader);
+
+    vk::ShaderModuleCreateInfo moduleInfo{};
+    moduleInfo.setCodeSize(code.size());
+    moduleInfo.setPCode(reinterpret_cast<const uint32_t*>(code.data()));
+    module = device_.createShaderModule(moduleInfo);
+
+    stage.setStage(part == PipelinePart::ePreRasterization
+                       ? vk::ShaderStageFlagBits::eVertex
+                       : vk::ShaderStageFlagBits::eFragment);
+    stage.setModule(module);
+    stage.setPName("main");
+    if (!constants.IsEmpty()) {
+      stage.setPSpecializationInfo(&specializationInfo);
+    }
+  }
+
+  // the driver ignores the state outside the part, so the full state can
+  // be passed to every part
+  auto rendering = state.rendering;
+
+  vk::GraphicsPipelineLibraryCreateInfoEXT libraryInfo{};
+  libraryInfo.setFlags(PartFlags(part));
+  libraryInfo.setPNext(&rendering);
+
+  vk::GraphicsPipelineCreateInfo pipelineInfo{};
+  state.Apply(pipelineInfo);
+  pipelineInfo.setFlags(
+      vk::PipelineCreateFlagBits::eLibraryKHR |
+      vk::PipelineCreateFlagBits::eRetainLinkTimeOptimizationInfoEXT);
+  if (module) {
+    pipelineInfo.setStages(stage);
+  }
+  pipelineInfo.setLayout(layout);
+  pipelineInfo.setPNext(&libraryInfo);
+
+  const auto result = device_.createGraphicsPipeline(cache_, pipelineInfo);
+
+  if (module) {
+    device_.destroyShaderModule(module);
+  }
+
+  if (result.result != vk::Result::eSuccess) {
+    spdlog::error("Failed to compile pipeline part {}", shader);
+    throw std::runtime_error("Failed to compile pipeline part");
+  }
+
+  return result.value;
+}
+
+auto PipelineLibrary::PartKeyHash::operator()(const PartKey& key) const
+    -> size_t {
+  const auto& config = key.config;
+  auto hash = static_cast<uint64_t>(key.part);
+  HashCombine(hash, std::hash<std::string>{}(key.shader));
+  HashCombine(hash, reinterpret_cast<uint64_t>(
+                        static_cast<VkPipelineLayout>(key.layout)));
+  HashCombine(hash, key.constants.Hash());
+  HashCombine(hash, static_cast<uint64_t>(config.vertex_layout));
+  HashCombine(hash, config.vertex_streams);
+  HashCombine(hash, config.depth_only ? 1 : 0);
+  HashCombine(hash, static_cast<uint64_t>(config.samples));
+  HashCombine(hash, static_cast<VkCullModeFlags>(config.cull_mode));
+  HashCombine(hash, config.depth_write ? 1 : 0);
+  HashCombine(hash, static_cast<uint64_t>(config.depth_compare));
+  return static_cast<size_t>(hash);
+}
+
+auto PipelineLibrary::LinkKeyHash::operator()(const LinkKey& key) const
+    -> size_t {
+  uint64_t hash = key.optimize ? 1 : 0;
+  HashCombine(hash, reinterpret_cast<uint64_t>(
+                        static_cast<VkPipelineLayout>(key.layout)));
+  for (const auto part : key.parts) {
+    HashCombine(hash,
+                reinterpret_cast<uint64_t>(static_cast<VkPipeline>(part)));
+  }
+  return static_cast<size_t>(hash);
+}
+
+template <typename Pipelines>
+auto PipelineLibrary::Store(Pipelines& pipelines,
+                            const typename Pipelines::key_type& key,
+                            vk::Pipeline pipeline) -> vk::Pipeline {
+  const auto [entry, inserted] = pipelines.try_emplace(key, pipeline);
+  if (!inserted) {
+    device_.destroyPipeline(pipeline);
+  }
+  return entry->second;
+}
+
+}  // namespace braque
@@ -0,0 +1,339 @@
+#include "braque/pipeline_manager.h"
+
+#include "braque/engine_context.h"
+#include "braque/job_system.h"
+#include "braque/layout_cache.h"
+#include "braque/pipeline_library.h"
+#include "braque/renderer.h"
+#include "braque/shader.h"
+#include "braque/swapchain.h"
+#include "braque/uniforms.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+
+#include <spdlog/spdlog.h>
+
+namespace braque {
+
+auto HashPipelineDesc(const PipelineDesc& desc) -> uint64_t {
+  const auto& config = desc.config;
+
+  uint64_t hash = std::hash<std::string>{}(desc.vertex_shader);
+  HashCombine(hash, std::hash<std::string>{}(desc.fragment_shader));
+  HashCombine(hash, static_cast<uint64_t>(config.vertex_layout));
+  HashCombine(hash, config.vertex_streams);
+  HashCombine(hash, config.depth_only ? 1 : 0);
+  HashCombine(hash, static_cast<uint64_t>(config.samples));
+  HashCombine(hash, static_cast<VkCullModeFlags>(config.cull_mode));
+  HashCombine(hash, config.depth_write ? 1 : 0);
+  HashCombine(hash, static_cast<uint64_t>(config.depth_compare));
+  HashCombine(hash, desc.constants.Hash());
+  return hash;
+}
+
+PipelineManager::PipelineManager(EngineContext& engine,
+                                 const Uniforms& uniforms)
+    : engine_(engine),
+      uniforms_(uniforms),
+      extended_dynamic_state_(
+          engine.getRenderer().GetFeatures().extended_dynamic_state) {
+  const auto& renderer = engine.getRenderer();
+
+  // without the extension every permutation is a monolithic compile
+  if (renderer.GetFeatures().graphics_pipeline_library) {
+    library_ = std::make_unique<PipelineLibrary>(
+        renderer.getDevice(), renderer.GetPipelineCache(),
+        extended_dynamic_state_);
+  }
+}
+
+PipelineManager::~PipelineManager() {
+  // compiles in flight write into their entries
+  for (const auto& entry : entries_) {
+    if (entry->job.valid()) {
+      entry->job.wait();
+    }
+    if (entry->reload_job.valid()) {
+      entry->reload_job.wait();
+    }
+  }
+  retired_.clear();
+  entries_.clear();
+}
+
+auto PipelineManager::Request(const PipelineDesc& desc) -> PipelineHandle {
+  if (const auto found = lookup_.find(desc); found != lookup_.end()) {
+    return {found->second};
+  }
+
+  const auto index = static_cast<uint32_t>(entries_.size());
+  auto& entry = *entries_.emplace_back(std::make_unique<Entry>());
+  entry.desc = desc;
+  lookup_.emplace(desc, index);
+
+  entry.job =
+      engine_.getJobSystem().Async([this, &entry] { Compile(entry); });
+
+  return {index};
+}
+
+void PipelineManager::WarmUp(std::span<const PipelineDesc> descs) {
+  std::vector<PipelineHandle> handles;
+  handles.reserve(descs.size());
+  for (const auto& desc : descs) {
+    handles.push_back(Request(desc));
+  }
+  for (const auto handle : handles) {
+    Wait(handle);
+  }
+}
+
+void PipelineManager::Wait(PipelineHandle handle) const {
+  const auto& entry = *entries_[handle.index];
+  if (entry.job.valid()) {
+    entry.job.wait();
+  }
+}
+
+auto PipelineManager::Get(PipelineHandle handle) const -> Pipeline* {
+  if (!handle.IsValid() || handle.index >= entries_.size()) {
+    return nullptr;
+  }
+  const auto& entry = *entries_[handle.index];
+  return entry.status.load(std::memory_order_acquire) == Status::eReady
+             ? entry.pipeline.get()
+             : nullptr;
+}
+
+auto PipelineManager::GetPendingCount() const -> uint32_t {
+  return static_cast<uint32_t>(std::count_if(
+      entries_.begin(), entries_.end(), [](const auto& entry) {
+        return entry->status.load(std::memory_order_acquire) ==
+               Status::ePending;
+      }));
+}
+
+void PipelineManager::Reload(const std::string& shader) {
+  // the watcher and the descs may spell the directory differently
+  const auto name = std::filesystem::path(shader).filename();
+  const auto uses = [&name](const std::string& path) {
+    return !path.empty() && std::filesystem::path(path).filename() == name;
+  };
+
+  // parts compiled from the old module must not be linked again
+  if (library_) {
+    library_->Evict(shader);
+  }
+
+  for (const auto& entry : entries_) {
+    if (!uses(entry->desc.vertex_shader) &&
+        !uses(entry->desc.fragment_shader)) {
+      continue;
+    }
+
+    // the first compile may have loaded the old module, waiting for it
+    // would stall the frame
+    if (entry->status.load(std::memory_order_acquire) == Status::ePending) {
+      entry->reload_wanted = true;
+      continue;
+    }
+
+    // failed pipelines get another chance with the fixed shader
+    StartReload(*entry);
+  }
+}
+
+void PipelineManager::StartReload(Entry& entry) {
+  entry.reload_wanted = false;
+
+  // the first compile is ready before its optimized link finished, which
+  // still writes the pipeline the reload replaces
+  entry.job.wait();
+
+  // a reload still compiling would read the module it replaced
+  if (entry.reload_job.valid()) {
+    entry.reload_job.wait();
+  }
+  entry.reload_ready.store(false, std::memory_order_relaxed);
+  entry.reloaded.reset();
+
+  spdlog::info("Reloading pipeline {} {}", entry.desc.vertex_shader,
+               entry.desc.fragment_shader);
+  entry.reload_job = engine_.getJobSystem().Async(
+      [this, &entry] { Recompile(entry); });
+}
+
+void PipelineManager::ApplyReloads() {
+  for (auto& retired : retired_) {
+    --retired.frames_left;
+  }
+  std::erase_if(retired_, [](const RetiredPipeline& retired) {
+    return retired.frames_left == 0;
+  });
+
+  for (const auto& entry : entries_) {
+    if (entry->reload_wanted &&
+        entry->job.wait_for(std::chrono::seconds(0)) ==
+            std::future_status::ready) {
+      // the first compile may have stored parts of the old module again
+      if (library_) {
+        library_->Evict(entry->desc.vertex_shader);
+        if (!entry->desc.fragment_shader.empty()) {
+          library_->Evict(entry->desc.fragment_shader);
+        }
+      }
+      StartReload(*entry);
+      continue;
+    }
+
+    if (!entry->reload_ready.load(std::memory_order_acquire)) {
+      continue;
+    }
+
+    // Reload waited for the first compile, this only guards the swap
+    if (entry->job.wait_for(std::chrono::seconds(0)) !=
+        std::future_status::ready) {
+      continue;
+    }
+    entry->reload_ready.store(false, std::memory_order_relaxed);
+
+    // frames in flight may still draw with the old pipeline, a failed
+    // compile left none
+    if (entry->pipeline) {
+      retired_.push_back(RetiredPipeline{std::move(entry->pipeline),
+                                         Swapchain::getFramesInFlightCount()});
+    }
+    entry->pipeline = std::move(entry->reloaded);
+    entry->status.store(Status::eReady, std::memory_order_release);
+  }
+}
+
+void PipelineManager::Compile(Entry& entry) const {
+  const auto& renderer = engine_.getRenderer();
+  const auto device = renderer.getDevice();
+  const auto& desc = entry.desc;
+
+  try {
+    const auto layout = GetLayout(desc);
+
+    if (library_) {
+      entry.pipeline = std::make_unique<Pipeline>(
+          device, *library_, desc.vertex_shader, desc.fragment_shader, layout,
+          desc.config, desc.constants);
+    } else {
+      // the modules are only needed while the pipeline is created
+      const auto shader =
+          desc.fragment_shader.empty()
+              ? std::make_unique<Shader>(device, desc.vertex_shader,
+                                         desc.constants)
+              : std::make_unique<Shader>(device, desc.vertex_shader,
+                                         desc.fragment_shader, desc.constants);
+
+      entry.pipeline = std::make_unique<Pipeline>(
+          device, renderer.GetPipelineCache(), *shader, layout, desc.config,
+          extended_dynamic_state_);
+    }
+    entry.status.store(Status::eReady, std::memory_order_release);
+  } catch (const std::exception& e) {
+    spdlog::error("Failed to compile pipeline {} {}: {}", desc.vertex_shader,
+                  desc.fragment_shader, e.what());
+    entry.status.store(Status::eFailed, std::memory_order_release);
+    return;
+  }
+
+  // drawing already works with the fast link, the optimized link replaces
+  // it once done
+  try {
+    entry.pipeline->Optimize();
+  } catch (const std::exception& e) {
+    spdlog::warn("Keeping unoptimized pipeline {} {}: {}", desc.vertex_shader,
+                 desc.fragment_shader, e.what());
+  }
+}
+
+void PipelineManager::Recompile(Entry& entry) const {
+  const auto& renderer = engine_.getRenderer();
+  const auto device = renderer.getDevice();
+  const auto& desc = entry.desc;
+
+  try {
+    const auto layout = GetLayout(desc);
+
+    const auto shader =
+        desc.fragment_shader.empty()
+            ? std::make_unique<Shader>(device, desc.vertex_shader,
+                                       desc.constants)
+            : std::make_unique<Shader>(device, desc.vertex_shader,
+                                       desc.fragment_shader, desc.constants);
+
+    entry.reloaded = std::make_unique<Pipeline>(
+        device, renderer.GetPipelineCache(), *shader, layout, desc.config,
+        extended_dynamic_state_);
+    entry.reload_ready.store(true, std::memory_order_release);
+  } catch (const std::exception& e) {
+    spdlog::error("Failed to reload pipeline {} {}, keeping the old one: {}",
+                  desc.vertex_shader, desc.fragment_shader, e.what());
+  }
+}
+
+auto PipelineManager::GetLayout(const PipelineDesc& desc) const
+    -> vk::PipelineLayout {
+  auto reflection = ReflectShaderFile(desc.vertex_shader);
+  if (!desc.fragment_shader.empty()) {
+    reflection = MergeReflections(reflection,
+                                  ReflectShaderFile(desc.fragment_shader));
+  }
+
+  // compact layouts feed the same locations from narrower formats, only
+  // missing attributes are an error
+  const auto vertexInput = GetVertexInputDescription(
+      desc.config.vertex_layout, desc.config.vertex_streams);
+  for (const auto& input : reflection.vertex_inputs) {
+    if (std::none_of(vertexInput.attributes.begin(),
+                     vertexInput.attributes.end(),
+                     [&input](const auto& attribute) {
+                       return attribute.location == input.location;
+                     })) {
+      spdlog::error("{} reads vertex location {} the layout does not provide",
+                    desc.vertex_shader, input.location);
+      throw std::runtime_error("Vertex input is not provided");
+    }
+  }
+
+  // set 0 is the frame set, allocated with its own layout, so the shaders
+  // may only use bindings it already has
+  const auto& frameBindings = uniforms_.GetBindings();
+  for (const auto& binding : GetSetBindings(reflection, 0)) {
+    const auto found = std::find_if(
+        frameBindings.begin(), frameBindings.end(),
+        [&binding](const ShaderBinding& frame) {
+          return frame.binding == binding.binding;
+        });
+    if (found == frameBindings.end() || found->type != binding.type ||
+        (found->stages & binding.stages) != binding.stages) {
+      spdlog::error("{} {} uses binding {} unlike the frame set",
+                    desc.vertex_shader, desc.fragment_shader,
+                    binding.binding);
+      throw std::runtime_error("Shader does not match the frame set");
+    }
+  }
+
+  auto& layouts = engine_.getRenderer().GetLayoutCache();
+
+  std::vector<vk::DescriptorSetLayout> setLayouts = {
+      uniforms_.GetDescriptorSetLayout()};
+  for (uint32_t set = 1; set < GetSetCount(reflection); ++set) {
+    setLayouts.push_back(layouts.GetSetLayout(GetSetBindings(reflection, set)));
+  }
+
+  // every scene pipeline has the push constants of the scene shaders,
+  // which keeps them valid when the pipeline changes between draws
+  const auto pushConstants = MergePushConstantRanges(
+      uniforms_.GetReflection().push_constants, reflection.push_constants);
+
+  return layouts.GetPipelineLayout(setLayouts, pushConstants);
+}
+
+}  // namespace braque
@@ -4,25 +4,87 @@
 
 #include "braque/renderer.h"
 
+#include "braque/descriptor_allocator.h"
+#include "braque/layout_cache.h"
+#include "braque/pipeline_cache.h"
+
 #include <GLFW/glfw3.h>
+#include <algorithm>
+#include <array>
+#include <string_view>
 #include <spdlog/spdlog.h>
 
 VULKAN_HPP_DEFAULT_DISPATCH_LOADER_DYNAMIC_STORAGE;
 
 namespace braque {
 
+auto SelectQueues(std::span<const vk::QueueFamilyProperties> families)
+    -> QueueSelection {
+  const auto supports = [&families](uint32_t family, vk::QueueFlags flags) {
+    return (families[family].queueFlags & flags) == flags;
+  };
+
+  QueueSelection queues{};
+  const auto count = static_cast<uint32_t>(families.size());
+
+  queues.graphics_family = count;
+  for (uint32_t family = 0; family < count; ++family) {
+    if (supports(family, vk::QueueFlagBits::eGraphics |
+                             vk::QueueFlagBits::eCompute)) {
+      queues.graphics_family = family;
+      break;
+    }
+  }
+  if (queues.graphics_family == count) {
+    spdlog::error("No queue family supports graphics");
+    throw std::runtime_error("No queue family supports graphics");
+  }
+
+  queues.compute_family = queues.graphics_family;
+  for (uint32_t family = 0; family < count; ++family) {
+    if (supports(family, vk::QueueFlagBits::eCompute) &&
+        !supports(family, vk::QueueFlagBits::eGraphics)) {
+      queues.compute_family = family;
+      queues.async_compute = true;
+      return queues;
+    }
+  }
+
+  if (families[queues.graphics_family].queueCount > 1) {
+    queues.compute_index = 1;
+    queues.async_compute = true;
+  }
+  return queues;
+}
+
 Renderer::Renderer()
     : instance_(createInstance()),
       m_physicalDevice(createPhysicalDevice(instance_)),
-      m_device(createLogicalDevice(m_physicalDevice)),
-      m_graphicsQueue(createGraphicsQueue(m_device, 0)),
-      command_pool_(CreateCommandPool(m_device, 0)),
-      graphicsQueueFamilyIndex(0) {
+      features_(QueryFeatures(m_physicalDevice)),
+      queues_(SelectQueues(m_physicalDevice.getQueueFamilyProperties())),
+      m_device(createLogicalDevice(m_physicalDevice, features_, queues_)),
+      m_graphicsQueue(createGraphicsQueue(m_device, queues_.graphics_family)),
+      compute_queue_(
+          m_device.getQueue(queues_.compute_family, queues_.compute_index)),
+      command_pool_(CreateCommandPool(m_device, queues_.graphics_family)),
+      graphicsQueueFamilyIndex(queues_.graphics_family) {
+  pipeline_cache_ = std::make_unique<PipelineCache>(
+      m_device, m_physicalDevice.getProperties(), kPipelineCachePath);
+  layout_cache_ = std::make_unique<LayoutCache>(m_device);
+  descriptor_allocator_ =
+      std::make_unique<DescriptorAllocator>(m_device, kDefaultPoolRatios);
+
   spdlog::info("Created renderer");
+  spdlog::info("  Async compute: {}", queues_.async_compute);
 }
 
 Renderer::~Renderer() {
 
+  // saves the cache, which needs the device
+  pipeline_cache_.reset();
+  descriptor_allocator_.reset();
+  layout_cache_.reset();
+
   // destroy the command pool
   m_device.destroyCommandPool(command_pool_);
 
@@ -34,6 +96,17 @@ Renderer::~Renderer() {
   instance_.destroy();
 }
 
+auto Renderer::GetPipelineCache() const -> vk::PipelineCache {
+  return pipeline_cache_->Get();
+}
+
+auto Renderer::GetQueueFamilyIndices() const -> std::vector<uint32_t> {
+  if (queues_.compute_family == queues_.graphics_family) {
+    return {queues_.graphics_family};
+  }
+  return {queues_.graphics_family, queues_.compute_family};
+}
+
 vk::Instance Renderer::createInstance() {
   VULKAN_HPP_DEFAULT_DISPATCHER.init();
 
@@ -114,19 +187,132 @@ vk::PhysicalDevice Renderer::createPhysicalDevice(vk::Instance instance) {
   return physicalDevice;
 }
 
-vk::Device Renderer::createLogicalDevice(vk::PhysicalDevice physicalDevice) {
-  // create the logical device
-  vk::DeviceQueueCreateInfo queueCreateInfo;
-  queueCreateInfo.setQueueFamilyIndex(0);
-  queueCreateInfo.setQueueCount(1);
-  constexpr auto queuePriority = 1.0F;
-  queueCreateInfo.setPQueuePriorities(&queuePriority);
+DeviceFeatures Renderer::QueryFeatures(vk::PhysicalDevice physicalDevice) {
+  const auto features =
+      physicalDevice.getFeatures2<vk::PhysicalDeviceFeatures2,
+                                  vk::PhysicalDeviceVulkan11Features,
+                                  vk::PhysicalDeviceVulkan12Features>();
+
+  const auto& core = features.get<vk::PhysicalDeviceFeatures2>().features;
+  const auto& vulkan11 = features.get<vk::PhysicalDeviceVulkan11Features>();
+  const auto& vulkan12 = features.get<vk::PhysicalDeviceVulkan12Features>();
+
+  // gl_DrawID is needed by every indirect draw path
+  if (vulkan11.shaderDrawParameters == vk::False) {
+    spdlog::error("Physical device does not support shader draw parameters");
+    throw std::runtime_error(
+        "Physical device does not support shader draw parameters");
+  }
+
+  // the single pass Hi-Z downsample indexes its array of level images
+  if (core.shaderStorageImageArrayDynamicIndexing == vk::False) {
+    spdlog::error(
+        "Physical device does not support storage image array indexing");
+    throw std::runtime_error(
+        "Physical device does not support storage image array indexing");
+  }
+
+  // bindless textures index one large, sparsely filled sampler array that
+  // is written while frames using it are still in flight
+  if (vulkan12.runtimeDescriptorArray == vk::False ||
+      vulkan12.shaderSampledImageArrayNonUniformIndexing == vk::False ||
+      vulkan12.descriptorBindingPartiallyBound == vk::False ||
+      vulkan12.descriptorBindingSampledImageUpdateAfterBind == vk::False) {
+    spdlog::error("Physical device does not support descriptor indexing");
+    throw std::runtime_error(
+        "Physical device does not support descriptor indexing");
+  }
+
+  // graphics and async compute wait on each other's timelines
+  if (vulkan12.timelineSemaphore == vk::False) {
+    spdlog::error("Physical device does not support timeline semaphores");
+    throw std::runtime_error(
+        "Physical device does not support timeline semaphores");
+  }
+
+  DeviceFeatures deviceFeatures{};
+  deviceFeatures.multi_draw_indirect = core.multiDrawIndirect == vk::True;
+  deviceFeatures.draw_indirect_count = vulkan12.drawIndirectCount == vk::True;
+
+  const auto properties =
+      physicalDevice.getProperties2<vk::PhysicalDeviceProperties2,
+                                    vk::PhysicalDeviceSubgroupProperties>();
+  const auto& subgroup =
+      properties.get<vk::PhysicalDeviceSubgroupProperties>();
+  const auto subgroupOperations = vk::SubgroupFeatureFlagBits::eBasic |
+                                  vk::SubgroupFeatureFlagBits::eArithmetic;
+  deviceFeatures.subgroup_arithmetic =
+      (subgroup.supportedStages & vk::ShaderStageFlagBits::eCompute) &&
+      (subgroup.supportedOperations & subgroupOperations) == subgroupOperations;
+
+  // extension features may only be queried when the extension exists
+  const auto extensions = physicalDevice.enumerateDeviceExtensionProperties();
+  const auto hasExtension = [&extensions](std::string_view name) {
+    return std::any_of(extensions.begin(), extensions.end(),
+                       [name](const vk::ExtensionProperties& extension) {
+                         return name == extension.extensionName.data();
+                       });
+  };
+
+  if (hasExtension(VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME) &&
+      hasExtension(VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME)) {
+    const auto library =
+        physicalDevice
+            .getFeatures2<vk::PhysicalDeviceFeatures2,
+                          vk::PhysicalDeviceGraphicsPipelineLibraryFeaturesEXT>();
+    deviceFeatures.graphics_pipeline_library =
+        library.get<vk::PhysicalDeviceGraphicsPipelineLibraryFeaturesEXT>()
+            .graphicsPipelineLibrary == vk::True;
+  }
+
+  if (hasExtension(VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME)) {
+    const auto dynamicState =
+        physicalDevice
+            .getFeatures2<vk::PhysicalDeviceFeatures2,
+                          vk::PhysicalDeviceExtendedDynamicStateFeaturesEXT>();
+    deviceFeatures.extended_dynamic_state =
+        dynamicState.get<vk::PhysicalDeviceExtendedDynamicStateFeaturesEXT>()
+            .extendedDynamicState == vk::True;
+  }
+
+  spdlog::info("  Multi draw indirect: {}", deviceFeatures.multi_draw_indirect);
+  spdlog::info("  Draw indirect count: {}", deviceFeatures.draw_indirect_count);
+  spdlog::info("  Graphics pipeline library: {}",
+               deviceFeatures.graphics_pipeline_library);
+  spdlog::info("  Extended dynamic state: {}",
+               deviceFeatures.extended_dynamic_state);
+  spdlog::info("  Subgroup arithmetic: {}",
+               deviceFeatures.subgroup_arithmetic);
+
+  return deviceFeatures;
+}
+
+vk::Device Renderer::createLogicalDevice(vk::PhysicalDevice physicalDevice,
+                                         const DeviceFeatures& features,
+                                         const QueueSelection& queues) {
+  // one graphics queue, and the async compute queue either in its own
+  // family or as the second queue of the graphics family
+  constexpr std::array queuePriorities = {1.0F, 1.0F};
+
+  std::vector<vk::DeviceQueueCreateInfo> queueCreateInfos(1);
+  queueCreateInfos[0].setQueueFamilyIndex(queues.graphics_family);
+  queueCreateInfos[0].setQueueCount(1);
+  queueCreateInfos[0].setPQueuePriorities(queuePriorities.data());
+
+  if (queues.compute_family != queues.graphics_family) {
+    vk::DeviceQueueCreateInfo computeCreateInfo;
+    computeCreateInfo.setQueueFamilyIndex(queues.compute_family);
+    computeCreateInfo.setQueueCount(1);
+    computeCreateInfo.setPQueuePriorities(queuePriorities.data());
+    queueCreateInfos.push_back(computeCreateInfo);
+  } else if (queues.compute_index > 0) {
+    queueCreateInfos[0].setQueueCount(2);
+  }
 
   vk::DeviceCreateInfo deviceCreateInfo;
-  deviceCreateInfo.setQueueCreateInfoCount(1);
-  deviceCreateInfo.setPQueueCreateInfos(&queueCreateInfo);
+  deviceCreateInfo.setQueueCreateInfos(queueCreateInfos);
 
-  auto deviceExtensions = getDeviceExtensions();
+  auto deviceExtensions = getDeviceExtensions(features);
 
   deviceCreateInfo.setEnabledExtensionCount(
       static_cast<uint32_t>(deviceExtensions.size()));
@@ -134,6 +320,8 @@ vk::Device Renderer::createLogicalDevice(vk::PhysicalDevice physicalDevice) {
 
   vk::PhysicalDeviceFeatures enabledFeatures{};
   enabledFeatures.setSamplerAnisotropy(true);
+  enabledFeatures.setMultiDrawIndirect(features.multi_draw_indirect);
+  enabledFeatures.setShaderStorageImageArrayDynamicIndexing(vk::True);
   deviceCreateInfo.setPEnabledFeatures(&enabledFeatures);
 
   // dynamic rendering features
@@ -145,13 +333,42 @@ vk::Device Renderer::createLogicalDevice(vk::PhysicalDevice physicalDevice) {
   synchronization2Features.setSynchronization2(vk::True);
   synchronization2Features.setPNext(&dynamicRenderingFeatures);
 
-  // float16 int8 features
-  vk::PhysicalDeviceFloat16Int8FeaturesKHR float16Int8Features;
-  float16Int8Features.setShaderFloat16(vk::True);
-  float16Int8Features.setShaderInt8(vk::True);
-  float16Int8Features.setPNext(&synchronization2Features);
+  // vulkan 1.1 features
+  vk::PhysicalDeviceVulkan11Features vulkan11Features;
+  vulkan11Features.setShaderDrawParameters(vk::True);
+  vulkan11Features.setPNext(&synchronization2Features);
+
+  // vulkan 1.2 features, float16 int8, indirect count, descriptor
+  // indexing for the bindless texture table and timeline semaphores
+  vk::PhysicalDeviceVulkan12Features vulkan12Features;
+  vulkan12Features.setShaderFloat16(vk::True);
+  vulkan12Features.setShaderInt8(vk::True);
+  vulkan12Features.setDrawIndirectCount(features.draw_indirect_count);
+  vulkan12Features.setRuntimeDescriptorArray(vk::True);
+  vulkan12Features.setShaderSampledImageArrayNonUniformIndexing(vk::True);
+  vulkan12Features.setDescriptorBindingPartiallyBound(vk::True);
+  vulkan12Features.setDescriptorBindingSampledImageUpdateAfterBind(vk::True);
+  vulkan12Features.setTimelineSemaphore(vk::True);
+  vulkan12Features.setPNext(&vulkan11Features);
+
+  // optional extensions go in front of the chain when they are enabled
+  void* featureChain = &vulkan12Features;
+
+  vk::PhysicalDeviceGraphicsPipelineLibraryFeaturesEXT libraryFeatures;
+  libraryFeatures.setGraphicsPipelineLibrary(vk::True);
+  if (features.graphics_pipeline_library) {
+    libraryFeatures.setPNext(featureChain);
+    featureChain = &libraryFeatures;
+  }
+
+  vk::PhysicalDeviceExtendedDynamicStateFeaturesEXT dynamicStateFeatures;
+  dynamicStateFeatures.setExtendedDynamicState(vk::True);
+  if (features.extended_dynamic_state) {
+    dynamicStateFeatures.setPNext(featureChain);
+    featureChain = &dynamicStateFeatures;
+  }
 
-  deviceCreateInfo.setPNext(&float16Int8Features);
+  deviceCreateInfo.setPNext(featureChain);
 
   const auto device = physicalDevice.createDevice(deviceCreateInfo);
 
@@ -192,13 +409,23 @@ auto Renderer::getInstanceExtensions() -> std::vector<char const*> {
   return extensions;
 }
 
-auto Renderer::getDeviceExtensions() -> std::vector<const char*> {
+auto Renderer::getDeviceExtensions(const DeviceFeatures& features)
+    -> std::vector<const char*> {
   std::vector deviceExtensions = {
       VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME,
       VK_KHR_SWAPCHAIN_EXTENSION_NAME,
       VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME,
   };
 
+  if (features.graphics_pipeline_library) {
+    deviceExtensions.push_back(VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME);
+    deviceExtensions.push_back(VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME);
+  }
+
+  if (features.extended_dynamic_state) {
+    deviceExtensions.push_back(VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME);
+  }
+
 #ifdef __APPLE__
   deviceExtensions.push_back("VK_KHR_portability_subset");
 #endif
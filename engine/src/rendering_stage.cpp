@@ -6,6 +6,7 @@
 
 #include "braque/image.h"
 #include "braque/pipeline.h"
+#include "braque/pipeline_manager.h"
 #include "braque/renderer.h"
 #include "braque/shader.h"
 #include "braque/swapchain.h"
@@ -15,19 +16,42 @@
 
 namespace braque {
 
-RenderingStage::RenderingStage(EngineContext& engine, Swapchain& swapchain, Uniforms& uniforms) : engine(engine), swapchain_(swapchain) {
+RenderingStage::RenderingStage(EngineContext& engine, Swapchain& swapchain, Uniforms& uniforms, VertexLayout vertex_layout) : engine(engine), swapchain_(swapchain) {
   spdlog::info("Creating rendering stage");
 
   createDescriptorPool();
+  frameDescriptors = std::make_unique<DescriptorSetCache>(
+      engine.getRenderer().getDevice(), Swapchain::getFramesInFlightCount());
 
   const auto extent = vk::Extent3D{swapchain.getExtent(), 1};
 
-  shader = std::make_unique<Shader>(engine.getRenderer().getDevice(),
-                                    "../assets/shaders/triangle.vert.spv",
-                                    "../assets/shaders/triangle.frag.spv");
-  pipeline =
-      std::make_unique<Pipeline>(engine.getRenderer().getDevice(), *shader,
-                                 uniforms.GetDescriptorSetLayout());
+  pipelines_ = std::make_unique<PipelineManager>(engine, uniforms);
+
+  // compact layouts need the shader that decodes them
+  PipelineDesc colorDesc{};
+  colorDesc.vertex_shader = vertex_layout == VertexLayout::eFull
+                                ? kSceneVertexShader
+                                : kSceneCompactVertexShader;
+  colorDesc.fragment_shader = kSceneFragmentShader;
+  colorDesc.config.vertex_layout = vertex_layout;
+
+  // the shading features of the scene, another set is another permutation
+  colorDesc.constants.SetUint(kLightCountConstant, 1);
+  colorDesc.constants.SetFloat(kAmbientStrengthConstant, 0.1F);
+  colorDesc.constants.SetBool(kAlbedoTexturesConstant, true);
+  colorDesc.constants.SetBool(kOcclusionTexturesConstant, true);
+
+  // the first frame draws with it. Depth only passes request their own
+  // permutation with kDepthVertexShader and kPositionStreamOnly
+  const std::array descs = {colorDesc};
+  pipelines_->WarmUp(descs);
+
+  pipelineHandle = pipelines_->Request(colorDesc);
+
+  if (!pipelines_->IsReady(pipelineHandle)) {
+    spdlog::error("Failed to create the scene pipeline");
+    throw std::runtime_error("Failed to create the scene pipeline");
+  }
 
   colorImages.reserve(Swapchain::getFramesInFlightCount());
 
@@ -41,7 +65,9 @@ RenderingStage::RenderingStage(EngineContext& engine, Swapchain& swapchain, Unif
   auto depthImageConfig = ImageConfig{};
   depthImageConfig.extent = extent;
   depthImageConfig.format = vk::Format::eD32Sfloat;
-  depthImageConfig.usage = vk::ImageUsageFlagBits::eDepthStencilAttachment;
+  // sampled while building the Hi-Z pyramid
+  depthImageConfig.usage = vk::ImageUsageFlagBits::eDepthStencilAttachment |
+                           vk::ImageUsageFlagBits::eSampled;
   depthImageConfig.samples = 4;
   depthImageConfig.mipLevels = 1;
 
@@ -59,6 +85,8 @@ RenderingStage::RenderingStage(EngineContext& engine, Swapchain& swapchain, Unif
     depthImages.emplace_back(engine, depthImageConfig);
     postprocessingImages.emplace_back(engine, postprocessingImageConfig);
   }
+
+  hizPyramid = std::make_unique<HiZPyramid>(engine, depthImages);
 }
 
 RenderingStage::~RenderingStage() {
@@ -68,20 +96,38 @@ RenderingStage::~RenderingStage() {
   spdlog::info("Destroying rendering stage");
 }
 
+void RenderingStage::BeginFrame() {
+  frameDescriptors->BeginFrame(swapchain_.CurrentFrameIndex());
+}
+
+void RenderingStage::AddComputePass(FramePoint point, ComputePass pass) {
+  computePasses[static_cast<size_t>(point)].push_back(std::move(pass));
+}
+
+void RenderingStage::RecordComputePasses(const vk::CommandBuffer buffer,
+                                         FramePoint point) const {
+  for (const auto& pass : computePasses[static_cast<size_t>(point)]) {
+    pass(buffer, swapchain_.CurrentFrameIndex());
+  }
+}
+
 void RenderingStage::begin(const vk::CommandBuffer buffer) {
   buffer.begin(vk::CommandBufferBeginInfo{
       vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
 }
 
-void RenderingStage::beginRenderingPass(const vk::CommandBuffer buffer) const {
+void RenderingStage::beginRenderingPass(const vk::CommandBuffer buffer,
+                                        bool clear) const {
 
   const auto curr = swapchain_.CurrentFrameIndex();
+  const auto loadOp =
+      clear ? vk::AttachmentLoadOp::eClear : vk::AttachmentLoadOp::eLoad;
 
   constexpr vk::ClearColorValue clearColor{0.0F, 0.0F, 0.0F, 0.0F};
 
   vk::RenderingAttachmentInfo renderingAttachmentInfo{};
   renderingAttachmentInfo.setClearValue(clearColor);
-  renderingAttachmentInfo.setLoadOp(vk::AttachmentLoadOp::eClear);
+  renderingAttachmentInfo.setLoadOp(loadOp);
   renderingAttachmentInfo.setStoreOp(vk::AttachmentStoreOp::eStore);
   renderingAttachmentInfo.setImageLayout(
       vk::ImageLayout::eColorAttachmentOptimal);
@@ -94,7 +140,7 @@ void RenderingStage::beginRenderingPass(const vk::CommandBuffer buffer) const {
 
   vk::RenderingAttachmentInfo depthAttachmentInfo{};
   depthAttachmentInfo.setImageView(depthImages[curr].GetImageView());
-  depthAttachmentInfo.setLoadOp(vk::AttachmentLoadOp::eClear);
+  depthAttachmentInfo.setLoadOp(loadOp);
   depthAttachmentInfo.setStoreOp(vk::AttachmentStoreOp::eStore);
   depthAttachmentInfo.setImageLayout(vk::ImageLayout::eDepthAttachmentOptimal);
   depthAttachmentInfo.setClearValue(clear_value);
@@ -119,34 +165,16 @@ void RenderingStage::end(const vk::CommandBuffer buffer) {
 }
 
 void RenderingStage::createDescriptorPool() {
-  constexpr auto descriptorCount = 1000;
-
-  constexpr std::array poolSizes = {
-      vk::DescriptorPoolSize{vk::DescriptorType::eSampler, descriptorCount},
-      vk::DescriptorPoolSize{vk::DescriptorType::eCombinedImageSampler,
-                             descriptorCount},
-      vk::DescriptorPoolSize{vk::DescriptorType::eSampledImage,
-                             descriptorCount},
-      vk::DescriptorPoolSize{vk::DescriptorType::eStorageImage,
-                             descriptorCount},
-      vk::DescriptorPoolSize{vk::DescriptorType::eUniformTexelBuffer,
-                             descriptorCount},
-      vk::DescriptorPoolSize{vk::DescriptorType::eStorageTexelBuffer,
-                             descriptorCount},
-      vk::DescriptorPoolSize{vk::DescriptorType::eUniformBuffer,
-                             descriptorCount},
-      vk::DescriptorPoolSize{vk::DescriptorType::eStorageBuffer,
-                             descriptorCount},
-      vk::DescriptorPoolSize{vk::DescriptorType::eUniformBufferDynamic,
-                             descriptorCount},
-      vk::DescriptorPoolSize{vk::DescriptorType::eStorageBufferDynamic,
-                             descriptorCount},
-      vk::DescriptorPoolSize{vk::DescriptorType::eInputAttachment,
-                             descriptorCount}};
+  // ImGui is the only user, a set for the font atlas and for each texture
+  // the debug window shows. Scene descriptors come from Uniforms
+  constexpr uint32_t descriptorCount = 16;
+
+  constexpr vk::DescriptorPoolSize poolSize{
+      vk::DescriptorType::eCombinedImageSampler, descriptorCount};
 
   const vk::DescriptorPoolCreateInfo poolInfo =
       vk::DescriptorPoolCreateInfo{}
-          .setPoolSizes(poolSizes)
+          .setPoolSizes(poolSize)
           .setMaxSets(descriptorCount)
           .setFlags(vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet);
 
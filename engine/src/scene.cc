@@ -4,50 +4,365 @@
 
 #include "braque/scene.h"
 
+#include "braque/camera.h"
 #include "braque/engine.h"
+#include "braque/frustum.h"
 #include "braque/texture.h"
 
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
 namespace braque {
-Scene::Scene(EngineContext& engine, Uniforms& uniforms)
+
+namespace {
+
+// streams are stored back to back in the vertex buffer
+constexpr vk::DeviceSize kStreamAlignment = 16;
+
+auto AlignStream(vk::DeviceSize size) -> vk::DeviceSize {
+  return (size + kStreamAlignment - 1) & ~(kStreamAlignment - 1);
+}
+
+}  // namespace
+
+Scene::Scene(EngineContext& engine, Uniforms& uniforms,
+             const HiZPyramid& pyramid, VertexLayout vertex_layout)
     : engine_(engine),
+      uniforms_(uniforms),
+      vertex_layout_(vertex_layout),
       vertex_buffer_(engine, BufferType::vertex, kVertexBufferSize),
-      index_buffer_(engine, BufferType::index, kVertexBufferSize),
+      index_buffer_(engine, BufferType::index, kIndexBufferSize),
       vertex_staging_buffer_(engine, BufferType::staging, kVertexBufferSize),
-      index_staging_buffer_(engine, BufferType::staging, kVertexBufferSize) {
+      index_staging_buffer_(engine, BufferType::staging, kIndexBufferSize),
+      materials_(Swapchain::getFramesInFlightCount()) {
 
-  // add a cube to vertex and index staging buffers
-  AddCube();
-  UploadSceneData();
+  CreateInstanceBuffers();
+  CreateDrawDataBuffers();
+  CreateMaterialBuffers();
+
+  indirect_pass_ = std::make_unique<IndirectDrawPass>(
+      engine, instance_buffers_, draw_data_buffers_, pyramid);
+
+  for (uint32_t i = 0; i < Swapchain::getFramesInFlightCount(); ++i) {
+    uniforms_.SetVisibleInstanceBuffer(i,
+                                       indirect_pass_->GetVisibleInstances(i));
+    cpu_visible_buffers_.emplace_back(engine, BufferType::storage,
+                                      kMaxInstances * sizeof(uint32_t));
+  }
 
   texture_ = new Texture(engine, "cobblestone", TextureType::eAlbedo, R"(../../../../assets/textures/brick_d.dds)");
   texture_->CreateImage(engine);
 
   CreateTextureSampler();
 
-  uniforms.SetTextureData(*texture_, texture_sampler_);
+  texture_index_ = uniforms.AddTexture(*texture_, texture_sampler_);
+
+  // the default material, instances refer to it unless given another
+  MaterialData material{};
+  material.albedo_texture = texture_index_;
+  AddMaterial(material);
+
+  // add a cube to vertex and index staging buffers
+  AddCube();
+  UploadSceneData();
 }
 
 Scene::~Scene() {
+  // the background rebuild writes into this scene
+  if (bvh_rebuild_.valid()) {
+    bvh_rebuild_.wait();
+  }
 
+  uniforms_.RemoveTexture(texture_index_);
   engine_.getRenderer().getDevice().destroySampler(texture_sampler_);
 
   delete texture_;
 }
 
-void Scene::Draw(vk::CommandBuffer buffer) {
+void Scene::Draw(vk::CommandBuffer buffer, vk::PipelineLayout layout,
+                 VertexStreams streams, CullPhase phase) {
+
+  if (gpu_driven_) {
+    BindVertexStreams(buffer, streams);
+    DrawIndirect(buffer, layout, phase);
+  } else if (phase == CullPhase::eVisibleLastFrame) {
+    DrawDirect(buffer, layout, streams);
+  }
+}
+
+void Scene::DrawDirect(vk::CommandBuffer buffer, vk::PipelineLayout layout,
+                       VertexStreams streams) {
+  DrawTranslator translator(buffer, layout, stream_offsets_, streams);
+  translator.Submit(draw_packets_);
+  submit_stats_ = translator.GetStats();
+}
+
+void Scene::BuildDrawPackets(const Camera& camera) {
+  draw_packets_.Clear();
+
+  for (const auto& batch : batches_) {
+    if (batch.instance_count == 0) {
+      continue;
+    }
+
+    const auto& mesh = meshes_[batch.mesh];
+    const auto& group = index_groups_[GetIndexGroup(mesh)];
+
+    // culled batches keep the survivors of each detail level after those
+    // of the previous level, unculled batches draw everything in full
+    std::array<uint32_t, kMaxMeshLods> lod_counts{batch.instance_count};
+    if (IsCpuCulling()) {
+      std::copy_n(batch_visible_counts_.begin() + batch.mesh * kMaxMeshLods,
+                  kMaxMeshLods, lod_counts.begin());
+    }
+
+    // the scene has one pipeline and its materials are per instance, so
+    // only the depth and the mesh order the draws. Without CPU culling the
+    // nearest instance is unknown and the mesh alone decides
+    const auto depth =
+        IsCpuCulling() ? QuantizeDepth(batch_depths_[batch.mesh],
+                                       camera.nearPlane_, camera.farPlane_)
+                       : 0U;
+    const auto key = MakeDrawKey(DrawPass::eOpaque, 0, 0, depth, batch.mesh);
+
+    DrawPacket packet{};
+    packet.vertex_buffer = vertex_buffer_.GetBuffer();
+    packet.index_buffer = index_buffer_.GetBuffer();
+    packet.index_buffer_offset = group.byte_offset;
+    packet.index_type = group.index_type;
+    // direct draws keep their draw data in the per mesh region
+    packet.draw_offset = kIndirectDrawDataCount + batch.mesh;
+    packet.vertex_offset = mesh.vertex_offset;
+    // the shader finds its instance data through gl_InstanceIndex which
+    // starts at first_instance
+    packet.first_instance = batch.first_instance;
+
+    for (uint32_t lod = 0; lod < mesh.lod_count; ++lod) {
+      if (lod_counts[lod] > 0) {
+        packet.index_count = mesh.lods[lod].index_count;
+        packet.first_index = mesh.lods[lod].index_offset;
+        packet.instance_count = lod_counts[lod];
+        draw_packets_.Add(key, packet);
+      }
+      packet.first_instance += lod_counts[lod];
+    }
+  }
+
+  draw_packets_.Sort(engine_.getJobSystem());
+}
+
+void Scene::DrawIndirect(vk::CommandBuffer buffer, vk::PipelineLayout layout,
+                         CullPhase phase) {
+  // one bucket per index type, each needs its own index buffer binding
+  for (uint32_t bucket = 0; bucket < index_groups_.size(); ++bucket) {
+    const auto& group = index_groups_[bucket];
+    if (group.meshes.empty()) {
+      continue;
+    }
+
+    index_buffer_.Bind(buffer, group.byte_offset, group.index_type);
+    indirect_pass_->Draw(buffer, current_frame_, bucket, layout, phase);
+  }
+}
+
+void Scene::PrepareDraws(vk::CommandBuffer buffer, const Camera& camera,
+                         uint32_t viewport_height) {
+  // the frame's descriptor set is idle after its fence, point it at the
+  // visible list that is about to be written
+  if (IsCpuCulling()) {
+    uniforms_.SetVisibleInstanceBuffer(current_frame_,
+                                       cpu_visible_buffers_[current_frame_]);
+    cull_view_.occlusion = false;
+    CullOnCpu(camera, viewport_height);
+    BuildDrawPackets(camera);
+    return;
+  }
+  uniforms_.SetVisibleInstanceBuffer(
+      current_frame_, indirect_pass_->GetVisibleInstances(current_frame_));
+
+  // direct draws without culling still read instances through the visible
+  // list, so the pass always runs and only culls when GPU driven
+  cull_view_.view_projection = camera.ProjectionMatrix() * camera.ViewMatrix();
+  cull_view_.frustum = gpu_driven_ && frustum_culling_;
+  cull_view_.occlusion = IsOcclusionActive();
+
+  // direct draws only read the first level of each batch
+  cull_view_.eye = camera.position_;
+  cull_view_.lod_scale =
+      ComputeLodScale(camera.fov_, static_cast<float>(viewport_height));
+  cull_view_.lod_threshold = gpu_driven_ ? lod_threshold_ : 0.0F;
+
+  if (!gpu_driven_) {
+    BuildDrawPackets(camera);
+  }
+
+  indirect_pass_->Dispatch(buffer, current_frame_, cull_view_,
+                           CullPhase::eVisibleLastFrame);
+}
+
+void Scene::CullOnCpu(const Camera& camera, uint32_t viewport_height) {
+  const auto view_projection = camera.ProjectionMatrix() * camera.ViewMatrix();
+  const auto frustum = ExtractFrustum(view_projection);
+
+  instance_visible_.resize(instance_bounds_.Size());
+  CullSpheres(engine_.getJobSystem(), frustum, instance_bounds_,
+              instance_visible_);
 
-  vertex_buffer_.Bind(buffer);
-  index_buffer_.Bind(buffer);
+  if (software_occlusion_) {
+    OccludeOnCpu(view_projection);
+  }
 
-  for (const auto& mesh : meshes_) {
-    // draw the mesh
-    buffer.drawIndexed(mesh.index_count, 1, mesh.index_offset,
-                       mesh.vertex_offset, 0);
+  const float lod_scale =
+      ComputeLodScale(camera.fov_, static_cast<float>(viewport_height));
+
+  // sort the survivors of each batch by detail level at the front of its
+  // range, a counting pass picks the levels and sizes them
+  auto* visible_list =
+      cpu_visible_buffers_[current_frame_].GetPointer<uint32_t>();
+  batch_visible_counts_.assign(batches_.size() * kMaxMeshLods, 0);
+  batch_depths_.assign(batches_.size(), camera.farPlane_);
+  instance_lods_.resize(instance_visible_.size());
+  cpu_stats_ = {};
+
+  for (const auto& batch : batches_) {
+    const auto& mesh = meshes_[batch.mesh];
+    std::array<float, kMaxMeshLods> errors{};
+    for (uint32_t lod = 0; lod < mesh.lod_count; ++lod) {
+      errors[lod] = mesh.lods[lod].error;
+    }
+
+    std::array<uint32_t, kMaxMeshLods> counts{};
+    for (uint32_t i = 0; i < batch.instance_count; ++i) {
+      const auto slot = batch.first_instance + i;
+      if (instance_visible_[slot] == 0) {
+        continue;
+      }
+
+      const auto sphere = instance_bounds_.Get(slot);
+      const float distance =
+          glm::length(glm::vec3(sphere) - camera.position_) - sphere.w;
+      batch_depths_[batch.mesh] = std::min(batch_depths_[batch.mesh], distance);
+
+      // errors are in object space, so is the distance they are judged at
+      const float scale = mesh.bounding_sphere.w > 0.0F
+                              ? sphere.w / mesh.bounding_sphere.w
+                              : 1.0F;
+      const auto lod = static_cast<uint8_t>(
+          SelectLod({errors.data(), mesh.lod_count}, distance / scale,
+                    lod_scale, lod_threshold_));
+      instance_lods_[slot] = lod;
+      counts[lod]++;
+    }
+
+    std::array<uint32_t, kMaxMeshLods> offsets{};
+    uint32_t count = 0;
+    for (uint32_t lod = 0; lod < kMaxMeshLods; ++lod) {
+      offsets[lod] = batch.first_instance + count;
+      count += counts[lod];
+      batch_visible_counts_[batch.mesh * kMaxMeshLods + lod] = counts[lod];
+    }
+
+    for (uint32_t i = 0; i < batch.instance_count; ++i) {
+      const auto slot = batch.first_instance + i;
+      if (instance_visible_[slot] != 0) {
+        visible_list[offsets[instance_lods_[slot]]++] = slot;
+      }
+    }
+
+    cpu_stats_.visible += count;
+    cpu_stats_.culled += batch.instance_count - count;
+  }
+
+  vmaFlushAllocation(engine_.getMemoryAllocator().getAllocator(),
+                     cpu_visible_buffers_[current_frame_].GetAllocation(), 0,
+                     VK_WHOLE_SIZE);
+}
+
+void Scene::OccludeOnCpu(const glm::mat4& view_projection) {
+  // only occluders that survived the frustum test can hide anything
+  occluders_.clear();
+  for (uint32_t slot = 0; slot < sorted_instances_.size(); ++slot) {
+    const auto& instance = sorted_instances_[slot];
+    if (instance_visible_[slot] != 0 &&
+        instance.mesh_index < occluder_meshes_.size() &&
+        !occluder_meshes_[instance.mesh_index].indices.empty()) {
+      occluders_.push_back(
+          {&occluder_meshes_[instance.mesh_index], instance.transform});
+    }
+  }
+
+  auto& jobs = engine_.getJobSystem();
+  occlusion_rasterizer_.Rasterize(jobs, view_projection, occluders_);
+  if (occluders_.empty()) {
+    return;
+  }
+
+  // the box around each bounding sphere stands in for the occludee
+  occludee_boxes_.resize(instance_bounds_.Size());
+  for (size_t slot = 0; slot < occludee_boxes_.size(); ++slot) {
+    const auto sphere = instance_bounds_.Get(slot);
+    occludee_boxes_[slot] = {glm::vec3(sphere) - sphere.w,
+                             glm::vec3(sphere) + sphere.w};
+  }
+
+  occlusion_rasterizer_.TestBoxes(jobs, occludee_boxes_, instance_visible_);
+}
+
+void Scene::PrepareOcclusionDraws(vk::CommandBuffer buffer) {
+  if (!cull_view_.occlusion) {
+    return;
+  }
+  indirect_pass_->Dispatch(buffer, current_frame_, cull_view_,
+                           CullPhase::eDisoccluded);
+}
+
+void Scene::BindVertexStreams(vk::CommandBuffer buffer,
+                              VertexStreams streams) const {
+  for (uint32_t i = 0; i < kVertexStreamCount; ++i) {
+    if ((streams & StreamBit(static_cast<VertexStream>(i))) != 0) {
+      buffer.bindVertexBuffers(i, vertex_buffer_.GetBuffer(),
+                               stream_offsets_[i]);
+    }
   }
 }
 
 void Scene::UploadSceneData() {
+  vk::DeviceSize vertex_data_size = 0;
+  for (size_t i = 0; i < kVertexStreamCount; ++i) {
+    stream_offsets_[i] = vertex_data_size;
+    vertex_data_size += AlignStream(vertex_streams_[i].size());
+  }
+
+  // 32-bit indices go first so both regions stay naturally aligned
+  const auto indices32_size = indices32_.size() * sizeof(uint32_t);
+  const auto indices16_size = indices16_.size() * sizeof(uint16_t);
+
+  if (vertex_data_size > kVertexBufferSize ||
+      indices32_size + indices16_size > kIndexBufferSize) {
+    spdlog::error("Scene geometry does not fit in the scene buffers");
+    throw std::runtime_error("Scene geometry does not fit in the scene buffers");
+  }
+
+  std::vector<std::byte> index_data(indices32_size + indices16_size);
+  std::memcpy(index_data.data(), indices32_.data(), indices32_size);
+  std::memcpy(index_data.data() + indices32_size, indices16_.data(),
+              indices16_size);
 
+  index_groups_[0].byte_offset = 0;
+  index_groups_[1].byte_offset = indices32_size;
+
+  std::vector<std::byte> vertex_data(vertex_data_size);
+  for (size_t i = 0; i < kVertexStreamCount; ++i) {
+    std::memcpy(vertex_data.data() + stream_offsets_[i],
+                vertex_streams_[i].data(), vertex_streams_[i].size());
+  }
+
+  vertex_staging_buffer_.CopyData(vertex_data.data(), vertex_data.size());
+  index_staging_buffer_.CopyData(index_data.data(), index_data.size());
 
   const auto graphicsQueue = engine_.getRenderer().getGraphicsQueue();
 
@@ -131,7 +446,7 @@ std::vector<Vertex> vertices = {
 };
 
 
-  std::vector<uint32_t> indices = {
+  const std::vector<uint32_t> indices = {
     // Front:   uses vertices [0..5]
     0, 1, 2,   2, 3, 0,
 
@@ -151,21 +466,488 @@ std::vector<Vertex> vertices = {
     30, 31, 32, 32, 33, 30
   };
 
-  // move data to staging buffer
-  vertex_staging_buffer_.CopyData(vertices.data(),
-                                  vertices.size() * sizeof(Vertex));
+  const auto cube = AddMesh("cube", vertices, indices);
+
+  // a solid box is its own best occluder
+  std::vector<glm::vec3> positions;
+  positions.reserve(vertices.size());
+  for (const auto& vertex : vertices) {
+    positions.push_back(vertex.position);
+  }
+  SetOccluder(cube, positions, indices);
+
+  AddInstance(cube, glm::mat4(1.0F));
+}
+
+auto Scene::AddMesh(const std::string& name, std::span<const Vertex> vertices,
+                    std::span<const uint32_t> indices) -> uint32_t {
+  if (meshes_.size() >= kMaxMeshes) {
+    spdlog::error("Too many meshes, limit is {}", kMaxMeshes);
+    throw std::runtime_error("Too many meshes");
+  }
+
+  const auto packed = PackVertices(vertices, vertex_layout_);
+
+  Mesh mesh;
+  mesh.vertex_offset = static_cast<int32_t>(vertex_count_);
+  mesh.position_scale = packed.position_scale;
+  mesh.position_offset = packed.position_offset;
+  mesh.bounding_sphere = ComputeBoundingSphere(vertices);
+
+  // every level indexes the same vertices, only the index ranges differ
+  std::vector<glm::vec3> positions;
+  positions.reserve(vertices.size());
+  for (const auto& vertex : vertices) {
+    positions.push_back(vertex.position);
+  }
+  const auto levels = BuildLodChain(
+      positions, indices, kLodMaxRelativeError * mesh.bounding_sphere.w);
+  mesh.lod_count = static_cast<uint32_t>(levels.size());
+
+  mesh.index_type = vertices.size() < kMaxUint16Vertices
+                        ? vk::IndexType::eUint16
+                        : vk::IndexType::eUint32;
+
+  // reject the mesh before any of it is added
+  const size_t index_size =
+      mesh.index_type == vk::IndexType::eUint16 ? sizeof(uint16_t)
+                                                : sizeof(uint32_t);
+  size_t index_bytes = indices32_.size() * sizeof(uint32_t) +
+                       indices16_.size() * sizeof(uint16_t);
+  for (const auto& level : levels) {
+    index_bytes += level.indices.size() * index_size;
+  }
+  if (index_bytes > kIndexBufferSize) {
+    spdlog::error("Indices of mesh {} exceed the {} byte index buffer", name,
+                  kIndexBufferSize);
+    throw std::runtime_error("Mesh indices do not fit in the index buffer");
+  }
+
+  vk::DeviceSize vertex_bytes = 0;
+  for (size_t i = 0; i < kVertexStreamCount; ++i) {
+    vertex_bytes +=
+        AlignStream(vertex_streams_[i].size() + packed.streams[i].size());
+  }
+  if (vertex_bytes > kVertexBufferSize) {
+    spdlog::error("Vertices of mesh {} exceed the {} byte vertex buffer",
+                  name, kVertexBufferSize);
+    throw std::runtime_error("Mesh vertices do not fit in the vertex buffer");
+  }
+
+  for (size_t i = 0; i < kVertexStreamCount; ++i) {
+    vertex_streams_[i].insert(vertex_streams_[i].end(),
+                              packed.streams[i].begin(),
+                              packed.streams[i].end());
+  }
+  vertex_count_ += static_cast<uint32_t>(vertices.size());
+
+  for (uint32_t lod = 0; lod < mesh.lod_count; ++lod) {
+    const auto& level = levels[lod];
+    auto& range = mesh.lods[lod];
+    range.index_count = static_cast<uint32_t>(level.indices.size());
+    range.error = level.error;
+
+    if (mesh.index_type == vk::IndexType::eUint16) {
+      range.index_offset = static_cast<uint32_t>(indices16_.size());
+      for (const auto index : level.indices) {
+        indices16_.push_back(static_cast<uint16_t>(index));
+      }
+    } else {
+      range.index_offset = static_cast<uint32_t>(indices32_.size());
+      indices32_.insert(indices32_.end(), level.indices.begin(),
+                        level.indices.end());
+    }
+  }
+
+  const auto mesh_index = static_cast<uint32_t>(meshes_.size());
+  auto& group = mesh.index_type == vk::IndexType::eUint32 ? index_groups_[0]
+                                                          : index_groups_[1];
+  group.meshes.push_back(mesh_index);
+
+  spdlog::info("Added mesh {} with {} vertices, {}-bit indices and {} levels",
+               name, vertices.size(),
+               mesh.index_type == vk::IndexType::eUint16 ? 16 : 32,
+               mesh.lod_count);
+
+  meshes_.push_back(mesh);
+  mesh_names_.push_back(name);
+  draw_frames_dirty_ = Swapchain::getFramesInFlightCount();
+  return mesh_index;
+}
+
+auto Scene::AddInstance(uint32_t mesh, const glm::mat4& transform,
+                        uint32_t material_index) -> uint32_t {
+  if (mesh >= meshes_.size()) {
+    spdlog::error("Instance refers to unknown mesh {}", mesh);
+    throw std::out_of_range("Instance refers to unknown mesh");
+  }
+
+  CheckMaterial(material_index);
+
+  if (instances_.size() >= kMaxInstances) {
+    spdlog::error("Too many instances, limit is {}", kMaxInstances);
+    throw std::runtime_error("Too many instances");
+  }
+
+  InstanceData instance{};
+  instance.transform = transform;
+  instance.material_index = material_index;
+  instance.mesh_index = mesh;
+
+  instances_.push_back(instance);
+  batches_dirty_ = true;
+  instance_frames_dirty_ = Swapchain::getFramesInFlightCount();
+
+  return static_cast<uint32_t>(instances_.size() - 1);
+}
+
+void Scene::SetInstanceMaterial(uint32_t instance, uint32_t material_index) {
+  CheckInstance(instance);
+  CheckMaterial(material_index);
 
-  index_staging_buffer_.CopyData(indices.data(),
-                                 indices.size() * sizeof(uint32_t));
+  instances_[instance].material_index = material_index;
 
-  // create the cube
-  Mesh cube;
-  cube.name = "cube";
-  cube.vertex_offset = 0;
-  cube.index_offset = 0;
-  cube.index_count = 36;
+  if (!batches_dirty_) {
+    sorted_instances_[instance_slots_[instance]].material_index =
+        material_index;
+  }
+
+  instance_frames_dirty_ = Swapchain::getFramesInFlightCount();
+}
+
+auto Scene::AddMaterial(const MaterialData& material) -> uint32_t {
+  return materials_.Add(material);
+}
+
+void Scene::SetMaterial(uint32_t material_index,
+                        const MaterialData& material) {
+  materials_.Set(material_index, material);
+}
+
+void Scene::SetTransform(uint32_t instance, const glm::mat4& transform) {
+  CheckInstance(instance);
+
+  instances_[instance].transform = transform;
+
+  // patch the sorted copy in place unless it is about to be rebuilt
+  if (!batches_dirty_) {
+    const auto slot = instance_slots_[instance];
+    sorted_instances_[slot].transform = transform;
+    UpdateBounds(slot);
+    bvh_moved_.push_back(instance);
+  }
+
+  instance_frames_dirty_ = Swapchain::getFramesInFlightCount();
+}
+
+void Scene::CheckInstance(uint32_t instance) const {
+  if (instance >= instances_.size()) {
+    spdlog::error("Unknown instance {}, the scene has {}", instance,
+                  instances_.size());
+    throw std::out_of_range("Unknown instance");
+  }
+}
+
+// triangle.frag indexes the material buffer with it unchecked
+void Scene::CheckMaterial(uint32_t material_index) const {
+  if (material_index >= materials_.Size()) {
+    spdlog::error("Unknown material {}, the scene has {}", material_index,
+                  materials_.Size());
+    throw std::out_of_range("Unknown material");
+  }
+}
+
+void Scene::SetOccluder(uint32_t mesh, std::span<const glm::vec3> positions,
+                        std::span<const uint32_t> indices) {
+  if (mesh >= meshes_.size()) {
+    spdlog::error("Occluder refers to unknown mesh {}", mesh);
+    throw std::runtime_error("Occluder refers to unknown mesh");
+  }
+
+  if (occluder_meshes_.size() < meshes_.size()) {
+    occluder_meshes_.resize(meshes_.size());
+  }
+
+  auto& occluder = occluder_meshes_[mesh];
+  occluder.positions.assign(positions.begin(), positions.end());
+  occluder.indices.assign(indices.begin(), indices.end());
+}
+
+auto Scene::ComputeBoundingSphere(std::span<const Vertex> vertices)
+    -> glm::vec4 {
+  if (vertices.empty()) {
+    return glm::vec4(0.0F);
+  }
+
+  // centered on the bounding box, not minimal but cheap and stable
+  auto min = vertices.front().position;
+  auto max = vertices.front().position;
+  for (const auto& vertex : vertices) {
+    min = glm::min(min, vertex.position);
+    max = glm::max(max, vertex.position);
+  }
+
+  const auto center = (min + max) * 0.5F;
+  float radius = 0.0F;
+  for (const auto& vertex : vertices) {
+    radius = std::max(radius, glm::length(vertex.position - center));
+  }
+
+  return {center, radius};
+}
+
+void Scene::UpdateBounds(uint32_t slot) {
+  const auto& instance = sorted_instances_[slot];
+  const auto sphere = meshes_[instance.mesh_index].bounding_sphere;
+
+  // the largest axis scale keeps the sphere conservative, matches
+  // cull_instances.comp
+  const auto& transform = instance.transform;
+  const float scale = std::max({glm::length(glm::vec3(transform[0])),
+                                glm::length(glm::vec3(transform[1])),
+                                glm::length(glm::vec3(transform[2]))});
+
+  instance_bounds_.Set(slot,
+                       glm::vec3(transform * glm::vec4(glm::vec3(sphere), 1.0F)),
+                       sphere.w * scale);
+}
+
+void Scene::RebuildBatches() {
+  // counting sort of the instances by mesh
+  batches_.assign(meshes_.size(), DrawBatch{});
+
+  for (const auto& instance : instances_) {
+    batches_[instance.mesh_index].instance_count++;
+  }
+
+  uint32_t first_instance = 0;
+  for (uint32_t mesh = 0; mesh < batches_.size(); ++mesh) {
+    batches_[mesh].mesh = mesh;
+    batches_[mesh].first_instance = first_instance;
+    first_instance += batches_[mesh].instance_count;
+    batches_[mesh].instance_count = 0;
+  }
 
-  meshes_.push_back(cube);
+  sorted_instances_.resize(instances_.size());
+  instance_slots_.resize(instances_.size());
+
+  for (uint32_t id = 0; id < instances_.size(); ++id) {
+    auto& batch = batches_[instances_[id].mesh_index];
+    const auto slot = batch.first_instance + batch.instance_count++;
+    sorted_instances_[slot] = instances_[id];
+    instance_slots_[id] = slot;
+  }
+
+  instance_bounds_.Resize(sorted_instances_.size());
+  for (uint32_t slot = 0; slot < sorted_instances_.size(); ++slot) {
+    UpdateBounds(slot);
+  }
+
+  // one draw record per detail level of each non empty batch, bucketed by
+  // index type. Every level owns a copy of the batch range in the visible
+  // list so the culling shader can append to any of them
+  draw_records_.clear();
+  std::array<uint32_t, kMaxDrawBuckets> bucket_sizes{};
+  const auto instance_total = static_cast<uint32_t>(sorted_instances_.size());
+
+  for (const auto& batch : batches_) {
+    if (batch.instance_count == 0) {
+      continue;
+    }
+
+    const auto& mesh = meshes_[batch.mesh];
+
+    // the culling shader finds the first level of an instance through this
+    const auto draw_index = static_cast<uint32_t>(draw_records_.size());
+    for (uint32_t i = 0; i < batch.instance_count; ++i) {
+      sorted_instances_[batch.first_instance + i].draw_index = draw_index;
+    }
+
+    for (uint32_t lod = 0; lod < mesh.lod_count; ++lod) {
+      DrawRecord record{};
+      record.index_count = mesh.lods[lod].index_count;
+      record.first_index = mesh.lods[lod].index_offset;
+      record.vertex_offset = mesh.vertex_offset;
+      record.first_instance = batch.first_instance + lod * instance_total;
+      record.instance_count = batch.instance_count;
+      record.bucket = GetIndexGroup(mesh);
+      record.slot = bucket_sizes[record.bucket]++;
+      record.lod_count = mesh.lod_count;
+      record.bounding_sphere = mesh.bounding_sphere;
+      record.draw_data.position_scale = glm::vec4(mesh.position_scale, 0.0F);
+      record.draw_data.position_offset =
+          glm::vec4(mesh.position_offset, 0.0F);
+      record.lod_error = mesh.lods[lod].error;
+
+      if (record.slot >= kMaxDrawsPerBucket) {
+        spdlog::error("Too many draws in bucket {}", record.bucket);
+        throw std::runtime_error("Too many draws in bucket");
+      }
+
+      draw_records_.push_back(record);
+    }
+  }
+
+  batches_dirty_ = false;
+  draw_frames_dirty_ = Swapchain::getFramesInFlightCount();
+}
+
+void Scene::Update(uint32_t frame_index) {
+  current_frame_ = frame_index;
+
+  // the fence of this frame has been waited on, its counters are final
+  indirect_pass_->ReadStats(frame_index);
+
+  if (batches_dirty_) {
+    RebuildBatches();
+  }
+
+  if (draw_frames_dirty_ > 0) {
+    UpdateDrawData(frame_index);
+    draw_frames_dirty_--;
+  }
+
+  // each frame in flight owns a copy, so a change is written once per copy
+  if (instance_frames_dirty_ > 0 && !sorted_instances_.empty()) {
+    instance_buffers_[frame_index].CopyData(
+        sorted_instances_.data(),
+        sorted_instances_.size() * sizeof(InstanceData));
+    instance_frames_dirty_--;
+  }
+
+  UpdateMaterials(frame_index);
+
+  UpdateSpatialIndex();
+}
+
+auto Scene::GetInstanceBox(uint32_t instance) const -> Aabb {
+  const auto sphere = instance_bounds_.Get(instance_slots_[instance]);
+  const auto center = glm::vec3(sphere);
+  return {center - glm::vec3(sphere.w), center + glm::vec3(sphere.w)};
+}
+
+void Scene::UpdateSpatialIndex() {
+  // swap in a finished background rebuild, instances may have moved since
+  // its snapshot so every box is refreshed
+  if (bvh_rebuild_.valid() &&
+      bvh_rebuild_.wait_for(std::chrono::seconds(0)) ==
+          std::future_status::ready) {
+    bvh_rebuild_.get();
+    if (pending_bvh_.GetObjectCount() == instances_.size()) {
+      std::swap(bvh_, pending_bvh_);
+      bvh_build_cost_ = bvh_.GetCost();
+      for (uint32_t id = 0; id < instances_.size(); ++id) {
+        bvh_.Update(id, GetInstanceBox(id));
+      }
+      bvh_.Refit();
+      bvh_moved_.clear();
+    }
+  }
+
+  if (bvh_.GetObjectCount() != instances_.size()) {
+    // instances were added, build synchronously so queries see them
+    if (bvh_rebuild_.valid()) {
+      bvh_rebuild_.get();
+    }
+
+    std::vector<Aabb> boxes(instances_.size());
+    for (uint32_t id = 0; id < instances_.size(); ++id) {
+      boxes[id] = GetInstanceBox(id);
+    }
+    bvh_.Build(boxes);
+    bvh_build_cost_ = bvh_.GetCost();
+    bvh_moved_.clear();
+    return;
+  }
+
+  if (bvh_moved_.empty()) {
+    return;
+  }
+
+  for (const auto id : bvh_moved_) {
+    bvh_.Update(id, GetInstanceBox(id));
+  }
+  bvh_moved_.clear();
+  bvh_.Refit();
+
+  if (!bvh_rebuild_.valid() &&
+      bvh_.GetCost() > bvh_build_cost_ * kBvhRebuildCostRatio) {
+    pending_bvh_boxes_.resize(instances_.size());
+    for (uint32_t id = 0; id < instances_.size(); ++id) {
+      pending_bvh_boxes_[id] = GetInstanceBox(id);
+    }
+    bvh_rebuild_ = engine_.getJobSystem().Async(
+        [this] { pending_bvh_.Build(pending_bvh_boxes_); });
+  }
+}
+
+void Scene::QueryInstances(const Frustum& frustum,
+                           std::vector<uint32_t>& instances) const {
+  bvh_.QueryFrustum(frustum, instances);
+}
+
+void Scene::QueryInstances(const Aabb& box,
+                           std::vector<uint32_t>& instances) const {
+  bvh_.QueryAabb(box, instances);
+}
+
+auto Scene::PickInstance(const Ray& ray) const -> RayHit {
+  return bvh_.Raycast(ray);
+}
+
+void Scene::UpdateDrawData(uint32_t frame_index) {
+  indirect_pass_->SetRecords(frame_index, draw_records_,
+                             static_cast<uint32_t>(sorted_instances_.size()));
+
+  // direct draws index the per mesh region with their mesh index
+  std::vector<DrawData> mesh_draw_data(meshes_.size());
+  for (size_t i = 0; i < meshes_.size(); ++i) {
+    mesh_draw_data[i].position_scale =
+        glm::vec4(meshes_[i].position_scale, 0.0F);
+    mesh_draw_data[i].position_offset =
+        glm::vec4(meshes_[i].position_offset, 0.0F);
+  }
+
+  if (!mesh_draw_data.empty()) {
+    draw_data_buffers_[frame_index].CopyData(
+        mesh_draw_data.data(), mesh_draw_data.size() * sizeof(DrawData),
+        kIndirectDrawDataCount * sizeof(DrawData));
+  }
+}
+
+void Scene::CreateDrawDataBuffers() {
+  for (uint32_t i = 0; i < Swapchain::getFramesInFlightCount(); ++i) {
+    draw_data_buffers_.emplace_back(
+        engine_, BufferType::storage,
+        (kIndirectDrawDataCount + kMaxMeshes) * sizeof(DrawData));
+    uniforms_.SetDrawDataBuffer(i, draw_data_buffers_.back());
+  }
+}
+
+void Scene::CreateMaterialBuffers() {
+  for (uint32_t i = 0; i < Swapchain::getFramesInFlightCount(); ++i) {
+    material_buffers_.emplace_back(engine_, BufferType::storage,
+                                   kMaxMaterials * sizeof(MaterialData));
+    uniforms_.SetMaterialBuffer(i, material_buffers_.back());
+  }
+}
+
+void Scene::UpdateMaterials(uint32_t frame_index) {
+  // only the entries this frame's copy has not seen yet
+  for (const auto& range : materials_.TakeDirtyRanges(frame_index)) {
+    material_buffers_[frame_index].CopyData(
+        materials_.GetData() + range.first,
+        range.count * sizeof(MaterialData),
+        range.first * sizeof(MaterialData));
+  }
+}
+
+void Scene::CreateInstanceBuffers() {
+  for (uint32_t i = 0; i < Swapchain::getFramesInFlightCount(); ++i) {
+    instance_buffers_.emplace_back(engine_, BufferType::storage,
+                                   kMaxInstances * sizeof(InstanceData));
+    uniforms_.SetInstanceBuffer(i, instance_buffers_.back());
+  }
 }
 
 void Scene::CreateTextureSampler() {
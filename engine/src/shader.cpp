@@ -3,6 +3,12 @@
 //
 #include "braque/shader.h"
 
+#ifdef BRAQUE_EMBED_SHADERS
+#include "braque/embedded_shaders.h"
+#endif
+
+#include <cstring>
+#include <filesystem>
 #include <fstream>
 #include <spdlog/spdlog.h>
 
@@ -10,13 +16,14 @@ namespace braque
 {
 
   // read file helper function
-  std::vector<char> ReadFile( const std::string & filename )
+  auto ReadFile( const std::string & filename ) -> std::vector<char>
   {
     // Open the file in binary mode
     std::ifstream file( filename, std::ios::ate | std::ios::binary );
 
     if ( !file.is_open() )
     {
+      spdlog::error( "Failed to open file {}", filename );
       throw std::runtime_error( "Failed to open file!" );
     }
 
@@ -34,11 +41,51 @@ namespace braque
     return buffer;
   }
 
-  Shader::Shader( vk::Device device, const std::string & vertexShaderFilename, const std::string & fragShaderFilename ) : device( device )
+  auto LoadShaderCode( const std::string & filename ) -> std::vector<char>
+  {
+#ifdef BRAQUE_EMBED_SHADERS
+    const auto name     = std::filesystem::path( filename ).filename().string();
+    const auto embedded = FindEmbeddedShader( name );
+    if ( !embedded.empty() )
+    {
+      std::vector<char> code( embedded.size_bytes() );
+      std::memcpy( code.data(), embedded.data(), embedded.size_bytes() );
+      return code;
+    }
+    spdlog::warn( "Shader {} is not embedded, reading it from disk", name );
+#endif
+    return ReadFile( filename );
+  }
+
+  auto ReflectShader( const std::vector<char> & code ) -> ShaderReflection
+  {
+    return ReflectShader( std::span( reinterpret_cast<const uint32_t *>( code.data() ), code.size() / sizeof( uint32_t ) ) );
+  }
+
+  auto ReflectShaderFile( const std::string & filename ) -> ShaderReflection
+  {
+    return ReflectShader( LoadShaderCode( filename ) );
+  }
+
+  Shader::Shader( vk::Device device, const std::string & vertexShaderFilename, const std::string & fragShaderFilename, const SpecializationConstants & constants )
+    : device( device ), constants( constants ), specializationInfo( this->constants.GetInfo() )
   {
     // Load the shader code from the file
-    vertexModule   = createShaderModule( ReadFile( vertexShaderFilename) );
-    fragmentModule = createShaderModule( ReadFile( fragShaderFilename ) );
+    const auto vertexCode   = LoadShaderCode( vertexShaderFilename );
+    const auto fragmentCode = LoadShaderCode( fragShaderFilename );
+
+    vertexModule   = createShaderModule( vertexCode );
+    fragmentModule = createShaderModule( fragmentCode );
+    reflection     = MergeReflections( ReflectShader( vertexCode ), ReflectShader( fragmentCode ) );
+  }
+
+  Shader::Shader( vk::Device device, const std::string & vertexShaderFilename, const SpecializationConstants & constants )
+    : device( device ), constants( constants ), specializationInfo( this->constants.GetInfo() )
+  {
+    const auto vertexCode = LoadShaderCode( vertexShaderFilename );
+
+    vertexModule = createShaderModule( vertexCode );
+    reflection   = ReflectShader( vertexCode );
   }
 
   Shader::~Shader()
@@ -68,15 +115,65 @@ namespace braque
     vertexShaderStageInfo.setStage( vk::ShaderStageFlagBits::eVertex );
     vertexShaderStageInfo.setModule( vertexModule );
     vertexShaderStageInfo.pName = "main";
+    if ( !constants.IsEmpty() )
+    {
+      vertexShaderStageInfo.setPSpecializationInfo( &specializationInfo );
+    }
     shaderStages.push_back( vertexShaderStageInfo );
 
+    if ( !fragmentModule )
+    {
+      return shaderStages;
+    }
+
     vk::PipelineShaderStageCreateInfo fragShaderStageInfo;
     fragShaderStageInfo.setStage( vk::ShaderStageFlagBits::eFragment );
     fragShaderStageInfo.setModule( fragmentModule );
     fragShaderStageInfo.pName = "main";
+    if ( !constants.IsEmpty() )
+    {
+      fragShaderStageInfo.setPSpecializationInfo( &specializationInfo );
+    }
     shaderStages.push_back( fragShaderStageInfo );
 
     return shaderStages;
   }
 
+  ComputeShader::ComputeShader( vk::Device device, const std::string & filename, const SpecializationConstants & constants )
+    : device( device ), constants( constants ), specializationInfo( this->constants.GetInfo() )
+  {
+    const auto code = LoadShaderCode( filename );
+
+    reflection = ReflectShader( code );
+    if ( reflection.stages != vk::ShaderStageFlagBits::eCompute )
+    {
+      spdlog::error( "Shader {} is not a compute shader", filename );
+      throw std::runtime_error( "Not a compute shader" );
+    }
+
+    vk::ShaderModuleCreateInfo createInfo{};
+    createInfo.setCodeSize( code.size() );
+    createInfo.setPCode( reinterpret_cast<const uint32_t *>( code.data() ) );
+
+    module = device.createShaderModule( createInfo );
+  }
+
+  ComputeShader::~ComputeShader()
+  {
+    device.destroyShaderModule( module );
+  }
+
+  auto ComputeShader::GetStageCreateInfo() const -> vk::PipelineShaderStageCreateInfo
+  {
+    vk::PipelineShaderStageCreateInfo stageInfo;
+    stageInfo.setStage( vk::ShaderStageFlagBits::eCompute );
+    stageInfo.setModule( module );
+    stageInfo.pName = "main";
+    if ( !constants.IsEmpty() )
+    {
+      stageInfo.setPSpecializationInfo( &specializationInfo );
+    }
+    return stageInfo;
+  }
+
 }  // namespace braque
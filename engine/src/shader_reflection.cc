@@ -0,0 +1,537 @@
+#include "braque/shader_reflection.h"
+
+#include <algorithm>
+#include <array>
+#include <iterator>
+#include <optional>
+#include <stdexcept>
+#include <tuple>
+#include <unordered_map>
+
+#include <spdlog/spdlog.h>
+
+namespace braque {
+
+namespace {
+
+// values from the SPIR-V specification
+constexpr uint32_t kSpirvMagic = 0x07230203;
+constexpr uint32_t kHeaderWords = 5;
+
+constexpr uint32_t kOpEntryPoint = 15;
+constexpr uint32_t kOpExecutionMode = 16;
+constexpr uint32_t kOpTypeInt = 21;
+constexpr uint32_t kOpTypeFloat = 22;
+constexpr uint32_t kOpTypeVector = 23;
+constexpr uint32_t kOpTypeMatrix = 24;
+constexpr uint32_t kOpTypeImage = 25;
+constexpr uint32_t kOpTypeSampler = 26;
+constexpr uint32_t kOpTypeSampledImage = 27;
+constexpr uint32_t kOpTypeArray = 28;
+constexpr uint32_t kOpTypeRuntimeArray = 29;
+constexpr uint32_t kOpTypeStruct = 30;
+constexpr uint32_t kOpTypePointer = 32;
+constexpr uint32_t kOpConstant = 43;
+constexpr uint32_t kOpVariable = 59;
+constexpr uint32_t kOpDecorate = 71;
+constexpr uint32_t kOpMemberDecorate = 72;
+
+constexpr uint32_t kExecutionModeLocalSize = 17;
+
+constexpr uint32_t kDecorationBufferBlock = 3;
+constexpr uint32_t kDecorationArrayStride = 6;
+constexpr uint32_t kDecorationMatrixStride = 7;
+constexpr uint32_t kDecorationBuiltIn = 11;
+constexpr uint32_t kDecorationLocation = 30;
+constexpr uint32_t kDecorationBinding = 33;
+constexpr uint32_t kDecorationDescriptorSet = 34;
+constexpr uint32_t kDecorationOffset = 35;
+
+constexpr uint32_t kStorageUniformConstant = 0;
+constexpr uint32_t kStorageInput = 1;
+constexpr uint32_t kStorageUniform = 2;
+constexpr uint32_t kStoragePushConstant = 9;
+constexpr uint32_t kStorageStorageBuffer = 12;
+
+constexpr uint32_t kDimBuffer = 5;
+constexpr uint32_t kDimSubpassData = 6;
+constexpr uint32_t kImageStorage = 2;
+
+constexpr uint32_t kNone = UINT32_MAX;
+
+struct Member {
+  uint32_t offset = 0;
+  uint32_t matrix_stride = 0;
+};
+
+// a result id with the decorations the reflection cares about
+struct Id {
+  std::span<const uint32_t> instruction;
+  uint32_t set = kNone;
+  uint32_t binding = kNone;
+  uint32_t location = kNone;
+  uint32_t array_stride = 0;
+  bool buffer_block = false;
+  bool builtin = false;
+  std::vector<Member> members;
+
+  [[nodiscard]] auto Opcode() const -> uint32_t {
+    return instruction.empty() ? 0 : instruction[0] & 0xFFFF;
+  }
+  [[nodiscard]] auto Operand(size_t i) const -> uint32_t {
+    return i < instruction.size() ? instruction[i] : 0;
+  }
+};
+
+class Module {
+ public:
+  explicit Module(std::span<const uint32_t> code) {
+    if (code.size() < kHeaderWords || code[0] != kSpirvMagic) {
+      Fail("not a SPIR-V module");
+    }
+
+    for (size_t offset = kHeaderWords; offset < code.size();) {
+      const uint32_t word_count = code[offset] >> 16;
+      if (word_count == 0 || offset + word_count > code.size()) {
+        Fail("truncated instruction");
+      }
+      Parse(code.subspan(offset, word_count));
+      offset += word_count;
+    }
+  }
+
+  [[nodiscard]] auto GetStage() const -> vk::ShaderStageFlags {
+    return stage_;
+  }
+  [[nodiscard]] auto GetVariables() const -> const std::vector<uint32_t>& {
+    return variables_;
+  }
+  [[nodiscard]] auto GetLocalSize() const -> std::array<uint32_t, 3> {
+    return local_size_;
+  }
+
+  [[nodiscard]] auto Get(uint32_t id) const -> const Id& {
+    const auto found = ids_.find(id);
+    if (found == ids_.end()) {
+      Fail("undefined id");
+    }
+    return found->second;
+  }
+
+  // size of a type as laid out in a block, only what push constant blocks
+  // can hold
+  [[nodiscard]] auto SizeOf(const Id& type, uint32_t matrix_stride = 0) const
+      -> uint32_t {
+    switch (type.Opcode()) {
+      case kOpTypeInt:
+      case kOpTypeFloat:
+        return type.Operand(2) / 8;
+      case kOpTypeVector:
+        return type.Operand(3) * SizeOf(Get(type.Operand(2)));
+      case kOpTypeMatrix:
+        return type.Operand(3) * (matrix_stride != 0
+                                      ? matrix_stride
+                                      : SizeOf(Get(type.Operand(2))));
+      case kOpTypeArray: {
+        const auto& element = Get(type.Operand(2));
+        const auto stride =
+            type.array_stride != 0 ? type.array_stride : SizeOf(element);
+        return ArrayLength(type) * stride;
+      }
+      case kOpTypeStruct: {
+        uint32_t size = 0;
+        for (size_t i = 0; i + 2 < type.instruction.size(); ++i) {
+          const auto member =
+              i < type.members.size() ? type.members[i] : Member{};
+          size = std::max(size, member.offset +
+                                    SizeOf(Get(type.Operand(i + 2)),
+                                           member.matrix_stride));
+        }
+        return size;
+      }
+      default:
+        return 0;
+    }
+  }
+
+  [[nodiscard]] auto ArrayLength(const Id& array) const -> uint32_t {
+    return Get(array.Operand(3)).Operand(3);
+  }
+
+  [[noreturn]] static void Fail(const char* reason) {
+    spdlog::error("Failed to reflect shader: {}", reason);
+    throw std::runtime_error("Failed to reflect shader");
+  }
+
+ private:
+  std::unordered_map<uint32_t, Id> ids_;
+  std::vector<uint32_t> variables_;
+  vk::ShaderStageFlags stage_;
+  uint32_t entry_point_ = kNone;
+  std::array<uint32_t, 3> local_size_{};
+
+  void Parse(std::span<const uint32_t> instruction) {
+    const uint32_t opcode = instruction[0] & 0xFFFF;
+    const auto operand = [&](size_t i) {
+      if (i >= instruction.size()) {
+        Fail("missing operand");
+      }
+      return instruction[i];
+    };
+
+    switch (opcode) {
+      case kOpEntryPoint:
+        // later entry points are ignored
+        if (!stage_) {
+          stage_ = StageOf(operand(1));
+          entry_point_ = operand(2);
+        }
+        break;
+      case kOpExecutionMode:
+        // sizes given by specialization constants stay zero
+        if (operand(1) == entry_point_ &&
+            operand(2) == kExecutionModeLocalSize) {
+          local_size_ = {operand(3), operand(4), operand(5)};
+        }
+        break;
+      case kOpTypeInt:
+      case kOpTypeFloat:
+      case kOpTypeVector:
+      case kOpTypeMatrix:
+      case kOpTypeImage:
+      case kOpTypeSampler:
+      case kOpTypeSampledImage:
+      case kOpTypeArray:
+      case kOpTypeRuntimeArray:
+      case kOpTypeStruct:
+      case kOpTypePointer:
+        ids_[operand(1)].instruction = instruction;
+        break;
+      case kOpConstant:
+        ids_[operand(2)].instruction = instruction;
+        break;
+      case kOpVariable:
+        ids_[operand(2)].instruction = instruction;
+        variables_.push_back(operand(2));
+        break;
+      case kOpDecorate:
+        Decorate(ids_[operand(1)], operand(2), instruction.size() > 3
+                                                   ? instruction[3]
+                                                   : 0);
+        break;
+      case kOpMemberDecorate: {
+        auto& members = ids_[operand(1)].members;
+        const auto index = operand(2);
+        if (members.size() <= index) {
+          members.resize(index + 1);
+        }
+        if (operand(3) == kDecorationOffset) {
+          members[index].offset = operand(4);
+        } else if (operand(3) == kDecorationMatrixStride) {
+          members[index].matrix_stride = operand(4);
+        }
+        break;
+      }
+      default:
+        break;
+    }
+  }
+
+  static void Decorate(Id& id, uint32_t decoration, uint32_t value) {
+    switch (decoration) {
+      case kDecorationBufferBlock:
+        id.buffer_block = true;
+        break;
+      case kDecorationArrayStride:
+        id.array_stride = value;
+        break;
+      case kDecorationBuiltIn:
+        id.builtin = true;
+        break;
+      case kDecorationLocation:
+        id.location = value;
+        break;
+      case kDecorationBinding:
+        id.binding = value;
+        break;
+      case kDecorationDescriptorSet:
+        id.set = value;
+        break;
+      default:
+        break;
+    }
+  }
+
+  static auto StageOf(uint32_t execution_model) -> vk::ShaderStageFlags {
+    switch (execution_model) {
+      case 0:
+        return vk::ShaderStageFlagBits::eVertex;
+      case 1:
+        return vk::ShaderStageFlagBits::eTessellationControl;
+      case 2:
+        return vk::ShaderStageFlagBits::eTessellationEvaluation;
+      case 3:
+        return vk::ShaderStageFlagBits::eGeometry;
+      case 4:
+        return vk::ShaderStageFlagBits::eFragment;
+      case 5:
+        return vk::ShaderStageFlagBits::eCompute;
+      default:
+        Fail("unsupported execution model");
+    }
+  }
+};
+
+auto DescriptorTypeOf(const Id& type, uint32_t storage)
+    -> std::optional<vk::DescriptorType> {
+  switch (storage) {
+    case kStorageUniform:
+      // older modules mark storage buffers as uniform buffer blocks
+      return type.buffer_block ? vk::DescriptorType::eStorageBuffer
+                               : vk::DescriptorType::eUniformBuffer;
+    case kStorageStorageBuffer:
+      return vk::DescriptorType::eStorageBuffer;
+    case kStorageUniformConstant:
+      break;
+    default:
+      return std::nullopt;
+  }
+
+  switch (type.Opcode()) {
+    case kOpTypeSampledImage:
+      return vk::DescriptorType::eCombinedImageSampler;
+    case kOpTypeSampler:
+      return vk::DescriptorType::eSampler;
+    case kOpTypeImage: {
+      const bool storage_image = type.Operand(7) == kImageStorage;
+      switch (type.Operand(3)) {
+        case kDimBuffer:
+          return storage_image ? vk::DescriptorType::eStorageTexelBuffer
+                               : vk::DescriptorType::eUniformTexelBuffer;
+        case kDimSubpassData:
+          return vk::DescriptorType::eInputAttachment;
+        default:
+          return storage_image ? vk::DescriptorType::eStorageImage
+                               : vk::DescriptorType::eSampledImage;
+      }
+    }
+    default:
+      return std::nullopt;
+  }
+}
+
+auto VertexFormatOf(const Module& module, const Id& type) -> vk::Format {
+  uint32_t components = 1;
+  const Id* scalar = &type;
+  if (type.Opcode() == kOpTypeVector) {
+    components = type.Operand(3);
+    scalar = &module.Get(type.Operand(2));
+  }
+  if (scalar->Operand(2) != 32 || components < 1 || components > 4) {
+    return vk::Format::eUndefined;
+  }
+
+  constexpr std::array kFloat = {
+      vk::Format::eR32Sfloat, vk::Format::eR32G32Sfloat,
+      vk::Format::eR32G32B32Sfloat, vk::Format::eR32G32B32A32Sfloat};
+  constexpr std::array kSint = {
+      vk::Format::eR32Sint, vk::Format::eR32G32Sint,
+      vk::Format::eR32G32B32Sint, vk::Format::eR32G32B32A32Sint};
+  constexpr std::array kUint = {
+      vk::Format::eR32Uint, vk::Format::eR32G32Uint,
+      vk::Format::eR32G32B32Uint, vk::Format::eR32G32B32A32Uint};
+
+  if (scalar->Opcode() == kOpTypeFloat) {
+    return kFloat[components - 1];
+  }
+  return scalar->Operand(3) != 0 ? kSint[components - 1]
+                                 : kUint[components - 1];
+}
+
+}  // namespace
+
+auto ReflectShader(std::span<const uint32_t> code) -> ShaderReflection {
+  const Module module(code);
+
+  ShaderReflection reflection;
+  reflection.stages = module.GetStage();
+  reflection.local_size = module.GetLocalSize();
+
+  for (const auto variable_id : module.GetVariables()) {
+    const auto& variable = module.Get(variable_id);
+    const auto storage = variable.Operand(3);
+    const auto& pointer = module.Get(variable.Operand(1));
+    const auto* type = &module.Get(pointer.Operand(3));
+
+    if (storage == kStoragePushConstant) {
+      const vk::PushConstantRange range{reflection.stages, 0,
+                                        module.SizeOf(*type)};
+      reflection.push_constants =
+          MergePushConstantRanges(reflection.push_constants, {&range, 1});
+      continue;
+    }
+
+    if (storage == kStorageInput) {
+      if (reflection.stages != vk::ShaderStageFlagBits::eVertex ||
+          variable.builtin || variable.location == kNone) {
+        continue;
+      }
+      // a matrix takes one location per column
+      uint32_t columns = 1;
+      if (type->Opcode() == kOpTypeMatrix) {
+        columns = type->Operand(3);
+        type = &module.Get(type->Operand(2));
+      }
+      for (uint32_t i = 0; i < columns; ++i) {
+        reflection.vertex_inputs.push_back(
+            {variable.location + i, VertexFormatOf(module, *type)});
+      }
+      continue;
+    }
+
+    if (variable.binding == kNone) {
+      continue;
+    }
+
+    ShaderBinding binding{};
+    binding.set = variable.set == kNone ? 0 : variable.set;
+    binding.binding = variable.binding;
+    binding.stages = reflection.stages;
+
+    // arrays of descriptors, the element type decides the descriptor type
+    while (type->Opcode() == kOpTypeArray ||
+           type->Opcode() == kOpTypeRuntimeArray) {
+      binding.count = type->Opcode() == kOpTypeArray
+                          ? binding.count * module.ArrayLength(*type)
+                          : 0;
+      type = &module.Get(type->Operand(2));
+    }
+
+    const auto descriptor_type = DescriptorTypeOf(*type, storage);
+    if (!descriptor_type) {
+      continue;
+    }
+    binding.type = *descriptor_type;
+    reflection.bindings.push_back(binding);
+  }
+
+  std::sort(reflection.bindings.begin(), reflection.bindings.end(),
+            [](const ShaderBinding& a, const ShaderBinding& b) {
+              return std::tie(a.set, a.binding) < std::tie(b.set, b.binding);
+            });
+  std::sort(reflection.vertex_inputs.begin(), reflection.vertex_inputs.end(),
+            [](const ShaderVertexInput& a, const ShaderVertexInput& b) {
+              return a.location < b.location;
+            });
+
+  return reflection;
+}
+
+auto MergeReflections(const ShaderReflection& a, const ShaderReflection& b)
+    -> ShaderReflection {
+  ShaderReflection merged = a;
+  merged.stages |= b.stages;
+
+  for (const auto& binding : b.bindings) {
+    const auto found = std::find_if(
+        merged.bindings.begin(), merged.bindings.end(),
+        [&binding](const ShaderBinding& existing) {
+          return existing.set == binding.set &&
+                 existing.binding == binding.binding;
+        });
+
+    if (found == merged.bindings.end()) {
+      merged.bindings.push_back(binding);
+      continue;
+    }
+    if (found->type != binding.type) {
+      spdlog::error("Set {} binding {} is declared with different types",
+                    binding.set, binding.binding);
+      throw std::runtime_error("Shader stages disagree on a binding");
+    }
+    // a runtime array stays a runtime array
+    if (found->count != 0) {
+      found->count = binding.count == 0 ? 0
+                                        : std::max(found->count, binding.count);
+    }
+    found->stages |= binding.stages;
+  }
+
+  merged.push_constants =
+      MergePushConstantRanges(a.push_constants, b.push_constants);
+
+  for (const auto& input : b.vertex_inputs) {
+    if (std::find(merged.vertex_inputs.begin(), merged.vertex_inputs.end(),
+                  input) == merged.vertex_inputs.end()) {
+      merged.vertex_inputs.push_back(input);
+    }
+  }
+
+  std::sort(merged.bindings.begin(), merged.bindings.end(),
+            [](const ShaderBinding& x, const ShaderBinding& y) {
+              return std::tie(x.set, x.binding) < std::tie(y.set, y.binding);
+            });
+  std::sort(merged.vertex_inputs.begin(), merged.vertex_inputs.end(),
+            [](const ShaderVertexInput& x, const ShaderVertexInput& y) {
+              return x.location < y.location;
+            });
+
+  return merged;
+}
+
+auto MergePushConstantRanges(std::span<const vk::PushConstantRange> a,
+                             std::span<const vk::PushConstantRange> b)
+    -> std::vector<vk::PushConstantRange> {
+  std::vector<vk::PushConstantRange> merged(a.begin(), a.end());
+
+  for (const auto& range : b) {
+    const auto same_stages = std::find_if(
+        merged.begin(), merged.end(), [&range](const auto& existing) {
+          return existing.stageFlags == range.stageFlags;
+        });
+    if (same_stages != merged.end()) {
+      const auto end = std::max(same_stages->offset + same_stages->size,
+                                range.offset + range.size);
+      same_stages->offset = std::min(same_stages->offset, range.offset);
+      same_stages->size = end - same_stages->offset;
+      continue;
+    }
+
+    // identical ranges of different stages become one range
+    const auto same_range = std::find_if(
+        merged.begin(), merged.end(), [&range](const auto& existing) {
+          return existing.offset == range.offset &&
+                 existing.size == range.size &&
+                 !(existing.stageFlags & range.stageFlags);
+        });
+    if (same_range != merged.end()) {
+      same_range->stageFlags |= range.stageFlags;
+      continue;
+    }
+
+    merged.push_back(range);
+  }
+
+  return merged;
+}
+
+auto GetSetCount(const ShaderReflection& reflection) -> uint32_t {
+  uint32_t count = 0;
+  for (const auto& binding : reflection.bindings) {
+    count = std::max(count, binding.set + 1);
+  }
+  return count;
+}
+
+auto GetSetBindings(const ShaderReflection& reflection, uint32_t set)
+    -> std::vector<ShaderBinding> {
+  std::vector<ShaderBinding> bindings;
+  std::copy_if(reflection.bindings.begin(), reflection.bindings.end(),
+               std::back_inserter(bindings),
+               [set](const ShaderBinding& binding) {
+                 return binding.set == set;
+               });
+  return bindings;
+}
+
+}  // namespace braque
@@ -0,0 +1,264 @@
+#include "braque/shader_watcher.h"
+
+#include "braque/job_system.h"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <utility>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace braque {
+
+auto ParseShaderIncludes(std::string_view source)
+    -> std::vector<std::string> {
+  std::vector<std::string> includes;
+  constexpr std::string_view kDirective = "#include";
+
+  while (!source.empty()) {
+    const auto end = source.find('\n');
+    auto line = source.substr(0, end);
+    source = end == std::string_view::npos ? std::string_view{}
+                                           : source.substr(end + 1);
+
+    const auto start = line.find_first_not_of(" \t");
+    if (start == std::string_view::npos ||
+        line.substr(start, kDirective.size()) != kDirective) {
+      continue;
+    }
+    line = line.substr(start + kDirective.size());
+
+    const auto open = line.find('"');
+    const auto close = open == std::string_view::npos
+                           ? std::string_view::npos
+                           : line.find('"', open + 1);
+    if (close != std::string_view::npos) {
+      includes.emplace_back(line.substr(open + 1, close - open - 1));
+    }
+  }
+  return includes;
+}
+
+ShaderWatcher::ShaderWatcher(JobSystem& jobs,
+                             std::filesystem::path source_dir,
+                             std::filesystem::path output_dir,
+                             std::string compiler)
+    : jobs_(jobs),
+      source_dir_(std::move(source_dir)),
+      output_dir_(std::move(output_dir)),
+      compiler_(std::move(compiler)) {
+#ifdef __linux__
+  // editors either write in place or rename a new file over the old one
+  inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (inotify_fd_ >= 0 &&
+      inotify_add_watch(inotify_fd_, source_dir_.c_str(),
+                        IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+    close(inotify_fd_);
+    inotify_fd_ = -1;
+  }
+#endif
+
+  if (inotify_fd_ < 0) {
+    FindChanged();
+  }
+
+  spdlog::info("Watching shaders in {}", source_dir_.string());
+}
+
+ShaderWatcher::~ShaderWatcher() {
+  // the compiles write into their entries
+  for (const auto& compile : compiles_) {
+    compile->job.wait();
+  }
+
+#ifdef __linux__
+  if (inotify_fd_ >= 0) {
+    close(inotify_fd_);
+  }
+#endif
+}
+
+auto ShaderWatcher::Poll() -> std::vector<std::string> {
+  for (const auto& source : ExpandIncludes(FindChanged())) {
+    const auto compiling = std::any_of(
+        compiles_.begin(), compiles_.end(),
+        [&source](const auto& compile) { return compile->source == source; });
+    if (compiling) {
+      stale_.insert(source);
+    } else {
+      StartCompile(source);
+    }
+  }
+
+  std::vector<std::string> compiled;
+  std::vector<std::filesystem::path> restart;
+
+  const auto finished = std::stable_partition(
+      compiles_.begin(), compiles_.end(), [](const auto& compile) {
+        return compile->job.wait_for(std::chrono::seconds(0)) !=
+               std::future_status::ready;
+      });
+  for (auto it = finished; it != compiles_.end(); ++it) {
+    const auto& compile = **it;
+    if (compile.succeeded) {
+      compiled.push_back(compile.spirv);
+    }
+    if (stale_.erase(compile.source) > 0) {
+      restart.push_back(compile.source);
+    }
+  }
+  compiles_.erase(finished, compiles_.end());
+
+  for (const auto& source : restart) {
+    StartCompile(source);
+  }
+  return compiled;
+}
+
+auto ShaderWatcher::IsShaderSource(const std::filesystem::path& path)
+    -> bool {
+  const auto extension = path.extension();
+  return extension == ".vert" || extension == ".frag" || extension == ".comp";
+}
+
+auto ShaderWatcher::IsShaderInclude(const std::filesystem::path& path)
+    -> bool {
+  return path.extension() == ".glsl";
+}
+
+auto ShaderWatcher::ExpandIncludes(
+    const std::set<std::filesystem::path>& changed) const
+    -> std::set<std::filesystem::path> {
+  std::set<std::filesystem::path> sources;
+  std::vector<std::string> pending;
+  for (const auto& path : changed) {
+    if (IsShaderInclude(path)) {
+      pending.push_back(path.filename().string());
+    } else {
+      sources.insert(path);
+    }
+  }
+  if (pending.empty()) {
+    return sources;
+  }
+
+  // only read when an include changed, which is rare
+  std::vector<std::pair<std::filesystem::path, std::vector<std::string>>>
+      files;
+  std::error_code error;
+  for (const auto& entry :
+       std::filesystem::directory_iterator(source_dir_, error)) {
+    const auto& path = entry.path();
+    if (!IsShaderSource(path) && !IsShaderInclude(path)) {
+      continue;
+    }
+    std::ifstream file(path);
+    const std::string text((std::istreambuf_iterator<char>(file)),
+                           std::istreambuf_iterator<char>());
+    files.emplace_back(path, ParseShaderIncludes(text));
+  }
+
+  // includes of includes pass the change on
+  std::set<std::string> visited(pending.begin(), pending.end());
+  while (!pending.empty()) {
+    const auto include = std::move(pending.back());
+    pending.pop_back();
+
+    for (const auto& [path, includes] : files) {
+      if (std::find(includes.begin(), includes.end(), include) ==
+          includes.end()) {
+        continue;
+      }
+      if (IsShaderSource(path)) {
+        sources.insert(path);
+      } else if (visited.insert(path.filename().string()).second) {
+        pending.push_back(path.filename().string());
+      }
+    }
+  }
+  return sources;
+}
+
+auto ShaderWatcher::FindChanged() -> std::set<std::filesystem::path> {
+  std::set<std::filesystem::path> changed;
+
+#ifdef __linux__
+  if (inotify_fd_ >= 0) {
+    alignas(inotify_event) std::array<char, 4096> events{};
+    ssize_t length = 0;
+    while ((length = read(inotify_fd_, events.data(), events.size())) > 0) {
+      for (ssize_t offset = 0; offset < length;) {
+        const auto* event =
+            reinterpret_cast<const inotify_event*>(events.data() + offset);
+        if (event->len > 0) {
+          const auto path = source_dir_ / event->name;
+          if (IsShaderSource(path) || IsShaderInclude(path)) {
+            changed.insert(path);
+          }
+        }
+        offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+      }
+    }
+    return changed;
+  }
+#endif
+
+  // a handful of stat calls, cheap enough to do every frame
+  std::error_code error;
+  for (const auto& entry :
+       std::filesystem::directory_iterator(source_dir_, error)) {
+    if (!IsShaderSource(entry.path()) && !IsShaderInclude(entry.path())) {
+      continue;
+    }
+    const auto time = entry.last_write_time(error);
+    auto [known, inserted] =
+        write_times_.try_emplace(entry.path().string(), time);
+    if (!inserted && known->second != time) {
+      known->second = time;
+      changed.insert(entry.path());
+    }
+  }
+  return changed;
+}
+
+void ShaderWatcher::StartCompile(const std::filesystem::path& source) {
+  auto& compile = *compiles_.emplace_back(std::make_unique<Compile>());
+  compile.source = source;
+  compile.spirv =
+      (output_dir_ / (source.filename().string() + ".spv")).generic_string();
+
+  spdlog::info("Recompiling {}", source.filename().string());
+
+  compile.job = jobs_.Async([this, &compile] {
+    // written aside and renamed over the old module, which is atomic
+    const auto temporary = compile.spirv + ".tmp";
+    const auto command = "\"" + compiler_ + "\" -g --target-env=vulkan1.2 -o \"" +
+                         temporary + "\" \"" + compile.source.string() + "\"";
+
+    // the compiler reports its errors itself
+    if (std::system(command.c_str()) != 0) {
+      spdlog::error("Failed to compile {}", compile.source.string());
+      return;
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporary, compile.spirv, error);
+    if (error) {
+      spdlog::error("Failed to replace {}: {}", compile.spirv,
+                    error.message());
+      return;
+    }
+    compile.succeeded = true;
+  });
+}
+
+}  // namespace braque
@@ -0,0 +1,44 @@
+#include "braque/slot_allocator.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace braque {
+
+SlotAllocator::SlotAllocator(uint32_t capacity, uint32_t retire_frames)
+    : capacity_(capacity), retire_frames_(retire_frames) {}
+
+auto SlotAllocator::Allocate() -> std::optional<uint32_t> {
+  uint32_t slot = 0;
+  if (!free_slots_.empty()) {
+    slot = free_slots_.back();
+    free_slots_.pop_back();
+  } else if (next_ < capacity_) {
+    slot = next_++;
+  } else {
+    return std::nullopt;
+  }
+  used_++;
+  return slot;
+}
+
+void SlotAllocator::Release(uint32_t slot) {
+  assert(slot < next_ && used_ > 0);
+  used_--;
+  retired_slots_.push_back({slot, frame_ + retire_frames_});
+}
+
+void SlotAllocator::NextFrame() {
+  frame_++;
+
+  // retired slots are in release order, so the ones due are at the front
+  const auto due = std::find_if(
+      retired_slots_.begin(), retired_slots_.end(),
+      [this](const RetiredSlot& retired) { return retired.free_frame > frame_; });
+  for (auto it = retired_slots_.begin(); it != due; ++it) {
+    free_slots_.push_back(it->slot);
+  }
+  retired_slots_.erase(retired_slots_.begin(), due);
+}
+
+}  // namespace braque
@@ -0,0 +1,65 @@
+#include "braque/specialization.h"
+
+#include "braque/pipeline.h"
+
+#include <algorithm>
+#include <bit>
+
+namespace braque {
+
+void SpecializationConstants::SetUint(uint32_t id, uint32_t value) {
+  Set(id, value);
+}
+
+void SpecializationConstants::SetInt(uint32_t id, int32_t value) {
+  Set(id, std::bit_cast<uint32_t>(value));
+}
+
+void SpecializationConstants::SetFloat(uint32_t id, float value) {
+  Set(id, std::bit_cast<uint32_t>(value));
+}
+
+void SpecializationConstants::SetBool(uint32_t id, bool value) {
+  Set(id, value ? VK_TRUE : VK_FALSE);
+}
+
+auto SpecializationConstants::GetInfo() const -> vk::SpecializationInfo {
+  vk::SpecializationInfo info{};
+  info.setMapEntries(entries_);
+  info.setDataSize(data_.size() * sizeof(uint32_t));
+  info.setPData(data_.data());
+  return info;
+}
+
+auto SpecializationConstants::Hash() const -> uint64_t {
+  uint64_t hash = entries_.size();
+  for (size_t i = 0; i < entries_.size(); ++i) {
+    HashCombine(hash, entries_[i].constantID);
+    HashCombine(hash, data_[i]);
+  }
+  return hash;
+}
+
+void SpecializationConstants::Set(uint32_t id, uint32_t bits) {
+  const auto found = std::lower_bound(
+      entries_.begin(), entries_.end(), id,
+      [](const vk::SpecializationMapEntry& entry, uint32_t constant) {
+        return entry.constantID < constant;
+      });
+  const auto index = static_cast<size_t>(found - entries_.begin());
+
+  if (found != entries_.end() && found->constantID == id) {
+    data_[index] = bits;
+    return;
+  }
+
+  // keeping the ids sorted makes equal constants compare equal regardless
+  // of the order they were set in
+  entries_.insert(found, vk::SpecializationMapEntry{id, 0, sizeof(uint32_t)});
+  data_.insert(data_.begin() + static_cast<std::ptrdiff_t>(index), bits);
+  for (size_t i = 0; i < entries_.size(); ++i) {
+    entries_[i].offset = static_cast<uint32_t>(i * sizeof(uint32_t));
+  }
+}
+
+}  // namespace braque
@@ -0,0 +1,219 @@
+#include "braque/sphere_bounds.h"
+
+#include "braque/job_system.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace braque {
+
+namespace {
+
+// tests spheres [begin, end) one at a time
+void CullRangeScalar(const Frustum& frustum, const SphereBounds& bounds,
+                     size_t begin, size_t end, uint8_t* visible) {
+  for (size_t i = begin; i < end; ++i) {
+    const auto sphere = bounds.Get(i);
+    visible[i] = IsSphereVisible(frustum, glm::vec3(sphere), sphere.w) ? 1 : 0;
+  }
+}
+
+#if defined(__AVX2__)
+
+constexpr size_t kLaneCount = 8;
+
+void CullRange(const Frustum& frustum, const SphereBounds& bounds,
+               size_t begin, size_t end, uint8_t* visible) {
+  // every plane component broadcast across the lanes once
+  __m256 planes[24];
+  for (size_t p = 0; p < 6; ++p) {
+    for (int c = 0; c < 4; ++c) {
+      planes[p * 4 + c] = _mm256_set1_ps(frustum.planes[p][c]);
+    }
+  }
+
+  const auto* xs = bounds.CenterX();
+  const auto* ys = bounds.CenterY();
+  const auto* zs = bounds.CenterZ();
+  const auto* rs = bounds.Radius();
+  const auto sign = _mm256_set1_ps(-0.0F);
+
+  size_t i = begin;
+  for (; i + kLaneCount <= end; i += kLaneCount) {
+    const auto x = _mm256_loadu_ps(xs + i);
+    const auto y = _mm256_loadu_ps(ys + i);
+    const auto z = _mm256_loadu_ps(zs + i);
+    const auto negative_radius = _mm256_xor_ps(_mm256_loadu_ps(rs + i), sign);
+
+    auto inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+    for (size_t p = 0; p < 6; ++p) {
+      auto distance = _mm256_mul_ps(planes[p * 4], x);
+      distance = _mm256_add_ps(distance, _mm256_mul_ps(planes[p * 4 + 1], y));
+      distance = _mm256_add_ps(distance, _mm256_mul_ps(planes[p * 4 + 2], z));
+      distance = _mm256_add_ps(distance, planes[p * 4 + 3]);
+      inside = _mm256_and_ps(
+          inside, _mm256_cmp_ps(distance, negative_radius, _CMP_GE_OQ));
+    }
+
+    const auto mask = _mm256_movemask_ps(inside);
+    for (size_t lane = 0; lane < kLaneCount; ++lane) {
+      visible[i + lane] = static_cast<uint8_t>((mask >> lane) & 1);
+    }
+  }
+
+  CullRangeScalar(frustum, bounds, i, end, visible);
+}
+
+#elif defined(__SSE2__) || defined(_M_X64)
+
+constexpr size_t kLaneCount = 4;
+
+void CullRange(const Frustum& frustum, const SphereBounds& bounds,
+               size_t begin, size_t end, uint8_t* visible) {
+  // every plane component broadcast across the lanes once
+  __m128 planes[24];
+  for (size_t p = 0; p < 6; ++p) {
+    for (int c = 0; c < 4; ++c) {
+      planes[p * 4 + c] = _mm_set1_ps(frustum.planes[p][c]);
+    }
+  }
+
+  const auto* xs = bounds.CenterX();
+  const auto* ys = bounds.CenterY();
+  const auto* zs = bounds.CenterZ();
+  const auto* rs = bounds.Radius();
+  const auto sign = _mm_set1_ps(-0.0F);
+
+  size_t i = begin;
+  for (; i + kLaneCount <= end; i += kLaneCount) {
+    const auto x = _mm_loadu_ps(xs + i);
+    const auto y = _mm_loadu_ps(ys + i);
+    const auto z = _mm_loadu_ps(zs + i);
+    const auto negative_radius = _mm_xor_ps(_mm_loadu_ps(rs + i), sign);
+
+    auto inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+    for (size_t p = 0; p < 6; ++p) {
+      auto distance = _mm_mul_ps(planes[p * 4], x);
+      distance = _mm_add_ps(distance, _mm_mul_ps(planes[p * 4 + 1], y));
+      distance = _mm_add_ps(distance, _mm_mul_ps(planes[p * 4 + 2], z));
+      distance = _mm_add_ps(distance, planes[p * 4 + 3]);
+      inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negative_radius));
+    }
+
+    const auto mask = _mm_movemask_ps(inside);
+    for (size_t lane = 0; lane < kLaneCount; ++lane) {
+      visible[i + lane] = static_cast<uint8_t>((mask >> lane) & 1);
+    }
+  }
+
+  CullRangeScalar(frustum, bounds, i, end, visible);
+}
+
+#elif defined(__ARM_NEON)
+
+constexpr size_t kLaneCount = 4;
+
+void CullRange(const Frustum& frustum, const SphereBounds& bounds,
+               size_t begin, size_t end, uint8_t* visible) {
+  // every plane component broadcast across the lanes once
+  float32x4_t planes[24];
+  for (size_t p = 0; p < 6; ++p) {
+    for (int c = 0; c < 4; ++c) {
+      planes[p * 4 + c] = vdupq_n_f32(frustum.planes[p][c]);
+    }
+  }
+
+  const auto* xs = bounds.CenterX();
+  const auto* ys = bounds.CenterY();
+  const auto* zs = bounds.CenterZ();
+  const auto* rs = bounds.Radius();
+
+  size_t i = begin;
+  for (; i + kLaneCount <= end; i += kLaneCount) {
+    const auto x = vld1q_f32(xs + i);
+    const auto y = vld1q_f32(ys + i);
+    const auto z = vld1q_f32(zs + i);
+    const auto negative_radius = vnegq_f32(vld1q_f32(rs + i));
+
+    auto inside = vdupq_n_u32(0xFFFFFFFFU);
+    for (size_t p = 0; p < 6; ++p) {
+      // multiplies and adds are kept separate to match the scalar path
+      auto distance = vmulq_f32(planes[p * 4], x);
+      distance = vaddq_f32(distance, vmulq_f32(planes[p * 4 + 1], y));
+      distance = vaddq_f32(distance, vmulq_f32(planes[p * 4 + 2], z));
+      distance = vaddq_f32(distance, planes[p * 4 + 3]);
+      inside = vandq_u32(inside, vcgeq_f32(distance, negative_radius));
+    }
+
+    visible[i] = static_cast<uint8_t>(vgetq_lane_u32(inside, 0) & 1);
+    visible[i + 1] = static_cast<uint8_t>(vgetq_lane_u32(inside, 1) & 1);
+    visible[i + 2] = static_cast<uint8_t>(vgetq_lane_u32(inside, 2) & 1);
+    visible[i + 3] = static_cast<uint8_t>(vgetq_lane_u32(inside, 3) & 1);
+  }
+
+  CullRangeScalar(frustum, bounds, i, end, visible);
+}
+
+#else
+
+constexpr size_t kLaneCount = 1;
+
+void CullRange(const Frustum& frustum, const SphereBounds& bounds,
+               size_t begin, size_t end, uint8_t* visible) {
+  CullRangeScalar(frustum, bounds, begin, end, visible);
+}
+
+#endif
+
+static_assert(kCullGrainSize % kLaneCount == 0,
+              "jobs must not split a vector of spheres");
+
+}  // namespace
+
+auto GetCullLaneCount() -> uint32_t {
+  return static_cast<uint32_t>(kLaneCount);
+}
+
+void SphereBounds::Resize(size_t count) {
+  center_x_.resize(count);
+  center_y_.resize(count);
+  center_z_.resize(count);
+  radius_.resize(count);
+}
+
+void SphereBounds::Set(size_t index, glm::vec3 center, float radius) {
+  center_x_[index] = center.x;
+  center_y_[index] = center.y;
+  center_z_[index] = center.z;
+  radius_[index] = radius;
+}
+
+void CullSpheres(const Frustum& frustum, const SphereBounds& bounds,
+                 std::span<uint8_t> visible) {
+  CullRange(frustum, bounds, 0, bounds.Size(), visible.data());
+}
+
+void CullSpheres(JobSystem& jobs, const Frustum& frustum,
+                 const SphereBounds& bounds, std::span<uint8_t> visible) {
+  if (bounds.Size() < kParallelCullThreshold) {
+    CullSpheres(frustum, bounds, visible);
+    return;
+  }
+
+  jobs.ParallelFor(bounds.Size(), kCullGrainSize,
+                   [&](size_t begin, size_t end) {
+                     CullRange(frustum, bounds, begin, end, visible.data());
+                   });
+}
+
+void CullSpheresScalar(const Frustum& frustum, const SphereBounds& bounds,
+                       std::span<uint8_t> visible) {
+  CullRangeScalar(frustum, bounds, 0, bounds.Size(), visible.data());
+}
+
+}  // namespace braque
@@ -236,7 +236,7 @@ namespace braque
     commandBuffers = context_.getRenderer().getDevice().allocateCommandBuffers( commandBufferAllocateInfo );
   }
 
-  void Swapchain::submitCommandBuffer()
+  void Swapchain::submitCommandBuffer( std::span<const vk::SemaphoreSubmitInfo> waits, std::span<const vk::SemaphoreSubmitInfo> signals )
   {
     // get current wait and signal semaphores
     auto wait   = imageAvailableSemaphores[currentFrameInFlight];
@@ -245,11 +245,13 @@ namespace braque
 
     auto commandBuffer = commandBuffers[currentImageIndex];
 
-    vk::SemaphoreSubmitInfo waitSemaphoreInfo{};
+    std::vector<vk::SemaphoreSubmitInfo> waitSemaphoreInfos( waits.begin(), waits.end() );
+    auto & waitSemaphoreInfo = waitSemaphoreInfos.emplace_back();
     waitSemaphoreInfo.setSemaphore( wait );
     waitSemaphoreInfo.setStageMask( vk::PipelineStageFlagBits2::eColorAttachmentOutput | vk::PipelineStageFlagBits2::eBottomOfPipe );
 
-    vk::SemaphoreSubmitInfo signalSemaphoreInfo{};
+    std::vector<vk::SemaphoreSubmitInfo> signalSemaphoreInfos( signals.begin(), signals.end() );
+    auto & signalSemaphoreInfo = signalSemaphoreInfos.emplace_back();
     signalSemaphoreInfo.setSemaphore( signal );
     signalSemaphoreInfo.setStageMask( vk::PipelineStageFlagBits2::eColorAttachmentOutput );
 
@@ -257,9 +259,9 @@ namespace braque
     commandBufferSubmitInfo.setCommandBuffer( commandBuffer );
 
     vk::SubmitInfo2 submitInfo{};
-    submitInfo.setWaitSemaphoreInfos( waitSemaphoreInfo );
+    submitInfo.setWaitSemaphoreInfos( waitSemaphoreInfos );
     submitInfo.setCommandBufferInfos( commandBufferSubmitInfo );
-    submitInfo.setSignalSemaphoreInfos( signalSemaphoreInfo );
+    submitInfo.setSignalSemaphoreInfos( signalSemaphoreInfos );
 
     context_.getRenderer().getGraphicsQueue().submit2KHR( submitInfo, fence );
   }
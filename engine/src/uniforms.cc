@@ -1,33 +1,58 @@
 #include <braque/engine.h>
+#include <braque/layout_cache.h>
+#include <braque/shader.h>
 #include <braque/texture.h>
 #include <braque/uniforms.h>
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
+
 namespace braque {
 
 constexpr uint32_t CAMERA_BINDING = 0;
+constexpr uint32_t TEXTURE_BINDING = 1;
+constexpr uint32_t INSTANCE_BINDING = 2;
+constexpr uint32_t DRAW_DATA_BINDING = 3;
+constexpr uint32_t VISIBLE_INSTANCE_BINDING = 4;
+constexpr uint32_t MATERIAL_BINDING = 5;
+
+struct FrameBinding {
+  uint32_t binding;
+  vk::DescriptorType type;
+};
+
+constexpr std::array kFrameBindings = {
+    FrameBinding{CAMERA_BINDING, vk::DescriptorType::eUniformBuffer},
+    FrameBinding{TEXTURE_BINDING, vk::DescriptorType::eCombinedImageSampler},
+    FrameBinding{INSTANCE_BINDING, vk::DescriptorType::eStorageBuffer},
+    FrameBinding{DRAW_DATA_BINDING, vk::DescriptorType::eStorageBuffer},
+    FrameBinding{VISIBLE_INSTANCE_BINDING, vk::DescriptorType::eStorageBuffer},
+    FrameBinding{MATERIAL_BINDING, vk::DescriptorType::eStorageBuffer}};
+
+// every shader drawn with the frame set, the set layout is the union of
+// their bindings
+constexpr std::array kFrameSetShaders = {
+    kSceneVertexShader, kSceneCompactVertexShader, kSceneFragmentShader,
+    kDepthVertexShader};
 
 struct CameraUbo {
   glm::mat4 view;
   glm::mat4 proj;
 };
 
-Uniforms::Uniforms(EngineContext& engine, Swapchain& swapchain) : engine_(engine), swapchain_(swapchain) {
+Uniforms::Uniforms(EngineContext& engine, Swapchain& swapchain)
+    : engine_(engine),
+      swapchain_(swapchain),
+      texture_slots_(kMaxBindlessTextures,
+                     Swapchain::getFramesInFlightCount()) {
   CreateUniformBuffers();
   createDescriptorSetLayout();
   createDescriptorPool();
   createDescriptorSets();
 }
 
-Uniforms::~Uniforms() {
-
-  // Destroy the descriptor pool
-  const auto& device = engine_.getRenderer().getDevice();
-
-  device.destroyDescriptorSetLayout(descriptor_set_layout_);
-  device.destroyDescriptorPool(descriptor_pool_);
-
-}
+// the pools go with the allocator, the layout belongs to the layout cache
+Uniforms::~Uniforms() = default;
 
 void Uniforms::CreateUniformBuffers() {
 
@@ -39,102 +64,146 @@ void Uniforms::CreateUniformBuffers() {
 }
 
 void Uniforms::createDescriptorSetLayout() {
-  const auto& device = engine_.getRenderer().getDevice();
-
-  vk::DescriptorSetLayoutBinding cameraBinding{};
-  cameraBinding.setBinding(CAMERA_BINDING);
-  cameraBinding.setDescriptorType(vk::DescriptorType::eUniformBuffer);
-  cameraBinding.setDescriptorCount(1);
-  cameraBinding.setStageFlags(vk::ShaderStageFlagBits::eVertex);
-
-  vk::DescriptorSetLayoutBinding samplerBinding{};
-  samplerBinding.binding = 1;
-  samplerBinding.descriptorCount = 1;
-  samplerBinding.descriptorType = vk::DescriptorType::eCombinedImageSampler;
-  samplerBinding.stageFlags = vk::ShaderStageFlagBits::eFragment;
-
-  std::array bindings = {cameraBinding, samplerBinding};
-
-  vk::DescriptorSetLayoutCreateInfo layoutInfo;
-  layoutInfo.setBindings(bindings);
+  for (const auto* shader : kFrameSetShaders) {
+    reflection_ = MergeReflections(reflection_, ReflectShaderFile(shader));
+  }
+  bindings_ = GetSetBindings(reflection_, 0);
+
+  // the shaders have to declare exactly what the descriptor writes fill
+  const auto matches = [this](const FrameBinding& expected) {
+    return std::any_of(bindings_.begin(), bindings_.end(),
+                       [&expected](const ShaderBinding& binding) {
+                         return binding.binding == expected.binding &&
+                                binding.type == expected.type;
+                       });
+  };
+  if (bindings_.size() != kFrameBindings.size() ||
+      !std::all_of(kFrameBindings.begin(), kFrameBindings.end(), matches)) {
+    spdlog::error("Scene shaders do not match the frame descriptor set");
+    throw std::runtime_error(
+        "Scene shaders do not match the frame descriptor set");
+  }
 
-  descriptor_set_layout_ = device.createDescriptorSetLayout(layoutInfo);
+  // the runtime texture array is the bindless table
+  descriptor_set_layout_ =
+      engine_.getRenderer().GetLayoutCache().GetSetLayout(
+          bindings_, kMaxBindlessTextures);
 }
 
 void Uniforms::createDescriptorPool() {
   const auto& device = engine_.getRenderer().getDevice();
+  const auto frameCount = static_cast<uint32_t>(camera_buffers_.size());
+
+  // exactly the descriptors of one set per frame in flight
+  std::vector<DescriptorPoolRatio> ratios;
+  for (const auto& binding : bindings_) {
+    const auto count = static_cast<float>(
+        binding.count == 0 ? kMaxBindlessTextures : binding.count);
+
+    const auto found =
+        std::find_if(ratios.begin(), ratios.end(),
+                     [&binding](const DescriptorPoolRatio& ratio) {
+                       return ratio.type == binding.type;
+                     });
+    if (found != ratios.end()) {
+      found->per_set += count;
+    } else {
+      ratios.push_back({binding.type, count});
+    }
+  }
 
-  std::array<vk::DescriptorPoolSize, 2> poolSizes{};
-
-  // for uniform buffer
-  poolSizes[0].setType(vk::DescriptorType::eUniformBuffer);
-  poolSizes[0].setDescriptorCount(static_cast<uint32_t>(camera_buffers_.size()));
-
-  // for combined image sampler
-  poolSizes[1].setType(vk::DescriptorType::eCombinedImageSampler);
-  poolSizes[1].setDescriptorCount(static_cast<uint32_t>(camera_buffers_.size()));
-
-  vk::DescriptorPoolCreateInfo poolInfo;
-  poolInfo.setPoolSizes(poolSizes);
-  poolInfo.setMaxSets(10);
-
-  descriptor_pool_ = device.createDescriptorPool(poolInfo);
+  descriptor_allocator_ = std::make_unique<DescriptorAllocator>(
+      device, ratios, frameCount,
+      vk::DescriptorPoolCreateFlagBits::eUpdateAfterBind);
 }
 
 void Uniforms::createDescriptorSets() {
   const auto& device = engine_.getRenderer().getDevice();
 
-  std::vector layouts(camera_buffers_.size(), descriptor_set_layout_);
-
-  vk::DescriptorSetAllocateInfo allocInfo;
-  allocInfo.setDescriptorPool(descriptor_pool_);
-  allocInfo.setSetLayouts(layouts);
-
-  descriptor_sets_ = device.allocateDescriptorSets(allocInfo);
+  // the bindless array is left out and written slot by slot in AddTexture
+  descriptor_template_ = std::make_unique<DescriptorTemplate>(
+      device, descriptor_set_layout_, bindings_);
 
   for (size_t i = 0; i < camera_buffers_.size(); ++i) {
-    vk::DescriptorBufferInfo bufferInfo;
-    bufferInfo.setBuffer(camera_buffers_[i].GetBuffer());
-    bufferInfo.setOffset(0);
-    bufferInfo.setRange(sizeof(CameraUbo));
-
-    vk::WriteDescriptorSet descriptorWrite;
-    descriptorWrite.setDstSet(descriptor_sets_[i]);
-    descriptorWrite.setDstBinding(CAMERA_BINDING);
-    descriptorWrite.setDstArrayElement(0);
-    descriptorWrite.setDescriptorType(vk::DescriptorType::eUniformBuffer);
-    descriptorWrite.setDescriptorCount(1);
-    descriptorWrite.setPBufferInfo(&bufferInfo);
-
-    device.updateDescriptorSets(descriptorWrite, nullptr);
+    descriptor_sets_.push_back(
+        descriptor_allocator_->Allocate(descriptor_set_layout_));
+
+    auto data = descriptor_template_->MakeData();
+    data.SetBuffer(CAMERA_BINDING, camera_buffers_[i].GetBuffer(), 0,
+                   sizeof(CameraUbo));
+    frame_data_.push_back(data);
+    written_data_.push_back(descriptor_template_->MakeData());
   }
 }
 
-void Uniforms::SetTextureData( const Texture& texture, vk::Sampler sampler) {
-
-  vk::DescriptorImageInfo imageInfo {};
+auto Uniforms::AddTexture(const Texture& texture, vk::Sampler sampler)
+    -> uint32_t {
+  const auto slot = texture_slots_.Allocate();
+  if (!slot) {
+    spdlog::error("Bindless texture table is full");
+    throw std::runtime_error("Bindless texture table is full");
+  }
 
+  vk::DescriptorImageInfo imageInfo{};
   imageInfo.setImageLayout(vk::ImageLayout::eShaderReadOnlyOptimal);
   imageInfo.setImageView(texture.GetImageView());
   imageInfo.setSampler(sampler);
 
-  // for each swapchain descriptor
+  // the slot is unused by every frame, so all sets can be written now
   for (uint32_t i = 0; i < Swapchain::getFramesInFlightCount(); ++i) {
-
     vk::WriteDescriptorSet descriptorWrite;
-
     descriptorWrite.setDstSet(descriptor_sets_[i]);
-    descriptorWrite.setDstBinding(1);
-    descriptorWrite.setDstArrayElement(0);
+    descriptorWrite.setDstBinding(TEXTURE_BINDING);
+    descriptorWrite.setDstArrayElement(*slot);
     descriptorWrite.setDescriptorType(vk::DescriptorType::eCombinedImageSampler);
     descriptorWrite.setDescriptorCount(1);
     descriptorWrite.setImageInfo(imageInfo);
 
-    engine_.getRenderer().getDevice().updateDescriptorSets(descriptorWrite, nullptr);
+    engine_.getRenderer().getDevice().updateDescriptorSets(descriptorWrite,
+                                                           nullptr);
   }
 
+  return *slot;
+}
+
+void Uniforms::RemoveTexture(uint32_t index) {
+  texture_slots_.Release(index);
+}
+
+void Uniforms::BeginFrame() {
+  texture_slots_.NextFrame();
+}
+
+void Uniforms::SetInstanceBuffer(uint32_t frame, const Buffer& buffer) {
+  WriteStorageBuffer(frame, INSTANCE_BINDING, buffer);
+}
+
+void Uniforms::SetDrawDataBuffer(uint32_t frame, const Buffer& buffer) {
+  WriteStorageBuffer(frame, DRAW_DATA_BINDING, buffer);
+}
+
+void Uniforms::SetVisibleInstanceBuffer(uint32_t frame,
+                                        const Buffer& buffer) {
+  WriteStorageBuffer(frame, VISIBLE_INSTANCE_BINDING, buffer);
+}
+
+void Uniforms::SetMaterialBuffer(uint32_t frame, const Buffer& buffer) {
+  WriteStorageBuffer(frame, MATERIAL_BINDING, buffer);
+}
+
+void Uniforms::WriteStorageBuffer(uint32_t frame, uint32_t binding,
+                                  const Buffer& buffer) {
+  // written in one template update when the set is next bound
+  frame_data_[frame].SetBuffer(binding, buffer.GetBuffer());
+}
 
+void Uniforms::FlushDescriptors(uint32_t frame) {
+  if (frame_data_[frame] == written_data_[frame]) {
+    return;
+  }
 
+  descriptor_template_->Update(descriptor_sets_[frame], frame_data_[frame]);
+  written_data_[frame] = frame_data_[frame];
 }
 
 void Uniforms::SetCameraData(vk::CommandBuffer buffer, const Camera& camera) {
@@ -158,9 +227,11 @@ void Uniforms::SetCameraData(vk::CommandBuffer buffer, const Camera& camera) {
   cameraBuffer.CopyData(buffer, &camera_ubo, sizeof(CameraUbo));
 }
 
-void Uniforms::Bind(vk::CommandBuffer buffer, vk::PipelineLayout layout) const {
+void Uniforms::Bind(vk::CommandBuffer buffer, vk::PipelineLayout layout) {
   const auto& frame = swapchain_.CurrentFrameIndex();
 
+  FlushDescriptors(frame);
+
   buffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
                             layout, 0,
                             descriptor_sets_[frame], nullptr);
@@ -0,0 +1,233 @@
+#include "braque/vertex_format.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include <glm/gtc/packing.hpp>
+#include <spdlog/spdlog.h>
+
+namespace braque {
+
+namespace {
+
+constexpr float kUnorm16Max = 65535.0F;
+constexpr float kSnorm16Max = 32767.0F;
+constexpr float kUnorm8Max = 255.0F;
+
+auto SignNotZero(glm::vec2 value) -> glm::vec2 {
+  return {value.x >= 0.0F ? 1.0F : -1.0F, value.y >= 0.0F ? 1.0F : -1.0F};
+}
+
+auto ToSnorm16(float value) -> int16_t {
+  return static_cast<int16_t>(
+      std::round(std::clamp(value, -1.0F, 1.0F) * kSnorm16Max));
+}
+
+auto ToUnorm16(float value) -> uint16_t {
+  return static_cast<uint16_t>(
+      std::round(std::clamp(value, 0.0F, 1.0F) * kUnorm16Max));
+}
+
+auto ToUnorm8(float value) -> uint8_t {
+  return static_cast<uint8_t>(
+      std::round(std::clamp(value, 0.0F, 1.0F) * kUnorm8Max));
+}
+
+auto CompactPositionFormat(VertexLayout layout) -> vk::Format {
+  return layout == VertexLayout::eHalf ? vk::Format::eR16G16B16A16Sfloat
+                                       : vk::Format::eR16G16B16A16Unorm;
+}
+
+}  // namespace
+
+auto EncodeOctahedral(glm::vec3 normal) -> glm::vec2 {
+  normal /= std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+
+  auto encoded = glm::vec2(normal.x, normal.y);
+  if (normal.z < 0.0F) {
+    encoded = (1.0F - glm::abs(glm::vec2(encoded.y, encoded.x))) *
+              SignNotZero(encoded);
+  }
+  return encoded;
+}
+
+auto DecodeOctahedral(glm::vec2 encoded) -> glm::vec3 {
+  auto normal = glm::vec3(encoded.x, encoded.y,
+                          1.0F - std::abs(encoded.x) - std::abs(encoded.y));
+  const float t = std::max(-normal.z, 0.0F);
+  normal.x += normal.x >= 0.0F ? -t : t;
+  normal.y += normal.y >= 0.0F ? -t : t;
+  return glm::normalize(normal);
+}
+
+auto GetVertexStride(VertexLayout layout, VertexStream stream) -> uint32_t {
+  const bool full = layout == VertexLayout::eFull;
+
+  switch (stream) {
+    case VertexStream::ePosition:
+      return full ? sizeof(glm::vec3) : sizeof(CompactPosition);
+    case VertexStream::eNormal:
+      return full ? sizeof(glm::vec3) : sizeof(CompactNormal);
+    case VertexStream::eAttributes:
+      return full ? sizeof(FullAttributes) : sizeof(CompactAttributes);
+  }
+  return 0;
+}
+
+auto GetVertexStride(VertexLayout layout, VertexStreams streams) -> uint32_t {
+  uint32_t stride = 0;
+  for (uint32_t i = 0; i < kVertexStreamCount; ++i) {
+    const auto stream = static_cast<VertexStream>(i);
+    if ((streams & StreamBit(stream)) != 0) {
+      stride += GetVertexStride(layout, stream);
+    }
+  }
+  return stride;
+}
+
+auto GetVertexInputDescription(VertexLayout layout, VertexStreams streams)
+    -> VertexInputDescription {
+  VertexInputDescription description;
+
+  const bool full = layout == VertexLayout::eFull;
+
+  for (uint32_t i = 0; i < kVertexStreamCount; ++i) {
+    const auto stream = static_cast<VertexStream>(i);
+    if ((streams & StreamBit(stream)) == 0) {
+      continue;
+    }
+
+    vk::VertexInputBindingDescription binding{};
+    binding.setBinding(i);
+    binding.setStride(GetVertexStride(layout, stream));
+    binding.setInputRate(vk::VertexInputRate::eVertex);
+    description.bindings.push_back(binding);
+
+    switch (stream) {
+      case VertexStream::ePosition:
+        description.attributes.emplace_back(
+            0, i,
+            full ? vk::Format::eR32G32B32Sfloat : CompactPositionFormat(layout),
+            0);
+        break;
+      case VertexStream::eNormal:
+        description.attributes.emplace_back(
+            1, i,
+            full ? vk::Format::eR32G32B32Sfloat : vk::Format::eR16G16Snorm, 0);
+        break;
+      case VertexStream::eAttributes:
+        if (full) {
+          description.attributes.emplace_back(2, i,
+                                              vk::Format::eR32G32B32Sfloat,
+                                              offsetof(FullAttributes, color));
+          description.attributes.emplace_back(
+              3, i, vk::Format::eR32G32Sfloat, offsetof(FullAttributes, uv));
+        } else {
+          description.attributes.emplace_back(
+              2, i, vk::Format::eR8G8B8A8Unorm,
+              offsetof(CompactAttributes, color));
+          description.attributes.emplace_back(3, i, vk::Format::eR16G16Sfloat,
+                                              offsetof(CompactAttributes, uv));
+        }
+        break;
+    }
+  }
+
+  return description;
+}
+
+namespace {
+
+template <typename T>
+void WriteStream(std::vector<std::byte>& stream, const std::vector<T>& values) {
+  stream.resize(values.size() * sizeof(T));
+  std::memcpy(stream.data(), values.data(), stream.size());
+}
+
+}  // namespace
+
+auto PackVertices(std::span<const Vertex> vertices, VertexLayout layout)
+    -> PackedVertices {
+  PackedVertices packed;
+
+  auto& position_stream =
+      packed.streams[static_cast<size_t>(VertexStream::ePosition)];
+  auto& normal_stream =
+      packed.streams[static_cast<size_t>(VertexStream::eNormal)];
+  auto& attribute_stream =
+      packed.streams[static_cast<size_t>(VertexStream::eAttributes)];
+
+  if (layout == VertexLayout::eFull) {
+    std::vector<glm::vec3> positions(vertices.size());
+    std::vector<glm::vec3> normals(vertices.size());
+    std::vector<FullAttributes> attributes(vertices.size());
+
+    for (size_t i = 0; i < vertices.size(); ++i) {
+      positions[i] = vertices[i].position;
+      normals[i] = vertices[i].normal;
+      attributes[i] = {vertices[i].color, vertices[i].uv};
+    }
+
+    WriteStream(position_stream, positions);
+    WriteStream(normal_stream, normals);
+    WriteStream(attribute_stream, attributes);
+    return packed;
+  }
+
+  // quantized positions are stored relative to the mesh bounds
+  if (layout == VertexLayout::eQuantized && !vertices.empty()) {
+    auto min = vertices.front().position;
+    auto max = vertices.front().position;
+    for (const auto& vertex : vertices) {
+      min = glm::min(min, vertex.position);
+      max = glm::max(max, vertex.position);
+    }
+
+    // avoid dividing by zero for flat meshes
+    const auto extent = max - min;
+    packed.position_scale = glm::vec3(extent.x > 0.0F ? extent.x : 1.0F,
+                                      extent.y > 0.0F ? extent.y : 1.0F,
+                                      extent.z > 0.0F ? extent.z : 1.0F);
+    packed.position_offset = min;
+  }
+
+  std::vector<CompactPosition> positions(vertices.size());
+  std::vector<CompactNormal> normals(vertices.size());
+  std::vector<CompactAttributes> attributes(vertices.size());
+
+  for (size_t i = 0; i < vertices.size(); ++i) {
+    const auto& vertex = vertices[i];
+
+    if (layout == VertexLayout::eQuantized) {
+      const auto normalized =
+          (vertex.position - packed.position_offset) / packed.position_scale;
+      positions[i] = {ToUnorm16(normalized.x), ToUnorm16(normalized.y),
+                      ToUnorm16(normalized.z), 0};
+    } else {
+      positions[i] = {glm::packHalf1x16(vertex.position.x),
+                      glm::packHalf1x16(vertex.position.y),
+                      glm::packHalf1x16(vertex.position.z), 0};
+    }
+
+    const auto octahedral = EncodeOctahedral(vertex.normal);
+    normals[i] = {ToSnorm16(octahedral.x), ToSnorm16(octahedral.y)};
+
+    attributes[i].color = {ToUnorm8(vertex.color.r), ToUnorm8(vertex.color.g),
+                           ToUnorm8(vertex.color.b), ToUnorm8(1.0F)};
+    attributes[i].uv = {glm::packHalf1x16(vertex.uv.x),
+                        glm::packHalf1x16(vertex.uv.y)};
+  }
+
+  WriteStream(position_stream, positions);
+  WriteStream(normal_stream, normals);
+  WriteStream(attribute_stream, attributes);
+
+  spdlog::info("Packed {} vertices from {} to {} bytes", vertices.size(),
+               vertices.size_bytes(),
+               vertices.size() * GetVertexStride(layout));
+
+  return packed;
+}
+
+}  // namespace braque
@@ -0,0 +1,141 @@
+// tests/test_bvh.cpp
+#include "gtest/gtest.h"
+#include "braque/bvh.h"
+#include "braque/job_system.h"
+
+#include <algorithm>
+#include <random>
+
+namespace {
+
+auto MakeBoxes(size_t count, uint32_t seed) -> std::vector<braque::Aabb> {
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<float> position(-100.0F, 100.0F);
+    std::uniform_real_distribution<float> size(0.1F, 3.0F);
+
+    std::vector<braque::Aabb> boxes(count);
+    for (auto& box : boxes) {
+        const glm::vec3 center(position(random), position(random),
+                               position(random));
+        const float extent = size(random);
+        box = {center - glm::vec3(extent), center + glm::vec3(extent)};
+    }
+    return boxes;
+}
+
+auto Overlaps(const braque::Aabb& a, const braque::Aabb& b) -> bool {
+    return glm::all(glm::lessThanEqual(a.min, b.max)) &&
+           glm::all(glm::greaterThanEqual(a.max, b.min));
+}
+
+auto BruteForceQuery(std::span<const braque::Aabb> boxes,
+                     const braque::Aabb& query) -> std::vector<uint32_t> {
+    std::vector<uint32_t> objects;
+    for (uint32_t i = 0; i < boxes.size(); ++i) {
+        if (Overlaps(boxes[i], query)) {
+            objects.push_back(i);
+        }
+    }
+    return objects;
+}
+
+void ExpectQueriesMatch(const braque::Bvh& bvh,
+                        std::span<const braque::Aabb> boxes) {
+    for (const auto& probe : MakeBoxes(100, 7)) {
+        const braque::Aabb query{probe.min - glm::vec3(8.0F),
+                                 probe.max + glm::vec3(8.0F)};
+
+        std::vector<uint32_t> objects;
+        bvh.QueryAabb(query, objects);
+        std::sort(objects.begin(), objects.end());
+
+        EXPECT_EQ(objects, BruteForceQuery(boxes, query));
+    }
+}
+
+}  // namespace
+
+TEST(BvhTest, BoxQueriesMatchBruteForce) {
+    const auto boxes = MakeBoxes(5000, 1);
+    braque::Bvh bvh;
+    bvh.Build(boxes);
+
+    EXPECT_EQ(bvh.GetObjectCount(), boxes.size());
+    ExpectQueriesMatch(bvh, boxes);
+}
+
+TEST(BvhTest, RaycastFindsNearestBox) {
+    braque::Bvh bvh;
+    const std::vector<braque::Aabb> boxes = {
+        {{-1, -1, -10}, {1, 1, -8}},
+        {{-1, -1, -5}, {1, 1, -3}},
+        {{5, 5, -5}, {6, 6, -4}},
+    };
+    bvh.Build(boxes);
+
+    const auto hit = bvh.Raycast({{0, 0, 0}, {0, 0, -1}});
+    EXPECT_EQ(hit.object, 1U);
+    EXPECT_FLOAT_EQ(hit.distance, 3.0F);
+
+    const auto miss = bvh.Raycast({{0, 0, 0}, {0, 0, 1}});
+    EXPECT_EQ(miss.object, braque::kInvalidObject);
+
+    const auto short_ray = bvh.Raycast({{0, 0, 0}, {0, 0, -1}, 2.0F});
+    EXPECT_EQ(short_ray.object, braque::kInvalidObject);
+}
+
+TEST(BvhTest, RefitKeepsQueriesCorrect) {
+    auto boxes = MakeBoxes(5000, 2);
+    braque::Bvh bvh;
+    bvh.Build(boxes);
+    const float build_cost = bvh.GetCost();
+
+    // scatter half of the objects, the tree stays valid but gets worse
+    const auto moved = MakeBoxes(boxes.size(), 3);
+    for (uint32_t i = 0; i < boxes.size(); i += 2) {
+        boxes[i] = moved[i];
+        bvh.Update(i, boxes[i]);
+    }
+    bvh.Refit();
+
+    ExpectQueriesMatch(bvh, boxes);
+    EXPECT_GT(bvh.GetCost(), build_cost);
+
+    bvh.Build(boxes);
+    EXPECT_LT(bvh.GetCost(), build_cost * 1.5F);
+}
+
+TEST(BvhTest, BatchedRaycastsMatchSingleRays) {
+    braque::JobSystem jobs(2);
+    const auto boxes = MakeBoxes(2000, 4);
+    braque::Bvh bvh;
+    bvh.Build(boxes);
+
+    std::vector<braque::Ray> rays;
+    for (const auto& target : MakeBoxes(256, 5)) {
+        rays.push_back({glm::vec3(0.0F), (target.min + target.max) * 0.5F});
+    }
+
+    std::vector<braque::RayHit> hits(rays.size());
+    bvh.Raycast(jobs, rays, hits);
+
+    for (size_t i = 0; i < rays.size(); ++i) {
+        const auto expected = bvh.Raycast(rays[i]);
+        EXPECT_EQ(hits[i].object, expected.object);
+        EXPECT_EQ(hits[i].distance, expected.distance);
+    }
+}
+
+TEST(BvhTest, CoincidentBoxesStillSplit) {
+    const std::vector<braque::Aabb> boxes(100, {{0, 0, 0}, {1, 1, 1}});
+    braque::Bvh bvh;
+    bvh.Build(boxes);
+
+    for (const auto& node : bvh.GetNodes()) {
+        EXPECT_LE(node.count, braque::kBvhMaxLeafSize);
+    }
+
+    std::vector<uint32_t> objects;
+    bvh.QueryAabb({{0.5F, 0.5F, 0.5F}, {0.6F, 0.6F, 0.6F}}, objects);
+    EXPECT_EQ(objects.size(), boxes.size());
+}
@@ -0,0 +1,75 @@
+// tests/test_descriptor_allocator.cpp
+#include "gtest/gtest.h"
+#include "braque/descriptor_allocator.h"
+
+#include <array>
+
+namespace {
+
+const std::array kBindings = {
+    braque::ShaderBinding{0, 0, vk::DescriptorType::eUniformBuffer, 1,
+                          vk::ShaderStageFlagBits::eVertex},
+    braque::ShaderBinding{0, 1, vk::DescriptorType::eCombinedImageSampler, 0,
+                          vk::ShaderStageFlagBits::eFragment},
+    braque::ShaderBinding{0, 3, vk::DescriptorType::eStorageBuffer, 2,
+                          vk::ShaderStageFlagBits::eVertex}};
+
+auto MakeBuffer(uint64_t handle) -> vk::Buffer {
+    return vk::Buffer(reinterpret_cast<VkBuffer>(handle));
+}
+
+}  // namespace
+
+TEST(DescriptorAllocatorTest, PoolSizesScaleWithSetCount) {
+    const std::array ratios = {
+        braque::DescriptorPoolRatio{vk::DescriptorType::eStorageBuffer, 4.0F},
+        braque::DescriptorPoolRatio{vk::DescriptorType::eStorageImage, 0.1F}};
+
+    const auto sizes = braque::GetPoolSizes(ratios, 64);
+    ASSERT_EQ(sizes.size(), 2U);
+    EXPECT_EQ(sizes[0].type, vk::DescriptorType::eStorageBuffer);
+    EXPECT_EQ(sizes[0].descriptorCount, 256U);
+    EXPECT_EQ(sizes[1].descriptorCount, 7U);
+
+    // every type keeps at least one descriptor
+    EXPECT_EQ(braque::GetPoolSizes(ratios, 1)[1].descriptorCount, 1U);
+}
+
+TEST(DescriptorAllocatorTest, PoolsGrowUpToTheLimit) {
+    EXPECT_EQ(braque::GetNextPoolSetCount(64), 128U);
+    EXPECT_EQ(braque::GetNextPoolSetCount(braque::kMaxSetsPerPool / 2 + 1),
+              braque::kMaxSetsPerPool);
+    EXPECT_EQ(braque::GetNextPoolSetCount(braque::kMaxSetsPerPool),
+              braque::kMaxSetsPerPool);
+}
+
+TEST(DescriptorAllocatorTest, EqualContentsHashEqual) {
+    braque::DescriptorData first(kBindings);
+    braque::DescriptorData second(kBindings);
+    EXPECT_EQ(first, second);
+    EXPECT_EQ(first.Hash(), second.Hash());
+
+    first.SetBuffer(0, MakeBuffer(1), 0, 128);
+    first.SetBuffer(3, MakeBuffer(2), 0, VK_WHOLE_SIZE, 1);
+    EXPECT_NE(first, second);
+    EXPECT_NE(first.Hash(), second.Hash());
+
+    second.SetBuffer(3, MakeBuffer(2), 0, VK_WHOLE_SIZE, 1);
+    second.SetBuffer(0, MakeBuffer(1), 0, 128);
+    EXPECT_EQ(first, second);
+    EXPECT_EQ(first.Hash(), second.Hash());
+
+    second.SetBuffer(3, MakeBuffer(2), 0, VK_WHOLE_SIZE, 0);
+    EXPECT_NE(first, second);
+}
+
+TEST(DescriptorAllocatorTest, RejectsDescriptorsOutsideTheSet) {
+    braque::DescriptorData data(kBindings);
+
+    // runtime arrays are written slot by slot, not through the data
+    EXPECT_THROW(data.SetImage(1, {}, vk::ImageLayout::eGeneral),
+                 std::runtime_error);
+    EXPECT_THROW(data.SetBuffer(2, MakeBuffer(1)), std::runtime_error);
+    EXPECT_THROW(data.SetBuffer(3, MakeBuffer(1), 0, VK_WHOLE_SIZE, 2),
+                 std::runtime_error);
+}
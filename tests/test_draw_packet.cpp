@@ -0,0 +1,90 @@
+// tests/test_draw_packet.cpp
+#include "gtest/gtest.h"
+#include "braque/draw_packet.h"
+#include "braque/job_system.h"
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+
+TEST(DrawPacketTest, KeyFieldsOrderByPriority) {
+    using braque::DrawPass;
+    using braque::MakeDrawKey;
+
+    // a higher field outweighs everything below it
+    EXPECT_LT(MakeDrawKey(DrawPass::eOpaque, 0, 0xFFFF, 0xFFFF, 0xFFFF),
+              MakeDrawKey(DrawPass::eOpaque, 1, 0, 0, 0));
+    EXPECT_LT(MakeDrawKey(DrawPass::eOpaque, 7, 3, 0xFFFF, 0xFFFF),
+              MakeDrawKey(DrawPass::eOpaque, 7, 4, 0, 0));
+    EXPECT_LT(MakeDrawKey(DrawPass::eOpaque, 7, 3, 10, 0xFFFF),
+              MakeDrawKey(DrawPass::eOpaque, 7, 3, 11, 0));
+    EXPECT_LT(MakeDrawKey(DrawPass::eOpaque, 0xFFF, 0, 0, 0),
+              MakeDrawKey(DrawPass::eTransparent, 0, 0, 0, 0));
+}
+
+TEST(DrawPacketTest, DepthBucketsAreFrontToBack) {
+    const float near_plane = 0.1F;
+    const float far_plane = 100.0F;
+
+    EXPECT_EQ(braque::QuantizeDepth(0.0F, near_plane, far_plane), 0U);
+    EXPECT_EQ(braque::QuantizeDepth(1000.0F, near_plane, far_plane), 0xFFFFU);
+
+    uint32_t previous = 0;
+    for (float depth = near_plane; depth < far_plane; depth *= 1.5F) {
+        const auto bucket = braque::QuantizeDepth(depth, near_plane, far_plane);
+        EXPECT_GE(bucket, previous);
+        previous = bucket;
+    }
+}
+
+TEST(DrawPacketTest, RadixSortIsStable) {
+    braque::JobSystem jobs(2);
+
+    // large enough to split across threads, few distinct keys so ties
+    // are common
+    for (const size_t count : {size_t{0}, size_t{1}, size_t{100},
+                               size_t{50000}}) {
+        std::mt19937_64 random(count);
+        std::vector<uint64_t> keys(count);
+        for (auto& key : keys) {
+            key = (random() % 64) << 40 | (random() % 16);
+        }
+        std::vector<uint32_t> values(count);
+        std::iota(values.begin(), values.end(), 0U);
+
+        std::vector<uint32_t> expected = values;
+        std::stable_sort(expected.begin(), expected.end(),
+                         [&](uint32_t a, uint32_t b) {
+                             return keys[a] < keys[b];
+                         });
+        const auto original = keys;
+
+        braque::RadixSort(jobs, keys, values);
+
+        EXPECT_EQ(values, expected);
+        for (size_t i = 0; i < count; ++i) {
+            EXPECT_EQ(keys[i], original[values[i]]);
+        }
+    }
+}
+
+TEST(DrawPacketTest, PacketsComeBackInKeyOrder) {
+    braque::JobSystem jobs(2);
+    braque::DrawPacketList packets;
+
+    for (uint32_t mesh = 0; mesh < 8; ++mesh) {
+        braque::DrawPacket packet{};
+        packet.first_instance = mesh;
+        // far meshes were added first
+        const auto depth = 1000U - mesh * 100U;
+        packets.Add(braque::MakeDrawKey(braque::DrawPass::eOpaque, 0, 0,
+                                        depth, mesh),
+                    packet);
+    }
+    packets.Sort(jobs);
+
+    ASSERT_EQ(packets.Size(), 8U);
+    for (uint32_t i = 0; i < 8; ++i) {
+        EXPECT_EQ(packets.Get(i).first_instance, 7U - i);
+    }
+}
@@ -0,0 +1,51 @@
+// tests/test_frustum.cpp
+#include "gtest/gtest.h"
+#include "braque/frustum.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace {
+
+auto MakeFrustum() -> braque::Frustum {
+    const auto view = glm::lookAt(glm::vec3(0, 0, 0), glm::vec3(0, 0, -1),
+                                  glm::vec3(0, 1, 0));
+    const auto proj =
+        glm::perspective(glm::radians(90.0F), 1.0F, 0.1F, 100.0F);
+    return braque::ExtractFrustum(proj * view);
+}
+
+}  // namespace
+
+TEST(FrustumTest, PlanesAreNormalized) {
+    const auto frustum = MakeFrustum();
+    for (const auto& plane : frustum.planes) {
+        EXPECT_NEAR(glm::length(glm::vec3(plane)), 1.0F, 1e-5F);
+    }
+}
+
+TEST(FrustumTest, SphereInFrontIsVisible) {
+    const auto frustum = MakeFrustum();
+    EXPECT_TRUE(braque::IsSphereVisible(frustum, glm::vec3(0, 0, -10), 1.0F));
+}
+
+TEST(FrustumTest, SphereBehindIsCulled) {
+    const auto frustum = MakeFrustum();
+    EXPECT_FALSE(braque::IsSphereVisible(frustum, glm::vec3(0, 0, 10), 1.0F));
+    EXPECT_FALSE(
+        braque::IsSphereVisible(frustum, glm::vec3(0, 0, -200), 1.0F));
+}
+
+TEST(FrustumTest, SphereCrossingPlaneIsVisible) {
+    const auto frustum = MakeFrustum();
+    // the right plane passes through x == -z for a 90 degree fov
+    EXPECT_TRUE(braque::IsSphereVisible(frustum, glm::vec3(10.5, 0, -10), 1.0F));
+    EXPECT_FALSE(braque::IsSphereVisible(frustum, glm::vec3(13, 0, -10), 1.0F));
+}
+
+TEST(FrustumTest, BoxVisibility) {
+    const auto frustum = MakeFrustum();
+    EXPECT_TRUE(braque::IsBoxVisible(frustum, {{-1, -1, -11}, {1, 1, -9}}));
+    EXPECT_FALSE(braque::IsBoxVisible(frustum, {{-1, -1, 9}, {1, 1, 11}}));
+    // straddles the right plane
+    EXPECT_TRUE(braque::IsBoxVisible(frustum, {{9, -1, -11}, {12, 1, -9}}));
+}
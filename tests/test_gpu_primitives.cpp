@@ -0,0 +1,263 @@
+// tests/test_gpu_primitives.cpp
+#include "gtest/gtest.h"
+#include "braque/buffer.h"
+#include "braque/descriptor_allocator.h"
+#include "braque/engine_context.h"
+#include "braque/gpu_primitives.h"
+#include "braque/job_system.h"
+#include "braque/memory_allocator.h"
+#include "braque/renderer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+TEST(GpuPrimitivesTest, SingleBlockScansInOneLevel) {
+    EXPECT_EQ(braque::GetScanLevels(0), std::vector<uint32_t>{0});
+    EXPECT_EQ(braque::GetScanLevels(braque::kScanBlockSize),
+              std::vector<uint32_t>{braque::kScanBlockSize});
+}
+
+TEST(GpuPrimitivesTest, ScansBlockTotalsDownToOneBlock) {
+    EXPECT_EQ(braque::GetScanLevels(braque::kScanBlockSize + 1),
+              (std::vector<uint32_t>{braque::kScanBlockSize + 1, 2}));
+
+    // 16M elements, 16k blocks, 16 blocks of those
+    EXPECT_EQ(braque::GetScanLevels(1U << 24),
+              (std::vector<uint32_t>{1U << 24, 1U << 14, 16}));
+}
+
+TEST(GpuPrimitivesTest, SortsFourBitsPerPass) {
+    EXPECT_EQ(braque::GetRadixPassCount(32), 8U);
+    EXPECT_EQ(braque::GetRadixPassCount(16), 4U);
+    EXPECT_EQ(braque::GetRadixPassCount(17), 5U);
+    EXPECT_EQ(braque::GetRadixPassCount(1), 1U);
+    EXPECT_THROW((void)braque::GetRadixPassCount(0), std::runtime_error);
+    EXPECT_THROW((void)braque::GetRadixPassCount(33), std::runtime_error);
+}
+
+TEST(GpuPrimitivesTest, LastPassSortsOnlyTheRemainingBits) {
+    EXPECT_EQ(braque::GetRadixDigitMask(32, 7), 0xFU);
+    EXPECT_EQ(braque::GetRadixDigitMask(10, 0), 0xFU);
+    EXPECT_EQ(braque::GetRadixDigitMask(10, 2), 0x3U);
+    EXPECT_EQ(braque::GetRadixDigitMask(17, 4), 0x1U);
+    EXPECT_EQ(braque::GetRadixDigitMask(2, 0), 0x3U);
+}
+
+namespace {
+
+// three scan levels: 1206 blocks, then 2 blocks of their totals
+constexpr uint32_t kLargeCount = 1'234'567;
+
+// a device and the primitives, created once for all device tests
+struct GpuContext {
+    braque::Renderer renderer;
+    braque::MemoryAllocator allocator{renderer};
+    braque::JobSystem jobs{1};
+    braque::EngineContext engine{allocator, renderer, jobs};
+    braque::DescriptorSetCache descriptors{renderer.getDevice(), 1};
+    braque::GpuPrimitives portable{engine, descriptors, kLargeCount, false};
+    braque::GpuPrimitives subgroup{engine, descriptors, kLargeCount, true};
+    vk::CommandBuffer commands = renderer.CreateCommandBuffer();
+
+    void Run(const std::function<void(vk::CommandBuffer)>& record) {
+        descriptors.BeginFrame(0);
+        commands.begin(vk::CommandBufferBeginInfo{});
+        record(commands);
+        commands.end();
+        renderer.SubmitAndWait(commands);
+    }
+
+    auto Upload(const std::vector<uint32_t>& data) -> braque::Buffer {
+        const auto size =
+            std::max<size_t>(data.size(), 1) * sizeof(uint32_t);
+        braque::Buffer buffer(engine, braque::BufferType::indirect, size);
+        braque::Buffer staging(engine, braque::BufferType::staging, size);
+        staging.CopyData(data.data(), data.size() * sizeof(uint32_t));
+
+        Run([&](vk::CommandBuffer cmd) {
+            staging.CopyToBuffer(cmd, buffer);
+            braque::InsertMemoryBarrier(
+                cmd, vk::PipelineStageFlagBits2::eCopy,
+                vk::AccessFlagBits2::eTransferWrite,
+                vk::PipelineStageFlagBits2::eComputeShader,
+                vk::AccessFlagBits2::eShaderRead);
+        });
+        return buffer;
+    }
+
+    auto Download(const braque::Buffer& buffer, uint32_t count)
+        -> std::vector<uint32_t> {
+        const auto size =
+            std::max<size_t>(count, 1) * sizeof(uint32_t);
+        braque::Buffer readback(engine, braque::BufferType::readback, size);
+
+        Run([&](vk::CommandBuffer cmd) {
+            braque::InsertMemoryBarrier(
+                cmd, vk::PipelineStageFlagBits2::eComputeShader,
+                vk::AccessFlagBits2::eShaderWrite,
+                vk::PipelineStageFlagBits2::eCopy,
+                vk::AccessFlagBits2::eTransferRead);
+            cmd.copyBuffer(buffer.GetBuffer(), readback.GetBuffer(),
+                           vk::BufferCopy{0, 0, size});
+            braque::InsertMemoryBarrier(
+                cmd, vk::PipelineStageFlagBits2::eCopy,
+                vk::AccessFlagBits2::eTransferWrite,
+                vk::PipelineStageFlagBits2::eHost,
+                vk::AccessFlagBits2::eHostRead);
+        });
+
+        vmaInvalidateAllocation(allocator.getAllocator(),
+                                readback.GetAllocation(), 0, VK_WHOLE_SIZE);
+        std::vector<uint32_t> data(count);
+        std::memcpy(data.data(), readback.GetPointer<uint32_t>(),
+                    count * sizeof(uint32_t));
+        return data;
+    }
+};
+
+auto MakeValues(uint32_t count, uint32_t range, uint32_t seed)
+    -> std::vector<uint32_t> {
+    std::mt19937 rng(seed);
+    std::vector<uint32_t> values(count);
+    for (auto& value : values) {
+        value = range == 0 ? rng() : rng() % range;
+    }
+    return values;
+}
+
+// runs every test with the portable shaders and with the subgroup ones
+class GpuPrimitivesDeviceTest : public ::testing::TestWithParam<bool> {
+ protected:
+    static void SetUpTestSuite() { context_ = std::make_unique<GpuContext>(); }
+    static void TearDownTestSuite() { context_.reset(); }
+
+    void SetUp() override {
+        if (GetParam() && !context_->subgroup.UsesSubgroups()) {
+            GTEST_SKIP() << "No subgroup arithmetic on this device";
+        }
+    }
+
+    static auto Context() -> GpuContext& { return *context_; }
+    auto Primitives() const -> braque::GpuPrimitives& {
+        return GetParam() ? context_->subgroup : context_->portable;
+    }
+
+ private:
+    static std::unique_ptr<GpuContext> context_;
+};
+
+std::unique_ptr<GpuContext> GpuPrimitivesDeviceTest::context_;
+
+}  // namespace
+
+TEST_P(GpuPrimitivesDeviceTest, ScansMatchTheStandardLibrary) {
+    auto& context = Context();
+    for (const uint32_t count : {1U, 1000U, 5'003U, kLargeCount}) {
+        const auto input = MakeValues(count, 16, count);
+        auto source = context.Upload(input);
+        auto exclusive = context.Upload(std::vector<uint32_t>(count));
+        auto inclusive = context.Upload(std::vector<uint32_t>(count));
+
+        context.Run([&](vk::CommandBuffer cmd) {
+            Primitives().ExclusiveScan(cmd, source.GetBuffer(),
+                                       exclusive.GetBuffer(), count);
+            Primitives().InclusiveScan(cmd, source.GetBuffer(),
+                                       inclusive.GetBuffer(), count);
+        });
+
+        std::vector<uint32_t> expected(count);
+        std::exclusive_scan(input.begin(), input.end(), expected.begin(), 0U);
+        EXPECT_EQ(context.Download(exclusive, count), expected) << count;
+
+        std::inclusive_scan(input.begin(), input.end(), expected.begin());
+        EXPECT_EQ(context.Download(inclusive, count), expected) << count;
+    }
+}
+
+TEST_P(GpuPrimitivesDeviceTest, CompactionMatchesCopyIf) {
+    auto& context = Context();
+    for (const uint32_t count : {0U, 3'001U, 777'777U}) {
+        const auto values = MakeValues(count, 0, count);
+        const auto flags = MakeValues(count, 2, count + 1);
+        auto value_buffer = context.Upload(values);
+        auto flag_buffer = context.Upload(flags);
+        auto output = context.Upload(std::vector<uint32_t>(count));
+        auto compacted = context.Upload({UINT32_MAX});
+
+        context.Run([&](vk::CommandBuffer cmd) {
+            Primitives().Compact(cmd, value_buffer.GetBuffer(),
+                                 flag_buffer.GetBuffer(), output.GetBuffer(),
+                                 compacted.GetBuffer(), count);
+        });
+
+        std::vector<uint32_t> expected;
+        for (uint32_t i = 0; i < count; ++i) {
+            if (flags[i] != 0) {
+                expected.push_back(values[i]);
+            }
+        }
+
+        const auto expected_count = static_cast<uint32_t>(expected.size());
+        EXPECT_EQ(context.Download(compacted, 1)[0], expected_count) << count;
+        EXPECT_EQ(context.Download(output, expected_count), expected) << count;
+    }
+}
+
+TEST_P(GpuPrimitivesDeviceTest, RadixSortIsStableLikeStableSort) {
+    auto& context = Context();
+    // 8 passes, 5 passes which end in the scratch buffers and 3 passes of
+    // which the last sorts only 2 bits
+    for (const uint32_t key_bits : {32U, 20U, 10U}) {
+        const auto mask = key_bits < 32 ? (1U << key_bits) - 1 : UINT32_MAX;
+        for (const uint32_t count : {2U, 4'099U, 300'001U}) {
+            auto keys = MakeValues(count, 0, count + key_bits);
+            for (uint32_t i = 0; i < count; ++i) {
+                // few distinct keys test the stability, the largest key
+                // sorts among the padding of the last block. The bits
+                // above key_bits are set and must not take part
+                const auto high = key_bits < 32 ? keys[i] << key_bits : 0U;
+                keys[i] = i % 3 == 0 ? UINT32_MAX : (keys[i] % 1024) | high;
+            }
+            std::vector<uint32_t> values(count);
+            std::iota(values.begin(), values.end(), 0U);
+
+            auto key_buffer = context.Upload(keys);
+            auto value_buffer = context.Upload(values);
+            context.Run([&](vk::CommandBuffer cmd) {
+                Primitives().RadixSort(cmd, key_buffer.GetBuffer(),
+                                       value_buffer.GetBuffer(), count,
+                                       key_bits);
+            });
+
+            std::vector<std::pair<uint32_t, uint32_t>> expected(count);
+            for (uint32_t i = 0; i < count; ++i) {
+                expected[i] = {keys[i], values[i]};
+            }
+            std::stable_sort(expected.begin(), expected.end(),
+                             [mask](const auto& a, const auto& b) {
+                                 return (a.first & mask) < (b.first & mask);
+                             });
+
+            const auto sorted_keys = context.Download(key_buffer, count);
+            const auto sorted_values = context.Download(value_buffer, count);
+            for (uint32_t i = 0; i < count; ++i) {
+                ASSERT_EQ(sorted_keys[i], expected[i].first)
+                    << count << " elements, " << key_bits << " bits, at " << i;
+                ASSERT_EQ(sorted_values[i], expected[i].second)
+                    << count << " elements, " << key_bits << " bits, at " << i;
+            }
+        }
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(Shaders, GpuPrimitivesDeviceTest, ::testing::Bool(),
+                         [](const ::testing::TestParamInfo<bool>& info) {
+                             return std::string(info.param ? "Subgroup" : "Portable");
+                         });
@@ -0,0 +1,60 @@
+// tests/test_material.cpp
+#include "gtest/gtest.h"
+#include "braque/material.h"
+
+TEST(MaterialTableTest, IdenticalMaterialsShareAnIndex) {
+    braque::MaterialTable table(2);
+
+    braque::MaterialData red{};
+    red.base_color = glm::vec4(1.0F, 0.0F, 0.0F, 1.0F);
+    braque::MaterialData textured{};
+    textured.albedo_texture = 3;
+
+    const auto first = table.Add(red);
+    EXPECT_EQ(table.Add(textured), first + 1);
+    EXPECT_EQ(table.Add(red), first);
+    EXPECT_EQ(table.Size(), 2U);
+    EXPECT_EQ(braque::HashMaterial(red), braque::HashMaterial(table.Get(first)));
+
+    // an edited material no longer matches its old content
+    table.Set(first, textured);
+    EXPECT_EQ(table.Add(red), 2U);
+}
+
+TEST(MaterialTableTest, EachFrameUploadsOnlyDirtyEntries) {
+    braque::MaterialTable table(2);
+    for (uint32_t i = 0; i < 4; ++i) {
+        braque::MaterialData material{};
+        material.roughness = static_cast<float>(i) / 4.0F;
+        table.Add(material);
+    }
+
+    const auto ranges = table.TakeDirtyRanges(0);
+    ASSERT_EQ(ranges.size(), 1U);
+    EXPECT_EQ(ranges[0].first, 0U);
+    EXPECT_EQ(ranges[0].count, 4U);
+    EXPECT_TRUE(table.TakeDirtyRanges(0).empty());
+
+    braque::MaterialData changed = table.Get(3);
+    changed.metallic = 1.0F;
+    table.Set(3, changed);
+    table.Set(1, table.Get(1));  // unchanged content is not re-uploaded
+
+    const auto update = table.TakeDirtyRanges(0);
+    ASSERT_EQ(update.size(), 1U);
+    EXPECT_EQ(update[0].first, 3U);
+    EXPECT_EQ(update[0].count, 1U);
+
+    // the other frame still misses every entry
+    const auto other = table.TakeDirtyRanges(1);
+    ASSERT_EQ(other.size(), 1U);
+    EXPECT_EQ(other[0].count, 4U);
+}
+
+TEST(MaterialTableTest, RejectsUnknownIndices) {
+    braque::MaterialTable table(2);
+    table.Add(braque::MaterialData{});
+
+    EXPECT_THROW(table.Set(1, braque::MaterialData{}), std::out_of_range);
+    EXPECT_EQ(table.Size(), 1U);
+}
@@ -0,0 +1,117 @@
+// tests/test_mesh_lod.cpp
+#include "gtest/gtest.h"
+#include "braque/mesh_lod.h"
+
+#include <glm/gtc/constants.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+struct TestMesh {
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t> indices;
+};
+
+// closed UV sphere of unit radius, the poles repeat their position
+auto MakeSphere(uint32_t rings, uint32_t segments) -> TestMesh {
+    TestMesh mesh;
+    for (uint32_t r = 0; r <= rings; ++r) {
+        for (uint32_t s = 0; s < segments; ++s) {
+            const float theta = glm::pi<float>() * static_cast<float>(r) /
+                                static_cast<float>(rings);
+            const float phi = glm::two_pi<float>() * static_cast<float>(s) /
+                              static_cast<float>(segments);
+            mesh.positions.emplace_back(std::sin(theta) * std::cos(phi),
+                                        std::cos(theta),
+                                        std::sin(theta) * std::sin(phi));
+        }
+    }
+    for (uint32_t r = 0; r < rings; ++r) {
+        for (uint32_t s = 0; s < segments; ++s) {
+            const uint32_t a = r * segments + s;
+            const uint32_t b = r * segments + (s + 1) % segments;
+            const uint32_t c = a + segments;
+            const uint32_t d = b + segments;
+            mesh.indices.insert(mesh.indices.end(), {a, c, b, b, c, d});
+        }
+    }
+    return mesh;
+}
+
+// flat n x n vertex grid in the xz plane
+auto MakeGrid(uint32_t n) -> TestMesh {
+    TestMesh mesh;
+    for (uint32_t y = 0; y < n; ++y) {
+        for (uint32_t x = 0; x < n; ++x) {
+            mesh.positions.emplace_back(static_cast<float>(x), 0.0F,
+                                        static_cast<float>(y));
+        }
+    }
+    for (uint32_t y = 0; y + 1 < n; ++y) {
+        for (uint32_t x = 0; x + 1 < n; ++x) {
+            const uint32_t a = y * n + x;
+            mesh.indices.insert(mesh.indices.end(),
+                                {a, a + n, a + 1, a + 1, a + n, a + n + 1});
+        }
+    }
+    return mesh;
+}
+
+}  // namespace
+
+TEST(MeshLodTest, FlatGridSimplifiesWithoutError) {
+    const auto grid = MakeGrid(17);
+    const auto level = braque::SimplifyMesh(grid.positions, grid.indices, 0,
+                                            0.001F);
+
+    EXPECT_LT(level.indices.size(), grid.indices.size() / 2);
+    EXPECT_EQ(level.indices.size() % 3, 0U);
+    EXPECT_NEAR(level.error, 0.0F, 1e-4F);
+
+    // the border is locked, so every corner is still referenced
+    for (const uint32_t corner : {0U, 16U, 272U, 288U}) {
+        EXPECT_NE(std::find(level.indices.begin(), level.indices.end(), corner),
+                  level.indices.end());
+    }
+}
+
+TEST(MeshLodTest, ChainReducesAndErrorGrows) {
+    const auto sphere = MakeSphere(24, 48);
+    const auto chain = braque::BuildLodChain(sphere.positions, sphere.indices,
+                                             braque::kLodMaxRelativeError);
+
+    ASSERT_GT(chain.size(), 1U);
+    EXPECT_LE(chain.size(), braque::kMaxMeshLods);
+    EXPECT_EQ(chain.front().indices, sphere.indices);
+    EXPECT_EQ(chain.front().error, 0.0F);
+
+    for (size_t i = 1; i < chain.size(); ++i) {
+        EXPECT_LT(chain[i].indices.size(), chain[i - 1].indices.size());
+        EXPECT_GE(chain[i].error, chain[i - 1].error);
+        EXPECT_LE(chain[i].error, braque::kLodMaxRelativeError);
+        for (const auto index : chain[i].indices) {
+            EXPECT_LT(index, sphere.positions.size());
+        }
+    }
+}
+
+TEST(MeshLodTest, SelectionCoarsensWithDistance) {
+    const std::vector<float> errors = {0.0F, 0.01F, 0.05F, 0.2F};
+    const float scale = braque::ComputeLodScale(45.0F, 1080.0F);
+
+    EXPECT_EQ(braque::SelectLod(errors, 1.0F, scale, 1.0F), 0U);
+    EXPECT_EQ(braque::SelectLod(errors, 5000.0F, scale, 1.0F), 3U);
+
+    uint32_t previous = 0;
+    for (float distance = 1.0F; distance < 5000.0F; distance *= 2.0F) {
+        const auto lod = braque::SelectLod(errors, distance, scale, 1.0F);
+        EXPECT_GE(lod, previous);
+        previous = lod;
+    }
+
+    // inside the bounds or with selection disabled
+    EXPECT_EQ(braque::SelectLod(errors, -1.0F, scale, 1.0F), 0U);
+    EXPECT_EQ(braque::SelectLod(errors, 5000.0F, scale, 0.0F), 0U);
+}
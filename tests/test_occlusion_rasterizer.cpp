@@ -0,0 +1,91 @@
+// tests/test_occlusion_rasterizer.cpp
+#include "gtest/gtest.h"
+#include "braque/job_system.h"
+#include "braque/occlusion_rasterizer.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+
+namespace {
+
+auto MakeViewProjection() -> glm::mat4 {
+    const auto view = glm::lookAt(glm::vec3(0, 0, 0), glm::vec3(0, 0, -1),
+                                  glm::vec3(0, 1, 0));
+    const auto proj =
+        glm::perspective(glm::radians(90.0F), 2.0F, 0.1F, 100.0F);
+    return proj * view;
+}
+
+// a 4x4 wall facing the camera five units away
+auto MakeWall() -> braque::OccluderMesh {
+    return {{{-2, -2, -5}, {2, -2, -5}, {2, 2, -5}, {-2, 2, -5}},
+            {0, 1, 2, 0, 2, 3}};
+}
+
+}  // namespace
+
+TEST(OcclusionRasterizerTest, WallCoversTheMiddleOfTheBuffer) {
+    braque::JobSystem jobs(2);
+    braque::OcclusionRasterizer rasterizer;
+    const auto wall = MakeWall();
+    const braque::Occluder occluder{&wall, glm::mat4(1.0F)};
+
+    rasterizer.Rasterize(jobs, MakeViewProjection(), {&occluder, 1});
+
+    const auto depth = rasterizer.GetDepth();
+    const auto center = rasterizer.GetHeight() / 2 * rasterizer.GetWidth() +
+                        rasterizer.GetWidth() / 2;
+    EXPECT_LT(depth[center], 1.0F);
+    EXPECT_EQ(depth[0], 1.0F);
+}
+
+TEST(OcclusionRasterizerTest, BoxBehindWallIsOccluded) {
+    braque::JobSystem jobs(2);
+    braque::OcclusionRasterizer rasterizer;
+    const auto wall = MakeWall();
+    const braque::Occluder occluder{&wall, glm::mat4(1.0F)};
+
+    rasterizer.Rasterize(jobs, MakeViewProjection(), {&occluder, 1});
+
+    EXPECT_FALSE(rasterizer.IsVisible({{-0.5, -0.5, -11}, {0.5, 0.5, -10}}));
+    EXPECT_TRUE(rasterizer.IsVisible({{-0.5, -0.5, -4}, {0.5, 0.5, -3}}));
+    // sticks out past the edge of the wall
+    EXPECT_TRUE(rasterizer.IsVisible({{1, -0.5, -11}, {8, 0.5, -10}}));
+}
+
+TEST(OcclusionRasterizerTest, TestBoxesOnlyClearsOccluded) {
+    braque::JobSystem jobs(2);
+    braque::OcclusionRasterizer rasterizer;
+    const auto wall = MakeWall();
+    const braque::Occluder occluder{&wall, glm::mat4(1.0F)};
+
+    rasterizer.Rasterize(jobs, MakeViewProjection(), {&occluder, 1});
+
+    const std::vector<braque::Aabb> boxes = {
+        {{-0.5, -0.5, -11}, {0.5, 0.5, -10}},
+        {{-0.5, -0.5, -4}, {0.5, 0.5, -3}},
+        {{-0.5, -0.5, -11}, {0.5, 0.5, -10}},
+    };
+    std::vector<uint8_t> visible = {1, 1, 0};
+
+    rasterizer.TestBoxes(jobs, boxes, visible);
+
+    EXPECT_EQ(visible, (std::vector<uint8_t>{0, 1, 0}));
+}
+
+TEST(OcclusionRasterizerTest, SkipsTrianglesCrossingTheNearPlane) {
+    braque::JobSystem jobs(2);
+    braque::OcclusionRasterizer rasterizer;
+    // a floor that starts between the eye and the near plane
+    const braque::OccluderMesh floor{
+        {{-1, -0.5, -0.05}, {1, -0.5, -0.05}, {0, -0.5, -10}}, {0, 1, 2}};
+    const braque::Occluder occluder{&floor, glm::mat4(1.0F)};
+
+    rasterizer.Rasterize(jobs, MakeViewProjection(), {&occluder, 1});
+
+    const auto depth = rasterizer.GetDepth();
+    EXPECT_GE(*std::min_element(depth.begin(), depth.end()), 0.0F);
+    // seen past the clipped part of the floor
+    EXPECT_TRUE(rasterizer.IsVisible({{-0.5, -0.4, -3}, {0.5, 0.4, -2}}));
+}
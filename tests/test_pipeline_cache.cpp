@@ -0,0 +1,56 @@
+// tests/test_pipeline_cache.cpp
+#include "gtest/gtest.h"
+#include "braque/pipeline_cache.h"
+
+#include <cstring>
+#include <vector>
+
+namespace {
+
+auto MakeProperties() -> vk::PhysicalDeviceProperties {
+    vk::PhysicalDeviceProperties properties{};
+    properties.vendorID = 0x10DE;
+    properties.deviceID = 0x2684;
+    for (uint32_t i = 0; i < VK_UUID_SIZE; ++i) {
+        properties.pipelineCacheUUID[i] = static_cast<uint8_t>(i * 7);
+    }
+    return properties;
+}
+
+// header of a cache written for the device, followed by some payload
+auto MakeCache(const vk::PhysicalDeviceProperties& properties)
+    -> std::vector<uint8_t> {
+    const uint32_t fields[] = {16 + VK_UUID_SIZE,
+                               VK_PIPELINE_CACHE_HEADER_VERSION_ONE,
+                               properties.vendorID, properties.deviceID};
+    std::vector<uint8_t> data(sizeof(fields) + VK_UUID_SIZE + 64, 0xAB);
+    std::memcpy(data.data(), fields, sizeof(fields));
+    std::memcpy(data.data() + sizeof(fields),
+                properties.pipelineCacheUUID.data(), VK_UUID_SIZE);
+    return data;
+}
+
+}  // namespace
+
+TEST(PipelineCacheTest, AcceptsCacheFromSameDevice) {
+    const auto properties = MakeProperties();
+    EXPECT_TRUE(braque::IsPipelineCacheCompatible(MakeCache(properties),
+                                                  properties));
+}
+
+TEST(PipelineCacheTest, RejectsForeignOrTruncatedCache) {
+    const auto properties = MakeProperties();
+    const auto cache = MakeCache(properties);
+
+    auto other_device = properties;
+    other_device.deviceID++;
+    EXPECT_FALSE(braque::IsPipelineCacheCompatible(cache, other_device));
+
+    auto other_driver = properties;
+    other_driver.pipelineCacheUUID[3] ^= 1;
+    EXPECT_FALSE(braque::IsPipelineCacheCompatible(cache, other_driver));
+
+    const std::span<const uint8_t> truncated(cache.data(), 20);
+    EXPECT_FALSE(braque::IsPipelineCacheCompatible(truncated, properties));
+    EXPECT_FALSE(braque::IsPipelineCacheCompatible({}, properties));
+}
@@ -0,0 +1,84 @@
+// tests/test_pipeline_manager.cpp
+#include "gtest/gtest.h"
+#include "braque/pipeline_manager.h"
+
+#include <bit>
+#include <unordered_set>
+
+namespace {
+
+auto MakeDesc() -> braque::PipelineDesc {
+    braque::PipelineDesc desc{};
+    desc.vertex_shader = "triangle.vert.spv";
+    desc.fragment_shader = "triangle.frag.spv";
+    return desc;
+}
+
+}  // namespace
+
+TEST(PipelineManagerTest, IdenticalStateHashesEqual) {
+    const auto a = MakeDesc();
+    const auto b = MakeDesc();
+
+    EXPECT_EQ(a, b);
+    EXPECT_EQ(braque::HashPipelineDesc(a), braque::HashPipelineDesc(b));
+}
+
+TEST(PipelineManagerTest, EveryStateChangeIsAPermutation) {
+    std::vector<braque::PipelineDesc> descs(8, MakeDesc());
+    descs[1].fragment_shader.clear();
+    descs[2].config.vertex_layout = braque::VertexLayout::eHalf;
+    descs[3].config.vertex_streams = braque::kPositionStreamOnly;
+    descs[4].config.depth_only = true;
+    descs[5].config.samples = vk::SampleCountFlagBits::e1;
+    descs[6].config.cull_mode = vk::CullModeFlagBits::eNone;
+    descs[7].config.depth_compare = vk::CompareOp::eGreaterOrEqual;
+
+    std::unordered_set<uint64_t> hashes;
+    for (const auto& desc : descs) {
+        hashes.insert(braque::HashPipelineDesc(desc));
+    }
+    EXPECT_EQ(hashes.size(), descs.size());
+    EXPECT_NE(descs[0], descs[7]);
+}
+
+TEST(PipelineManagerTest, SpecializationConstantsArePartOfTheKey) {
+    auto a = MakeDesc();
+    auto b = MakeDesc();
+    a.constants.SetUint(braque::kLightCountConstant, 2);
+    a.constants.SetBool(braque::kAlbedoTexturesConstant, false);
+
+    // the order constants are set in does not matter
+    b.constants.SetBool(braque::kAlbedoTexturesConstant, false);
+    b.constants.SetUint(braque::kLightCountConstant, 2);
+    EXPECT_EQ(a, b);
+    EXPECT_EQ(braque::HashPipelineDesc(a), braque::HashPipelineDesc(b));
+
+    b.constants.SetUint(braque::kLightCountConstant, 3);
+    EXPECT_NE(a, b);
+    EXPECT_NE(braque::HashPipelineDesc(a), braque::HashPipelineDesc(b));
+    EXPECT_NE(braque::HashPipelineDesc(MakeDesc()),
+              braque::HashPipelineDesc(b));
+}
+
+TEST(PipelineManagerTest, SpecializationDataIsPackedById) {
+    braque::SpecializationConstants constants;
+    constants.SetFloat(braque::kAmbientStrengthConstant, 0.5F);
+    constants.SetUint(braque::kLightCountConstant, 4);
+    constants.SetBool(braque::kOcclusionTexturesConstant, true);
+    constants.SetUint(braque::kLightCountConstant, 3);
+
+    const auto info = constants.GetInfo();
+    ASSERT_EQ(info.mapEntryCount, 3U);
+    EXPECT_EQ(info.dataSize, 3 * sizeof(uint32_t));
+
+    const auto* data = static_cast<const uint32_t*>(info.pData);
+    for (uint32_t i = 0; i < info.mapEntryCount; ++i) {
+        EXPECT_EQ(info.pMapEntries[i].offset, i * sizeof(uint32_t));
+        EXPECT_EQ(info.pMapEntries[i].size, sizeof(uint32_t));
+    }
+    EXPECT_EQ(info.pMapEntries[0].constantID, braque::kLightCountConstant);
+    EXPECT_EQ(data[0], 3U);
+    EXPECT_EQ(data[1], std::bit_cast<uint32_t>(0.5F));
+    EXPECT_EQ(data[2], static_cast<uint32_t>(VK_TRUE));
+}
@@ -18,4 +18,40 @@ TEST(WindowTest, Initialization) {
     // ... your assertions to test window initialization ...
     auto nativeWindow = window.GetNativeWindow();
     EXPECT_TRUE(nativeWindow);
-}
\ No newline at end of file
+}
+
+TEST(RendererTest, SelectsDedicatedComputeFamily) {
+    const std::vector<vk::QueueFamilyProperties> families = {
+        {vk::QueueFlagBits::eGraphics | vk::QueueFlagBits::eCompute |
+             vk::QueueFlagBits::eTransfer, 1},
+        {vk::QueueFlagBits::eTransfer, 2},
+        {vk::QueueFlagBits::eCompute | vk::QueueFlagBits::eTransfer, 4}};
+
+    const auto queues = braque::SelectQueues(families);
+    EXPECT_EQ(queues.graphics_family, 0U);
+    EXPECT_EQ(queues.compute_family, 2U);
+    EXPECT_EQ(queues.compute_index, 0U);
+    EXPECT_TRUE(queues.async_compute);
+}
+
+TEST(RendererTest, FallsBackToGraphicsFamilyForCompute) {
+    // a second queue of the graphics family still overlaps
+    std::vector<vk::QueueFamilyProperties> families = {
+        {vk::QueueFlagBits::eTransfer, 1},
+        {vk::QueueFlagBits::eGraphics | vk::QueueFlagBits::eCompute, 16}};
+
+    auto queues = braque::SelectQueues(families);
+    EXPECT_EQ(queues.graphics_family, 1U);
+    EXPECT_EQ(queues.compute_family, 1U);
+    EXPECT_EQ(queues.compute_index, 1U);
+    EXPECT_TRUE(queues.async_compute);
+
+    // a single queue is shared
+    families[1].queueCount = 1;
+    queues = braque::SelectQueues(families);
+    EXPECT_EQ(queues.compute_index, 0U);
+    EXPECT_FALSE(queues.async_compute);
+
+    families.pop_back();
+    EXPECT_THROW((void)braque::SelectQueues(families), std::runtime_error);
+}
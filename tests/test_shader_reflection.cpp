@@ -0,0 +1,244 @@
+// tests/test_shader_reflection.cpp
+#include "gtest/gtest.h"
+#include "braque/shader_reflection.h"
+
+#include <initializer_list>
+
+namespace {
+
+// opcodes and enums from the SPIR-V specification
+constexpr uint32_t kOpEntryPoint = 15;
+constexpr uint32_t kOpExecutionMode = 16;
+constexpr uint32_t kOpTypeInt = 21;
+constexpr uint32_t kOpTypeFloat = 22;
+constexpr uint32_t kOpTypeVector = 23;
+constexpr uint32_t kOpTypeImage = 25;
+constexpr uint32_t kOpTypeSampledImage = 27;
+constexpr uint32_t kOpTypeArray = 28;
+constexpr uint32_t kOpTypeRuntimeArray = 29;
+constexpr uint32_t kOpTypeStruct = 30;
+constexpr uint32_t kOpTypePointer = 32;
+constexpr uint32_t kOpConstant = 43;
+constexpr uint32_t kOpVariable = 59;
+constexpr uint32_t kOpDecorate = 71;
+constexpr uint32_t kOpMemberDecorate = 72;
+
+constexpr uint32_t kLocalSize = 17;
+
+constexpr uint32_t kBlock = 2;
+constexpr uint32_t kBuiltIn = 11;
+constexpr uint32_t kLocation = 30;
+constexpr uint32_t kBinding = 33;
+constexpr uint32_t kDescriptorSet = 34;
+constexpr uint32_t kOffset = 35;
+
+constexpr uint32_t kUniformConstant = 0;
+constexpr uint32_t kInput = 1;
+constexpr uint32_t kUniform = 2;
+constexpr uint32_t kPushConstant = 9;
+constexpr uint32_t kStorageBuffer = 12;
+
+constexpr uint32_t kMain = 0x6E69616D;  // "main"
+
+// hand assembled module, only what the reflection reads
+class SpirvBuilder {
+public:
+    SpirvBuilder() : words_{0x07230203, 0x00010300, 0, 64, 0} {}
+
+    void Op(uint32_t opcode, std::initializer_list<uint32_t> operands) {
+        words_.push_back(
+            (static_cast<uint32_t>(operands.size() + 1) << 16) | opcode);
+        words_.insert(words_.end(), operands);
+    }
+
+    void Descriptor(uint32_t id, uint32_t set, uint32_t binding) {
+        Op(kOpDecorate, {id, kDescriptorSet, set});
+        Op(kOpDecorate, {id, kBinding, binding});
+    }
+
+    [[nodiscard]] auto Words() const -> const std::vector<uint32_t>& {
+        return words_;
+    }
+
+private:
+    std::vector<uint32_t> words_;
+};
+
+// vec3 input at location 0, gl_VertexIndex, a camera uniform block at 0,
+// a storage buffer at 2 and a { uint; vec4 } push constant block
+auto MakeVertexShader() -> SpirvBuilder {
+    SpirvBuilder spirv;
+    spirv.Op(kOpEntryPoint, {0, 1, kMain, 0});
+    spirv.Op(kOpDecorate, {4, kLocation, 0});
+    spirv.Op(kOpDecorate, {7, kBuiltIn, 42});
+    spirv.Op(kOpDecorate, {8, kBlock});
+    spirv.Descriptor(10, 0, 0);
+    spirv.Op(kOpDecorate, {13, kBlock});
+    spirv.Descriptor(15, 0, 2);
+    spirv.Op(kOpDecorate, {17, kBlock});
+    spirv.Op(kOpMemberDecorate, {17, 0, kOffset, 0});
+    spirv.Op(kOpMemberDecorate, {17, 1, kOffset, 16});
+
+    spirv.Op(kOpTypeFloat, {2, 32});
+    spirv.Op(kOpTypeVector, {3, 2, 3});
+    spirv.Op(kOpTypePointer, {5, kInput, 3});
+    spirv.Op(kOpVariable, {5, 4, kInput});
+    spirv.Op(kOpTypeInt, {6, 32, 1});
+    spirv.Op(kOpTypePointer, {9, kInput, 6});
+    spirv.Op(kOpVariable, {9, 7, kInput});
+    spirv.Op(kOpTypeVector, {16, 2, 4});
+    spirv.Op(kOpTypeStruct, {8, 16});
+    spirv.Op(kOpTypePointer, {11, kUniform, 8});
+    spirv.Op(kOpVariable, {11, 10, kUniform});
+    spirv.Op(kOpTypeInt, {18, 32, 0});
+    spirv.Op(kOpTypeRuntimeArray, {12, 18});
+    spirv.Op(kOpTypeStruct, {13, 12});
+    spirv.Op(kOpTypePointer, {14, kStorageBuffer, 13});
+    spirv.Op(kOpVariable, {14, 15, kStorageBuffer});
+    spirv.Op(kOpTypeStruct, {17, 18, 16});
+    spirv.Op(kOpTypePointer, {19, kPushConstant, 17});
+    spirv.Op(kOpVariable, {19, 20, kPushConstant});
+    return spirv;
+}
+
+// the camera block at 0, a bindless texture array at 1 and four textures
+// in set 1
+auto MakeFragmentShader() -> SpirvBuilder {
+    SpirvBuilder spirv;
+    spirv.Op(kOpEntryPoint, {4, 1, kMain, 0});
+    spirv.Op(kOpDecorate, {8, kBlock});
+    spirv.Descriptor(10, 0, 0);
+    spirv.Descriptor(24, 0, 1);
+    spirv.Descriptor(28, 1, 0);
+
+    spirv.Op(kOpTypeFloat, {2, 32});
+    spirv.Op(kOpTypeVector, {16, 2, 4});
+    spirv.Op(kOpTypeStruct, {8, 16});
+    spirv.Op(kOpTypePointer, {11, kUniform, 8});
+    spirv.Op(kOpVariable, {11, 10, kUniform});
+    spirv.Op(kOpTypeImage, {20, 2, 1, 0, 0, 0, 1, 0});
+    spirv.Op(kOpTypeSampledImage, {21, 20});
+    spirv.Op(kOpTypeRuntimeArray, {22, 21});
+    spirv.Op(kOpTypePointer, {23, kUniformConstant, 22});
+    spirv.Op(kOpVariable, {23, 24, kUniformConstant});
+    spirv.Op(kOpTypeInt, {18, 32, 0});
+    spirv.Op(kOpConstant, {18, 25, 4});
+    spirv.Op(kOpTypeArray, {26, 21, 25});
+    spirv.Op(kOpTypePointer, {27, kUniformConstant, 26});
+    spirv.Op(kOpVariable, {27, 28, kUniformConstant});
+    return spirv;
+}
+
+// 16x16 workgroups writing a storage image at 0 and a storage buffer at 1
+// of set 1, with a uint push constant
+auto MakeComputeShader() -> SpirvBuilder {
+    SpirvBuilder spirv;
+    spirv.Op(kOpEntryPoint, {5, 1, kMain, 0});
+    spirv.Op(kOpExecutionMode, {1, kLocalSize, 16, 16, 1});
+    spirv.Descriptor(4, 0, 0);
+    spirv.Descriptor(9, 1, 1);
+    spirv.Op(kOpDecorate, {7, kBlock});
+    spirv.Op(kOpDecorate, {10, kBlock});
+    spirv.Op(kOpMemberDecorate, {10, 0, kOffset, 0});
+
+    spirv.Op(kOpTypeFloat, {2, 32});
+    spirv.Op(kOpTypeImage, {3, 2, 1, 0, 0, 0, 2, 3});
+    spirv.Op(kOpTypePointer, {6, kUniformConstant, 3});
+    spirv.Op(kOpVariable, {6, 4, kUniformConstant});
+    spirv.Op(kOpTypeInt, {18, 32, 0});
+    spirv.Op(kOpTypeRuntimeArray, {12, 18});
+    spirv.Op(kOpTypeStruct, {7, 12});
+    spirv.Op(kOpTypePointer, {8, kStorageBuffer, 7});
+    spirv.Op(kOpVariable, {8, 9, kStorageBuffer});
+    spirv.Op(kOpTypeStruct, {10, 18});
+    spirv.Op(kOpTypePointer, {11, kPushConstant, 10});
+    spirv.Op(kOpVariable, {11, 13, kPushConstant});
+    return spirv;
+}
+
+}  // namespace
+
+TEST(ShaderReflectionTest, ReadsBindingsPushConstantsAndInputs) {
+    const auto reflection =
+        braque::ReflectShader(MakeVertexShader().Words());
+
+    EXPECT_EQ(reflection.stages,
+              vk::ShaderStageFlags(vk::ShaderStageFlagBits::eVertex));
+
+    ASSERT_EQ(reflection.bindings.size(), 2U);
+    EXPECT_EQ(reflection.bindings[0].binding, 0U);
+    EXPECT_EQ(reflection.bindings[0].type, vk::DescriptorType::eUniformBuffer);
+    EXPECT_EQ(reflection.bindings[1].binding, 2U);
+    EXPECT_EQ(reflection.bindings[1].type, vk::DescriptorType::eStorageBuffer);
+    EXPECT_EQ(reflection.bindings[1].count, 1U);
+
+    ASSERT_EQ(reflection.push_constants.size(), 1U);
+    EXPECT_EQ(reflection.push_constants[0].offset, 0U);
+    EXPECT_EQ(reflection.push_constants[0].size, 32U);
+
+    // the builtin is not a vertex input
+    ASSERT_EQ(reflection.vertex_inputs.size(), 1U);
+    EXPECT_EQ(reflection.vertex_inputs[0].location, 0U);
+    EXPECT_EQ(reflection.vertex_inputs[0].format,
+              vk::Format::eR32G32B32Sfloat);
+
+    EXPECT_THROW(
+        (void)braque::ReflectShader(std::vector<uint32_t>{1, 2, 3, 4, 5}),
+        std::runtime_error);
+}
+
+TEST(ShaderReflectionTest, MergedStagesShareBindings) {
+    const auto vertex = braque::ReflectShader(MakeVertexShader().Words());
+    const auto fragment =
+        braque::ReflectShader(MakeFragmentShader().Words());
+    const auto merged = braque::MergeReflections(vertex, fragment);
+
+    EXPECT_EQ(braque::GetSetCount(merged), 2U);
+
+    const auto frame_set = braque::GetSetBindings(merged, 0);
+    ASSERT_EQ(frame_set.size(), 3U);
+    EXPECT_EQ(frame_set[0].stages,
+              vk::ShaderStageFlagBits::eVertex |
+                  vk::ShaderStageFlagBits::eFragment);
+    EXPECT_EQ(frame_set[1].type, vk::DescriptorType::eCombinedImageSampler);
+    EXPECT_EQ(frame_set[1].count, 0U);
+    EXPECT_EQ(frame_set[1].stages,
+              vk::ShaderStageFlags(vk::ShaderStageFlagBits::eFragment));
+
+    const auto material_set = braque::GetSetBindings(merged, 1);
+    ASSERT_EQ(material_set.size(), 1U);
+    EXPECT_EQ(material_set[0].count, 4U);
+
+    // only the vertex stage pushes constants
+    ASSERT_EQ(merged.push_constants.size(), 1U);
+    EXPECT_EQ(merged.push_constants[0].stageFlags,
+              vk::ShaderStageFlags(vk::ShaderStageFlagBits::eVertex));
+
+    // binding 0 declared as a storage buffer in another stage
+    auto conflicting = fragment;
+    conflicting.bindings[0].type = vk::DescriptorType::eStorageBuffer;
+    EXPECT_THROW((void)braque::MergeReflections(vertex, conflicting),
+                 std::runtime_error);
+}
+
+TEST(ShaderReflectionTest, ReadsComputeWorkgroupSize) {
+    const auto reflection =
+        braque::ReflectShader(MakeComputeShader().Words());
+
+    EXPECT_EQ(reflection.stages,
+              vk::ShaderStageFlags(vk::ShaderStageFlagBits::eCompute));
+    EXPECT_EQ(reflection.local_size, (std::array<uint32_t, 3>{16, 16, 1}));
+
+    ASSERT_EQ(reflection.bindings.size(), 2U);
+    EXPECT_EQ(reflection.bindings[0].type, vk::DescriptorType::eStorageImage);
+    EXPECT_EQ(reflection.bindings[1].set, 1U);
+    EXPECT_EQ(reflection.bindings[1].type, vk::DescriptorType::eStorageBuffer);
+    EXPECT_EQ(braque::GetSetCount(reflection), 2U);
+
+    ASSERT_EQ(reflection.push_constants.size(), 1U);
+    EXPECT_EQ(reflection.push_constants[0].size, 4U);
+
+    // graphics stages have no workgroup
+    const auto vertex = braque::ReflectShader(MakeVertexShader().Words());
+    EXPECT_EQ(vertex.local_size, (std::array<uint32_t, 3>{0, 0, 0}));
+}
@@ -0,0 +1,23 @@
+// tests/test_shader_watcher.cpp
+#include "gtest/gtest.h"
+#include "braque/shader_watcher.h"
+
+TEST(ShaderWatcherTest, ParsesQuotedIncludes) {
+    const auto includes = braque::ParseShaderIncludes(
+        "#version 450\n"
+        "#extension GL_GOOGLE_include_directive : require\n"
+        "\n"
+        "  #include \"parallel_scan.glsl\"\n"
+        "#define USE_SUBGROUPS\n"
+        "#include \"scan_blocks.glsl\"");
+
+    EXPECT_EQ(includes, (std::vector<std::string>{"parallel_scan.glsl",
+                                                  "scan_blocks.glsl"}));
+}
+
+TEST(ShaderWatcherTest, IgnoresOtherDirectives) {
+    EXPECT_TRUE(braque::ParseShaderIncludes(
+                    "#version 450\n// #include in a comment line\n"
+                    "#include <system.glsl>\n")
+                    .empty());
+}
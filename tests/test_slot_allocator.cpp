@@ -0,0 +1,31 @@
+// tests/test_slot_allocator.cpp
+#include "gtest/gtest.h"
+#include "braque/slot_allocator.h"
+
+TEST(SlotAllocatorTest, AllocatesUntilFull) {
+    braque::SlotAllocator slots(3, 2);
+
+    EXPECT_EQ(slots.Allocate(), 0U);
+    EXPECT_EQ(slots.Allocate(), 1U);
+    EXPECT_EQ(slots.Allocate(), 2U);
+    EXPECT_FALSE(slots.Allocate().has_value());
+    EXPECT_EQ(slots.GetUsedCount(), 3U);
+}
+
+TEST(SlotAllocatorTest, ReleasedSlotsWaitForFramesInFlight) {
+    braque::SlotAllocator slots(2, 2);
+    const auto first = slots.Allocate();
+    ASSERT_TRUE(slots.Allocate().has_value());
+
+    slots.Release(*first);
+    EXPECT_EQ(slots.GetUsedCount(), 1U);
+    EXPECT_FALSE(slots.Allocate().has_value());
+
+    // a frame still in flight may read the released slot
+    slots.NextFrame();
+    EXPECT_FALSE(slots.Allocate().has_value());
+
+    slots.NextFrame();
+    EXPECT_EQ(slots.Allocate(), first);
+    EXPECT_FALSE(slots.Allocate().has_value());
+}
@@ -0,0 +1,94 @@
+// tests/test_sphere_bounds.cpp
+#include "gtest/gtest.h"
+#include "braque/job_system.h"
+#include "braque/sphere_bounds.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <random>
+
+namespace {
+
+auto MakeFrustum() -> braque::Frustum {
+    const auto view = glm::lookAt(glm::vec3(0, 0, 0), glm::vec3(0, 0, -1),
+                                  glm::vec3(0, 1, 0));
+    const auto proj =
+        glm::perspective(glm::radians(90.0F), 1.0F, 0.1F, 100.0F);
+    return braque::ExtractFrustum(proj * view);
+}
+
+// spheres scattered around the camera, about half of them visible
+auto MakeBounds(size_t count) -> braque::SphereBounds {
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> position(-150.0F, 150.0F);
+    std::uniform_real_distribution<float> radius(0.1F, 5.0F);
+
+    braque::SphereBounds bounds;
+    bounds.Resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        bounds.Set(i, glm::vec3(position(rng), position(rng), position(rng)),
+                   radius(rng));
+    }
+    return bounds;
+}
+
+}  // namespace
+
+TEST(SphereBoundsTest, MatchesSingleSphereTest) {
+    const auto frustum = MakeFrustum();
+
+    braque::SphereBounds bounds;
+    bounds.Resize(3);
+    bounds.Set(0, glm::vec3(0, 0, -10), 1.0F);
+    bounds.Set(1, glm::vec3(0, 0, 10), 1.0F);
+    bounds.Set(2, glm::vec3(10.5, 0, -10), 1.0F);
+
+    std::vector<uint8_t> visible(bounds.Size());
+    braque::CullSpheres(frustum, bounds, visible);
+
+    EXPECT_EQ(visible[0], 1);
+    EXPECT_EQ(visible[1], 0);
+    EXPECT_EQ(visible[2], 1);
+}
+
+TEST(SphereBoundsTest, VectorKernelMatchesScalar) {
+    const auto frustum = MakeFrustum();
+    // not a multiple of the lane count so the tail is covered too
+    const auto bounds = MakeBounds(1003);
+
+    std::vector<uint8_t> expected(bounds.Size());
+    std::vector<uint8_t> visible(bounds.Size());
+    braque::CullSpheresScalar(frustum, bounds, expected);
+    braque::CullSpheres(frustum, bounds, visible);
+
+    EXPECT_EQ(visible, expected);
+}
+
+TEST(SphereBoundsTest, ParallelMatchesScalar) {
+    const auto frustum = MakeFrustum();
+    const auto bounds = MakeBounds(braque::kParallelCullThreshold * 3 + 5);
+
+    std::vector<uint8_t> expected(bounds.Size());
+    std::vector<uint8_t> visible(bounds.Size());
+    braque::CullSpheresScalar(frustum, bounds, expected);
+
+    braque::JobSystem jobs(3);
+    braque::CullSpheres(jobs, frustum, bounds, visible);
+
+    EXPECT_EQ(visible, expected);
+}
+
+TEST(JobSystemTest, ParallelForCoversEveryIndexOnce) {
+    braque::JobSystem jobs(4);
+    std::vector<int> hits(10007, 0);
+
+    jobs.ParallelFor(hits.size(), 64, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            hits[i]++;
+        }
+    });
+
+    for (const auto hit : hits) {
+        EXPECT_EQ(hit, 1);
+    }
+}
@@ -0,0 +1,56 @@
+// tests/test_vertex_format.cpp
+#include "gtest/gtest.h"
+#include "braque/vertex_format.h"
+
+TEST(VertexFormatTest, OctahedralRoundTrip) {
+    const std::array normals = {
+        glm::vec3(0, 0, 1),  glm::vec3(0, 0, -1), glm::vec3(1, 0, 0),
+        glm::vec3(0, -1, 0), glm::normalize(glm::vec3(1, -2, -3))};
+
+    for (const auto& normal : normals) {
+        const auto decoded =
+            braque::DecodeOctahedral(braque::EncodeOctahedral(normal));
+        EXPECT_NEAR(glm::dot(normal, decoded), 1.0F, 1e-5F);
+    }
+}
+
+TEST(VertexFormatTest, CompactLayoutIsSmaller) {
+    EXPECT_EQ(braque::GetVertexStride(braque::VertexLayout::eFull), 44U);
+    EXPECT_EQ(braque::GetVertexStride(braque::VertexLayout::eQuantized), 20U);
+
+    const auto description =
+        braque::GetVertexInputDescription(braque::VertexLayout::eQuantized);
+    EXPECT_EQ(description.bindings.size(), 3U);
+    EXPECT_EQ(description.attributes.size(), 4U);
+}
+
+TEST(VertexFormatTest, PositionOnlyStream) {
+    EXPECT_EQ(braque::GetVertexStride(braque::VertexLayout::eFull,
+                                      braque::kPositionStreamOnly),
+              12U);
+
+    const auto description = braque::GetVertexInputDescription(
+        braque::VertexLayout::eFull, braque::kPositionStreamOnly);
+    ASSERT_EQ(description.bindings.size(), 1U);
+    ASSERT_EQ(description.attributes.size(), 1U);
+    EXPECT_EQ(description.bindings[0].binding, 0U);
+    EXPECT_EQ(description.attributes[0].location, 0U);
+}
+
+TEST(VertexFormatTest, QuantizedPositionsUseMeshBounds) {
+    const std::vector<braque::Vertex> vertices = {
+        {{-1, 2, 0}, {0, 0, 1}, {1, 0, 0}, {0, 0}},
+        {{3, 4, 0}, {0, 0, 1}, {0, 1, 0}, {1, 1}}};
+
+    const auto packed =
+        braque::PackVertices(vertices, braque::VertexLayout::eQuantized);
+
+    const auto& positions = packed.streams[static_cast<size_t>(
+        braque::VertexStream::ePosition)];
+    EXPECT_EQ(positions.size(), 2 * sizeof(braque::CompactPosition));
+    EXPECT_FLOAT_EQ(packed.position_offset.x, -1.0F);
+    EXPECT_FLOAT_EQ(packed.position_scale.x, 4.0F);
+    EXPECT_FLOAT_EQ(packed.position_scale.y, 2.0F);
+    // flat axis must not produce a zero scale
+    EXPECT_FLOAT_EQ(packed.position_scale.z, 1.0F);
+}